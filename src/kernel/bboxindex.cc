@@ -0,0 +1,211 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+
+#include "kernel/static.h"
+#include "kernel/bboxindex.h"
+
+#include <math.h>
+
+//=====================================================================================
+namespace pdfobjects {
+//=====================================================================================
+
+namespace {
+
+	/** Checks whether coordinate is usable for indexing. */
+	inline bool
+	isFiniteCoordinate (libs::Coordinate c)
+	{
+		return (c == c) 
+			&& (c < libs::COORDINATE_INVALID) 
+			&& (c > -libs::COORDINATE_INVALID);
+	}
+
+	/** Maximum portion of cells covered by a rectangle stored in cells. */
+	const size_t LARGE_RECTANGLE_RATIO = 4;
+
+} // namespace
+
+BBoxIndex::BBoxIndex ()
+	: columns (0), rows (0), xmin (0), ymin (0), cellWidth (1), cellHeight (1), stamp (0)
+{
+}
+
+void
+BBoxIndex::clear ()
+{
+	boxes.clear ();
+	cells.clear ();
+	large.clear ();
+	stamps.clear ();
+	columns = rows = 0;
+	stamp = 0;
+}
+
+size_t
+BBoxIndex::column (Coordinate x) const
+{
+	Coordinate c = floor ((x - xmin) / cellWidth);
+	// also NaN
+	if (!(c > 0))
+		return 0;
+	if (c >= columns)
+		return columns - 1;
+	return static_cast<size_t> (c);
+}
+
+size_t
+BBoxIndex::row (Coordinate y) const
+{
+	Coordinate r = floor ((y - ymin) / cellHeight);
+	// also NaN
+	if (!(r > 0))
+		return 0;
+	if (r >= rows)
+		return rows - 1;
+	return static_cast<size_t> (r);
+}
+
+void
+BBoxIndex::build (const std::vector<Rectangle>& rects)
+{
+	clear ();
+	boxes.resize (rects.size());
+	stamps.resize (rects.size(), 0);
+
+	// normalize rectangles and get covered area
+	Coordinate xmax = 0, ymax = 0;
+	size_t valid = 0;
+	for (size_t i = 0; i < rects.size(); ++i)
+	{
+		const Rectangle& rc = rects[i];
+		Box& box = boxes[i];
+		if (!Rectangle::isInitialized (rc) 
+				|| !isFiniteCoordinate (rc.xleft) || !isFiniteCoordinate (rc.xright)
+				|| !isFiniteCoordinate (rc.yleft) || !isFiniteCoordinate (rc.yright))
+		{
+			// empty box never intersects anything
+			box.xmin = box.ymin = 1;
+			box.xmax = box.ymax = 0;
+			continue;
+		}
+		box.xmin = std::min (rc.xleft, rc.xright);
+		box.xmax = std::max (rc.xleft, rc.xright);
+		box.ymin = std::min (rc.yleft, rc.yright);
+		box.ymax = std::max (rc.yleft, rc.yright);
+		if (!valid++)
+		{
+			xmin = box.xmin; xmax = box.xmax;
+			ymin = box.ymin; ymax = box.ymax;
+		}else
+		{
+			xmin = std::min (xmin, box.xmin); xmax = std::max (xmax, box.xmax);
+			ymin = std::min (ymin, box.ymin); ymax = std::max (ymax, box.ymax);
+		}
+	}
+	if (!valid)
+		return;
+
+	// roughly one rectangle per cell
+	size_t side = static_cast<size_t> (ceil (sqrt (static_cast<double> (valid))));
+	side = std::max (static_cast<size_t> (1), std::min (side, static_cast<size_t> (MAX_GRID_SIZE)));
+	columns = (xmax > xmin) ? side : 1;
+	rows = (ymax > ymin) ? side : 1;
+	cellWidth = (xmax > xmin) ? (xmax - xmin) / columns : 1;
+	cellHeight = (ymax > ymin) ? (ymax - ymin) / rows : 1;
+	cells.resize (columns * rows);
+
+	size_t largeCells = std::max (static_cast<size_t> (1), (columns * rows) / LARGE_RECTANGLE_RATIO);
+	for (size_t i = 0; i < boxes.size(); ++i)
+	{
+		const Box& box = boxes[i];
+		if (box.xmin > box.xmax)
+			continue;
+		size_t c1 = column (box.xmin), c2 = column (box.xmax);
+		size_t r1 = row (box.ymin), r2 = row (box.ymax);
+		if (1 < largeCells && (c2 - c1 + 1) * (r2 - r1 + 1) > largeCells)
+		{
+			large.push_back (i);
+			continue;
+		}
+		for (size_t r = r1; r <= r2; ++r)
+			for (size_t c = c1; c <= c2; ++c)
+				cells[r * columns + c].push_back (i);
+	}
+}
+
+void
+BBoxIndex::query (const Rectangle& rc, std::vector<size_t>& result) const
+{
+	result.clear ();
+	if (cells.empty())
+		return;
+
+	Box area;
+	area.xmin = std::min (rc.xleft, rc.xright);
+	area.xmax = std::max (rc.xleft, rc.xright);
+	area.ymin = std::min (rc.yleft, rc.yright);
+	area.ymax = std::max (rc.yleft, rc.yright);
+	
+	// each rectangle is reported once even if it is in more cells
+	if (!++stamp)
+	{
+		std::fill (stamps.begin(), stamps.end(), 0);
+		stamp = 1;
+	}
+	
+	size_t c1 = column (area.xmin), c2 = column (area.xmax);
+	size_t r1 = row (area.ymin), r2 = row (area.ymax);
+	for (size_t r = r1; r <= r2; ++r)
+	{
+		for (size_t c = c1; c <= c2; ++c)
+		{
+			const std::vector<size_t>& cell = cells[r * columns + c];
+			for (std::vector<size_t>::const_iterator i = cell.begin(); i != cell.end(); ++i)
+			{
+				if (stamp == stamps[*i])
+					continue;
+				stamps[*i] = stamp;
+				const Box& box = boxes[*i];
+				if (box.xmin <= area.xmax && area.xmin <= box.xmax 
+						&& box.ymin <= area.ymax && area.ymin <= box.ymax)
+					result.push_back (*i);
+			}
+		}
+	}
+	for (std::vector<size_t>::const_iterator i = large.begin(); i != large.end(); ++i)
+	{
+		const Box& box = boxes[*i];
+		if (box.xmin <= area.xmax && area.xmin <= box.xmax 
+				&& box.ymin <= area.ymax && area.ymin <= box.ymax)
+			result.push_back (*i);
+	}
+
+	std::sort (result.begin(), result.end());
+}
+
+//=====================================================================================
+} // namespace pdfobjects
+//=====================================================================================
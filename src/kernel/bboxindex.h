@@ -0,0 +1,129 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+#ifndef _BBOXINDEX_H_
+#define _BBOXINDEX_H_
+
+#include "kernel/static.h"
+
+//=====================================================================================
+namespace pdfobjects {
+//=====================================================================================
+
+/**
+ * Spatial index of rectangles.
+ *
+ * Rectangles (typically bounding boxes of pdf operators) are identified by
+ * their position in the container given to build method. Index is a uniform
+ * grid over the area covered by all rectangles. Each cell holds rectangles
+ * which intersect it, so a query has to check only rectangles from cells
+ * covered by the queried area. Rectangles covering a large part of the area
+ * are kept aside and checked by each query.
+ * <br>
+ * Index is static, it has to be built again if rectangles change.
+ */
+class BBoxIndex
+{
+public:
+	typedef libs::Rectangle Rectangle;
+	typedef libs::Coordinate Coordinate;
+
+	/** Maximum number of grid cells in one dimension. */
+	static const size_t MAX_GRID_SIZE = 256;
+
+private:
+	/** Normalized rectangle. */
+	struct Box
+	{
+		Coordinate xmin, ymin, xmax, ymax;
+	};
+
+	/** Normalized indexed rectangles. */
+	std::vector<Box> boxes;
+
+	/** Grid cells (row major) with positions of intersecting rectangles. */
+	std::vector<std::vector<size_t> > cells;
+
+	/** Positions of rectangles covering too many cells. */
+	std::vector<size_t> large;
+
+	/** Grid dimensions. */
+	size_t columns, rows;
+
+	/** Grid origin and cell size. */
+	Coordinate xmin, ymin, cellWidth, cellHeight;
+
+	/** Query stamps for duplicate elimination. */
+	mutable std::vector<size_t> stamps;
+
+	/** Stamp of the last query. */
+	mutable size_t stamp;
+
+	/** Gets column of x coordinate (clamped to the grid). */
+	size_t column (Coordinate x) const;
+
+	/** Gets row of y coordinate (clamped to the grid). */
+	size_t row (Coordinate y) const;
+
+public:
+	/** Creates empty index. */
+	BBoxIndex ();
+
+	/** Removes all rectangles. */
+	void clear ();
+
+	/**
+	 * Builds index for given rectangles.
+	 *
+	 * Uninitialized rectangles (see Rectangle::isInitialized) and rectangles 
+	 * with non finite coordinates are never returned by queries.
+	 *
+	 * @param rects Rectangles to index.
+	 */
+	void build (const std::vector<Rectangle>& rects);
+
+	/**
+	 * Returns number of indexed rectangles.
+	 */
+	size_t size () const
+		{ return boxes.size(); }
+
+	/**
+	 * Finds all rectangles intersecting given one.
+	 *
+	 * Rectangles touching the area are considered intersecting, as by 
+	 * libs::rectangle_intersect.
+	 *
+	 * @param rc Queried area.
+	 * @param result Output container with positions of found rectangles in
+	 * ascending order.
+	 */
+	void query (const Rectangle& rc, std::vector<size_t>& result) const;
+};
+
+//=====================================================================================
+} // namespace pdfobjects
+//=====================================================================================
+
+#endif // _BBOXINDEX_H_
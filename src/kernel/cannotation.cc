@@ -29,6 +29,7 @@
 #include"kernel/cobjecthelpers.h"
 #include"utils/debug.h"
 #include"kernel/factories.h"
+#include"os/threads.h"
 
 using namespace boost;
 using namespace std;
@@ -37,6 +38,15 @@ namespace pdfobjects {
 
 namespace utils {
 
+namespace {
+
+/** Lock for lazy initialization of annotTypeMapping.
+ * Pages of different documents may be processed by different threads.
+ */
+os::Mutex annotMappingLock;
+
+} // namespace
+
 /** Returns CAnnotation enumeration type for given name.
  * @param typeName String representation of type (value of Subtype field from
  * annotation dictionary).
@@ -52,6 +62,7 @@ CAnnotation::AnnotType annotTypeMapping(const std::string & typeName)
 using namespace std;
 	
 	typedef map<string, CAnnotation::AnnotType> AnnotMapping;
+	os::ScopedLock lock(annotMappingLock);
 	// mapping
 	static AnnotMapping annotMapping;
 	
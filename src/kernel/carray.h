@@ -62,6 +62,8 @@ namespace pdfobjects {
  */
 class CArray : noncopyable, public IProperty
 {
+	friend class CStreamsLexer;
+
 public:
 	typedef std::vector<boost::shared_ptr<IProperty> > Value; 
 	typedef const std::string&		 				 WriteType; 
@@ -32,7 +32,7 @@
 #include "kernel/pdfoperators.h"
 #include "kernel/stateupdater.h"
 #include "kernel/cobject.h"
-#include "kernel/cstreamsxpdfreader.h"
+#include "kernel/cstreamslexer.h"
 #include "kernel/cinlineimage.h"
 #include "kernel/contentschangetag.h"
 #include "kernel/pdfoperatorsiter.h"
@@ -40,6 +40,8 @@
 //fabs
 #include <math.h>
 
+#include <bitset>
+
 //==========================================================
 namespace pdfobjects {
 //==========================================================
@@ -61,7 +63,7 @@ namespace {
 	 *
 	 * This is vital when operands are changed.
 	 *
-	 * @param first First operator to set pdf to.
+	 * @param first First operator to set pdf to (with all its children).
 	 * @param pdf Valid pdf where operands belong.
 	 * @param rf  Valid Indiref of a cstream parent.
 	 * @param cs Content stream where the operator is.
@@ -75,6 +77,7 @@ namespace {
 					boost::shared_ptr<IPropertyObserver> observer)
 	{
 		utilsPrintDbg (DBG_DBG, "");
+		boost::shared_ptr<PdfOperator> last = getLastOperator (first);
 		CContentStream::OperatorIterator it = PdfOperator::getIterator (first);
 		while (!it.isEnd())
 		{
@@ -88,6 +91,8 @@ namespace {
 			if (0 < it.getCurrent()->getParametersCount())
 				it.getCurrent()->init_operands (observer, pdf, &rf);
 			
+			if (it.getCurrent() == last)
+				break;
 			it = it.next ();
 		}
 	}
@@ -106,139 +111,99 @@ namespace {
 	 * @return CStream representing inline image.
 	 */
 	CInlineImage*
-	getInlineImage (CStreamsXpdfReader<CContentStream::CStreams>& streamreader) 
+	getInlineImage (CStreamsLexer& streamreader) 
 	{
 		kernelPrintDbg (DBG_DBG, "");
-		::Object dict;
-		dict.initDict ((XRef*)NULL); // We do not have (need) valid xref, but be CAREFUL
-
-		// Get first object
-		boost::shared_ptr< ::Object> o(XPdfObjectFactory::getInstance(), xpdf::object_deleter());
-		streamreader.getXpdfObject (*o);
+		CDict dict;
 
 		//
 		// Get the inline image dictionary
 		// 
-		while (!streamreader.eof() && !o->isCmd("ID")) 
+		boost::shared_ptr<IProperty> o;
+		string cmd;
+		CStreamsLexer::ObjectKind kind;
+		while (CStreamsLexer::End != (kind = streamreader.getObject (o, cmd)))
 		{
-			if (o->isName())
+			if (CStreamsLexer::Operator == kind)
 			{
-				char* key = ::copyString (o->getName());
-				streamreader.getXpdfObject (*o);
-				if (streamreader.eof()) 
+				if ("ID" == cmd)
+					break;
+				continue;
+			}
+			
+			if (isName (o))
+			{
+				string key;
+				IProperty::getSmartCObjectPtr<CName>(o)->getValue (key);
+				if (CStreamsLexer::Operand != streamreader.getObject (o, cmd))
 				{
-					gfree (key);
 					assert (!"Bad inline image.");
 					throw CObjInvalidObject ();
 				}
-				dict.dictAdd (key, o.get());
-			
+				dict.addProperty (key, *o);
 			}
-			
-			streamreader.getXpdfObject (*o);
 		}
 
 		// Bad content stream
-		if (streamreader.eof())
+		if (CStreamsLexer::End == kind)
 		{
 			utilsPrintDbg (debug::DBG_ERR, "Content stream is damaged...");
 			return NULL;
 		}
 	
-		// 
-		// Make stream
-		// 
-		boost::scoped_ptr<Stream> str (new ::EmbedStream (streamreader.getXpdfStream (), &dict, gFalse, 0));
-		str->reset();
-		if (str)
-		{
-			// Copy chars to buf and with this buffer initialize CInlineImage
-			CStream::Buffer buf;
-			
-			int c1, c2;
-			c1 = str->getBaseStream()->getChar();
-			c2 = str->getBaseStream()->getChar();
-			buf.push_back (c1);
-			buf.push_back (c2);
-			while (!('E' == c1 && 'I' == c2) && EOF != c2) 
-			{
-				c1 = c2;
-				c2 = str->getBaseStream()->getChar();
-				buf.push_back (c2);
-			}
-			// Pop EI
-			buf.pop_back ();
-			buf.pop_back ();
-			return new CInlineImage (dict, buf);
-			// dict will get deallocated when str gets deallocated
-				
-		}else
-		{
-			assert (!"Bad embedded stream.");
-			throw CObjInvalidObject ();
-		}
+		// Image data are directly after ID
+		CStream::Buffer buf;
+		streamreader.getInlineImageData (buf);
+		return new CInlineImage (dict, buf);
 	}
 
 	/**
 	 * Create simple operator and its operands.
 	 *
+	 * @param streamreader CStreams parser.
+	 * @param operands Output operands.
+	 * @param cmd Output operator name.
+	 *
 	 * @return True if everything ok, false if end of stream reached.
 	 */
 	bool
-	createOperandsFromStream (CStreamsXpdfReader<CContentStream::CStreams>& streamreader, 
+	createOperandsFromStream (CStreamsLexer& streamreader, 
 					PdfOperator::Operands& operands,
-					boost::shared_ptr< ::Object>& o)
+					std::string& cmd)
 	{
-		// Get first object
-		streamreader.getXpdfObject (*o);
-
 		//
-		// Loop through all object, if it is an operator create pdfoperator else assume it is an operand
+		// Loop through all object, if it is an operator we are done else it is an operand
 		//
-		while (!streamreader.eof()) 
-		{
-			if (o->isCmd ())
-			{// We have an OPERATOR
-				return true;
-			
-			}else 
-			{// We have an OPERAND
-				
-				boost::shared_ptr<IProperty> pIp (createObjFromXpdfObj (*o));
-				operands.push_back (pIp);
-			}
-
-			o->free ();
-			// Grab the next object
-			streamreader.getXpdfObject (*o);
-
-		} // while
+		boost::shared_ptr<IProperty> operand;
+		CStreamsLexer::ObjectKind kind;
+		while (CStreamsLexer::Operand == (kind = streamreader.getObject (operand, cmd)))
+			operands.push_back (operand);
 		
-		return false;
+		return CStreamsLexer::Operator == kind;
 	}
 	
 	/**
-	 * Create operator from xpdf object.
+	 * Create operator from the stream.
 	 *
-	 * @param streamreader CStreams parser from which we get an xpdf object.
+	 * @param streamreader CStreams parser.
 	 * @param operands Operands of operator. They are shared through subcalls.
 	 */
 	boost::shared_ptr<PdfOperator>
-	createOperatorFromStream (CStreamsXpdfReader<CContentStream::CStreams>& streamreader, 
+	createOperatorFromStream (CStreamsLexer& streamreader, 
 					PdfOperator::Operands& operands)
 	{
 		// Get operands
-		boost::shared_ptr< ::Object> o(XPdfObjectFactory::getInstance(), xpdf::object_deleter());
-		if (!createOperandsFromStream (streamreader, operands, o))
+		string cmd;
+		if (!createOperandsFromStream (streamreader, operands, cmd))
 			return boost::shared_ptr<PdfOperator> ();
 		
 		//
 		// SPECIAL CASE for inline image (stream within a text stream)
 		//
-		if ( 0 == strncmp (o->getCmd(), "BI", 2))
+		if ("BI" == cmd)
 		{
 			utilsPrintDbg (debug::DBG_DBG, "");
-			const StateUpdater::CheckTypes* chcktp = StateUpdater::findOp (o->getCmd());
+			const StateUpdater::CheckTypes* chcktp = StateUpdater::findOp (cmd.c_str());
 			assert(chcktp);
 			if (!checkAndFixOperator (*chcktp, operands))
 			{
@@ -247,12 +212,11 @@ namespace {
 			}
 			
 			boost::shared_ptr<CInlineImage> inimg (getInlineImage (streamreader));
-			return boost::shared_ptr<PdfOperator> (new InlineImageCompositePdfOperator (inimg, chcktp->name, chcktp->endTag));
+			return createPooledOperator<PdfOperator> (new InlineImageCompositePdfOperator (inimg, chcktp->name, chcktp->endTag));
 		}
 
 		// factory function for all other operators
-		std::string name = o->getCmd();
-		return createOperator(name, operands);
+		return createOperator(cmd, operands);
 	}
 	
 	/**
@@ -264,13 +228,13 @@ namespace {
 	 * This function is called recursively to create the tree like structure of
 	 * pdf operators
 	 *
-	 * @param streamreader CStreams parser from which we get an xpdf object.
+	 * @param streamreader CStreams parser.
 	 * @param operands Operands of operator. They are shared through subcalls.
 	 *
 	 * @return New pdf operator.
 	 */
 	boost::shared_ptr<PdfOperator>
-	parseOp (CStreamsXpdfReader<CContentStream::CStreams>& streamreader, PdfOperator::Operands& operands)
+	parseOp (CStreamsLexer& streamreader, PdfOperator::Operands& operands)
 	{
 		// Create operator with its operands
 		boost::shared_ptr<PdfOperator> result = createOperatorFromStream (streamreader, operands);
@@ -327,15 +291,11 @@ namespace {
 	 * 
 	 * @param operators Operator stack.
 	 * @param streams 	Streams to be parsed.
-	 * @param cs 		Content stream in which operators belong
-	 * @param observer 	Operand observer.
 	 * @param parsedstreams Streams that have been really parsed.
 	 */
 	void
 	parse (CContentStream::Operators& operators, 
 						CContentStream::CStreams& streams, 
-						CContentStream& cs,
-						boost::shared_ptr<IPropertyObserver> observer,
 						CContentStream::CStreams* parsedstreams = NULL)
 	{
 		// Clear operators
@@ -348,16 +308,13 @@ namespace {
 			if (!hasValidPdf (*it) || !hasValidRef (*it))
 				throw CObjInvalidObject ();
 		}
-		boost::weak_ptr<CPdf> pdf = streams.front()->getPdf ();
-		assert (pdf.lock());
-		IndiRef rf = streams.front()->getIndiRef ();
 
 		assert (!streams.empty());
-		CStreamsXpdfReader<CContentStream::CStreams> streamreader (streams);
+		CStreamsLexer streamreader (streams);
 		streamreader.open ();
 	
 		PdfOperator::Operands operands;
-		boost::shared_ptr<PdfOperator> topoperator (new UnknownCompositePdfOperator ("",""));	
+		boost::shared_ptr<PdfOperator> topoperator = createPooledOperator<PdfOperator> (new UnknownCompositePdfOperator ("",""));	
 		boost::shared_ptr<PdfOperator> newop, previousLast = topoperator;
 
 		//
@@ -374,12 +331,11 @@ namespace {
 				//
 				if (isPdfOp (*newop,ContentsChangeTag::CHANGE_TAG_NAME))
 				{	
-					PdfOperator::Operands ops;
-					newop->getParameters (ops);
+					const CompactOperands& ops = newop->getCompactParameters ();
 					if (!ops.empty())
 					{
 						try {
-							if (ContentsChangeTag::CHANGE_TAG_ID == getNameFromIProperty(ops.front()))
+							if (ContentsChangeTag::CHANGE_TAG_ID == ops.getName (0))
 								our_change = true;
 						}catch (ElementBadTypeException&)
 							{}
@@ -400,12 +356,13 @@ namespace {
 					// if we want to do something with all operators (xml
 					// output) we have a problem
 
-                    if (our_change)
-                        break;
-                        boost::shared_ptr< ::Object> o(XPdfObjectFactory::getInstance(), xpdf::object_deleter());
-                        streamreader.lookXpdfObject (*o);
-                        if (o->isName (ContentsChangeTag::CHANGE_TAG_ID))
-                        break;
+					if (our_change)
+						break;
+					boost::shared_ptr<IProperty> next;
+					string cmd;
+					if (CStreamsLexer::Operand == streamreader.lookObject (next, cmd) && isName (next)
+							&& ContentsChangeTag::CHANGE_TAG_ID == getNameFromIProperty (next))
+						break;
 				}
 			}
 
@@ -447,10 +404,6 @@ namespace {
 		}
 
 			assert (operands.empty());
-			assert (observer);
-		// Set pdf ref and cs
-		if (!operators.empty())
-			opsSetPdfRefCs (operators.front(), pdf, rf, cs, observer);
 	}
 
 
@@ -478,6 +431,96 @@ namespace {
 		}
 	};
 
+	/**
+	 * Checks whether an operator keeps graphical state of following operators.
+	 *
+	 * This is true for balanced q/Q blocks because Q restores everything
+	 * saved by q.
+	 *
+	 * @param oper Pdf operator.
+	 *
+	 * @return True if operator doesn't change graphical state.
+	 */
+	bool
+	isStateNeutral (boost::shared_ptr<PdfOperator> oper)
+	{
+		if (!isCompositeOp (oper) || !isPdfOp (oper, "q"))
+			return false;
+		return isPdfOp (getLastOperator (oper), "Q");
+	}
+
+	/**
+	 * Find first level operator containing given operator.
+	 *
+	 * @param operators First level operators.
+	 * @param oper Operator to look for.
+	 *
+	 * @return First level operator or NULL if not found.
+	 */
+	boost::shared_ptr<PdfOperator>
+	findFirstLevelOperator (const CContentStream::Operators& operators, const PdfOperator* oper)
+	{
+		for (CContentStream::Operators::const_iterator top = operators.begin(); top != operators.end(); ++top)
+		{
+			boost::shared_ptr<PdfOperator> last = getLastOperator (*top);
+			for (CContentStream::OperatorIterator it = PdfOperator::getIterator (*top); !it.isEnd(); it.next())
+			{
+				if (it.getCurrent().get() == oper)
+					return *top;
+				if (it.getCurrent() == last)
+					break;
+			}
+		}
+		return boost::shared_ptr<PdfOperator> ();
+	}
+
+	/**
+	 * Replaces all occurrences of all texts in one pass.
+	 *
+	 * @param text Text.
+	 * @param replacements Texts to replace.
+	 * @param first First characters of texts to replace.
+	 * @param result Output text.
+	 *
+	 * @return True if anything has been replaced.
+	 */
+	bool
+	replaceTexts (const std::string& text, 
+				  const CContentStream::TextReplacements& replacements, 
+				  const std::bitset<256>& first,
+				  std::string& result)
+	{
+		typedef CContentStream::TextReplacements::const_iterator Iterator;
+		bool replaced = false;
+		result.clear ();
+		result.reserve (text.length());
+		size_t pos = 0;
+		while (pos < text.length())
+		{
+			unsigned char c = static_cast<unsigned char> (text[pos]);
+			Iterator best = replacements.end();
+			if (first[c])
+			{
+				// texts starting with the same character are adjacent
+				for (Iterator it = replacements.lower_bound (std::string (1, text[pos])); 
+						it != replacements.end() && it->first[0] == text[pos]; ++it)
+				{
+					if ((best == replacements.end() || best->first.length() < it->first.length())
+							&& 0 == text.compare (pos, it->first.length(), it->first))
+						best = it;
+				}
+			}
+			if (best == replacements.end())
+			{
+				result += text[pos++];
+				continue;
+			}
+			result += best->second;
+			pos += best->first.length();
+			replaced = true;
+		}
+		return replaced;
+	}
 	
 //==========================================================
 } // namespace
@@ -531,7 +574,7 @@ CContentStream::OperandObserver::notify (boost::shared_ptr<IProperty> newValue,
 										  boost::shared_ptr<const IProperty::ObserverContext>) const 
 throw ()
 {
-		if (_locked) 
+		if (!contentstream || contentstream->operandsLocked) 
 			return;
 
 	try {
@@ -545,8 +588,8 @@ throw ()
 			assert (hasValidRef (newValue));
 		}
 
-		// Stream has changed, reparse it
-		contentstream->saveChange ();
+		// Stream has changed, save it
+		contentstream->operandChanged (top.lock());
 		
 	}catch (ReadOnlyDocumentException&)
 	{
@@ -566,13 +609,13 @@ throw ()
 // Constructors
 //
 CContentStream::CContentStream (boost::shared_ptr<GfxState> state, 
-		boost::shared_ptr<GfxResources> res) : gfxstate (state), gfxres (res) {
+		boost::shared_ptr<GfxResources> res) : gfxstate (state), gfxres (res), operandsLocked (false), allDirty (false), bboxIndexDirty (true) {
 }
 
 CContentStream::CContentStream (CStreams& strs, 
 								boost::shared_ptr<GfxState> state, 
 								boost::shared_ptr<GfxResources> res) 
-	: gfxstate (state), gfxres (res)
+	: gfxstate (state), gfxres (res), operandsLocked (false), allDirty (false), bboxIndexDirty (true)
 {
 	kernelPrintDbg (DBG_DBG, "");
 	setStreams(strs);
@@ -602,15 +645,15 @@ void CContentStream::setStreams (CStreams& strs) {
 	
 	// Create cstream observer and register it on all operands
 	cstreamobserver = boost::shared_ptr<CStreamObserver> (new CStreamObserver (this));
-	// Create operand observer
-	operandobserver = boost::shared_ptr<OperandObserver> (new OperandObserver (this));
 	
 	// Parse it, move parsed streams from strs to cstreams
-	parse (operators, strs, *this, operandobserver, &cstreams);
+	releaseOperandObservers ();
+	parse (operators, strs, &cstreams);
+	initOperators ();
 	
 	// Save bounding boxes
-	if (!operators.empty()) 
-		StateUpdater::updatePdfOperators (PdfOperator::getIterator (operators.front()), gfxres, *gfxstate, BBoxUpdater());
+	allDirty = true;
+	updateBBoxes ();
 
 	// Register observer on all cstream
 	registerCStreamObservers ();
@@ -641,12 +684,380 @@ CContentStream::reparse (bool bboxOnly, boost::shared_ptr<GfxState> state, boost
 	{
 		// Clear operators	
 		operators.clear ();
-		parse (operators, cstreams, *this, operandobserver);
+		releaseOperandObservers ();
+		parse (operators, cstreams);
+		initOperators ();
 	}
 	
 	// Save bounding boxes
-	if (!operators.empty()) 
-		StateUpdater::updatePdfOperators (PdfOperator::getIterator (operators.front()), gfxres, *gfxstate, BBoxUpdater());
+	allDirty = true;
+	updateBBoxes ();
+}
+
+//
+//
+//
+void
+CContentStream::markDirty (boost::shared_ptr<PdfOperator> oper, bool stateChanged)
+{
+	bboxIndexDirty = true;
+	if (allDirty)
+		return;
+	
+	boost::shared_ptr<PdfOperator> top = findFirstLevelOperator (operators, oper.get());
+	if (!top)
+	{
+		kernelPrintDbg (debug::DBG_WARN, "Operator not found, all operators have to be updated.");
+		allDirty = true;
+		return;
+	}
+	markTopDirty (top, stateChanged);
+}
+
+//
+//
+//
+void
+CContentStream::markTopDirty (boost::shared_ptr<PdfOperator> top, bool stateChanged)
+{
+	bboxIndexDirty = true;
+	if (allDirty)
+		return;
+
+	// changes inside of balanced q/Q don't influence anything else
+	if (stateChanged && isStateNeutral (top))
+		stateChanged = false;
+	
+	bool& dirty = dirtyOperators[top];
+	dirty = dirty || stateChanged;
+}
+
+//
+//
+//
+void
+CContentStream::operandChanged (boost::shared_ptr<PdfOperator> top)
+{
+	if (top)
+		markTopDirty (top);
+	else
+		allDirty = true;
+
+	_objectChanged ();
+}
+
+//
+//
+//
+boost::shared_ptr<CContentStream::OperandObserver>
+CContentStream::getOperandObserver (boost::shared_ptr<PdfOperator> top)
+{
+	boost::shared_ptr<OperandObserver>& observer = operandobservers[top.get()];
+	if (!observer)
+		observer = boost::shared_ptr<OperandObserver> (new OperandObserver (this, top));
+	return observer;
+}
+
+//
+//
+//
+void
+CContentStream::releaseOperandObserver (const PdfOperator* top)
+{
+	OperandObservers::iterator it = operandobservers.find (top);
+	if (it == operandobservers.end())
+		return;
+	it->second->detach ();
+	operandobservers.erase (it);
+}
+
+//
+//
+//
+void
+CContentStream::releaseOperandObservers ()
+{
+	for (OperandObservers::iterator it = operandobservers.begin(); it != operandobservers.end(); ++it)
+		it->second->detach ();
+	operandobservers.clear ();
+}
+
+//
+//
+//
+void
+CContentStream::initOperator (boost::shared_ptr<PdfOperator> oper, boost::shared_ptr<PdfOperator> top)
+{
+	assert (!cstreams.empty());
+	assert (hasValidRef (cstreams.front()));
+	assert (hasValidPdf (cstreams.front()));
+	if (!top)
+		throw CObjInvalidObject ();
+
+	boost::weak_ptr<CPdf> pdf = cstreams.front()->getPdf();
+	assert (pdf.lock());
+	IndiRef rf = cstreams.front()->getIndiRef ();
+	opsSetPdfRefCs (oper, pdf, rf, *this, getOperandObserver (top));
+}
+
+//
+//
+//
+void
+CContentStream::initOperators ()
+{
+	for (Operators::iterator it = operators.begin(); it != operators.end(); ++it)
+		initOperator (*it, *it);
+}
+
+//
+//
+//
+CContentStream::OperatorIterator
+CContentStream::resumeReplay (boost::shared_ptr<PdfOperator> oper, Replay& replay) const
+{
+	assert (NULL == replay.state);
+	
+	// the nearest checkpoint is at most CHECKPOINT_INTERVAL operators back
+	for (OperatorIterator it = PdfOperator::getIterator (oper); !it.isBegin(); it.prev())
+	{
+		Checkpoints::const_iterator checkpoint = checkpoints.find (it.getCurrent().get());
+		if (checkpoint == checkpoints.end())
+			continue;
+		
+		replay.state = checkpoint->second.state->copy (true);
+		replay.openQs = checkpoint->second.openQs;
+		replay.missingSaves = replay.openQs.size();
+		return it;
+	}
+
+	// start from the beginning
+	assert (!gfxstate->isPath());
+	replay.state = gfxstate->copy (false);
+	assert (!operators.empty());
+	return PdfOperator::getIterator (operators.front());
+}
+
+//
+//
+//
+void
+CContentStream::replayOperator (Replay& replay, boost::shared_ptr<PdfOperator> oper, 
+								PdfOperator::BBox& rc, bool record)
+{
+	static const NameAtom qAtom = internName ("q");
+	static const NameAtom QAtom = internName ("Q");
+	NameAtom atom = oper->getOperatorAtom ();
+
+	if (record)
+	{
+		if (CHECKPOINT_INTERVAL <= replay.sinceCheckpoint)
+		{
+			Checkpoint& checkpoint = checkpoints[oper.get()];
+			checkpoint.oper = oper;
+			checkpoint.state = boost::shared_ptr<GfxState> (replay.state->copy (true));
+			checkpoint.openQs = replay.openQs;
+			replay.sinceCheckpoint = 0;
+		}else if (!checkpoints.empty())
+			checkpoints.erase (oper.get());
+	}
+
+	replay.state = StateUpdater::updatePdfOperator (replay.state, gfxres, oper, rc);
+	++replay.sinceCheckpoint;
+
+	if (qAtom == atom && isCompositeOp (oper))
+	{
+		replay.openQs.push_back (oper);
+	
+	}else if (QAtom == atom && !replay.openQs.empty())
+	{
+		// q was before the replay start, so the state saved by it has to be
+		// replayed from the checkpoint preceding the q
+		if (replay.missingSaves == replay.openQs.size())
+		{
+			GfxState* saved = replayStateBefore (replay.openQs.back());
+			delete replay.state;
+			replay.state = saved;
+			--replay.missingSaves;
+		}
+		replay.openQs.pop_back ();
+	}
+}
+
+//
+//
+//
+void
+CContentStream::removeCheckpoints (boost::shared_ptr<PdfOperator> oper)
+{
+	if (checkpoints.empty())
+		return;
+	
+	boost::shared_ptr<PdfOperator> last = getLastOperator (oper);
+	for (OperatorIterator it = PdfOperator::getIterator (oper); !it.isEnd(); it.next())
+	{
+		checkpoints.erase (it.getCurrent().get());
+		if (it.getCurrent() == last)
+			break;
+	}
+}
+
+//
+//
+//
+void
+CContentStream::getOperatorCandidates (const libs::Rectangle& rc, 
+		std::vector<boost::shared_ptr<PdfOperator> >& candidates) const
+{
+	candidates.clear ();
+	if (operators.empty())
+		return;
+
+	if (bboxIndexDirty)
+	{
+		kernelPrintDbg (debug::DBG_DBG, "Building spatial index.");
+		indexedOperators.clear ();
+		std::vector<libs::Rectangle> bboxes;
+		ChangeableOperatorIterator it = PdfOperator::getIterator<ChangeableOperatorIterator> (operators.front());
+		for (; !it.isEnd(); it.next())
+		{
+			indexedOperators.push_back (it.getCurrent());
+			bboxes.push_back (it.getCurrent()->getBBox());
+		}
+		bboxIndex.build (bboxes);
+		bboxIndexDirty = false;
+	}
+
+	std::vector<size_t> positions;
+	bboxIndex.query (rc, positions);
+	candidates.reserve (positions.size());
+	for (std::vector<size_t>::const_iterator i = positions.begin(); i != positions.end(); ++i)
+		candidates.push_back (indexedOperators[*i]);
+}
+
+//
+//
+//
+boost::shared_ptr<GfxState>
+CContentStream::getStateBefore (boost::shared_ptr<PdfOperator> oper)
+{
+	assert (gfxres);
+	assert (gfxstate);
+	
+	// checkpoints have to be up to date
+	updateBBoxes ();
+
+	return boost::shared_ptr<GfxState> (replayStateBefore (oper));
+}
+
+//
+//
+//
+GfxState*
+CContentStream::replayStateBefore (boost::shared_ptr<PdfOperator> oper)
+{
+	Replay replay;
+	PdfOperator::BBox rc;
+	for (OperatorIterator it = resumeReplay (oper, replay); !it.isEnd(); it.next())
+	{
+		if (it.getCurrent() == oper)
+			break;
+		replayOperator (replay, it.getCurrent(), rc, false);
+	}
+	
+	GfxState* result = replay.state;
+	replay.state = NULL;
+	return result;
+}
+
+//
+//
+//
+void
+CContentStream::updateBBoxes ()
+{
+	assert (gfxres);
+	assert (gfxstate);
+
+	if (operators.empty())
+	{
+		allDirty = false;
+		dirtyOperators.clear ();
+		checkpoints.clear ();
+		bboxIndexDirty = true;
+		return;
+	}
+	if (allDirty || !dirtyOperators.empty())
+		bboxIndexDirty = true;
+
+	BBoxUpdater ftor;
+	ftor (gfxres);
+	PdfOperator::BBox rc;
+	
+	if (allDirty)
+	{
+		allDirty = false;
+		dirtyOperators.clear ();
+		checkpoints.clear ();
+		
+		Replay replay;
+		for (OperatorIterator it = resumeReplay (operators.front(), replay); !it.isEnd(); it.next())
+		{
+			replayOperator (replay, it.getCurrent(), rc, true);
+			ftor (it.getCurrent(), rc, *replay.state);
+		}
+		return;
+	}
+
+	if (dirtyOperators.empty())
+		return;
+	
+	DirtyOperators dirty;
+	dirty.swap (dirtyOperators);
+	size_t remaining = dirty.size ();
+	kernelPrintDbg (debug::DBG_DBG, "Updating " << remaining << " changed operators.");
+	
+	// Find the first changed operator
+	Operators::const_iterator top = operators.begin();
+	while (top != operators.end() && dirty.end() == dirty.find (*top))
+		++top;
+	if (top == operators.end())
+		return;
+	
+	// Replay the state from the nearest checkpoint
+	Replay replay;
+	for (OperatorIterator it = resumeReplay (*top, replay); !it.isEnd(); it.next())
+	{
+		if (it.getCurrent() == *top)
+			break;
+		replayOperator (replay, it.getCurrent(), rc, false);
+	}
+
+	// Update changed operators (or till the end if the state of following
+	// operators could have changed)
+	bool stateChanged = false;
+	for (; top != operators.end(); ++top)
+	{
+		DirtyOperators::const_iterator d = dirty.find (*top);
+		bool update = stateChanged || (d != dirty.end());
+		if (d != dirty.end())
+			--remaining;
+		else if (!update && 0 == remaining)
+			break;
+
+		boost::shared_ptr<PdfOperator> last = getLastOperator (*top);
+		for (OperatorIterator it = PdfOperator::getIterator (*top); !it.isEnd(); it.next())
+		{
+			replayOperator (replay, it.getCurrent(), rc, update);
+			if (update)
+				ftor (it.getCurrent(), rc, *replay.state);
+			if (it.getCurrent() == last)
+				break;
+		}
+		
+		if (d != dirty.end() && d->second)
+			stateChanged = true;
+	}
 }
 
 //
@@ -655,34 +1066,52 @@ CContentStream::reparse (bool bboxOnly, boost::shared_ptr<GfxState> state, boost
 void 
 CContentStream::replaceText (const std::string& what, const std::string& with)
 {
-	bool dirty = false;
-		if (operators.empty())
-			return;
+	TextReplacements replacements;
+	replacements[what] = with;
+	replaceText (replacements);
+}
 
-	operandobserver->lock();
+//
+//
+//
+size_t
+CContentStream::replaceText (const TextReplacements& replacements)
+{
+	std::bitset<256> first;
+	for (TextReplacements::const_iterator it = replacements.begin(); it != replacements.end(); ++it)
+		if (!it->first.empty())
+			first[static_cast<unsigned char> (it->first[0])] = true;
+		if (operators.empty() || first.none())
+			return 0;
 
+	operandsLocked = true;
+
+	size_t changed = 0;
+	std::string text, replaced;
 	TextOperatorIterator tit = PdfOperator::getIterator<TextOperatorIterator> (operators.front());
 	while (!tit.isEnd())
 	{
 		// uff
 		boost::shared_ptr<TextSimpleOperator> _cur 
 				= boost::dynamic_pointer_cast<TextSimpleOperator, PdfOperator> (tit.getCurrent());
-		std::string tmp;
-		_cur->getFontText (tmp);
-		string replaced = boost::replace_all_copy (tmp, what, with);
-		if (tmp != replaced)
+		text.clear ();
+		_cur->getFontText (text);
+		if (replaceTexts (text, replacements, first, replaced))
 		{
-			dirty = true;
-			boost::shared_ptr<TextSimpleOperator> _cur 
-					= boost::dynamic_pointer_cast<TextSimpleOperator, PdfOperator> (tit.getCurrent());
+			++changed;
 			_cur->setFontText (replaced);
 		}
 		tit.next();
 	}
 
-	operandobserver->unlock();
-	if (dirty)
+	operandsLocked = false;
+	if (changed)
+	{
+			kernelPrintDbg (debug::DBG_DBG, "Replaced text in " << changed << " operators.");
+		allDirty = true;
 		_objectChanged();
+	}
+	return changed;
 }
 
 
@@ -740,8 +1169,8 @@ CContentStream::_objectChanged ()
 	// 
 	registerCStreamObservers ();
 	
-	// Update bboxes
-	reparse (true);
+	// Update bboxes of changed operators
+	updateBBoxes ();
 
 	// Notify observers
 	boost::shared_ptr<CContentStream> current (this, EmptyDeallocator<CContentStream> ());
@@ -770,6 +1199,8 @@ CContentStream::deleteOperator (OperatorIterator it, bool indicateChange)
 	
 	// Be sure that the operator won't get deallocated along the way
 	boost::shared_ptr<PdfOperator> toDel = it.getCurrent ();
+	removeCheckpoints (toDel);
+	bboxIndexDirty = true;
 	
 	//
 	// Remove it from operators or composite
@@ -784,8 +1215,10 @@ CContentStream::deleteOperator (OperatorIterator it, bool indicateChange)
 		assert (composite);
 		// Remove it from composite
 		if (composite)
+		{
+			markDirty (toDel);
 			composite->remove (toDel);
-		else
+		}else
 		{
 			//assert ("Want to delete a not existing operator.");
 			throw CObjInvalidObject ();
@@ -793,6 +1226,16 @@ CContentStream::deleteOperator (OperatorIterator it, bool indicateChange)
 	
 	}else
 	{
+		// Following operators are influenced by removed one
+		if (!allDirty && !isStateNeutral (toDel))
+		{
+			Operators::iterator operNext = operIt; ++operNext;
+			if (operNext != operators.end())
+				dirtyOperators[*operNext] = true;
+		}
+		dirtyOperators.erase (toDel);
+		releaseOperandObserver (toDel.get());
+		
 		// Remove it from operators
 		operators.erase (operIt);
 	}
@@ -857,19 +1300,12 @@ CContentStream::insertOperator (OperatorIterator it, boost::shared_ptr<PdfOperat
 	{
 		assert (!it.valid());
 		operators.push_back (newOper);
+		bboxIndexDirty = true;
 		return;
 	}
 	assert (!it.isEnd());
 	assert (!cstreams.empty());
 
-	// Set correct IndiRef, CPdf and cs to inserted operator
-	assert (hasValidRef (cstreams.front()));
-	assert (hasValidPdf (cstreams.front()));
-	boost::weak_ptr<CPdf> pdf = cstreams.front()->getPdf();
-	assert (pdf.lock());
-	IndiRef rf = cstreams.front()->getIndiRef ();
-	opsSetPdfRefCs (newOper, pdf, rf, *this, operandobserver);
-
 	//
 	// Insert into operators or composite
 	// 
@@ -883,8 +1319,11 @@ CContentStream::insertOperator (OperatorIterator it, boost::shared_ptr<PdfOperat
 		assert (composite);
 		// Insert it into composite
 		if (composite)
+		{
+			// Set correct IndiRef, CPdf and cs to inserted operator
+			initOperator (newOper, findFirstLevelOperator (operators, composite.get()));
 			composite->insert_after (it.getCurrent(), newOper);
-		else
+		}else
 		{
 			//assert ("Want to insert after not existing operator.");
 			throw CObjInvalidObject ();
@@ -892,6 +1331,8 @@ CContentStream::insertOperator (OperatorIterator it, boost::shared_ptr<PdfOperat
 	
 	}else
 	{
+		// Set correct IndiRef, CPdf and cs to inserted operator
+		initOperator (newOper, newOper);
 		// Insert it into operators
 		++operIt;
 		operators.insert (operIt, newOper);
@@ -916,6 +1357,8 @@ CContentStream::insertOperator (OperatorIterator it, boost::shared_ptr<PdfOperat
 		newOper->setNext (itNxt.getCurrent());
 	}
 
+	markDirty (newOper);
+
 	// If indicateChange is true, pdf&rf&contenstream is set when reparsing
 	if (indicateChange)
 	{
@@ -945,25 +1388,21 @@ CContentStream::frontInsertOperator (boost::shared_ptr<PdfOperator> newoper,
 
 	// Check whether we can make the change
 	cstreams.front()->canChange();
-	IndiRef rf = cstreams.front()->getIndiRef ();
-	boost::weak_ptr<CPdf> pdf = cstreams.front()->getPdf();
-	assert (pdf.lock());
 	// set accordingly	
-	opsSetPdfRefCs (newoper, pdf, rf, *this, operandobserver);
+	initOperator (newoper, newoper);
 
 	if (operators.empty ())
 	{ // Insert into empty contentstream
 		operators.push_back (newoper);
 	}else
 	{ // Insert into
-		opsSetPdfRefCs (newoper, pdf, rf, *this, operandobserver);
-
 		boost::shared_ptr<PdfOperator> secondoper = operators.front();
 		operators.push_front (newoper);
 		boost::shared_ptr<PdfOperator> lastofnew = getLastOperator (newoper);
 		secondoper->setPrev (lastofnew);
 		lastofnew->setNext (secondoper);
 	}
+	markDirty (newoper);
 
 	// If indicateChange is true, pdf&rf&contenstream is set when reparsing
 	if (indicateChange)
@@ -997,15 +1436,8 @@ CContentStream::replaceOperator (OperatorIterator it,
 
 	// Be sure that the operator won't get deallocated along the way
 	boost::shared_ptr<PdfOperator> toReplace = it.getCurrent ();
+	removeCheckpoints (toReplace);
 	
-	// Set correct IndiRef, CPdf and cs to inserted operator
-	assert (hasValidRef (cstreams.front()));
-	assert (hasValidPdf (cstreams.front()));
-	boost::weak_ptr<CPdf> pdf = cstreams.front()->getPdf();
-	assert (pdf.lock());
-	IndiRef rf = cstreams.front()->getIndiRef ();
-	opsSetPdfRefCs (newOper, pdf, rf, *this, operandobserver);
-
 	//
 	// Replace in operators or composite
 	// 
@@ -1020,6 +1452,8 @@ CContentStream::replaceOperator (OperatorIterator it,
 		// Replace it from composite
 		if (composite)
 		{
+			// Set correct IndiRef, CPdf and cs to inserted operator
+			initOperator (newOper, findFirstLevelOperator (operators, composite.get()));
 			composite->insert_after (toReplace, newOper);
 			composite->remove (toReplace);
 		
@@ -1031,8 +1465,12 @@ CContentStream::replaceOperator (OperatorIterator it,
 	
 	}else
 	{
+		// Set correct IndiRef, CPdf and cs to inserted operator
+		initOperator (newOper, newOper);
 		// Replace it from operators
 		std::replace (operators.begin(), operators.end(), *operIt, newOper);
+		dirtyOperators.erase (toReplace);
+		releaseOperandObserver (toReplace.get());
 	}
 
 	
@@ -1066,6 +1504,11 @@ CContentStream::replaceOperator (OperatorIterator it,
 	//
 	toReplace->setPrev (PdfOperator::ListItem());
 	getLastOperator(toReplace)->setNext (PdfOperator::ListItem());
+
+	markDirty (newOper);
+	// Following operators are influenced by replaced first level one
+	if (!allDirty && operIt != operators.end() && !isStateNeutral (toReplace))
+		dirtyOperators[newOper] = true;
 	
 	// If indicateChange is true, pdf&rf&contenstream is set when reparsing
 	if (indicateChange)
@@ -31,6 +31,7 @@
 
 #include "kernel/pdfoperatorsbase.h"
 #include "kernel/pdfoperatorsiter.h"
+#include "kernel/bboxindex.h"
 
 //==========================================================
 namespace pdfobjects {
@@ -96,6 +97,8 @@ public:
 	typedef std::list<boost::shared_ptr<CStream> > CStreams;
 	typedef PdfOperator::Iterator OperatorIterator;
 	typedef observer::BasicChangeContext<CContentStream> BasicObserverContext;
+	/** Text replacements (what -> with). */
+	typedef std::map<std::string, std::string> TextReplacements;
 	
 private:
 
@@ -153,14 +156,17 @@ private:
 	 * Operand stream observer.
 	 *
 	 * If an operand is changed, save the stream notifying all observers.
+	 * Each first level operator has its own observer registered on operands
+	 * of all its operators, so the changed operator is known without
+	 * searching the content stream.
 	 */
 	struct OperandObserver : public IPropertyObserver
 	{
 		//
 		// Constructor
 		//
-		OperandObserver (CContentStream* cc) : contentstream (cc), _locked(false)
-			{assert (cc);}
+		OperandObserver (CContentStream* cc, boost::shared_ptr<PdfOperator> op) : contentstream (cc), top (op)
+			{assert (cc); assert (op);}
 		//
 		// Observer interface
 		//
@@ -170,10 +176,8 @@ private:
 		//
 		//
 		//
-		/** lock notifying */
-		void lock() { _locked = true; }
-		/** unlock notifying */
-		void unlock() { _locked = false; }
+		/** Stop notifying, the operator is no longer in the content stream. */
+		void detach () { contentstream = NULL; }
 
 		//
 		// Destructor
@@ -182,13 +186,213 @@ private:
 
 	private:
 		CContentStream* contentstream;
-		bool _locked;
+		boost::weak_ptr<PdfOperator> top;
 	};
 
+	/** Type for operand observers keyed by their first level operators. */
+	typedef std::map<const PdfOperator*, boost::shared_ptr<OperandObserver> > OperandObservers;
+
 	/** Observer observing underlying cstreams. */
 	boost::shared_ptr<CStreamObserver> cstreamobserver;
-	/** Observer observing operands of all operators. */
-	boost::shared_ptr<OperandObserver> operandobserver;
+	/** Observers observing operands of first level operators. */
+	OperandObservers operandobservers;
+	/** If true, operand changes are not saved. */
+	bool operandsLocked;
+	friend struct OperandObserver;
+
+	/**
+	 * Returns operand observer of a first level operator, creates it if
+	 * needed.
+	 *
+	 * @param top First level operator.
+	 *
+	 * @return Operand observer.
+	 */
+	boost::shared_ptr<OperandObserver> getOperandObserver (boost::shared_ptr<PdfOperator> top);
+
+	/**
+	 * Detaches operand observer of an operator which is no longer a first
+	 * level operator of this content stream.
+	 *
+	 * @param top Removed first level operator.
+	 */
+	void releaseOperandObserver (const PdfOperator* top);
+
+	/** Detaches all operand observers. */
+	void releaseOperandObservers ();
+
+	/**
+	 * Sets pdf, indiref and content stream to operators and registers 
+	 * operand observers of their first level operators on their operands.
+	 *
+	 * @param oper Operator (with its children) to initialize.
+	 * @param top First level operator containing oper.
+	 */
+	void initOperator (boost::shared_ptr<PdfOperator> oper, boost::shared_ptr<PdfOperator> top);
+
+	/** Initializes all first level operators. */
+	void initOperators ();
+
+	//
+	// Incremental bounding box updates
+	//
+private:
+	/** Type for first level operators with outdated bounding boxes.
+	 * Value is true if the change can influence graphical state of all 
+	 * following operators too.
+	 */
+	typedef std::map<boost::shared_ptr<PdfOperator>, bool> DirtyOperators;
+
+	/** First level operators with outdated bounding boxes. */
+	DirtyOperators dirtyOperators;
+
+	/** If true, bounding boxes of all operators are outdated. */
+	bool allDirty;
+
+	//
+	// Spatial index
+	//
+private:
+	/** Spatial index of changeable operators bounding boxes. */
+	mutable BBoxIndex bboxIndex;
+
+	/** Changeable operators in the order of bboxIndex positions. */
+	mutable std::vector<boost::shared_ptr<PdfOperator> > indexedOperators;
+
+	/** If true, bboxIndex has to be built again before next query. */
+	mutable bool bboxIndexDirty;
+
+	/**
+	 * Finds changeable operators which bounding boxes can intersect given
+	 * rectangle.
+	 *
+	 * Spatial index is built if it is outdated.
+	 *
+	 * @param rc Rectangle.
+	 * @param candidates Output container with operators in content stream 
+	 * order.
+	 */
+	void getOperatorCandidates (const libs::Rectangle& rc, 
+			std::vector<boost::shared_ptr<PdfOperator> >& candidates) const;
+
+	//
+	// Graphical state checkpoints
+	//
+public:
+	/** Maximum number of operators between two checkpoints. */
+	static const size_t CHECKPOINT_INTERVAL = 64;
+
+private:
+	/**
+	 * Graphical state snapshot before an operator.
+	 *
+	 * Snapshot contains only the current state without states saved by
+	 * enclosing q operators. When a replay resumed from the snapshot 
+	 * reaches Q of such q, state before the q is replayed from the 
+	 * preceding checkpoint (see replayStateBefore).
+	 */
+	struct Checkpoint
+	{
+		/** Operator (kept so that its address is not reused). */
+		boost::shared_ptr<PdfOperator> oper;
+		/** Graphical state before the operator. */
+		boost::shared_ptr<GfxState> state;
+		/** Enclosing q operators (outermost first). */
+		PdfOperator::PdfOperators openQs;
+	};
+
+	/** Type for checkpoints indexed by operator. */
+	typedef std::map<const PdfOperator*, Checkpoint> Checkpoints;
+
+	/** Graphical state checkpoints.
+	 *
+	 * One checkpoint (full GfxState copy) is stored after each
+	 * CHECKPOINT_INTERVAL operators, so the memory is proportional to the
+	 * number of operators divided by the interval. They are created by 
+	 * updateBBoxes.
+	 */
+	Checkpoints checkpoints;
+
+	/** State of operators replay. */
+	struct Replay
+	{
+		/** Current graphical state (owned by replay). */
+		GfxState* state;
+		/** Enclosing q operators (outermost first). */
+		PdfOperator::PdfOperators openQs;
+		/** Number of outermost openQs without saved state in the state. */
+		size_t missingSaves;
+		/** Number of operators since the last checkpoint. */
+		size_t sinceCheckpoint;
+
+		Replay () : state (NULL), missingSaves (0), sinceCheckpoint (0) {}
+		~Replay () { delete state; }
+	private:
+		Replay (const Replay&);
+		Replay& operator= (const Replay&);
+	};
+
+	/**
+	 * Prepares replay which ends before given operator.
+	 *
+	 * Finds the nearest checkpoint before given operator (including
+	 * operator itself) and initializes replay from it. If there is no such
+	 * checkpoint, replay starts from the first operator with initial state.
+	 *
+	 * @param oper Operator.
+	 * @param replay Replay to initialize.
+	 *
+	 * @return Iterator of the first operator to replay.
+	 */
+	OperatorIterator resumeReplay (boost::shared_ptr<PdfOperator> oper, Replay& replay) const;
+
+	/**
+	 * Updates replayed graphical state by given operator.
+	 *
+	 * @param replay Replay state.
+	 * @param oper Operator.
+	 * @param rc Output bounding box of the operator.
+	 * @param record If true, checkpoint before the operator is stored if
+	 * needed (and an outdated one removed).
+	 */
+	void replayOperator (Replay& replay, boost::shared_ptr<PdfOperator> oper, 
+						 PdfOperator::BBox& rc, bool record);
+
+	/**
+	 * Replays graphical state before given operator.
+	 *
+	 * Replay starts from the nearest checkpoint, states saved by q operators
+	 * before this checkpoint are replayed recursively when needed.
+	 *
+	 * @param oper Operator.
+	 *
+	 * @return Graphical state owned by the caller.
+	 */
+	GfxState* replayStateBefore (boost::shared_ptr<PdfOperator> oper);
+
+	/**
+	 * Removes checkpoints of given operator and all its children.
+	 *
+	 * @param oper Operator.
+	 */
+	void removeCheckpoints (boost::shared_ptr<PdfOperator> oper);
+
+public:
+	/**
+	 * Get graphical state before given operator.
+	 *
+	 * State is replayed from the nearest checkpoint, so this takes about
+	 * CHECKPOINT_INTERVAL operator updates (plus one more interval for each
+	 * Q whose q precedes the checkpoint; pending changes are applied first).
+	 *
+	 * REMARK: Returned state doesn't contain states saved by enclosing q
+	 * operators.
+	 *
+	 * @param oper Operator of this content stream.
+	 *
+	 * @return Graphical state.
+	 */
+	boost::shared_ptr<GfxState> getStateBefore (boost::shared_ptr<PdfOperator> oper);
 
 	
 	//
@@ -332,11 +536,10 @@ public:
 		utilsPrintDbg (debug::DBG_DBG, "--- SELECTED THESE OPERATORS --- ");
 		for (typename OpContainer::const_iterator it = opContainer.begin (); it != opContainer.end(); ++it)
 		{
-			PdfOperator::Operands ops;
-			(*it)->getParameters (ops);
+			const CompactOperands& ops = (*it)->getCompactParameters ();
 			std::string strop;
 			if (0 < ops.size())
-				ops[0]->getStringRepresentation (strop);
+				ops.getStringRepresentation (0, strop);
 			std::string tmp;
 			(*it)->getOperatorName (tmp);
 			utilsPrintDbg (debug::DBG_DBG, tmp << "(" << strop << "): " << (*it)->getBBox());
@@ -345,6 +548,46 @@ public:
 		// 
 	}
 
+
+	/**
+	 * Get objects intersecting a rectangle.
+	 *
+	 * Same as the generic version but only operators found by the spatial
+	 * index are compared.
+	 *
+	 * @param opContainer Output container.
+	 * @param cmp Rectangle comparator.
+	 */
+	template<typename OpContainer>
+	void getOperatorsAtPosition (OpContainer& opContainer, const PdfOpCmpRc& cmp) const
+	{
+		std::vector<boost::shared_ptr<PdfOperator> > candidates;
+		getOperatorCandidates (cmp.getRectangle(), candidates);
+		for (std::vector<boost::shared_ptr<PdfOperator> >::const_iterator it = candidates.begin(); it != candidates.end(); ++it)
+			if (cmp((*it)->getBBox()))
+				opContainer.push_back (*it);
+	}
+
+	/**
+	 * Get objects containing a point.
+	 *
+	 * Same as the generic version but only operators found by the spatial
+	 * index are compared.
+	 *
+	 * @param opContainer Output container.
+	 * @param cmp Point comparator.
+	 */
+	template<typename OpContainer>
+	void getOperatorsAtPosition (OpContainer& opContainer, const PdfOpCmpPt& cmp) const
+	{
+		const Point& pt = cmp.getPoint ();
+		std::vector<boost::shared_ptr<PdfOperator> > candidates;
+		getOperatorCandidates (libs::Rectangle (pt.x, pt.y, pt.x, pt.y), candidates);
+		for (std::vector<boost::shared_ptr<PdfOperator> >::const_iterator it = candidates.begin(); it != candidates.end(); ++it)
+			if (cmp((*it)->getBBox()))
+				opContainer.push_back (*it);
+	}
+
 	/**
 	 * Get first level pdf operators.
 	 *
@@ -489,10 +732,11 @@ public:
 	/**
 	 * Save content stream to underlying cstream(s) and notify all observers. 
 	 *
-	 * Does not reparse anything. 
+	 * Does not reparse anything but bounding boxes of all operators are
+	 * updated because we don't know what has been changed.
 	 */
 	void saveChange () 
-		{ _objectChanged(); }
+		{ allDirty = true; _objectChanged(); }
 
 	/**
 	 * Get smart pointer to this content stream.
@@ -515,14 +759,72 @@ public:
 	 */
 	void replaceText (const std::string& what, const std::string& with);
 
+	/**
+	 * Replaces many texts in this content stream.
+	 *
+	 * Text operators are traversed once and the stream is saved once. 
+	 * All replacements are done in one pass through each text (the longest 
+	 * text to replace wins at a position), so replaced text is never
+	 * replaced again. Texts are compared in the font encoding.
+	 *
+	 * @param replacements Texts to replace (empty ones are ignored).
+	 * @return Number of changed text operators.
+	 */
+	size_t replaceText (const TextReplacements& replacements);
+
 
 private:
 	/**
 	 * Save changes and indicate that the object has changed by calling all
 	 * observers.
+	 *
+	 * Only bounding boxes of operators marked by markDirty are updated.
 	 */
 	void _objectChanged ();
 
+	/**
+	 * Marks operator as changed.
+	 *
+	 * First level operator containing given operator is marked, so its 
+	 * bounding boxes are updated by the next updateBBoxes.
+	 *
+	 * @param oper Changed operator (from any level).
+	 * @param stateChanged True if the change can influence graphical state
+	 * of following operators. Changes inside of balanced q/Q blocks never
+	 * do.
+	 */
+	void markDirty (boost::shared_ptr<PdfOperator> oper, bool stateChanged = true);
+
+	/**
+	 * Marks first level operator as changed.
+	 *
+	 * @param top First level operator.
+	 * @param stateChanged See markDirty.
+	 */
+	void markTopDirty (boost::shared_ptr<PdfOperator> top, bool stateChanged = true);
+
+	/**
+	 * Operand has changed.
+	 *
+	 * Marks the first level operator with the changed operand as changed 
+	 * (or everything if it is no longer available) and saves the change.
+	 *
+	 * @param top First level operator containing the changed operand.
+	 */
+	void operandChanged (boost::shared_ptr<PdfOperator> top);
+
+	/**
+	 * Updates bounding boxes of changed operators.
+	 *
+	 * Graphical state is replayed from the nearest checkpoint before the 
+	 * first changed operator and bounding boxes are set from this operator.
+	 * Update stops after the last changed operator unless a change could have 
+	 * influenced graphical state of following operators (everything outside 
+	 * of balanced q/Q blocks). Checkpoints of all updated operators are 
+	 * refreshed.
+	 */
+	void updateBBoxes ();
+
 	//
 	// Observers
 	//
@@ -555,6 +857,8 @@ public:
 		kernelPrintDbg (debug::DBG_DBG, "destructing..");
 		// Unregister cstream observers
 		unregisterCStreamObservers ();
+		// Operators can outlive us
+		releaseOperandObservers ();
 		check_observerlist (this->observers);
 	}
 };
@@ -46,7 +46,8 @@ using namespace boost;
 //
 // Protected constructor
 //
-CDict::CDict (boost::weak_ptr<CPdf> p, const Object& o, const IndiRef& rf) : IProperty (p,rf) 
+CDict::CDict (boost::weak_ptr<CPdf> p, const Object& o, const IndiRef& rf) 
+	: IProperty (p,rf), indexedCount (0), unindexed (false)
 {
 	// Build the tree from xpdf object
 	utils::complexValueFromXpdfObj<pDict,Value&> (*this, o, value);
@@ -55,7 +56,7 @@ CDict::CDict (boost::weak_ptr<CPdf> p, const Object& o, const IndiRef& rf) : IPr
 //
 // Protected constructor
 //
-CDict::CDict (const Object& o)
+CDict::CDict (const Object& o) : indexedCount (0), unindexed (false)
 {
 	// Build the tree from xpdf object
 	utils::complexValueFromXpdfObj<pDict,Value&> (*this, o, value);
@@ -83,13 +84,88 @@ CDict::containsProperty (const string& name) const
 {
 	//kernelPrintDbg (debug::DBG_DBG, "getAllPropertyNames()");
 
-	for ( Value::const_iterator it = value.begin(); it != value.end(); ++it)
+	return _findPosition (name) != value.size();
+}
+
+//
+//
+//
+CDict::Value::size_type
+CDict::_findPosition (PropertyId id) const
+{
+	// Small dictionaries are faster to scan
+	if (value.size() < INDEX_THRESHOLD || !_updateIndex ())
 	{
-		if ((*it).first == name)
-			return true;
+		Value::size_type pos = 0;
+		for (; pos < value.size(); ++pos)
+			if (value[pos].first == id)
+				break;
+		return pos;
 	}
 
-	return false;
+	// all indexed names are interned, so unknown name can't be present
+	NameAtom atom = NameTable::instance().lookup (id);
+	if (NO_ATOM == atom)
+		return value.size();
+	Index::const_iterator it = index->find (atom);
+	if (it == index->end())
+		return value.size();
+	return it->second;
+}
+
+//
+//
+//
+CDict::Value::size_type
+CDict::_findPosition (NameAtom atom) const
+{
+	if (value.size() < INDEX_THRESHOLD || !_updateIndex ())
+	{
+		const std::string& id = atomName (atom);
+		Value::size_type pos = 0;
+		for (; pos < value.size(); ++pos)
+			if (value[pos].first == id)
+				break;
+		return pos;
+	}
+
+	Index::const_iterator it = index->find (atom);
+	if (it == index->end())
+		return value.size();
+	return it->second;
+}
+
+//
+//
+//
+bool
+CDict::_updateIndex () const
+{
+	if (unindexed)
+		return false;
+	if (!index)
+	{
+		index.reset (new Index);
+		indexedCount = 0;
+	}
+	assert (indexedCount <= value.size());
+
+	// Index entries appended since the last lookup. Insert doesn't overwrite
+	// already indexed name so the first occurence wins as in the linear scan
+	for (; indexedCount < value.size(); ++indexedCount)
+	{
+		NameAtom atom = NameTable::instance().tryIntern (value[indexedCount].first);
+		if (NO_ATOM == atom)
+		{
+			// name table is full, scan this dictionary
+			index.reset ();
+			indexedCount = 0;
+			unindexed = true;
+			return false;
+		}
+		index->insert (Index::value_type (atom, indexedCount));
+	}
+	return true;
 }
 
 //
@@ -99,19 +175,11 @@ boost::shared_ptr<IProperty>
 CDict::getProperty (PropertyId id) const
 {
 	//kernelPrintDbg (debug::DBG_DBG,"getProperty() " << id);
-	//
-	// BEWARE using find_if with stateful functors !!!!!
-	//
-	DictIdxComparator cmp (id);
-	Value::const_iterator it = value.begin();
-	for (; it != value.end(); ++it)
-		if (cmp (*it))
-			break;
-
-	if (it == value.end())
+	Value::size_type pos = _findPosition (id);
+	if (pos == value.size())
 		throw ElementNotFoundException ("", "");
 	
-	boost::shared_ptr<IProperty> ip = cmp.getIProperty ();
+	boost::shared_ptr<IProperty> ip = value[pos].second;
 
 	// Set mode only if pdf is valid
 	_setMode (ip,id);
@@ -119,6 +187,24 @@ CDict::getProperty (PropertyId id) const
 	return ip;
 }
 
+//
+//
+//
+boost::shared_ptr<IProperty>
+CDict::getProperty (NameAtom atom) const
+{
+	Value::size_type pos = _findPosition (atom);
+	if (pos == value.size())
+		throw ElementNotFoundException ("", "");
+	
+	boost::shared_ptr<IProperty> ip = value[pos].second;
+
+	// Set mode only if pdf is valid
+	_setMode (ip, atomName (atom));
+
+	return ip;
+}
+
 
 //
 // Set methods
@@ -175,23 +261,16 @@ CDict::delProperty (PropertyId id)
 	// Check whether we can make the change
 	this->canChange();
 
-	//
-	// BEWARE using find_if with stateful functors !!!!!
-	// We could have used getProperty but we also need the iterator
-	//
-	DictIdxComparator cmp (id);
-	Value::iterator oldit = value.begin();
-	for (; oldit != value.end(); ++oldit)
-		if (cmp (*oldit))
-			break;
-	
-	if (oldit == value.end())
+	// We could have used getProperty but we also need the position
+	Value::size_type pos = _findPosition (id);
+	if (pos == value.size())
 		throw ElementNotFoundException ("CDict", "item not found");
 	
-	boost::shared_ptr<IProperty> oldip = cmp.getIProperty ();
+	boost::shared_ptr<IProperty> oldip = value[pos].second;
 	
-	// Delete that item	
-	value.erase (oldit);
+	// Delete that item	- positions of all following items are shifted
+	value.erase (value.begin() + pos);
+	_invalidateIndex ();
 
 	if (hasValidPdf (this))
 	{
@@ -295,20 +374,15 @@ CDict::setProperty (PropertyId id, IProperty& newIp)
 
 	//
 	// Find the item we want
-	// BEWARE using find_if with stateful functors !!!!!
 	//
-	DictIdxComparator cmp (id);
-	Value::iterator it = value.begin();
-	for (; it != value.end(); ++it)
-		if (cmp (*it))
-			break;
+	Value::size_type pos = _findPosition (id);
 
 	// Check the bounds, if fails add it
-	if (it == value.end())
+	if (pos == value.size())
 		return addProperty (id, newIp);
 
 	// Save the old one
-	boost::shared_ptr<IProperty> oldIp = cmp.getIProperty ();
+	boost::shared_ptr<IProperty> oldIp = value[pos].second;
 	// Clone the added property
 	boost::shared_ptr<IProperty> newIpClone = newIp.clone ();
 	assert (newIpClone);
@@ -317,8 +391,8 @@ CDict::setProperty (PropertyId id, IProperty& newIp)
 	newIpClone->setIndiRef (this->getIndiRef());
 	newIpClone->setPdf (this->getPdf());
 
-	// Construct item, and replace it with this one
-	fill_n (it, 1, make_pair ((*it).first, newIpClone));
+	// Replace the value, name (and so index) stays untouched
+	value[pos].second = newIpClone;
 
 	//
 	// Dispatch change if we are in valid pdf
@@ -437,21 +511,16 @@ CDict::_setMode (boost::shared_ptr<IProperty> ip, PropertyId id) const
 		// We can not use containsProperty and getValue because they call this
 		// function and an infinite  cycle would occur
 		//
-		DictIdxComparator cmp ("Type");
-		Value::const_iterator it = value.begin();
-		for (; it != value.end(); ++it)
-		{
-			if (cmp (*it))
-				break;
-		}
-		if (it == value.end())
+		static const NameAtom typeAtom = internName ("Type");
+		Value::size_type pos = _findPosition (typeAtom);
+		if (pos == value.size())
 		{ // No type found
 			mode = modecontroller->getMode ("", id);
 			
 		}else	
 		{ // We have found a type
 			string tmp;
-			boost::shared_ptr<IProperty> type = cmp.getIProperty ();
+			boost::shared_ptr<IProperty> type = value[pos].second;
 			if (isName (type))
 				IProperty::getSmartCObjectPtr<CName>(type)->getValue(tmp);
 			mode = modecontroller->getMode (tmp, id);
@@ -487,7 +556,8 @@ CDict::doClone () const
 	//
 	// Loop through all items and clone them as well and finally add them to the new object
 	//
-	 Value::const_iterator it = value.begin ();
+	clone_->value.reserve (value.size());
+	Value::const_iterator it = value.begin ();
 	for (; it != value.end (); ++it)
 		clone_->value.push_back (make_pair ((*it).first, (*it).second->clone()));
 
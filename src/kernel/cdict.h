@@ -30,6 +30,8 @@
 #include "kernel/iproperty.h"
 #include "kernel/cobjectsimple.h"
 #include "kernel/carray.h"
+#include "kernel/nametable.h"
+#include <boost/unordered_map.hpp>
 
 
 //=====================================================================================
@@ -67,9 +69,16 @@ namespace pdfobjects {
 class CDict : noncopyable, public IProperty
 {
 	friend class CStream;
+	friend class CStreamsLexer;
 	
 public:
-	typedef std::list<std::pair<std::string, boost::shared_ptr<IProperty> > > Value; 
+	/** 
+	 * Dictionary entries in their insertion order.
+	 *
+	 * Entries are stored in contiguous storage which is cheap to scan for
+	 * small dictionaries. Larger dictionaries are looked up through index.
+	 */
+	typedef std::vector<std::pair<std::string, boost::shared_ptr<IProperty> > > Value; 
 	typedef const std::string& WriteType; 
 	typedef const std::string& PropertyId;
 	typedef observer::ComplexChangeContext<IProperty, PropertyId> CDictComplexObserverContext;
@@ -84,6 +93,73 @@ private:
 	/** Dictionary representation. */
 	Value value;
 
+	/** 
+	 * Minimal number of entries for which index is used for lookups.
+	 * Smaller dictionaries are simply scanned.
+	 */
+	static const size_t INDEX_THRESHOLD = 12;
+
+	/** Hashed index type - mapping from name atom to the position in value. */
+	typedef boost::unordered_map<NameAtom, Value::size_type> Index;
+
+	/** 
+	 * Lookup index for large dictionaries.
+	 *
+	 * All indexed names are interned, so names which are not in the NameTable
+	 * can't be in the dictionary. If a name can't be interned because the 
+	 * NameTable is full, the dictionary is not indexed and it is scanned
+	 * instead until the index is invalidated.
+	 * Index is created lazily by _findPosition and it covers first indexedCount
+	 * entries from value. New entries appended to value (also those added
+	 * directly by friend classes and helper functions) are indexed on next
+	 * lookup. Index has to be discarded by _invalidateIndex whenever an entry
+	 * is removed.
+	 */
+	mutable boost::scoped_ptr<Index> index;
+
+	/** Number of entries from value covered by index. */
+	mutable Value::size_type indexedCount;
+
+	/** Set if some name couldn't be interned (dictionary is scanned). */
+	mutable bool unindexed;
+
+	/**
+	 * Finds position of the property with given name.
+	 *
+	 * Uses linear scan for small dictionaries and hashed index otherwise. If
+	 * there are more properties with the same name (which may happen for
+	 * documents which are not valid), the first one is returned.
+	 *
+	 * @param id Name of the property.
+	 * @return Position of the property in value or value.size() if not found.
+	 */
+	Value::size_type _findPosition (PropertyId id) const;
+
+	/**
+	 * Finds position of the property with given name atom.
+	 * 
+	 * @param atom Atom of the property name.
+	 * @return Position of the property in value or value.size() if not found.
+	 */
+	Value::size_type _findPosition (NameAtom atom) const;
+
+	/**
+	 * Updates index with entries appended since the last lookup.
+	 * @return false if the dictionary can't be indexed.
+	 */
+	bool _updateIndex () const;
+
+	/**
+	 * Discards lookup index.
+	 * Must be called whenever an entry is removed from value.
+	 */
+	void _invalidateIndex () 
+	{
+		index.reset ();
+		indexedCount = 0;
+		unindexed = false;
+	}
+
 
 	//
 	// Constructors
@@ -111,7 +187,7 @@ public:
 	/** 
 	 * Public constructor. This object will not be associated with a pdf.
 	 */
-	CDict () {}
+	CDict () : indexedCount (0), unindexed (false) {}
 
 
 	//
@@ -202,6 +278,17 @@ public:
 	 * @return True if the property exists, false otherwise.
 	 */
 	bool containsProperty (const std::string& name) const;
+
+	/**
+	 * Returns true if the property with given name atom is present in the
+	 * dictionary.
+	 *
+	 * @param atom Atom of the property name (see NameTable).
+	 *
+	 * @return True if the property exists, false otherwise.
+	 */
+	bool containsProperty (NameAtom atom) const
+		{ return _findPosition (atom) != value.size(); }
 	
 	/**
 	 * Returns value of property identified by its name.
@@ -211,6 +298,18 @@ public:
    	 */
 	boost::shared_ptr<IProperty> getProperty (PropertyId id) const;
 
+	/**
+	 * Returns value of property identified by its name atom.
+	 *
+	 * This is faster equivalent of getProperty(atomName(atom)) which is 
+	 * suitable for frequently used names.
+   	 *
+   	 * @param 	atom 	Atom of the property name (see NameTable).
+	 * @return	Output variable where the value will be stored.
+	 * @throw ElementNotFoundException if there is no such property.
+   	 */
+	boost::shared_ptr<IProperty> getProperty (NameAtom atom) const;
+
 	/** 
 	 * Returns property identified by its name.
 	 * This is a convenient method which also does the casting trickery
@@ -577,6 +676,24 @@ typedef unsigned char* (*stream_data_extractor)( Object& obj, size_t& size);
  */
 size_t streamToCharBuffer (Object & streamObject, Ref* ref, CharBuffer & outputBuf,
 		stream_data_extractor extractor);
+
+/** Makes a valid pdf indirect object representation of stream object with
+ * already extracted data.
+ * @param streamObject Xpdf object representing stream.
+ * @param ref Reference for this indirect object.
+ * @param outputBuf Output byte buffer containing complete representation.
+ * @param dataBuff Stream data (as returned by stream_data_extractor). Buffer
+ * is deallocated by this function.
+ * @param realBufferLen Number of bytes in dataBuff.
+ *
+ * Same as streamToCharBuffer but it doesn't call any extractor. This is
+ * useful when data are prepared elsewhere (e.g. compressed by another
+ * thread).
+ *
+ * @return number of bytes used in outputBuf or 0 if problem occures.
+ */
+size_t streamDataToCharBuffer (Object & streamObject, Ref* ref, CharBuffer & outputBuf,
+		unsigned char * dataBuff, size_t realBufferLen);
 	
 /**
  * Convert xpdf object to string
@@ -999,6 +999,15 @@ size_t streamToCharBuffer (Object & streamObject, Ref* ref, CharBuffer & outputB
 	unsigned char * dataBuff = extractor(streamObject, realBufferLen);
 	if(!dataBuff)
 		return 0;
+	return streamDataToCharBuffer(streamObject, ref, outputBuf, dataBuff, realBufferLen);
+}
+
+size_t streamDataToCharBuffer (Object & streamObject, Ref* ref, CharBuffer & outputBuf,
+		unsigned char * dataBuff, size_t realBufferLen)
+{
+	assert(streamObject.getType()==objStream);
+	boost::shared_ptr< ::Object> lenghtObj(XPdfObjectFactory::getInstance(), xpdf::object_deleter());
+ 	streamObject.streamGetDict()->lookup("Length", lenghtObj.get());
 	if(!realBufferLen)
 		utilsPrintDbg(debug::DBG_WARN, "Stream " << *ref << " with zero bytes in encountered");
 	
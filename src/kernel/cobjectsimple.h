@@ -29,6 +29,7 @@
 #include "kernel/static.h"
 #include "kernel/iproperty.h"
 #include "kernel/xpdf.h"
+#include "kernel/nametable.h"
 #include <poppler/Lexer.h>
 #include <algorithm>
 
@@ -102,8 +103,35 @@ template<> struct PropertyTraitSimple<pRef>
  * Copying complex types could be very expensive so we have made the decision to
  * avoid it.
  */
+/**
+ * Cached name atom of a simple object.
+ *
+ * Only names cache their atom (see CObjectSimple::getAtom), other simple
+ * types derive from the empty template so they don't pay for it.
+ */
 template <PropertyType Tp>
-class CObjectSimple : noncopyable, public IProperty
+struct SimpleAtomCache
+{
+	/** Forget the cached atom. */
+	void resetAtom () const {}
+};
+
+/** Cached name atom of a name object. */
+template <>
+struct SimpleAtomCache<pName>
+{
+	/** Cached atom of the value (NO_ATOM if not known yet). */
+	mutable NameAtom atom;
+
+	SimpleAtomCache () : atom (NO_ATOM) {}
+
+	/** Forget the cached atom. */
+	void resetAtom () const
+		{ atom = NO_ATOM; }
+};
+
+template <PropertyType Tp>
+class CObjectSimple : noncopyable, public IProperty, private SimpleAtomCache<Tp>
 {
 public:
 	typedef typename PropertyTraitSimple<Tp>::writeType WriteType;
@@ -204,6 +232,17 @@ public:
 	 */
 	Value getValue () const;
 
+	/**
+	 * Return atom of the name value (only for CName).
+	 *
+	 * Atom is cached, so comparing names through their atoms is just an
+	 * integer comparison.
+	 *
+	 * @return Atom of the value (see NameTable) or NO_ATOM if the name
+	 * can't be interned because the table is full.
+	 */
+	NameAtom getAtom () const;
+
 	//
 	// Set methods
 	//
@@ -110,6 +110,19 @@ CObjectSimple<Tp>::getValue () const
 	return value;
 }
 
+//
+// Get the atom of name value
+//
+template<PropertyType Tp>
+NameAtom
+CObjectSimple<Tp>::getAtom () const
+{
+	STATIC_CHECK ((pName == Tp),INCORRECT_USE_OF_getAtom_FUNCTION_FOR_NON_pName_TYPE);
+	if (NO_ATOM == this->atom)
+		this->atom = NameTable::instance().tryIntern (value);
+	return this->atom;
+}
+
 
 //
 // Set methods
@@ -136,6 +149,7 @@ CObjectSimple<Tp>::setStringRepresentation (const std::string& strO)
 		boost::shared_ptr<ObserverContext> context (this->_createContext());
 		// Change our value
 		utils::simpleValueFromString (strO, value);
+		this->resetAtom ();
 		
 		try {
 			// notify observers and dispatch the change
@@ -153,6 +167,7 @@ CObjectSimple<Tp>::setStringRepresentation (const std::string& strO)
 
 		// Change our value
 		utils::simpleValueFromString (strO, this->value);
+		this->resetAtom ();
 	}
 }
 
@@ -178,6 +193,7 @@ CObjectSimple<Tp>::setValue (WriteType val)
 		boost::shared_ptr<ObserverContext> context (this->_createContext());
 		// Change the value
 		value = val;
+		this->resetAtom ();
 		
 		try {
 			// notify observers and dispatch the change
@@ -195,6 +211,7 @@ CObjectSimple<Tp>::setValue (WriteType val)
 
 		// Change the value
 		value = val;
+		this->resetAtom ();
 	}
 }	
 
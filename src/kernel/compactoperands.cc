@@ -0,0 +1,226 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+
+#include "kernel/static.h"
+#include "kernel/compactoperands.h"
+#include "kernel/cobject.h"
+#include "kernel/factories.h"
+#include "kernel/exceptions.h"
+
+//==========================================================
+namespace pdfobjects {
+//==========================================================
+
+using namespace std;
+using namespace boost;
+using namespace utils;
+
+//
+//
+//
+void
+CompactOperands::push_back (boost::shared_ptr<IProperty>& ip)
+{
+	assert (ip);
+	Operand op;
+	op.type = ip->getType ();
+	
+	//
+	// Object can't be dropped if anybody else uses it or if it lives in
+	// a pdf
+	//
+	if (!ip.unique() || hasValidPdf (ip))
+	{
+		op.property = ip;
+		ip.reset ();
+		operands.push_back (op);
+		return;
+	}
+
+	switch (op.type)
+	{
+		case pBool:
+			op.value.b = IProperty::getSmartCObjectPtr<CBool> (ip)->getValue ();
+			break;
+		case pInt:
+			op.value.i = IProperty::getSmartCObjectPtr<CInt> (ip)->getValue ();
+			break;
+		case pReal:
+			op.value.r = IProperty::getSmartCObjectPtr<CReal> (ip)->getValue ();
+			break;
+		case pName:
+			// names which can't be interned are kept as objects
+			op.value.atom = IProperty::getSmartCObjectPtr<CName> (ip)->getAtom ();
+			if (NO_ATOM == op.value.atom)
+				op.property = ip;
+			break;
+		case pNull:
+			break;
+		default:
+			op.property = ip;
+			break;
+	}
+	ip.reset ();
+	operands.push_back (op);
+}
+
+//
+//
+//
+double
+CompactOperands::getNumber (size_t pos) const
+{
+	const Operand& op = operands[pos];
+	if (op.property)
+		return getDoubleFromIProperty (op.property);
+	
+	if (pInt == op.type)
+		return op.value.i;
+	if (pReal == op.type)
+		return op.value.r;
+	throw ElementBadTypeException ("CompactOperands::getNumber");
+}
+
+//
+//
+//
+int
+CompactOperands::getInt (size_t pos) const
+{
+	const Operand& op = operands[pos];
+	if (op.property)
+		return getIntFromIProperty (op.property);
+	
+	if (pInt == op.type)
+		return op.value.i;
+	throw ElementBadTypeException ("CompactOperands::getInt");
+}
+
+//
+//
+//
+std::string
+CompactOperands::getName (size_t pos) const
+{
+	const Operand& op = operands[pos];
+	if (op.property)
+		return getNameFromIProperty (op.property);
+	
+	if (pName == op.type)
+		return atomName (op.value.atom);
+	throw ElementBadTypeException ("CompactOperands::getName");
+}
+
+//
+//
+//
+boost::shared_ptr<IProperty>
+CompactOperands::getProperty (size_t pos) const
+{
+	const Operand& op = operands[pos];
+	if (op.property)
+		return op.property;
+
+	switch (op.type)
+	{
+		case pBool:
+			return boost::shared_ptr<IProperty> (CBoolFactory::getInstance (op.value.b));
+		case pInt:
+			return boost::shared_ptr<IProperty> (CIntFactory::getInstance (op.value.i));
+		case pReal:
+			return boost::shared_ptr<IProperty> (CRealFactory::getInstance (op.value.r));
+		case pName:
+			return boost::shared_ptr<IProperty> (CNameFactory::getInstance (atomName (op.value.atom)));
+		case pNull:
+			return boost::shared_ptr<IProperty> (CNullFactory::getInstance ());
+		default:
+			assert (!"Compact operand of complex type.");
+			throw CObjInvalidObject ();
+	}
+}
+
+//
+//
+//
+boost::shared_ptr<IProperty>
+CompactOperands::promote (size_t pos)
+{
+	Operand& op = operands[pos];
+	if (!op.property)
+		op.property = getProperty (pos);
+	return op.property;
+}
+
+//
+//
+//
+bool
+CompactOperands::contains (const IProperty* ip) const
+{
+	for (Storage::const_iterator it = operands.begin(); it != operands.end(); ++it)
+		if (it->property.get() == ip)
+			return true;
+	return false;
+}
+
+//
+//
+//
+void
+CompactOperands::getStringRepresentation (size_t pos, std::string& str) const
+{
+	const Operand& op = operands[pos];
+	if (op.property)
+	{
+		op.property->getStringRepresentation (str);
+		return;
+	}
+
+	switch (op.type)
+	{
+		case pBool:
+			simpleValueToString<pBool> (op.value.b, str);
+			break;
+		case pInt:
+			simpleValueToString<pInt> (op.value.i, str);
+			break;
+		case pReal:
+			simpleValueToString<pReal> (op.value.r, str);
+			break;
+		case pName:
+			simpleValueToString<pName> (atomName (op.value.atom), str);
+			break;
+		case pNull:
+			simpleValueToString<pNull> (NullType (), str);
+			break;
+		default:
+			assert (!"Compact operand of complex type.");
+			throw CObjInvalidObject ();
+	}
+}
+
+//==========================================================
+} // namespace pdfobjects
+//==========================================================
@@ -0,0 +1,197 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+#ifndef _COMPACTOPERANDS_H_
+#define _COMPACTOPERANDS_H_
+
+// static includes
+#include "kernel/static.h"
+#include "kernel/iproperty.h"
+#include "kernel/nametable.h"
+
+//==========================================================
+namespace pdfobjects {
+//==========================================================
+
+/**
+ * Compact storage of pdf operator operands.
+ *
+ * Content streams consist mostly of numbers and names. Each full IProperty
+ * object carries observer list, pdf and indirect reference, so storing
+ * operands as objects is very expensive. Simple operands (numbers, names,
+ * booleans and null) are stored here as tagged plain values and their
+ * objects are created (promoted) only when somebody asks for a handle which
+ * can be changed. Other operands (strings, arrays, dictionaries, references)
+ * are always stored as objects.
+ * <br>
+ * Names are stored as NameTable atoms. Names which can't be interned 
+ * (see NameTable::tryIntern) are stored as objects too.
+ * <br>
+ * Read only access (getType, getNumber, getName...) never promotes an
+ * operand.
+ */
+class CompactOperands
+{
+public:
+	/** Single operand. */
+	struct Operand
+	{
+		/** Type of the operand. */
+		PropertyType type;
+		
+		/** Plain value. Valid only if property is not set. */
+		union
+		{
+			bool b;
+			int i;
+			double r;
+			NameAtom atom;
+		} value;
+		
+		/** Operand object. Empty if operand is stored as plain value. */
+		boost::shared_ptr<IProperty> property;
+	};
+	
+	typedef std::vector<Operand> Storage;
+
+private:
+	/** Operands. */
+	Storage operands;
+
+public:
+	/** Number of operands. */
+	size_t size () const
+		{ return operands.size(); }
+
+	/** Are there any operands. */
+	bool empty () const
+		{ return operands.empty(); }
+
+	/** Remove all operands. */
+	void clear ()
+		{ operands.clear(); }
+
+	/** Reserve space for operands. */
+	void reserve (size_t count)
+		{ operands.reserve (count); }
+
+	/**
+	 * Append an operand.
+	 *
+	 * Takes over the operand object, ip is reset. If nobody else references
+	 * the object and it is a simple one which doesn't belong to a pdf, only
+	 * its value is stored (names only if they have an atom).
+	 *
+	 * @param ip Operand object.
+	 */
+	void push_back (boost::shared_ptr<IProperty>& ip);
+
+	/**
+	 * Get type of an operand.
+	 *
+	 * @param pos Position of the operand.
+	 * @return Type of the operand.
+	 */
+	PropertyType getType (size_t pos) const
+		{ return operands[pos].type; }
+
+	/**
+	 * Is operand stored as a plain value.
+	 *
+	 * @param pos Position of the operand.
+	 * @return True if operand object was not created yet.
+	 */
+	bool isCompact (size_t pos) const
+		{ return !operands[pos].property; }
+
+	/**
+	 * Get numeric value of an operand.
+	 *
+	 * @param pos Position of the operand.
+	 * @return Value of int or real operand.
+	 * @throw ElementBadTypeException if operand is not a number.
+	 */
+	double getNumber (size_t pos) const;
+
+	/**
+	 * Get integer value of an operand.
+	 *
+	 * @param pos Position of the operand.
+	 * @return Value of int operand.
+	 * @throw ElementBadTypeException if operand is not an int.
+	 */
+	int getInt (size_t pos) const;
+
+	/**
+	 * Get name value of an operand.
+	 *
+	 * @param pos Position of the operand.
+	 * @return Value of name operand.
+	 * @throw ElementBadTypeException if operand is not a name.
+	 */
+	std::string getName (size_t pos) const;
+
+	/**
+	 * Get operand object.
+	 *
+	 * If the operand is stored as a plain value, new standalone object with
+	 * the same value is returned. Changes of this object are not reflected
+	 * in the operand.
+	 *
+	 * @param pos Position of the operand.
+	 * @return Operand object.
+	 */
+	boost::shared_ptr<IProperty> getProperty (size_t pos) const;
+
+	/**
+	 * Promote an operand.
+	 * Creates operand object if it is stored as a plain value.
+	 *
+	 * @param pos Position of the operand.
+	 * @return Operand object which is stored from now on.
+	 */
+	boost::shared_ptr<IProperty> promote (size_t pos);
+
+	/**
+	 * Is given object one of operands.
+	 *
+	 * @param ip Object.
+	 * @return True if ip is stored operand object.
+	 */
+	bool contains (const IProperty* ip) const;
+
+	/**
+	 * Get string representation of an operand.
+	 *
+	 * @param pos Position of the operand.
+	 * @param str Output string.
+	 */
+	void getStringRepresentation (size_t pos, std::string& str) const;
+};
+
+//==========================================================
+} // namespace pdfobjects
+//==========================================================
+
+#endif // _COMPACTOPERANDS_H_
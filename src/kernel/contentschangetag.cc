@@ -84,14 +84,14 @@ ContentsChangeTag::getTime (boost::shared_ptr<PdfOperator> op)
 	time_t time = 0;
 	if (0 < op->getParametersCount())
 	{
-		PdfOperator::Operands ops;
-		op->getParameters (ops);
+		// Only reading, don't create operand objects
+		const CompactOperands& ops = op->getCompactParameters ();
 		assert (!ops.empty());
 		
 		try {
-			if (isDict (ops.front())) {
+			if (pDict == ops.getType (0)) {
 				double tmp;
-				utils::simpleValueFromString (utils::getStringFromDict (ops.front(),"Time"),tmp);
+				utils::simpleValueFromString (utils::getStringFromDict (ops.getProperty (0),"Time"),tmp);
 				if (numeric_limits<time_t>::max() > tmp)
 					time = static_cast<time_t> (tmp);
 			}
@@ -499,18 +499,50 @@ public:
 	 * Returns plain text extracted from a page using xpdf code.
 	 * 
 	 * @param text Output string  where the text will be saved.
-	 * @param encoding Encoding format.
+	 * @param encoding Encoding format. It is set to xpdf global parameters, so
+	 * it must not be used when pages are processed concurrently (set the 
+	 * encoding before workers start then).
 	 * @param rc Rectangle from which to extract the text.
 	 */
 	void getText (std::string& text, const std::string* encoding = NULL, const libs::Rectangle* rc = NULL) const
 		{ _contents->getText (text, encoding, rc); }
+
+	/**
+	 * Returns words of the page with their bounding boxes.
+	 * @see CPageContents::getTextWords
+	 * 
+	 * @param words Output container.
+	 */
+	void getTextWords (CPageContents::Words& words) const
+		{ _contents->getTextWords (words); }
+
+	/**
+	 * Returns text version of the page.
+	 * @see CPageContents::getTextVersion
+	 */
+	size_t getTextVersion () const
+		{ return _contents->getTextVersion (); }
+
+	/**
+	 * Registers observer notified whenever the text version changes.
+	 * @see CPageContents::registerTextObserver
+	 */
+	void registerTextObserver (const Observer& observer) const
+		{ _contents->registerTextObserver (observer); }
+
+	/**
+	 * Unregisters text observer.
+	 * @see CPageContents::unregisterTextObserver
+	 */
+	void unregisterTextObserver (const Observer& observer) const
+		{ _contents->unregisterTextObserver (observer); }
  
 	 /**
 	  * Find all occurences of a text on this page.
 	  *
-	  * It uses xpdf TextOutputDevice to get the bounding box of found text.
+	  * @see CPageContents::findText
 	  *
-	  * @param text Text to find.
+	  * @param text Text to find (UTF-8).
 	  * @param recs Output container of rectangles of all occurences of the text.
 	  * @param params Search parameters.
 	  *
@@ -522,6 +554,15 @@ public:
 					  const TextSearchParams& params = TextSearchParams()) const
 		{ return _contents->findText (text, recs, params);	}
 
+	/**
+	 * Find all occurences of many texts on this page in one pass.
+	 * @see CPageContents::findTexts
+	 */
+	size_t findTexts (const TextSearch& search,
+					  CPageContents::TextMatches& matches,
+					  const TextSearchParams& params = TextSearchParams()) const
+		{ return _contents->findTexts (search, matches, params); }
+
 	/**
 	 * Move contentstream up one level. Which means it will be repainted by less objects.
 	 */
@@ -592,6 +633,16 @@ public:
 		_contents->replaceText (what, with);
 	}
 
+	/**
+	 * Replaces many texts in the whole page.
+	 * @see CPageContents::replaceText
+	 */
+	size_t replaceText (const CContentStream::TextReplacements& replacements)
+	{
+			_check_validity();
+		return _contents->replaceText (replacements);
+	}
+
 	/**
 	 * Adds text to specified position.
 	 */
@@ -75,6 +75,17 @@ CPageContents::ContentsWatchDog::notify (boost::shared_ptr<IProperty> newValue,
 {
 		kernelPrintDbg (debug::DBG_DBG, "context type=" << context->getType());
 
+	// Stream data of a content stream changed (operators were changed), 
+	// there is nothing to reparse but extracted text is not valid anymore
+	if (newValue && isStream (newValue))
+	{
+		_cnt->invalidate_text_layer ();
+		return;
+	}
+
+	// Whatever else changed, extracted text is not valid anymore either
+	_cnt->invalidate_text_layer ();
+
 	//Several scenarios can happen
 	//1) page dictionary gets changed
 	//	OK 1.1 - added Contents entry
@@ -236,7 +247,7 @@ namespace {
 // CPageContents
 //==========================================================
 
-CPageContents::CPageContents (CPage* page) : _page(page), _wd (new ContentsWatchDog (this))
+CPageContents::CPageContents (CPage* page) : _page(page), _wd (new ContentsWatchDog (this)), _textversion (0)
 {
 	if (_page)
 		_dict = _page->getDictionary();
@@ -245,6 +256,12 @@ CPageContents::CPageContents (CPage* page) : _page(page), _wd (new ContentsWatch
 
 CPageContents::~CPageContents ()
 {
+	if (_dict)
+	{
+		boost::shared_ptr<CPdf> pdf = _dict->getPdf().lock ();
+		if (pdf)
+			pdf->forgetTextLayer (*this);
+	}
 	reset ();
 }
 
@@ -386,13 +403,8 @@ CPageContents::getText (std::string& text, const string* encoding, const libs::R
 {
 		kernelPrintDbg (debug::DBG_DBG, "");
 
-	// Create text output device
-    boost::scoped_ptr<TextOutputDev> textDev (new ::TextOutputDev (NULL, gFalse,0, gFalse, gFalse));
-		if (!textDev->isOk())
-			throw CObjInvalidOperation ();
-
-	// Display page
-	_page->display()->displayPage (*textDev);	
+	// Get text device with displayed page
+	::TextOutputDev& textDev = text_layer ();
 
 	// Set encoding
 	if (encoding)
@@ -406,11 +418,45 @@ CPageContents::getText (std::string& text, const string* encoding, const libs::R
 	if (90 == rot || 270 == rot)
 		std::swap (rec.xright, rec.yright);
 
-	boost::scoped_ptr<GooString> gtxt (textDev->getText(rec.xleft, rec.yleft, rec.xright, rec.yright));
+	boost::scoped_ptr<GooString> gtxt (textDev.getText(rec.xleft, rec.yleft, rec.xright, rec.yright));
 	text = gtxt->getCString();
 }
 
 
+//
+//
+//
+void
+CPageContents::getTextWords (Words& words) const
+{
+	words.clear ();
+
+	// Use the text layer if valid, display the page otherwise
+	check_text_layer ();
+	boost::shared_ptr< ::TextOutputDev> textdev = _textlayer.textdev;
+	if (!textdev)
+	{
+		textdev = boost::shared_ptr< ::TextOutputDev> (new ::TextOutputDev (NULL, gFalse, 0, gFalse, gFalse));
+			if (!textdev->isOk())
+				throw CObjInvalidOperation ();
+		_page->display()->displayPage (*textdev);
+	}
+
+	boost::scoped_ptr<TextWordList> list (textdev->makeWordList (gFalse));
+	int count = list->getLength ();
+	words.reserve (count);
+	for (int i = 0; i < count; ++i)
+	{
+		::TextWord* word = list->get (i);
+		boost::scoped_ptr<GooString> text (word->getText ());
+		Word w;
+		w.text = text->getCString ();
+		word->getBBox (&w.bbox.xleft, &w.bbox.yleft, &w.bbox.xright, &w.bbox.yright);
+		words.push_back (w);
+	}
+}
+
+
 //
 // Text search/find
 //
@@ -421,52 +467,15 @@ CPageContents::getText (std::string& text, const string* encoding, const libs::R
 template<typename RectangleContainer>
 size_t CPageContents::findText (std::string text, 
 					  RectangleContainer& recs, 
-					  const TextSearchParams&) const
+					  const TextSearchParams& params) const
 {
-    double x = 000;
-	// Create text output device
-    boost::scoped_ptr<TextOutputDev> textDev (new ::TextOutputDev (NULL, gFalse, x,gFalse, gFalse));
-		assert (textDev->isOk());
-		if (!textDev->isOk())
-			throw CObjInvalidOperation ();
-
-	// Get the text
-	_page->display()->displayPage (*textDev);	
+	std::vector<std::string> patterns (1, text);
+	TextSearch search (patterns, params.caseSensitive);
 
-    GBool startAtTop, stopAtBottom, startAtLast, stopAtLast, caseSensitive, backward, wholeWord;
-	startAtTop = stopAtBottom = startAtLast = stopAtLast = gTrue;
-    caseSensitive = backward =  wholeWord = gFalse;
-	
-	double xMin = 0, yMin = 0, xMax = 0, yMax = 0;
-
-	// Convert text to unicode (slightly modified from from PDFCore.cc)
-	int length = static_cast<int>(text.length());
-	::Unicode* utext = static_cast<Unicode*> (new Unicode [length]);
-	for (int i = 0; i < length; ++i)
-	    utext[i] = static_cast<Unicode> (text[i] & 0xff);
-	
-	if (textDev->findText(utext, length, startAtTop, stopAtBottom, 
-                startAtLast,stopAtLast, caseSensitive, backward,wholeWord,
-				&xMin, &yMin, &xMax, &yMax))
-	{
-		startAtTop = gFalse;
-		
-		recs.push_back (libs::Rectangle (xMin, yMin, xMax, yMax));
-		// Get all text objects
-		while (textDev->findText (utext, length,
-								  startAtTop, stopAtBottom, 
-								  startAtLast, stopAtLast, 
-                                  caseSensitive, backward,wholeWord,
-								  &xMin, &yMin, &xMax, &yMax))
-		{
-			recs.push_back (libs::Rectangle (xMin, yMin, xMax, yMax));
-		}
-	}
-
-	//
-	// Find out the words...
-	//
-	delete[] utext;	
+	TextMatches matches;
+	findTexts (search, matches, params);
+	for (TextMatches::const_iterator it = matches.begin(); it != matches.end(); ++it)
+		recs.push_back (it->bbox);
 	return recs.size();
 }
 
@@ -476,6 +485,64 @@ template size_t CPageContents::findText<std::vector<libs::Rectangle> >
 	 std::vector<libs::Rectangle>& recs, 
 	 const TextSearchParams& params) const;
 
+//
+//
+//
+size_t
+CPageContents::findTexts (const TextSearch& search,
+						  TextMatches& matches,
+						  const TextSearchParams& params) const
+{
+	matches.clear ();
+	text_layer_glyphs ();
+	const TextSearch::Text& glyphs = _textlayer.glyphs;
+	const std::vector<libs::Rectangle>& boxes = _textlayer.glyphboxes;
+
+	TextSearch::Matches found;
+	search.search (glyphs, found, params.wholeWord);
+
+	// Region is used only if it is not empty
+	libs::Rectangle region (params.regionXLeft, params.regionYLeft, params.regionXRight, params.regionYRight);
+	bool useRegion = (params.regionXRight > params.regionXLeft && params.regionYRight > params.regionYLeft);
+
+	matches.reserve (found.size());
+	for (TextSearch::Matches::const_iterator it = found.begin(); it != found.end(); ++it)
+	{
+		// Bounding box of glyphs (separators have no boxes of their own)
+		libs::Rectangle bbox;
+		for (size_t i = it->begin; i < it->end; ++i)
+		{
+			if (TextSearch::isSpace (glyphs[i]))
+				continue;
+			bbox = libs::Rectangle::isInitialized (bbox) ? libs::rectangle_merge (bbox, boxes[i]) : boxes[i];
+		}
+		if (!libs::Rectangle::isInitialized (bbox))
+			continue;
+
+		// Like xpdf, start after the start position in the reading order
+		if (!params.startAtTop)
+		{
+			if (bbox.yleft < params.yStart || (bbox.yleft == params.yStart && bbox.xleft <= params.xStart))
+				continue;
+		}
+		// and stop before the stop position
+		if (!params.stopAtBottom)
+		{
+			if (bbox.yleft > params.yEnd || (bbox.yleft == params.yEnd && bbox.xleft >= params.xEnd))
+				continue;
+		}
+		if (useRegion && !(region.contains (bbox.xleft, bbox.yleft) && region.contains (bbox.xright, bbox.yright)))
+			continue;
+
+		TextMatch match;
+		match.pattern = it->pattern;
+		match.bbox = bbox;
+		matches.push_back (match);
+	}
+
+	return matches.size();
+}
+
 //
 //
 //
@@ -488,6 +555,19 @@ CPageContents::replaceText (const std::string& what, const std::string& with)
 		(*it)->replaceText (what, with);
 }
 
+//
+//
+//
+size_t
+CPageContents::replaceText (const CContentStream::TextReplacements& replacements)
+{
+	init();
+	size_t changed = 0;
+	for (CCs::iterator it = _ccs.begin (); it != _ccs.end(); ++it)
+		changed += (*it)->replaceText (replacements);
+	return changed;
+}
+
 //
 //
 //
@@ -905,12 +985,11 @@ CPageContents::parse ()
 		{
 			std::string tmp;
 			opit.getCurrent()->getOperatorName (tmp);
-			PdfOperator::Operands operands;
 			if (tmp == "Tm")
 			{
 					kernelPrintDbg (debug::DBG_WARN, "Using non default different Tm");
-				opit.getCurrent()->getParameters (operands);
-				_likely_tm = operands;
+				// Only reading, don't create operand objects
+				_likely_tm = opit.getCurrent()->getCompactParameters ();
 			}
 			opit.next();
 		}
@@ -972,9 +1051,188 @@ CPageContents::unreg_observer (boost::shared_ptr<IProperty> ip) const
 void 
 CPageContents::change (bool invalid)
 { 
+	invalidate_text_layer ();
+	sync_stream_observers ();
 	_page->_objectChanged (invalid); 
 }
 
+//
+//
+//
+void
+CPageContents::sync_stream_observers ()
+{
+	for (CContentStream::CStreams::iterator it = _wdstreams.begin(); it != _wdstreams.end(); ++it)
+		UNREGISTER_SHAREDPTR_OBSERVER((*it), _wd);
+	_wdstreams.clear ();
+	
+	getAllCStreams (_ccs, _wdstreams);
+	for (CContentStream::CStreams::iterator it = _wdstreams.begin(); it != _wdstreams.end(); ++it)
+		REGISTER_SHAREDPTR_OBSERVER((*it), _wd);
+}
+
+
+//==========================================================
+// Text layer
+//==========================================================
+
+//
+//
+//
+void
+CPageContents::releaseTextLayer () const
+{
+	_textlayer.textdev.reset ();
+	_textlayer.sources.clear ();
+	_textlayer.glyphs.clear ();
+	_textlayer.glyphboxes.clear ();
+}
+
+//
+//
+//
+void
+CPageContents::touch_text_layer () const
+{
+	if (!_dict)
+		return;
+	boost::shared_ptr<CPdf> pdf = _dict->getPdf().lock ();
+	if (pdf)
+		pdf->useTextLayer (*this);
+}
+
+//
+//
+//
+void
+CPageContents::invalidate_text_layer () const
+{
+	releaseTextLayer ();
+	if (_dict)
+	{
+		boost::shared_ptr<CPdf> pdf = _dict->getPdf().lock ();
+		if (pdf)
+			pdf->forgetTextLayer (*this);
+	}
+	++_textversion;
+
+	if (_page && _textobservers.hasObservers())
+	{
+		boost::shared_ptr<CPage> current (_page, EmptyDeallocator<CPage> ());
+		_textobservers.notifyObservers (current, 
+				boost::shared_ptr<const CPage::ObserverContext> (new CPage::BasicObserverContext (current)));
+	}
+}
+
+//
+//
+//
+void
+CPageContents::check_text_layer () const
+{
+	if (!(_textlayer.params == _display_params()))
+	{
+		invalidate_text_layer ();
+		_textlayer.params = _display_params ();
+	}
+}
+
+//
+//
+//
+::TextOutputDev&
+CPageContents::text_layer () const
+{
+	check_text_layer ();
+	if (!_textlayer.textdev)
+	{
+			kernelPrintDbg (debug::DBG_DBG, "Extracting text layer.");
+		// Create text output device
+		boost::shared_ptr< ::TextOutputDev> textdev (new ::TextOutputDev (NULL, gFalse, 0, gFalse, gFalse));
+			if (!textdev->isOk())
+				throw CObjInvalidOperation ();
+
+		// Display page
+		_page->display()->displayPage (*textdev);
+		_textlayer.textdev = textdev;
+	}
+	touch_text_layer ();
+	return *_textlayer.textdev;
+}
+
+//
+//
+//
+void
+CPageContents::text_layer_glyphs () const
+{
+	::TextOutputDev& textdev = text_layer ();
+	if (!_textlayer.glyphs.empty())
+		return;
+
+	TextSearch::Text& glyphs = _textlayer.glyphs;
+	std::vector<libs::Rectangle>& boxes = _textlayer.glyphboxes;
+	boost::scoped_ptr<TextWordList> list (textdev.makeWordList (gFalse));
+	::TextWord* prev = NULL;
+	for (int i = 0; i < list->getLength (); ++i)
+	{
+		::TextWord* word = list->get (i);
+
+		// Separate words on the same line by space (if there is one) and
+		// lines by new line
+		if (prev)
+		{
+			::Unicode separator = (prev->getNext() == word) ? ' ' : '\n';
+			if ('\n' == separator || prev->getSpaceAfter())
+			{
+				glyphs.push_back (separator);
+				boxes.push_back (libs::Rectangle ());
+			}
+		}
+		prev = word;
+
+		for (int j = 0; j < word->getLength (); ++j)
+		{
+			libs::Rectangle box;
+			word->getCharBBox (j, &box.xleft, &box.yleft, &box.xright, &box.yright);
+
+			// Expand latin ligatures (U+FB00 - U+FB06) so that they can be 
+			// found by letters, long s t is searched as st
+			::Unicode c = *word->getChar (j);
+			static const char* ligatures[] = {"ff", "fi", "fl", "ffi", "ffl", "st", "st"};
+			if (0xFB00 <= c && c <= 0xFB06)
+			{
+				for (const char* l = ligatures[c - 0xFB00]; *l; ++l)
+				{
+					glyphs.push_back (static_cast< ::Unicode> (*l));
+					boxes.push_back (box);
+				}
+				continue;
+			}
+			glyphs.push_back (c);
+			boxes.push_back (box);
+		}
+	}
+	// Empty page is not built again
+	if (glyphs.empty())
+	{
+		glyphs.push_back ('\n');
+		boxes.push_back (libs::Rectangle ());
+	}
+		kernelPrintDbg (debug::DBG_DBG, "Text layer glyphs: " << glyphs.size());
+}
+
+//
+//
+//
+boost::shared_ptr<void>&
+CPageContents::text_layer_source (const std::string& name)
+{
+	check_text_layer ();
+	touch_text_layer ();
+	return _textlayer.sources[name];
+}
+
 void 
 CPageContents::_xpdf_display_params (boost::shared_ptr<GfxResources>& res, 
 									boost::shared_ptr<GfxState>& state)
@@ -988,6 +1246,12 @@ CPageContents::_page_pos () const
 	return _page->getPagePosition();
 }
 
+const DisplayParams&
+CPageContents::_display_params () const
+{
+	return _page->display()->getDisplayParams();
+}
+
 //
 //
 //
@@ -1076,6 +1340,10 @@ CPageContents::reset ()
 		if (!_page)
 			return;
 	unreg_observer ();
+	for (CContentStream::CStreams::iterator it = _wdstreams.begin(); it != _wdstreams.end(); ++it)
+		UNREGISTER_SHAREDPTR_OBSERVER((*it), _wd);
+	_wdstreams.clear ();
+	invalidate_text_layer ();
 	_page = NULL;
 	_dict.reset ();
 	_wd.reset ();
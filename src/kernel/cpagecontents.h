@@ -35,8 +35,11 @@
 #include "kernel/cstream.h"
 #include "kernel/textoutput.h"
 #include "kernel/textsearchparams.h"
+#include "kernel/textsearch.h"
 #include "kernel/stateupdater.h"
 #include "kernel/cobjectsimple.h"
+#include "kernel/displayparams.h"
+#include <typeinfo>
 
 
 //==========================================================
@@ -56,7 +59,7 @@ class CDict;
  * Class representing the Contents entry in a page.
  * Provides convinient access and modify operations on "Contents" entry of a page dictionary.
  */
-class CPageContents : public ICPageModule
+class CPageContents : public ICPageModule, public TextLayerHolder
 {
 
 	//==========================================================
@@ -100,6 +103,13 @@ private:
 			for (size_t i = 0; i < 6; ++i)
 				_tm[i] = utils::getDoubleFromIProperty(ops[i]);
 		}
+		void operator= (const CompactOperands& ops) 
+		{ 
+				if (ops.size() !=  6)
+					return;
+			for (size_t i = 0; i < 6; ++i)
+				_tm[i] = ops.getNumber (i);
+		}
 		void set_position (const libs::Point& p) 
 			{ _tm[4] = p.x; _tm[5] = p.y; }
 		operator PdfOperator::Operands () 
@@ -113,7 +123,49 @@ private:
 	};
 
 
+	/**
+	 * Text layer of a page.
+	 *
+	 * Extracting text means displaying the whole page, so the result is kept
+	 * and shared by getText, findText and convert until the page changes
+	 * (invalidated by ContentsWatchDog and by our own changes) or display
+	 * parameters are changed.
+	 */
+	struct TextLayer
+	{
+		/** Display parameters used for extraction. */
+		DisplayParams params;
+		/** Xpdf text device holding words and lines with coordinates. */
+		boost::shared_ptr< ::TextOutputDev> textdev;
+		/** Formatted text sources of convert indexed by their type name. */
+		typedef std::map<std::string, boost::shared_ptr<void> > Sources;
+		Sources sources;
+		/** Text in the reading order searched by findText (words are
+		 * separated by spaces, lines by new lines), built on demand. */
+		TextSearch::Text glyphs;
+		/** Bounding boxes of glyphs. */
+		std::vector<libs::Rectangle> glyphboxes;
+	};
+
 	// Typedefs
+public:
+	/** Word of the page text with its bounding box (in the same coordinates
+	 * as findText results). */
+	struct Word
+	{
+		std::string text;
+		libs::Rectangle bbox;
+	};
+	typedef std::vector<Word> Words;
+	/** Occurrence of a pattern found by findTexts. */
+	struct TextMatch
+	{
+		/** Index of the pattern in the TextSearch. */
+		size_t pattern;
+		/** Bounding box of the occurrence. */
+		libs::Rectangle bbox;
+	};
+	typedef std::vector<TextMatch> TextMatches;
 private:
 	typedef std::vector<boost::shared_ptr<CContentStream> > CCs;
 
@@ -123,7 +175,11 @@ private:
 	CPage* _page;	// pages
 	boost::shared_ptr<CDict> _dict;	// pages
 	boost::shared_ptr<ContentsWatchDog> _wd;
+	CContentStream::CStreams _wdstreams;	// streams observed by _wd
 	Tm _likely_tm;
+	mutable TextLayer _textlayer;
+	mutable size_t _textversion;	// incremented whenever the text layer is dropped
+	mutable observer::ObserverHandler<CPage> _textobservers;	// notified whenever the text version changes
 
 
 	// Ctor & Dtor
@@ -138,6 +194,13 @@ public:
 	/** @see ICPageModule::reset */
 	virtual void reset ();
 
+	//
+	// TextLayerHolder interface
+	//
+public:
+	/** @see TextLayerHolder::releaseTextLayer */
+	virtual void releaseTextLayer () const;
+
 
 	//
 	// Methods
@@ -213,9 +276,9 @@ public:
 	/**
 	 * Find all occurences of a text on this page.
 	 *
-	 * It uses xpdf TextOutputDevice to get the bounding box of found text.
+	 * Text is searched in the text layer, see findTexts.
 	 *
-	 * @param text Text to find.
+	 * @param text Text to find (UTF-8).
 	 * @param recs Output container of rectangles of all occurences of the text.
 	 * @param params Search parameters.
 	 *
@@ -226,11 +289,37 @@ public:
 					  RectangleContainer& recs, 
 					  const TextSearchParams& params = TextSearchParams()) const;
 
+	/**
+	 * Find all occurences of many texts on this page in one pass.
+	 *
+	 * Each occurrence has one bounding box of its glyphs, occurrences don't
+	 * cross lines. Case sensitivity is given by the search object, other 
+	 * parameters are taken from params.
+	 *
+	 * @param search Search automaton (can be shared by all pages).
+	 * @param matches Output container ordered by the reading order.
+	 * @param params Search parameters.
+	 *
+	 * @return Number of occurences found.
+	 */
+	size_t findTexts (const TextSearch& search,
+					  TextMatches& matches,
+					  const TextSearchParams& params = TextSearchParams()) const;
+
 	/**
 	 * Replaces text in the whole page.
 	 */
 	void replaceText (const std::string& what, const std::string& with);
 
+	/**
+	 * Replaces many texts in the whole page.
+	 * Each content stream is traversed and saved once.
+	 *
+	 * @see CContentStream::replaceText
+	 * @return Number of changed text operators.
+	 */
+	size_t replaceText (const CContentStream::TextReplacements& replacements);
+
 	/**
 	 * Adds text in to the page.
 	 */
@@ -257,31 +346,39 @@ public:
 
 		typedef textoutput::PageTextSource<WordEngine, LineEngine, ColumnEngine> TextSource;
 
-		// Create gfx resource and state
-		boost::shared_ptr<GfxResources> gfxres;
-		boost::shared_ptr<GfxState> gfxstate;
-		_xpdf_display_params (gfxres, gfxstate);
-			assert (gfxres && gfxstate);
-
-		// Create page text class with parametrized parts
-		TextSource text_source;
-
-		// Get text from all content streams
+		// Parse before the text layer is used (parsing invalidates it)
 		init();
-		for (CCs::iterator it = _ccs.begin(); it != _ccs.end(); ++it)
+		boost::shared_ptr<void>& cached = text_layer_source (typeid(TextSource).name());
+		if (!cached)
 		{
-			// Get operators and build text representation if not empty
-			CContentStream::Operators ops;
-			(*it)->getPdfOperators (ops);
-			if (!ops.empty())
+			// Create gfx resource and state
+			boost::shared_ptr<GfxResources> gfxres;
+			boost::shared_ptr<GfxState> gfxstate;
+			_xpdf_display_params (gfxres, gfxstate);
+				assert (gfxres && gfxstate);
+
+			// Create page text class with parametrized parts
+			boost::shared_ptr<TextSource> source (new TextSource);
+
+			// Get text from all content streams
+			for (CCs::iterator it = _ccs.begin(); it != _ccs.end(); ++it)
 			{
-				PdfOperator::Iterator itt = PdfOperator::getIterator (ops.front());
-				StateUpdater::updatePdfOperators<TextSource&> (itt, gfxres, *gfxstate, text_source);
+				// Get operators and build text representation if not empty
+				CContentStream::Operators ops;
+				(*it)->getPdfOperators (ops);
+				if (!ops.empty())
+				{
+					PdfOperator::Iterator itt = PdfOperator::getIterator (ops.front());
+					StateUpdater::updatePdfOperators<TextSource&> (itt, gfxres, *gfxstate, *source);
+				}
 			}
+
+			// Create lines, columns...
+			source->format ();
+			cached = source;
 		}
+		const TextSource& text_source = *static_cast<const TextSource*> (cached.get());
 
-		// Create lines, columns...
-		text_source.format ();
 		// Build the output
 		if (hasValidPdf(_dict))
 			text_source.output (out, _page_pos());
@@ -341,12 +438,54 @@ public:
 	 * algorithm that works most of the time.
 	 *
 	 * @param text Output string  where the text will be saved.
-	 * @param encoding Encoding format.
+	 * @param encoding Encoding format. It is set to xpdf global parameters, so
+	 * it must not be used when pages are processed concurrently (set the 
+	 * encoding before workers start then).
 	 * @param rc Rectangle from which to extract the text.
 	 */
 	void getText (std::string& text, 
 				  const std::string* encoding = NULL, 
 				  const libs::Rectangle* rc = NULL) const;
+
+	/**
+	 * Returns words of the page in the reading order.
+	 *
+	 * Valid text layer is used if there is one, otherwise the page is
+	 * displayed without creating the text layer (so that indexing of all 
+	 * pages of a big document doesn't keep text of all of them). Text is
+	 * encoded by xpdf text encoding.
+	 *
+	 * @param words Output container.
+	 */
+	void getTextWords (Words& words) const;
+
+	/**
+	 * Returns text version of the page.
+	 * Version changes whenever the page text may have changed, so text
+	 * extracted from the page is up to date as long as the version is the
+	 * same.
+	 */
+	size_t getTextVersion () const
+		{ return _textversion; }
+
+	/**
+	 * Registers observer notified whenever the text version changes.
+	 *
+	 * Unlike page observers, these are notified also when only content 
+	 * stream operators change (e.g. by CContentStream).
+	 *
+	 * @param observer Observer to register.
+	 */
+	void registerTextObserver (const observer::ObserverHandler<CPage>::Observer& observer) const
+		{ _textobservers.registerObserver (observer); }
+
+	/**
+	 * Unregisters text observer.
+	 * @param observer Observer to unregister.
+	 * @throw ObserverException if the observer is not registered.
+	 */
+	void unregisterTextObserver (const observer::ObserverHandler<CPage>::Observer& observer) const
+		{ _textobservers.unregisterObserver (observer); }
  
 	/**
 	 * Move contentstream up one level. Which means it will be repainted by less objects.
@@ -413,9 +552,53 @@ private:
 
 	/** 
 	 * Indicate changed page. 
+	 * Drops the text layer and observes streams of actual content streams.
 	 */
 	inline void change (bool invalid = false);
 
+	//
+	// Text layer methods
+	//
+private:
+	/**
+	 * Drops the text layer if it doesn't match actual display params.
+	 */
+	void check_text_layer () const;
+
+	/**
+	 * Returns text device of the text layer. Page is displayed only if there
+	 * is no valid text layer.
+	 */
+	::TextOutputDev& text_layer () const;
+
+	/**
+	 * Fills glyphs of the text layer if they are not there yet.
+	 */
+	void text_layer_glyphs () const;
+
+	/**
+	 * Returns (possibly empty) cached text source of given type.
+	 * @param name Type name of the text source.
+	 */
+	boost::shared_ptr<void>& text_layer_source (const std::string& name);
+
+	/**
+	 * Registers use of the text layer in the document, so that only text 
+	 * layers of recently used pages are kept.
+	 */
+	void touch_text_layer () const;
+
+	/**
+	 * Drops the text layer.
+	 */
+	void invalidate_text_layer () const;
+
+	/**
+	 * Registers watchdog on streams of actual content streams (and unregisters 
+	 * it from streams observed before).
+	 */
+	void sync_stream_observers ();
+
 	//
 	// Helper methods because of cpage not included in headers
 	//
@@ -429,6 +612,10 @@ private:
 	 * Get xpdf display params.
 	 */
 	size_t _page_pos () const;
+	/**
+	 * Get actual display params.
+	 */
+	const DisplayParams& _display_params () const;
 
 
 	//
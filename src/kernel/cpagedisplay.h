@@ -122,6 +122,12 @@ public:
 	 */
 	void setDisplayParams (const DisplayParams& dp);
 
+	/**
+	 * Returns actual display params.
+	 */
+	const DisplayParams& getDisplayParams () const
+		{ return _params; }
+
 	/**
 	 * Draws page on an output device.
 	 * Use old display params.
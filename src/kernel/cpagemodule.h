@@ -68,6 +68,30 @@ public:
 }; // class ICPageModule
 
 
+/**
+ * Holder of a cached text layer.
+ *
+ * Text layer keeps words of the whole page, so CPdf bounds the number of
+ * holders which keep it (see CPdf::setTextLayerLimit). Holders register each
+ * use of their layer by CPdf::useTextLayer and CPdf asks the least recently
+ * used ones to release it.
+ */
+class TextLayerHolder
+{
+public:
+	/**
+	 * Releases the cached text layer.
+	 *
+	 * Layer is extracted again when it is needed, so releasing doesn't change
+	 * the text and must not notify text observers.
+	 */
+	virtual void releaseTextLayer () const = 0;
+	// virutal dtor
+	virtual ~TextLayerHolder () {};
+
+}; // class TextLayerHolder
+
+
 //=====================================================================================
 } // namespace pdfobjects
 //=====================================================================================
@@ -31,8 +31,12 @@
 #include "kernel/factories.h"
 #include "utils/debug.h"
 #include "kernel/cpageattributes.h"
+#include "kernel/cpagemodule.h"
 #include "kernel/pdfedit-core-dev.h"
 #include "kernel/streamwriter.h"
+#include "kernel/pdfwriter.h"
+#include "kernel/mmapstream.h"
+#include "os/threads.h"
 #include <poppler/Stream.h>
 
 using namespace boost;
@@ -47,6 +51,14 @@ namespace pdfobjects
 // initializes global list of alive pdf instances
 CPdf::CPdfListContainer CPdf::allPdfs = CPdf::CPdfListContainer();
 
+namespace {
+
+/** Lock for allPdfs and resolvedRefMapping of all instances.
+ */
+os::Mutex allPdfsLock;
+
+} // namespace
+
 namespace utils 
 {
 
@@ -792,6 +804,83 @@ bool isEncrypted(const boost::shared_ptr<CPdf> &pdf)
  	return (gTrue == pdf->getCXref()->isEncrypted());
 }
 
+namespace {
+
+/** Collects page dictionary references from intermediate node sub tree.
+ * @param interNodeDict Intermediate node dictionary.
+ * @param index Container for references (filled in document order).
+ * @param visited References of already visited nodes.
+ *
+ * Walks page tree same way as findPageDict - only references to leaf or
+ * intermediate nodes from Kids arrays are considered, everything else is
+ * ignored.
+ *
+ * @return false if some node is referenced more times (page tree is
+ * ambiguous), true otherwise.
+ */
+bool collectPageRefs(const boost::shared_ptr<CDict> & interNodeDict, 
+		std::vector<IndiRef> & index, 
+		std::set<IndiRef, IndComparator> & visited)
+{
+	ChildrenStorage children;
+	getKidsFromInterNode(interNodeDict, children);
+	for(ChildrenStorage::const_iterator i=children.begin(); i!=children.end(); ++i)
+	{
+		boost::shared_ptr<IProperty> child=*i;
+		if(!isRef(child))
+			continue;
+		PageTreeNodeType nodeType=getNodeType(child);
+		if(nodeType!=LeafNode && nodeType!=InterNode)
+			continue;
+
+		IndiRef ref=getValueFromSimple<CRef>(child);
+		if(!visited.insert(ref).second)
+		{
+			utilsPrintDbg(DBG_WARN, "Node "<<ref<<" is referenced more times in page tree.");
+			return false;
+		}
+		if(nodeType==LeafNode)
+		{
+			index.push_back(ref);
+			continue;
+		}
+		if(!collectPageRefs(getCObjectFromRef<CDict>(child), index, visited))
+			return false;
+	}
+	return true;
+}
+
+/** Collects intermediate node references from intermediate node sub tree.
+ * @param interNodeDict Intermediate node dictionary.
+ * @param refs Container for references.
+ * @param visited References of already visited nodes.
+ *
+ * Walks page tree same way as collectPageRefs, but only references of 
+ * intermediate nodes are collected. Nodes referenced more times are 
+ * collected only once.
+ */
+void collectInterNodeRefs(const boost::shared_ptr<CDict> & interNodeDict, 
+		std::vector<IndiRef> & refs, 
+		std::set<IndiRef, IndComparator> & visited)
+{
+	ChildrenStorage children;
+	getKidsFromInterNode(interNodeDict, children);
+	for(ChildrenStorage::const_iterator i=children.begin(); i!=children.end(); ++i)
+	{
+		boost::shared_ptr<IProperty> child=*i;
+		if(!isRef(child) || getNodeType(child)!=InterNode)
+			continue;
+
+		IndiRef ref=getValueFromSimple<CRef>(child);
+		if(!visited.insert(ref).second)
+			continue;
+		refs.push_back(ref);
+		collectInterNodeRefs(getCObjectFromRef<CDict>(child), refs, visited);
+	}
+}
+
+} // end of anonymous namespace for page index helpers
+
 } // end of utils namespace
 
 void CPdf::registerPageTreeObservers(boost::shared_ptr<IProperty> & prop)
@@ -1105,6 +1194,7 @@ using namespace utils;
 
 	// invalidates pageCount
 	pdf->pageCount=0;
+	++pdf->pageTreeVersion;
 	
 	// removes and invalidates whole pageList
 	kernelPrintDbg(DBG_DBG, "Invalidating pageList with "<<pdf->pageList.size()<<" elements");
@@ -1114,6 +1204,8 @@ using namespace utils;
 		page->invalidate();
 	}
 	pdf->pageList.clear();
+	pdf->discardBatchPages();
+	pdf->invalidatePageIndex();
 
 	// clears nodeCountCache
 	kernelPrintDbg(DBG_DBG, "Discarding nodeCountCache with "<<pdf->nodeCountCache.size()<<" entries");
@@ -1588,6 +1680,7 @@ void CPdf::initRevisionSpecific()
 		}
 		pageList.clear();
 	}
+	discardBatchPages();
 
 	// cleans up indirect mapping
 	if(indMap.size())
@@ -1597,16 +1690,20 @@ void CPdf::initRevisionSpecific()
 		for(IndirectMapping::iterator i=indMap.begin(); i!=indMap.end(); ++i)
 		{
 			IndiRef ref=i->first;
-			boost::shared_ptr<IProperty> value=i->second;
+			const boost::shared_ptr<IProperty> & value=i->second.value;
 			if(!value.unique())
 				kernelPrintDbg(debug::DBG_WARN, "Somebody still holds property with with "<<ref);
 		}
 		kernelPrintDbg(debug::DBG_DBG, "Cleaning up indirect mapping with "<<indMap.size()<<" elements");
 		indMap.clear();
 	}
+	indMapSweepSize=indMapLimit;
 
-	// invalidates pageCount
+	// invalidates pageCount and page index (pending page batch is lost)
 	pageCount=0;
+	invalidatePageIndex();
+	pageBatch=false;
+	++pageTreeVersion;
 
 	if((docCatalog.get()) && (!docCatalog.unique()))
 		kernelPrintDbg(debug::DBG_WARN, "Document catalog dictionary is held by somebody.");
@@ -1659,13 +1756,23 @@ void CPdf::initRevisionSpecific()
 		registerPageTreeObservers(pageTreeRoot);
 }
 
-CPdf::CPdf(BaseStream * stream, OpenMode openMode)
+CPdf::CPdf(BaseStream * stream, OpenMode openMode, size_t cacheLimit)
 	:pageTreeRootObserver(new PageTreeRootObserver(this)),
 	 pageTreeNodeObserver(new PageTreeNodeObserver(this)),
 	 pageTreeKidsObserver(new PageTreeKidsObserver(this)),
 	 id(NO_PDF_ID),
 	 change(false), 
-	 modeController(NULL)
+	 indMapLimit(cacheLimit),
+	 indMapSweepSize(cacheLimit),
+	 indMapClock(0),
+	 textLayerLimit(DEFAULT_TEXT_LAYER_LIMIT),
+	 pageIndexState(PageIndexInvalid),
+	 pagePositionsDirtyFrom(1),
+	 pageBatch(false),
+	 pageTreeVersion(0),
+	 modeController(NULL),
+	 transactionDepth(0),
+	 deliveringNotifications(false)
 {
 	// gets xref writer - if error occures, exception is thrown 
 	// Note that we can't do anything that could use cobjects here
@@ -1747,12 +1854,14 @@ void CPdf::setPdfId()
 	assert(getCPdfFromId(id) == this);
 	kernelPrintDbg(DBG_DBG, "pdf "<< this 
 			<< " is associated with id=" << id);
+	os::ScopedLock lock(allPdfsLock);
 	CPdf::allPdfs.push_back(id);
 }
 
 void CPdf::releasePdfId()
 {
 	// removes current id from the list of all life pdfs
+	os::ScopedLock lock(allPdfsLock);
 	CPdfListContainer::iterator iter = 
 		std::find(CPdf::allPdfs.begin(), CPdf::allPdfs.end(), id);
 	assert(iter != CPdf::allPdfs.end());
@@ -1780,6 +1889,12 @@ void CPdf::invalidate()
 		i->second->invalidate();
 	}
 	pageList.clear();
+	discardBatchPages();
+	invalidatePageIndex();
+
+	// deferred notifications can't be delivered anymore
+	clearDeferredNotifications();
+	transactionDepth=0;
 
 	// idealy we should unregister page tree observers but as the _this
 	// is no longer valid in this context (last reference to 
@@ -1796,6 +1911,7 @@ void CPdf::invalidate()
 	indMap.clear();
 
 	// clean up resolved reference mapping for different pdf objects
+	os::ScopedLock lock(allPdfsLock);
 	for(ResolvedRefMapping::iterator i=resolvedRefMapping.begin(); 
 			i!=resolvedRefMapping.end(); ++i)
 	{
@@ -1836,8 +1952,9 @@ boost::shared_ptr<IProperty> CPdf::getIndirectProperty(const IndiRef &ref)const
 	IndirectMapping::iterator i = indMap.find(ref);
 	if(i!=indMap.end())
 	{
-		// mapping exists, so returns value
-		return i->second;
+		// mapping exists, so marks it as used and returns value
+		i->second.lastAccess=++indMapClock;
+		return i->second.value;
 	}
 
 	kernelPrintDbg(DBG_DBG, "No mapping for "<<ref);
@@ -1856,9 +1973,14 @@ boost::shared_ptr<IProperty> CPdf::getIndirectProperty(const IndiRef &ref)const
 	// the mapping
 	if(obj->getType()!=objNull)
 	{
+		// makes place for the new entry if the mapping is full
+		if(indMapLimit && indMap.size()>=indMapSweepSize)
+			shrinkIndirectMapping();
+
 		IProperty * prop=utils::createObjFromXpdfObj(_this.lock(), *obj, ref);
 		prop_ptr=boost::shared_ptr<IProperty>(prop);
-		indMap.insert(IndirectMapping::value_type(ref, prop_ptr));
+		indMap.insert(IndirectMapping::value_type(ref, 
+					IndirectEntry(prop_ptr, ++indMapClock)));
 		kernelPrintDbg(DBG_DBG, "Mapping created for "<<ref);
 	}else
 	{
@@ -1869,6 +1991,141 @@ boost::shared_ptr<IProperty> CPdf::getIndirectProperty(const IndiRef &ref)const
 	return prop_ptr;
 }
 
+namespace {
+
+/** Checks whether given property is referenced only by its owner.
+ * @param prop Property to check.
+ * @param holders Number of expected references to the property.
+ *
+ * Property is unreferenced if it is not held by more than holders 
+ * references, has no registered observer and all its direct children 
+ * are unreferenced too (they are held only by their parent). Indirect 
+ * children are not checked because they are just CRef values.
+ *
+ * @return true if property is unreferenced, false otherwise.
+ */
+bool isUnreferenced(const boost::shared_ptr<IProperty> & prop, long holders)
+{
+	if(prop.use_count()>holders || prop->hasObservers())
+		return false;
+
+	// each child is held by its parent and by children container
+	typedef std::vector<boost::shared_ptr<IProperty> > ChildList;
+	ChildList children;
+	switch(prop->getType())
+	{
+		case pDict:
+			IProperty::getSmartCObjectPtr<CDict>(prop)->_getAllChildObjects(children);
+			break;
+		case pArray:
+			IProperty::getSmartCObjectPtr<CArray>(prop)->_getAllChildObjects(children);
+			break;
+		case pStream:
+			IProperty::getSmartCObjectPtr<CStream>(prop)->_getAllChildObjects(children);
+			break;
+		default:
+			return true;
+	}
+	for(ChildList::const_iterator i=children.begin(); i!=children.end(); ++i)
+		if(!isUnreferenced(*i, 2))
+			return false;
+	return true;
+}
+
+/** Comparator for indirect mapping iterators according their last access.
+ */
+struct LessRecentlyUsed
+{
+	bool operator()(const IndirectMapping::iterator & i1, 
+			const IndirectMapping::iterator & i2)const
+	{
+		return i1->second.lastAccess < i2->second.lastAccess;
+	}
+};
+
+} // annonymous namespace
+
+const size_t CPdf::DEFAULT_INDIRECT_CACHE_LIMIT;
+const size_t CPdf::DEFAULT_PAGE_TREE_FANOUT;
+
+void CPdf::shrinkIndirectMapping()const
+{
+	size_t lowWater=indMapLimit/2;
+	kernelPrintDbg(DBG_DBG, "Shrinking indirect mapping with "<<indMap.size()
+			<<" entries (limit="<<indMapLimit<<")");
+
+	// collects all entries which can be dropped and fetched again later
+	typedef std::vector<IndirectMapping::iterator> Candidates;
+	Candidates candidates;
+	for(IndirectMapping::iterator i=indMap.begin(); i!=indMap.end(); ++i)
+	{
+		::Ref ref={i->first.num, i->first.gen};
+		if(xref->isChangedRef(ref))
+			continue;
+		if(isUnreferenced(i->second.value, 1))
+			candidates.push_back(i);
+	}
+
+	// evicts least recently used first
+	size_t toEvict=std::min(candidates.size(), 
+			(indMap.size()>lowWater)?indMap.size()-lowWater:0);
+	std::partial_sort(candidates.begin(), candidates.begin()+toEvict, 
+			candidates.end(), LessRecentlyUsed());
+	for(size_t i=0; i<toEvict; ++i)
+		indMap.erase(candidates[i]);
+
+	// if we couldn't get under the limit, too many objects are in use - so
+	// waits until the mapping doubles its size before next try
+	indMapSweepSize=std::max(indMapLimit, 2*indMap.size());
+	kernelPrintDbg(DBG_INFO, toEvict<<" indirect mappings evicted. "
+			<<indMap.size()<<" entries remain. Next sweep at "<<indMapSweepSize);
+}
+
+void CPdf::setIndirectCacheLimit(size_t limit)
+{
+	kernelPrintDbg(DBG_DBG, "limit="<<limit);
+	indMapLimit=limit;
+	indMapSweepSize=limit;
+	if(indMapLimit && indMap.size()>=indMapSweepSize)
+		shrinkIndirectMapping();
+}
+
+void CPdf::setTextLayerLimit(size_t limit)
+{
+	kernelPrintDbg(DBG_DBG, "limit="<<limit);
+	textLayerLimit=limit;
+	while(textLayerLimit && textLayers.size()>textLayerLimit)
+	{
+		const TextLayerHolder * holder=textLayers.back();
+		textLayers.pop_back();
+		holder->releaseTextLayer();
+	}
+}
+
+void CPdf::useTextLayer(const TextLayerHolder & holder)const
+{
+	std::list<const TextLayerHolder *>::iterator i=std::find(textLayers.begin(), textLayers.end(), &holder);
+	if(i==textLayers.begin() && i!=textLayers.end())
+		return;
+	if(i!=textLayers.end())
+		textLayers.erase(i);
+	textLayers.push_front(&holder);
+
+	// holders are removed before they are asked to release, so that
+	// releaseTextLayer can't see inconsistent list
+	while(textLayerLimit && textLayers.size()>textLayerLimit)
+	{
+		const TextLayerHolder * victim=textLayers.back();
+		textLayers.pop_back();
+		kernelPrintDbg(DBG_DBG, "releasing least recently used text layer");
+		victim->releaseTextLayer();
+	}
+}
+
+void CPdf::forgetTextLayer(const TextLayerHolder & holder)const
+{
+	textLayers.remove(&holder);
+}
 
 IndiRef CPdf::registerIndirectProperty(const boost::shared_ptr<IProperty> &ip, IndiRef &ref)
 {
@@ -2127,7 +2384,16 @@ using namespace boost;
 		// pdf too. We can clearly register with given indiRef
 		kernelPrintDbg(DBG_DBG, "Property from same pdf");
 		IndiRef ref = xref->reserveRef();
-		return registerIndirectProperty(ip, ref);
+		try
+		{
+			return registerIndirectProperty(ip, ref);
+		}catch(...)
+		{
+			// reservation is not used, so returns it back
+			::Ref xpdfRef={ref.num, ref.gen};
+			xref->releaseRef(xpdfRef);
+			throw;
+		}
 	}
 
 	// ip is from different pdf.
@@ -2135,20 +2401,26 @@ using namespace boost;
 	// pdf==null - prop from no pdf - then uses NO_PDF_ID constant). 
 	// It contains mappings from such pdf indirect reference to coresponding 
 	// newly created reference for this pdf.
+	// ipPdf instance is held above, so its storage can't be released while 
+	// it is used below. Other instances may remove their entries
+	// concurrently, though.
 	cpdf_id_t id=(ipPdf)?ipPdf->getId():CPdf::NO_PDF_ID;
-	ResolvedRefMapping::iterator i=resolvedRefMapping.find(id);
 	ResolvedRefStorage * resolvedStorage;
-	if(i==resolvedRefMapping.end())
-	{
-		// creates new storage and insert mapping and associates it with ip's
-		// pdf (represented by its id and newly created resolvedStorage).
-		resolvedStorage=new ResolvedRefStorage();
-		resolvedRefMapping.insert(ResolvedRefMapping::value_type(id, resolvedStorage));
-		kernelPrintDbg(DBG_DBG, "No resolvedRefMapping entry for "<<id
-				<<" pdf. Created new entry");
-	}else
-		// uses already created storage
-		resolvedStorage=i->second;
+	{
+		os::ScopedLock lock(allPdfsLock);
+		ResolvedRefMapping::iterator i=resolvedRefMapping.find(id);
+		if(i==resolvedRefMapping.end())
+		{
+			// creates new storage and insert mapping and associates it with ip's
+			// pdf (represented by its id and newly created resolvedStorage).
+			resolvedStorage=new ResolvedRefStorage();
+			resolvedRefMapping.insert(ResolvedRefMapping::value_type(id, resolvedStorage));
+			kernelPrintDbg(DBG_DBG, "No resolvedRefMapping entry for "<<id
+					<<" pdf. Created new entry");
+		}else
+			// uses already created storage
+			resolvedStorage=i->second;
+	}
 
 	// If given ip is indirect and there already is mapping in resolvedStorage,
 	// this property or reference to it has already been processed
@@ -2295,7 +2567,7 @@ public:
 	}
 };
 
-boost::shared_ptr<CPdf> CPdf::getInstance(const char * filename, OpenMode mode)
+boost::shared_ptr<CPdf> CPdf::getInstance(const char * filename, OpenMode mode, size_t cacheLimit, bool mapFile)
 {
 using namespace std;
 
@@ -2330,14 +2602,30 @@ using namespace std;
 	Object obj;
 	obj.initNull();
 
-    BaseStream *stream = new FileStream((GooFile*)file, 0, gFalse, 0, &obj);
-	kernelPrintDbg(debug::DBG_DBG,"File stream created");
+	BaseStream *stream = NULL;
+	if(mapFile)
+	{
+		if(mode == ReadOnly)
+			stream = MmapStream::create(file, &obj);
+		else
+			kernelPrintDbg(debug::DBG_INFO, "Memory mapping is not used for mode="
+					<< mode);
+		if(stream)
+			kernelPrintDbg(debug::DBG_DBG,"Memory mapped stream created");
+	}
+	if(!stream)
+	{
+		// file handle is used also for writing (if opened for it) because 
+		// GooFile is read only
+		stream = new FileStreamWriter((GooFile*)file, 0, gFalse, 0, &obj, file);
+		kernelPrintDbg(debug::DBG_DBG,"File stream writer created");
+	}
 
 	// stream is ready, creates CPdf instance
 	boost::shared_ptr<CPdf> instance;
 	try
 	{
-		instance = boost::shared_ptr<CPdf>(new CPdf(stream, mode), PdfFileDeleter(file));
+		instance = boost::shared_ptr<CPdf>(new CPdf(stream, mode, cacheLimit), PdfFileDeleter(file));
 		instance->_this = instance;
 
 		// initializes revision specific data for the newest revision
@@ -2387,6 +2675,18 @@ using namespace utils;
 		throw PageNotFoundException(pos);
 	}
 
+	// pages are kept by their references during page batch
+	if(pageBatch)
+	{
+		BatchPages::const_iterator i=batchPages.find(pageIndex[pos-1]);
+		if(i!=batchPages.end())
+			return i->second;
+		boost::shared_ptr<CDict> pageDict_ptr=IProperty::getSmartCObjectPtr<CDict>(getIndirectProperty(pageIndex[pos-1]));
+		boost::shared_ptr<CPage> page_ptr(CPageFactory::getInstance(pageDict_ptr));
+		batchPages.insert(BatchPages::value_type(pageIndex[pos-1], page_ptr));
+		return page_ptr;
+	}
+
 	// checks if page is available in pageList
 	PageList::const_iterator i;
 	if((i=pageList.find(pos))!=pageList.end())
@@ -2395,13 +2695,27 @@ using namespace utils;
 		return i->second;
 	}
 
-	// page is not available in pageList, searching has to be done
+	// page is not available in pageList, uses flat page index if possible
+	boost::shared_ptr<CDict> pageDict_ptr;
+	if(ensurePageIndex() && pos<=pageIndex.size())
+	{
+		boost::shared_ptr<IProperty> pageProp=getIndirectProperty(pageIndex[pos-1]);
+		if(isDict(pageProp))
+			pageDict_ptr=IProperty::getSmartCObjectPtr<CDict>(pageProp);
+		else
+			kernelPrintDbg(DBG_WARN, "Indexed page "<<pageIndex[pos-1]<<" is not dictionary.");
+	}
+
+	// searching has to be done
 	// find throws an exception if any problem found, otherwise pageDict_ptr
 	// contians Page dictionary at specified position.
-	boost::shared_ptr<CDict> rootPages_ptr=getPageTreeRoot(_this.lock());
-	if(!rootPages_ptr.get())
-		throw PageNotFoundException(pos);
-	boost::shared_ptr<CDict> pageDict_ptr=findPageDict(_this.lock(), rootPages_ptr, 1, pos, &nodeCountCache);
+	if(!pageDict_ptr.get())
+	{
+		boost::shared_ptr<CDict> rootPages_ptr=getPageTreeRoot(_this.lock());
+		if(!rootPages_ptr.get())
+			throw PageNotFoundException(pos);
+		pageDict_ptr=findPageDict(_this.lock(), rootPages_ptr, 1, pos, &nodeCountCache);
+	}
 
 	// creates CPage instance from page dictionary and stores it to the pageList
 	CPage * page=CPageFactory::getInstance(pageDict_ptr);
@@ -2420,6 +2734,10 @@ using namespace utils;
 	
 	check_need_credentials(xref);
 
+	// page tree is not up to date during page batch
+	if(pageBatch)
+		return pageIndex.size();
+
 	// try to use cached value - if zero, we have to get it from Page tree root
 	if(pageCount)
 	{
@@ -2488,6 +2806,27 @@ size_t CPdf::getPagePosition(const boost::shared_ptr<CPage> &page)const
 		
 	check_need_credentials(xref);
 
+	// gets position from page index and checks that the page has been
+	// returned for that position
+	boost::shared_ptr<CDict> pageDict=page->getDictionary();
+	size_t pos=(pageDict)?getIndexedPagePosition(pageDict->getIndiRef()):0;
+	if(pageBatch)
+	{
+		BatchPages::const_iterator i=(pageDict)?batchPages.find(pageDict->getIndiRef()):batchPages.end();
+		if(pos && i!=batchPages.end() && i->second==page)
+			return pos;
+		throw PageNotFoundException();
+	}
+	if(pos)
+	{
+		PageList::const_iterator i=pageList.find(pos);
+		if(i!=pageList.end() && i->second==page)
+		{
+			kernelPrintDbg(DBG_DBG, "Page found at pos="<<pos);
+			return pos;
+		}
+	}
+
 	// search in returned page list
 	PageList::iterator i;
 	for(i=pageList.begin(); i!=pageList.end(); ++i)
@@ -2505,6 +2844,149 @@ size_t CPdf::getPagePosition(const boost::shared_ptr<CPage> &page)const
 	throw PageNotFoundException();
 }
 
+void CPdf::invalidatePageIndex()const
+{
+	kernelPrintDbg(DBG_DBG, "Discarding page index with "<<pageIndex.size()<<" entries");
+	pageIndexState=PageIndexInvalid;
+	pageIndex.clear();
+	pagePositions.clear();
+	pagePositionsDirtyFrom=1;
+}
+
+bool CPdf::ensurePageIndex()const
+{
+using namespace utils;
+
+	if(pageIndexState!=PageIndexInvalid)
+		return pageIndexState==PageIndexReady;
+
+	kernelPrintDbg(DBG_DBG, "Building page index");
+	invalidatePageIndex();
+	pageIndexState=PageIndexUnusable;
+	boost::shared_ptr<CDict> rootDict=getPageTreeRoot(_this.lock());
+	if(!rootDict.get())
+		return false;
+	
+	std::set<IndiRef, IndComparator> visited;
+	visited.insert(rootDict->getIndiRef());
+	bool unambiguous;
+	try
+	{
+		unambiguous=collectPageRefs(rootDict, pageIndex, visited);
+	}catch(CObjectException & e)
+	{
+		kernelPrintDbg(DBG_WARN, "Page tree walking failed. cause="<<e.what());
+		unambiguous=false;
+	}
+	if(!unambiguous || pageIndex.size()!=getPageCount())
+	{
+		kernelPrintDbg(DBG_WARN, "Page tree can't be flattened (indexed="
+				<<pageIndex.size()<<" pageCount="<<getPageCount()
+				<<"). Page tree searching will be used.");
+		pageIndex.clear();
+		return false;
+	}
+
+	// reverse mapping is filled lazily by getIndexedPagePosition
+	pagePositionsDirtyFrom=1;
+	pageIndexState=PageIndexReady;
+	kernelPrintDbg(DBG_DBG, "Page index built with "<<pageIndex.size()<<" pages");
+	return true;
+}
+
+size_t CPdf::getIndexedPagePosition(const IndiRef & ref)const
+{
+	if(!ensurePageIndex())
+		return 0;
+
+	// cached position is valid only if it is not stale and the index still
+	// contains given reference there
+	if(ref.num<pagePositions.size())
+	{
+		size_t pos=pagePositions[ref.num];
+		if(pos && pos<pagePositionsDirtyFrom && pageIndex[pos-1]==ref)
+			return pos;
+	}
+	
+	// nothing has changed since the last refresh - ref is not indexed
+	if(pagePositionsDirtyFrom>pageIndex.size())
+		return 0;
+
+	// refreshes all stale positions
+	for(size_t pos=pagePositionsDirtyFrom; pos<=pageIndex.size(); ++pos)
+	{
+		size_t num=pageIndex[pos-1].num;
+		if(num>=pagePositions.size())
+			pagePositions.resize(num+1, 0);
+		pagePositions[num]=pos;
+	}
+	pagePositionsDirtyFrom=pageIndex.size()+1;
+
+	if(ref.num<pagePositions.size())
+	{
+		size_t pos=pagePositions[ref.num];
+		if(pos && pos<=pageIndex.size() && pageIndex[pos-1]==ref)
+			return pos;
+	}
+	return 0;
+}
+
+void CPdf::consolidatePageIndex(const boost::shared_ptr<IProperty> & oldValue, const boost::shared_ptr<IProperty> & newValue)
+{
+using namespace utils;
+
+	// changes in unusable index could have fixed the page tree so it will be
+	// built again
+	if(pageIndexState!=PageIndexReady)
+	{
+		invalidatePageIndex();
+		return;
+	}
+
+	// only single pages are handled incrementally
+	bool oldPage=!isNull(oldValue), newPage=!isNull(newValue);
+	if((oldPage && getNodeType(oldValue)!=LeafNode) 
+			|| (newPage && getNodeType(newValue)!=LeafNode)
+			|| (!oldPage && !newPage))
+	{
+		invalidatePageIndex();
+		return;
+	}
+
+	size_t pos=0;
+	if(oldPage)
+	{
+		// removed resp. replaced page is still in the index
+		pos=getIndexedPagePosition(getValueFromSimple<CRef>(oldValue));
+	}else
+	{
+		// new page is already in the page tree
+		try
+		{
+			pos=getNodePosition(_this.lock(), newValue, &nodeCountCache);
+		}catch(std::exception & e)
+		{
+			kernelPrintDbg(DBG_WARN, "Couldn't get newValue position. reason="<<e.what());
+		}
+		if(pos>pageIndex.size()+1)
+			pos=0;
+	}
+	if(!pos)
+	{
+		invalidatePageIndex();
+		return;
+	}
+
+	if(oldPage && newPage)
+		pageIndex[pos-1]=getValueFromSimple<CRef>(newValue);
+	else if(oldPage)
+		pageIndex.erase(pageIndex.begin()+(pos-1));
+	else
+		pageIndex.insert(pageIndex.begin()+(pos-1), getValueFromSimple<CRef>(newValue));
+	pagePositionsDirtyFrom=std::min(pagePositionsDirtyFrom, pos);
+	kernelPrintDbg(DBG_DBG, "Page index updated at pos="<<pos<<" size="<<pageIndex.size());
+}
+
 
 void CPdf::consolidatePageList(const boost::shared_ptr<IProperty> & oldValue, const boost::shared_ptr<IProperty> & newValue)
 {
@@ -2512,6 +2994,12 @@ using namespace utils;
 
 	kernelPrintDbg(DBG_DBG, "");
 
+	++pageTreeVersion;
+
+	// flat page index is updated before pageList because it uses 
+	// the original state of the index
+	consolidatePageIndex(oldValue, newValue);
+
 	// correction for all pages affected by this subtree change
 	int difference=0;
 
@@ -2901,6 +3389,57 @@ using namespace utils;
 	return !countChanged;
 }
 
+IndiRef CPdf::addPageDictionary(const boost::shared_ptr<CPage> &page)
+{
+using namespace utils;
+
+	boost::shared_ptr<CDict> pageDict=page->getDictionary();
+	boost::shared_ptr<CPdf> pageDictPdf = pageDict->getPdf().lock();
+	if(pageDictPdf && pageDictPdf !=_this.lock())
+	{
+		// page comes from different valid pdf - we have to create clone and
+		// remove Parent field from it. Also inheritable properties have to be
+		// handled
+		IndiRef pageDictIndiRef=pageDict->getIndiRef();
+		pageDict=IProperty::getSmartCObjectPtr<CDict>(pageDict->clone());
+		pageDict->delProperty("Parent");
+
+		// clone needs to set pdf and indirect, because these values are not
+		// cloned and they are needed for indirect properties dereferencing
+		// (pdf) and for internal referencies (some of pageDict members may
+		// refer to page). This implies that pageDict has to be locked for
+		// dispatchChange.
+		pageDict->lockChange();
+		pageDict->setPdf(pageDictPdf);
+		pageDict->setIndiRef(pageDictIndiRef);
+		CPageAttributes::setInheritable(pageDict);
+	}
+
+	// Adds pageDict as new indirect property (also with properties referenced 
+	// by this dictionary) if it comes from different pdf. Otherwise simply
+	// add reference.
+	IndiRef pageRef;
+	if(pageDict->getPdf().lock() == _this.lock())
+	{	
+		try
+		{
+			size_t pos = getPagePosition(page);
+			kernelPrintDbg(debug::DBG_ERR, "Page " 
+					<< pageDict->getIndiRef() 
+					<< " is already in the pdf at "<<
+					pos << " position");
+			throw AmbiguousPageTreeException();
+		}catch (PageNotFoundException &)
+		{
+			pageRef=pageDict->getIndiRef();
+		}
+	}
+	else
+		pageRef=addIndirectProperty(pageDict, true);
+
+	return pageRef;
+}
+
 boost::shared_ptr<CPage> CPdf::insertPage(const boost::shared_ptr<CPage> &page, size_t pos)
 {
 using namespace utils;
@@ -2919,6 +3458,28 @@ using namespace utils;
 	if(pos==0)
 		pos=1;
 
+	// page tree is rebuilt at the end of batch, so just page index is updated
+	if(pageBatch)
+	{
+		if(pos>pageIndex.size())
+			pos=pageIndex.size()+1;
+		IndiRef pageRef=addPageDictionary(page);
+		if(getIndexedPagePosition(pageRef))
+		{
+			kernelPrintDbg(DBG_ERR, "Page "<<pageRef<<" is already in the batch");
+			throw AmbiguousPageTreeException();
+		}
+		pageIndex.insert(pageIndex.begin()+(pos-1), pageRef);
+		pagePositionsDirtyFrom=std::min(pagePositionsDirtyFrom, pos);
+		++pageTreeVersion;
+
+		boost::shared_ptr<CDict> newPageDict_ptr=IProperty::getSmartCObjectPtr<CDict>(getIndirectProperty(pageRef));
+		boost::shared_ptr<CPage> newPage_ptr(CPageFactory::getInstance(newPageDict_ptr));
+		batchPages.insert(BatchPages::value_type(pageRef, newPage_ptr));
+		kernelPrintDbg(DBG_DBG, "Page inserted to batch at pos="<<pos);
+		return newPage_ptr;
+	}
+
 	// gets intermediate node which includes node at given position. To enable
 	// also to insert after last page, following work around is done:
 	// if page is greater than page count, append flag is set to true and so new
@@ -2991,49 +3552,7 @@ using namespace utils;
 
 	// Now it is safe to add indirect object, because there is nothing that can
 	// fail
-	boost::shared_ptr<CDict> pageDict=page->getDictionary();
-	boost::shared_ptr<CPdf> pageDictPdf = pageDict->getPdf().lock();
-	if(pageDictPdf && pageDictPdf !=_this.lock())
-	{
-		// page comes from different valid pdf - we have to create clone and
-		// remove Parent field from it. Also inheritable properties have to be
-		// handled
-		IndiRef pageDictIndiRef=pageDict->getIndiRef();
-		pageDict=IProperty::getSmartCObjectPtr<CDict>(pageDict->clone());
-		pageDict->delProperty("Parent");
-
-		// clone needs to set pdf and indirect, because these values are not
-		// cloned and they are needed for indirect properties dereferencing
-		// (pdf) and for internal referencies (some of pageDict members may
-		// refer to page). This implies that pageDict has to be locked for
-		// dispatchChange.
-		pageDict->lockChange();
-		pageDict->setPdf(pageDictPdf);
-		pageDict->setIndiRef(pageDictIndiRef);
-		CPageAttributes::setInheritable(pageDict);
-	}
-
-	// Adds pageDict as new indirect property (also with properties referenced 
-	// by this dictionary) if it comes from different pdf. Otherwise simply
-	// add reference.
-	IndiRef pageRef;
-	if(pageDict->getPdf().lock() == _this.lock())
-	{	
-		try
-		{
-			size_t pos = getPagePosition(page);
-			kernelPrintDbg(debug::DBG_ERR, "Page " 
-					<< pageDict->getIndiRef() 
-					<< " is already in the pdf at "<<
-					pos << " position");
-			throw AmbiguousPageTreeException();
-		}catch (PageNotFoundException &)
-		{
-			pageRef=pageDict->getIndiRef();
-		}
-	}
-	else
-		pageRef=addIndirectProperty(pageDict, true);
+	IndiRef pageRef=addPageDictionary(page);
 
 	// adds newly created page dictionary to the kids array at kidsIndex
 	// position. This triggers pageTreeWatchDog for consolidation and observer
@@ -3069,6 +3588,22 @@ using namespace utils;
 	if(!POSITION_IN_RANGE(pos))
 		throw PageNotFoundException(pos);
 
+	// page tree is rebuilt at the end of batch, so just page index is updated
+	if(pageBatch)
+	{
+		BatchPages::iterator i=batchPages.find(pageIndex[pos-1]);
+		if(i!=batchPages.end())
+		{
+			i->second->invalidate();
+			batchPages.erase(i);
+		}
+		pageIndex.erase(pageIndex.begin()+(pos-1));
+		pagePositionsDirtyFrom=std::min(pagePositionsDirtyFrom, pos);
+		++pageTreeVersion;
+		kernelPrintDbg(DBG_DBG, "Page removed from batch at pos="<<pos);
+		return;
+	}
+
 	// Searches for page dictionary at given pos and gets its reference.
 	// getPageTreeRoot doesn't fail, because we are in page range and so it has
 	// to exist
@@ -3108,6 +3643,357 @@ using namespace utils;
 	// pageList at this moment
 }
 
+void CPdf::discardBatchPages()const
+{
+	for(BatchPages::iterator i=batchPages.begin(); i!=batchPages.end(); ++i)
+		i->second->invalidate();
+	batchPages.clear();
+}
+
+void CPdf::beginPageBatch()
+{
+	kernelPrintDbg(DBG_DBG, "");
+
+	check_need_credentials(xref);
+
+	if(getMode()==ReadOnly)
+	{
+		kernelPrintDbg(DBG_ERR, "Document is in read-only mode now");
+		throw ReadOnlyDocumentException("Document is in read-only mode.");
+	}
+	if(pageBatch)
+	{
+		kernelPrintDbg(DBG_WARN, "Page batch is already active");
+		return;
+	}
+	if(!utils::getPageTreeRoot(_this.lock()).get())
+		throw NoPageRootException();
+	if(!ensurePageIndex())
+	{
+		kernelPrintDbg(DBG_ERR, "Page tree can't be flattened");
+		throw AmbiguousPageTreeException();
+	}
+	// returned pages are kept by reference until the batch is committed
+	for(PageList::iterator i=pageList.begin(); i!=pageList.end(); ++i)
+		batchPages.insert(BatchPages::value_type(pageIndex[i->first-1], i->second));
+	pageList.clear();
+	pageBatch=true;
+	kernelPrintDbg(DBG_INFO, "Page batch started with "<<pageIndex.size()<<" pages");
+}
+
+size_t CPdf::buildPageTreeNode(const boost::shared_ptr<CDict> & node, 
+		size_t begin, size_t end, size_t fanOut, size_t height)
+{
+using namespace utils;
+
+	size_t count=end-begin;
+	CRef parentCRef(node->getIndiRef());
+	boost::shared_ptr<CArray> kids(CArrayFactory::getInstance());
+	if(height<=1)
+	{
+		assert(count<=fanOut);
+		// direct pages
+		for(size_t i=begin; i<end; ++i)
+		{
+			boost::shared_ptr<CDict> pageDict=IProperty::getSmartCObjectPtr<CDict>(getIndirectProperty(pageIndex[i]));
+			pageDict->setProperty("Parent", parentCRef);
+			CRef pageCRef(pageIndex[i]);
+			kids->addProperty(pageCRef);
+		}
+	}else
+	{
+		// each child sub tree has height-1 levels and so it can hold
+		// fanOut^(height-1) pages. Pages are distributed evenly to as few 
+		// children as possible, which means that each child gets at least 
+		// one page and all children are built with the same height.
+		size_t childCapacity=1;
+		for(size_t level=1; level<height; ++level)
+			childCapacity*=fanOut;
+		size_t children=(count+childCapacity-1)/childCapacity;
+		assert(children<=fanOut);
+		size_t childBegin=begin;
+		for(size_t child=0; child<children; ++child)
+		{
+			size_t childEnd=childBegin+count/children+((child<count%children)?1:0);
+
+			// creates new intermediate node - Parent has to be set after node
+			// is added, otherwise reference would be resolved as a reference
+			// to the different document
+			boost::shared_ptr<CDict> childDict(CDictFactory::getInstance());
+			boost::scoped_ptr<CName> type(CNameFactory::getInstance("Pages"));
+			childDict->addProperty("Type", *type);
+			IndiRef childRef=addIndirectProperty(childDict);
+			boost::shared_ptr<CDict> childNode=IProperty::getSmartCObjectPtr<CDict>(getIndirectProperty(childRef));
+			childNode->addProperty("Parent", parentCRef);
+			buildPageTreeNode(childNode, childBegin, childEnd, fanOut, height-1);
+
+			CRef childCRef(childRef);
+			kids->addProperty(childCRef);
+			childBegin=childEnd;
+		}
+		assert(childBegin==end);
+	}
+
+	node->setProperty("Kids", *kids);
+	boost::scoped_ptr<CInt> countInt(CIntFactory::getInstance(count));
+	node->setProperty("Count", *countInt);
+	return count;
+}
+
+void CPdf::commitPageBatch(size_t fanOut)
+{
+using namespace utils;
+
+	kernelPrintDbg(DBG_DBG, "fanOut="<<fanOut);
+
+	check_need_credentials(xref);
+
+	if(getMode()==ReadOnly)
+	{
+		kernelPrintDbg(DBG_ERR, "Document is in read-only mode now");
+		throw ReadOnlyDocumentException("Document is in read-only mode.");
+	}
+	if(fanOut<2)
+		fanOut=2;
+
+	boost::shared_ptr<IProperty> rootProp=getPageTreeRoot(_this.lock());
+	if(!rootProp.get())
+		throw NoPageRootException();
+	if(!ensurePageIndex())
+	{
+		kernelPrintDbg(DBG_ERR, "Page tree can't be flattened");
+		throw AmbiguousPageTreeException();
+	}
+	boost::shared_ptr<CDict> rootDict=IProperty::getSmartCObjectPtr<CDict>(rootProp);
+
+	// page tree observers would consider all moved pages as removed ones,
+	// so they are unregistered during rebuild and the page tree related
+	// state is updated manualy
+	unregisterPageTreeObservers(rootProp, true);
+
+	// original intermediate nodes won't be used anymore, so all inherited
+	// attributes have to be stored directly in pages
+	for(size_t i=0; i<pageIndex.size(); ++i)
+	{
+		boost::shared_ptr<CDict> pageDict=IProperty::getSmartCObjectPtr<CDict>(getIndirectProperty(pageIndex[i]));
+		CPageAttributes::setInheritable(pageDict);
+	}
+	std::vector<IndiRef> oldNodes;
+	std::set<IndiRef, IndComparator> visited;
+	collectInterNodeRefs(rootDict, oldNodes, visited);
+
+	// the smallest height which can hold all pages - all pages are placed 
+	// in this depth
+	size_t height=1;
+	for(size_t capacity=fanOut; capacity<pageIndex.size(); capacity*=fanOut)
+		++height;
+	size_t count=buildPageTreeNode(rootDict, 0, pageIndex.size(), fanOut, height);
+	kernelPrintDbg(DBG_INFO, "Page tree rebuilt with "<<count<<" pages (fanOut="
+			<<fanOut<<", height="<<height<<")");
+
+	// original intermediate nodes are not referenced anymore
+	for(std::vector<IndiRef>::const_iterator i=oldNodes.begin(); i!=oldNodes.end(); ++i)
+	{
+		::Ref ref={i->num, i->gen};
+		indMap.erase(*i);
+		xref->freeRef(ref);
+	}
+	kernelPrintDbg(DBG_DBG, oldNodes.size()<<" original intermediate nodes freed");
+
+	// page order hasn't changed, so page index is still valid and pageList
+	// is built from pages returned during batch
+	if(pageBatch)
+	{
+		for(size_t i=0; i<pageIndex.size(); ++i)
+		{
+			BatchPages::iterator page=batchPages.find(pageIndex[i]);
+			if(page!=batchPages.end())
+				pageList.insert(pageList.end(), PageList::value_type(i+1, page->second));
+		}
+		batchPages.clear();
+	}
+	utils::clearCache(nodeCountCache);
+	utils::clearCache(pageTreeKidsParentCache);
+	pageBatch=false;
+	pageCount=count;
+	registerPageTreeObservers(rootProp);
+}
+
+void CPdf::commitTransaction()
+{
+	if(!transactionDepth)
+	{
+		kernelPrintDbg(DBG_WARN, "No active transaction");
+		return;
+	}
+	if(--transactionDepth)
+		return;
+
+	kernelPrintDbg(DBG_DBG, "Delivering "<<deferredNotifications.size()<<" deferred notifications");
+	deliverDeferredNotifications();
+}
+
+void CPdf::abortTransaction()
+{
+	if(!transactionDepth)
+	{
+		kernelPrintDbg(DBG_WARN, "No active transaction");
+		return;
+	}
+	if(--transactionDepth)
+		return;
+
+	// changes stay applied even though transaction is left because of an
+	// error, so observers have to get them. Notifications deferred during 
+	// delivery are delivered by the running loop
+	if(deferredNotifications.size())
+		kernelPrintDbg(DBG_WARN, "Delivering "<<deferredNotifications.size()
+				<<" deferred notifications of aborted transaction");
+	deliverDeferredNotifications(true);
+}
+
+bool CPdf::deferNotification(IProperty * subject, 
+		const boost::shared_ptr<IProperty> & newValue, 
+		const boost::shared_ptr<const IPropertyObserverSubject::ObserverContext> & context)
+{
+	if(!transactionDepth || !context)
+		return false;
+
+	// dictionary entries are coalesced separately, changes of arrays can't
+	// be coalesced because positions of other elements may have changed
+	// meanwhile, so they are kept in order
+	std::string valueId;
+	bool coalesce=(subject->getType()!=pArray);
+	if(coalesce && context->getType()==observer::ComplexChangeContextType)
+	{
+		boost::shared_ptr<const CDict::CDictComplexObserverContext> dictContext=
+			dynamic_pointer_cast<const CDict::CDictComplexObserverContext, 
+			const IPropertyObserverSubject::ObserverContext>(context);
+		if(!dictContext)
+			return false;
+		valueId=dictContext->getValueId();
+	}
+
+	DeferredNotificationsIndex::key_type key(subject, valueId);
+	DeferredNotificationsIndex::iterator i=deferredNotificationsIndex.find(key);
+	if(coalesce && i!=deferredNotificationsIndex.end())
+	{
+		// keeps the original context and updates value
+		deferredNotifications[i->second].newValue=newValue;
+		return true;
+	}
+
+	DeferredNotification notification;
+	notification.subject=subject;
+	notification.valueId=valueId;
+	notification.newValue=newValue;
+	notification.context=context;
+	deferredNotificationsIndex.insert(DeferredNotificationsIndex::value_type(key, deferredNotifications.size()));
+	deferredNotifications.push_back(notification);
+	subject->notificationDeferred=true;
+	return true;
+}
+
+void CPdf::forgetDeferredNotifications(const IProperty * subject)
+{
+	DeferredNotificationsIndex::iterator i=deferredNotificationsIndex.lower_bound(
+			DeferredNotificationsIndex::key_type(subject, std::string()));
+	while(i!=deferredNotificationsIndex.end() && i->first.first==subject)
+	{
+		deferredNotifications[i->second].subject=NULL;
+		deferredNotificationsIndex.erase(i++);
+	}
+}
+
+void CPdf::notifyObserversContained(IProperty & subject, 
+		const boost::shared_ptr<IProperty> & newValue, 
+		const boost::shared_ptr<const IPropertyObserverSubject::ObserverContext> & context)
+{
+	// observers may unregister themselves when notified
+	IPropertyObserverSubject::ObserverList observers=subject.observers;
+	for(IPropertyObserverSubject::ObserverList::const_iterator i=observers.begin(); 
+			i!=observers.end(); ++i)
+	{
+		try
+		{
+			if((*i)->isActive())
+				(*i)->notify(newValue, context);
+		}catch(std::exception & e)
+		{
+			kernelPrintDbg(DBG_ERR, "Observer failed with \""<<e.what()<<"\"");
+		}catch(...)
+		{
+			kernelPrintDbg(DBG_ERR, "Observer failed with unknown exception");
+		}
+	}
+}
+
+void CPdf::deliverDeferredNotifications(bool containErrors)
+{
+	// notifications deferred by observers are appended and delivered by the
+	// running loop
+	if(deliveringNotifications)
+		return;
+
+	// resets delivery state on every path (also when an observer throws),
+	// so that the following transactions are not blocked
+	struct DeliveryGuard
+	{
+		CPdf & pdf;
+		DeliveryGuard(CPdf & p):pdf(p)
+		{
+			pdf.deliveringNotifications=true;
+		}
+		~DeliveryGuard()
+		{
+			pdf.clearDeferredNotifications();
+			pdf.deliveringNotifications=false;
+		}
+	} guard(*this);
+
+	// subjects keep notificationDeferred flag until all their notifications 
+	// are delivered so that they are forgotten if the subject is destroyed
+	// by an observer
+	for(size_t i=0; i<deferredNotifications.size(); ++i)
+	{
+		DeferredNotification notification=deferredNotifications[i];
+		if(!notification.subject)
+			continue;
+		deferredNotifications[i].subject=NULL;
+		std::pair<DeferredNotificationsIndex::iterator, DeferredNotificationsIndex::iterator> range=
+			deferredNotificationsIndex.equal_range(
+				DeferredNotificationsIndex::key_type(notification.subject, notification.valueId));
+		// equal keys (array changes) keep insertion order, so the first 
+		// one matches
+		for(DeferredNotificationsIndex::iterator j=range.first; j!=range.second; ++j)
+			if(j->second==i)
+			{
+				deferredNotificationsIndex.erase(j);
+				break;
+			}
+		DeferredNotificationsIndex::iterator next=deferredNotificationsIndex.lower_bound(
+				DeferredNotificationsIndex::key_type(notification.subject, std::string()));
+		if(next==deferredNotificationsIndex.end() || next->first.first!=notification.subject)
+			notification.subject->notificationDeferred=false;
+		if(containErrors)
+			notifyObserversContained(*notification.subject, 
+					notification.newValue, notification.context);
+		else
+			notification.subject->IPropertyObserverSubject::notifyObservers(
+					notification.newValue, notification.context);
+	}
+}
+
+void CPdf::clearDeferredNotifications()
+{
+	for(DeferredNotifications::iterator i=deferredNotifications.begin();
+			i!=deferredNotifications.end(); ++i)
+		if(i->subject)
+			i->subject->notificationDeferred=false;
+	deferredNotifications.clear();
+	deferredNotificationsIndex.clear();
+}
+
 void CPdf::save(bool newRevision)const
 {
 	kernelPrintDbg(DBG_DBG, "");
@@ -3137,6 +4023,33 @@ void CPdf::save(bool newRevision)const
 	change=false;
 }
 
+void CPdf::setPdfWriter(utils::IPdfWriter * writer)
+{
+	kernelPrintDbg(DBG_DBG, "");
+
+	if(!writer)
+		return;
+	utils::IPdfWriter * old=xref->setPdfWriter(writer);
+	if(old && old!=writer)
+		delete old;
+}
+
+void CPdf::setCompressionPolicy(const utils::CompressionPolicy & policy)
+{
+	kernelPrintDbg(DBG_DBG, "level="<<policy.level
+			<<" storeThreshold="<<policy.storeThreshold
+			<<" passthrough="<<policy.passthrough);
+
+	// setPdfWriter with NULL doesn't change anything and returns current one
+	utils::IPdfWriter * writer=xref->setPdfWriter(NULL);
+	if(!writer)
+	{
+		kernelPrintDbg(DBG_WARN, "No pdf writer set. Ignoring compression policy.");
+		return;
+	}
+	writer->setCompressionPolicy(policy);
+}
+
 void CPdf::clone(FILE * file)const
 {
 using namespace debug;
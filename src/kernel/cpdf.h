@@ -33,6 +33,7 @@
 #include "kernel/iproperty.h"
 #include "kernel/cstream.h"
 #include <poppler/Stream.h>
+#include <exception>
 
 class StreamWriter;
 
@@ -43,6 +44,7 @@ class IProperty;
 class CDict;
 class CXref;
 class CPage;
+class TextLayerHolder;
 template<typename IP> inline boost::shared_ptr<CDict> getCDictFromDict (IP& ip, const std::string& key);
 
 namespace utils {
@@ -50,6 +52,7 @@ namespace utils {
 template<typename Container> void getAllChildrenOfPdfObject (boost::shared_ptr<CDict> topdict, Container& cont);
 
 class IPdfWriter;
+struct CompressionPolicy;
 
 /**
  * Indirect referencies comparator.
@@ -129,10 +132,29 @@ typedef std::pair<IndiRef, enum ResolveRefState> ResolvedRefEntry;
  */
 typedef std::map<IndiRef, ResolvedRefEntry*, utils::IndComparator > ResolvedRefStorage;
 
+/** Entry of the indirect properties mapping.
+ *
+ * Holds the property value together with the access stamp which is used to
+ * find the least recently used entries when the mapping has to be shrunk.
+ */
+struct IndirectEntry
+{
+	/** Indirect property value.
+	 */
+	boost::shared_ptr<IProperty> value;
+
+	/** Value of CPdf::indMapClock when the entry was accessed last time.
+	 */
+	unsigned long lastAccess;
+
+	IndirectEntry(const boost::shared_ptr<IProperty> & v, unsigned long stamp)
+		:value(v), lastAccess(stamp) {}
+};
+
 /**
  * Indirect properties mapping type.
  */
-typedef std::map<const IndiRef, boost::shared_ptr<IProperty>, utils::IndComparator> IndirectMapping;
+typedef std::map<const IndiRef, IndirectEntry, utils::IndComparator> IndirectMapping;
 
 /** Type for pdf identificator.
  */
@@ -299,6 +321,10 @@ protected:
 	typedef std::vector<cpdf_id_t> CPdfListContainer;
 
 	/** List of all aive pdfs.
+	 * <br>
+	 * Different instances may be created and destroyed by different threads
+	 * (see ParallelPages), so the list and resolvedRefMapping of all 
+	 * instances are guarded by a lock private to the implementation.
 	 */
 	static CPdfListContainer allPdfs;
 
@@ -605,7 +631,10 @@ protected:
 	 * document. 
 	 * <br>
 	 * Indirect objects with no PDF are associated with NO_PDF_ID id.
-	 *
+	 * <br>
+	 * Entries are removed also by other instances when they are destroyed
+	 * (see releasePdfId), so the mapping is accessed only with allPdfs 
+	 * lock held.
 	 */
 	ResolvedRefMapping resolvedRefMapping;
 
@@ -709,6 +738,85 @@ protected:
 	 */
 	void consolidatePageList(const boost::shared_ptr<IProperty> & oldValue, const boost::shared_ptr<IProperty> & newValue);
 
+	/** Keeps flat page index in sync after change in Page tree.
+	 * @param oldValue Old reference (CNull if no previous state).
+	 * @param newValue New reference (CNull if no future state).
+	 *
+	 * Parameters have the same meaning as for consolidatePageList which 
+	 * calls this method before pageList is consolidated.
+	 * <br>
+	 * Single page insertion, removal and replacement are applied directly to
+	 * the pageIndex (position of the removed resp. replaced page is taken 
+	 * from the index, position of the new page from the page tree). All other
+	 * changes (whole sub trees) invalidate the index and it is built again 
+	 * when it is needed next time.
+	 */
+	void consolidatePageIndex(const boost::shared_ptr<IProperty> & oldValue, const boost::shared_ptr<IProperty> & newValue);
+
+	/** Builds flat page index if it is not valid.
+	 *
+	 * Walks the whole page tree (same way as findPageDict does - everything 
+	 * which is not a reference to a page tree node is ignored) and stores 
+	 * page dictionary references in the document order to the pageIndex.
+	 * <br>
+	 * If the page tree is ambiguous (some node is referenced more times) or
+	 * doesn't match getPageCount, index is marked as unusable and callers
+	 * have to fall back to page tree searching until the page tree changes.
+	 *
+	 * @return true if pageIndex can be used, false otherwise.
+	 */
+	bool ensurePageIndex()const;
+
+	/** Discards flat page index.
+	 * It is built again by ensurePageIndex when needed.
+	 */
+	void invalidatePageIndex()const;
+
+	/** Returns position of page dictionary from the flat page index.
+	 * @param ref Reference of the page dictionary.
+	 *
+	 * Refreshes reverse mapping for positions moved by incremental index 
+	 * changes if necessary.
+	 *
+	 * @return Page position (starting from 1) or 0 if index is not usable or 
+	 * given reference is not indexed page.
+	 */
+	size_t getIndexedPagePosition(const IndiRef & ref)const;
+
+	/** Adds given page dictionary to this document.
+	 * @param page Page to be added.
+	 *
+	 * Helper for insertPage which prepares page dictionary (clones pages from
+	 * different documents with all inheritable attributes and referenced 
+	 * objects) and returns reference which can be stored to the page tree.
+	 *
+	 * @throw AmbiguousPageTreeException if page is already in the page tree.
+	 * @return Reference of the page dictionary in this document.
+	 */
+	IndiRef addPageDictionary(const boost::shared_ptr<CPage> & page);
+
+	/** Invalidates and discards all pages from batchPages.
+	 */
+	void discardBatchPages()const;
+
+	/** Builds balanced page tree under given node.
+	 * @param node Intermediate node.
+	 * @param begin Index of the first page in pageIndex.
+	 * @param end Index behind the last page in pageIndex.
+	 * @param fanOut Maximum number of kids for node.
+	 * @param height Number of levels under node (pages are in the last
+	 * one). Range has to fit to fanOut^height pages.
+	 *
+	 * Sets Kids and Count of node. If height is bigger than 1, creates new
+	 * intermediate nodes (each of them covering consecutive range of pages 
+	 * with the same size up to one) and continues recursively with height-1,
+	 * so all pages end up in the same depth.
+	 *
+	 * @return Number of pages under node.
+	 */
+	size_t buildPageTreeNode(const boost::shared_ptr<CDict> & node, 
+			size_t begin, size_t end, size_t fanOut, size_t height);
+
 	/** Registers definitive value of property to the xref.
 	 * @param ip Property to be used.
 	 * @param ref Reference for property
@@ -859,9 +967,56 @@ private:
 	 * refernce. We know only the id and gen number. All indirect objects
 	 * with same reference has to share value and this is guarantied by this 
 	 * mapping.
+	 * <br>
+	 * Mapping behaves like a cache bounded by indMapLimit. Whenever its size
+	 * reaches indMapSweepSize, all entries which can be safely dropped are
+	 * evicted (least recently used first) - see shrinkIndirectMapping. Evicted
+	 * objects are transparently fetched again by getIndirectProperty.
 	 */
 	mutable IndirectMapping indMap;
 
+	/** Maximum number of entries which should be kept in indMap.
+	 *
+	 * 0 means that mapping is not bounded and entries are removed only when
+	 * they are replaced or when revision is changed.
+	 */
+	size_t indMapLimit;
+
+	/** Size of indMap when shrinkIndirectMapping should be triggered.
+	 *
+	 * This is usually indMapLimit, but it is raised if mapping contains too
+	 * many entries which can't be evicted so that we don't need to check all
+	 * of them for each new entry.
+	 */
+	mutable size_t indMapSweepSize;
+
+	/** Access counter for indMap entries.
+	 * Incremented for each getIndirectProperty call.
+	 */
+	mutable unsigned long indMapClock;
+
+	/** Holders of cached text layers, the most recently used first.
+	 * @see useTextLayer
+	 */
+	mutable std::list<const TextLayerHolder *> textLayers;
+
+	/** Maximum number of cached text layers (0 for unbounded).
+	 */
+	size_t textLayerLimit;
+
+	/** Evicts unused entries from indirect mapping.
+	 *
+	 * Entry can be evicted only if it hasn't been changed (it is not in
+	 * XRefWriter changed storage), nobody else holds its value or any of its
+	 * direct children and no observer is registered on it. Such an entry can
+	 * be fetched again from the xref without any visible difference.
+	 * <br>
+	 * Least recently used entries are evicted until the mapping size gets
+	 * under half of indMapLimit. Finally sets indMapSweepSize so that mapping
+	 * is not examined again too soon if not enough entries could be evicted.
+	 */
+	void shrinkIndirectMapping()const;
+
 	/** Document catalog dictionary.
 	 *
 	 * It is used for document property handling. Initialization is done by
@@ -896,6 +1051,22 @@ private:
 	 */
 	mutable PageList pageList;
 
+	/** Type of pages returned during page batch.
+	 *
+	 * It is association of page dictionary reference with CPage instance.
+	 */
+	typedef std::map<IndiRef, boost::shared_ptr<CPage>, utils::IndComparator> BatchPages;
+
+	/** Pages returned during page batch.
+	 *
+	 * Positions of pages change with each insertPage and removePage in the
+	 * batch, so returned pages are kept by their dictionary reference (the
+	 * position is given by pageIndex) and pageList is empty while batch is 
+	 * active. pageList is rebuilt from this storage once by 
+	 * commitPageBatch.
+	 */
+	mutable BatchPages batchPages;
+
 	/** Number of pages in document.
 	 *
 	 * Keeps value of actual number of pages or 0 if value is invalid and
@@ -923,6 +1094,57 @@ private:
 	 */
 	mutable PageTreeNodeCountCache nodeCountCache;
 
+	/** State of the flat page index.
+	 */
+	enum PageIndexState 
+	{
+		/** Index has to be built. */
+		PageIndexInvalid, 
+		/** Index reflects current page tree. */
+		PageIndexReady, 
+		/** Page tree can't be flattened (ambiguous tree). */
+		PageIndexUnusable
+	};
+
+	/** Current pageIndex state.
+	 */
+	mutable PageIndexState pageIndexState;
+
+	/** Flat page index.
+	 *
+	 * Page dictionary reference for each page in the document order (page at
+	 * position pos is at pos-1 index). It is built lazily by ensurePageIndex
+	 * and maintained by consolidatePageIndex when page tree changes, so 
+	 * getPage doesn't have to search the page tree.
+	 */
+	mutable std::vector<IndiRef> pageIndex;
+
+	/** Reverse mapping for pageIndex.
+	 *
+	 * Page position for each page dictionary indexed by its object number (0 
+	 * means unknown). Value for number is valid only if it is less than 
+	 * pagePositionsDirtyFrom and pageIndex contains the same reference on that
+	 * position. Otherwise it has to be refreshed (see getIndexedPagePosition).
+	 */
+	mutable std::vector<size_t> pagePositions;
+
+	/** The first position with stale pagePositions value.
+	 *
+	 * Incremental pageIndex changes just move this value down instead of
+	 * updating reverse mapping for all following pages.
+	 */
+	mutable size_t pagePositionsDirtyFrom;
+
+	/** Flag for active page batch.
+	 * @see beginPageBatch
+	 */
+	bool pageBatch;
+
+	/** Version of the page tree.
+	 * @see getPageTreeVersion
+	 */
+	size_t pageTreeVersion;
+
 	/** Cache for indirect Kids arrays mapping to their parents.
 	 *
 	 * This cache enables to overcome problem with indirect Kids arrays in
@@ -997,6 +1219,105 @@ private:
 	 */
 	boost::weak_ptr<CPdf> _this;
 
+	/** Nesting level of transactions.
+	 * @see beginTransaction
+	 */
+	size_t transactionDepth;
+
+	/** Flag for deferred notifications delivery in progress.
+	 */
+	bool deliveringNotifications;
+
+	/** Notification deferred by an active transaction.
+	 */
+	struct DeferredNotification
+	{
+		/** Changed object (NULL if it has been destroyed meanwhile). */
+		IProperty * subject;
+		/** Identifier of changed value (name of dictionary entry, empty for
+		 * object itself). 
+		 */
+		std::string valueId;
+		/** The most recent value. */
+		boost::shared_ptr<IProperty> newValue;
+		/** Context of the first change (holds the original value). */
+		boost::shared_ptr<const IPropertyObserverSubject::ObserverContext> context;
+	};
+
+	/** Type for deferred notifications.
+	 * Notifications are kept in the order of the first change.
+	 */
+	typedef std::vector<DeferredNotification> DeferredNotifications;
+
+	/** Type for deferred notifications lookup.
+	 * Maps changed object and value identifier to the position in 
+	 * DeferredNotifications. Changes of arrays are not coalesced, so there
+	 * may be more notifications with the same key for them.
+	 */
+	typedef std::multimap<std::pair<const IProperty *, std::string>, size_t> DeferredNotificationsIndex;
+
+	/** Notifications deferred by the active transaction.
+	 */
+	DeferredNotifications deferredNotifications;
+
+	/** Lookup for deferredNotifications.
+	 */
+	DeferredNotificationsIndex deferredNotificationsIndex;
+
+	/** Defers notification of given object.
+	 * @param subject Changed object.
+	 * @param newValue New value.
+	 * @param context Context of the change.
+	 *
+	 * If there is already deferred notification for the same value of the 
+	 * same object, only its new value is updated, so the original value from
+	 * the first change's context is kept. Changes of arrays can't be 
+	 * coalesced (positions of other elements are shifted by them), so each
+	 * of them is deferred separately and they are delivered in order.
+	 *
+	 * @return true if notification has been deferred, false if it should be
+	 * delivered immediately.
+	 */
+	bool deferNotification(IProperty * subject, 
+			const boost::shared_ptr<IProperty> & newValue, 
+			const boost::shared_ptr<const IPropertyObserverSubject::ObserverContext> & context);
+
+	/** Forgets all deferred notifications of given object.
+	 * @param subject Object which is being destroyed.
+	 */
+	void forgetDeferredNotifications(const IProperty * subject);
+
+	/** Delivers all deferred notifications.
+	 * @param containErrors Whether exceptions of observers should be caught.
+	 *
+	 * Notifications deferred during delivery (by transactions started by
+	 * observers) are delivered as well. If containErrors is false and an 
+	 * observer throws, all remaining notifications are discarded (see 
+	 * clearDeferredNotifications) and the exception is propagated. 
+	 * Otherwise exception of an observer is logged and delivery continues 
+	 * with the next observer.
+	 */
+	void deliverDeferredNotifications(bool containErrors=false);
+
+	/** Notifies all observers of given object and catches their exceptions.
+	 * @param subject Changed object.
+	 * @param newValue New value.
+	 * @param context Context of the change.
+	 */
+	static void notifyObserversContained(IProperty & subject, 
+			const boost::shared_ptr<IProperty> & newValue, 
+			const boost::shared_ptr<const IPropertyObserverSubject::ObserverContext> & context);
+
+	/** Discards all deferred notifications.
+	 *
+	 * Clears deferredNotifications and deferredNotificationsIndex and resets
+	 * notificationDeferred flag of all subjects with pending notifications.
+	 */
+	void clearDeferredNotifications();
+
+	/** IProperty hands over notifications during transaction. */
+	friend class IProperty;
+
 	/** Empty constructor.
 	 *
 	 * This constructor is disabled, because we want to prevent uninitialized
@@ -1010,12 +1331,14 @@ private:
 	/** Initializating constructor.
 	 * @param stream Stream with data.
 	 * @param openMode Mode for this file.
+	 * @param cacheLimit Maximum number of cached indirect objects (0 for 
+	 * unbounded).
 	 *
 	 * Creates XRefWriter, initializes pageTreeWatchDog and finally calls
 	 * initRevisionSpecific method for initialization of internal structures
 	 * which depends on current revision.
 	 */
-    CPdf(BaseStream * stream, OpenMode openMode);
+    CPdf(BaseStream * stream, OpenMode openMode, size_t cacheLimit=DEFAULT_INDIRECT_CACHE_LIMIT);
 	
 	/** Destructor.
 	 * 
@@ -1040,14 +1363,90 @@ public:
 	 * @param filename File name with pdf content (if null, new document 
 	 *	will be created).
 	 * @param mode Mode to open file.
+	 * @param cacheLimit Maximum number of indirect objects kept in memory
+	 * (0 means no limit). See setIndirectCacheLimit.
+	 * @param mapFile Flag for memory mapped input (see MmapStream).
 	 *
 	 * This is only way how to get instance of CPdf type. All necessary 
 	 * initialization is done.
+	 * <br>
+	 * If mapFile is set and mode is ReadOnly, the whole file is mapped to the
+	 * memory and all document reading (cross reference parsing, revisions
+	 * collecting, objects fetching and content streams parsing) is done
+	 * directly from the mapping. Standard file stream is used as a fallback 
+	 * if the file cannot be mapped. Flag is ignored for other modes because
+	 * changes are written to the file.
 	 *
 	 * @throw PdfOpenException if file open fails.
 	 * @return Initialized (and ready to be used) CPdf instance.
 	 */
-	static boost::shared_ptr<CPdf> getInstance(const char * filename, OpenMode mode);
+	static boost::shared_ptr<CPdf> getInstance(const char * filename, OpenMode mode, 
+			size_t cacheLimit=DEFAULT_INDIRECT_CACHE_LIMIT, bool mapFile=false);
+
+	/** Default limit for cached indirect objects.
+	 *
+	 * Cache is unbounded by default, so that every indirect object keeps its
+	 * instance for the whole document lifetime. Callers which process big
+	 * documents can opt in for eviction by getInstance or 
+	 * setIndirectCacheLimit.
+	 */
+	static const size_t DEFAULT_INDIRECT_CACHE_LIMIT = 0;
+
+	/** Sets limit for cached indirect objects.
+	 * @param limit Maximum number of entries (0 for unbounded cache).
+	 *
+	 * Indirect objects returned by getIndirectProperty are cached so that
+	 * all users share the same instance. Only objects which are not held
+	 * by anybody else and which are not changed are dropped from the cache 
+	 * when the limit is reached, so the limit can be exceeded if too many
+	 * objects are in use. 
+	 */
+	void setIndirectCacheLimit(size_t limit);
+
+	/** Returns limit for cached indirect objects.
+	 * @return Maximum number of cached entries (0 for unbounded cache).
+	 */
+	size_t getIndirectCacheLimit()const
+	{
+		return indMapLimit;
+	}
+
+	/** Default limit for cached text layers.
+	 */
+	static const size_t DEFAULT_TEXT_LAYER_LIMIT = 8;
+
+	/** Sets limit for cached text layers.
+	 * @param limit Maximum number of pages which keep their text layer (0 for
+	 * unbounded).
+	 *
+	 * Only text layers of the most recently used pages are kept, others
+	 * are extracted again when they are needed.
+	 */
+	void setTextLayerLimit(size_t limit);
+
+	/** Returns limit for cached text layers.
+	 * @return Maximum number of cached text layers (0 for unbounded).
+	 */
+	size_t getTextLayerLimit()const
+	{
+		return textLayerLimit;
+	}
+
+	/** Marks text layer of given holder as the most recently used.
+	 * @param holder Holder which has just used its text layer.
+	 *
+	 * Least recently used holders above the limit are asked to release
+	 * their layers.
+	 */
+	void useTextLayer(const TextLayerHolder & holder)const;
+
+	/** Removes given holder from cached text layers.
+	 * @param holder Holder which doesn't keep its text layer anymore.
+	 *
+	 * Must be called when holder releases its layer itself or when it is
+	 * destroyed.
+	 */
+	void forgetTextLayer(const TextLayerHolder & holder)const;
 
 	/** Returns unique identificator for this pdf.
 	 *
@@ -1331,6 +1730,9 @@ public:
 	 * not have contained them directly). Finally dictionary is added with
 	 * followRefs set to true (in addIndirectProperty method) so that all 
 	 * referenced objecs are deep-copied too.
+	 * <br>
+	 * If page batch is active (see beginPageBatch), page tree is not touched
+	 * and new page is just stored to the page index. 
 	 *
 	 * @throw ReadOnlyDocumentException if mode is set to ReadOnly or we are in
 	 * older revision (where no changes are allowed).
@@ -1354,6 +1756,9 @@ public:
 	 * <br>
 	 * Intermediate nodes with no direct page are kept in page tree in this
 	 * implementation.
+	 * <br>
+	 * If page batch is active (see beginPageBatch), page tree is not touched
+	 * and page is just removed from the page index. 
 	 *
 	 * @throw PageNotFoundException if given page couldn't be found.
 	 * @throw ReadOnlyDocumentException if mode is set to ReadOnly or we are in
@@ -1363,12 +1768,162 @@ public:
 	 */
 	void removePage(size_t pos);
 
+	/** Default maximum number of Kids for page tree nodes built by 
+	 * commitPageBatch.
+	 */
+	static const size_t DEFAULT_PAGE_TREE_FANOUT = 32;
+
+	/** Starts batch of page insertions and removals.
+	 *
+	 * Until commitPageBatch is called, insertPage and removePage don't touch
+	 * page tree and so no page tree consolidation is done for them. Pages
+	 * are kept only in the flat page index and all page access methods 
+	 * (getPage, getPagePosition, getPageCount, ...) work with it as usual.
+	 * <br>
+	 * Page tree must not be changed by other means (direct Kids arrays 
+	 * manipulation) while batch is active. Changes done in the batch are not
+	 * visible in the page tree (and so in the saved document) until 
+	 * commitPageBatch.
+	 * <br>
+	 * Calling this method when batch is already active does nothing.
+	 *
+	 * @throw ReadOnlyDocumentException if mode is set to ReadOnly or we are in
+	 * older revision (where no changes are allowed).
+	 * @throw NoPageRootException if no page tree root can be found.
+	 * @throw AmbiguousPageTreeException if page tree can't be flattened.
+	 */
+	void beginPageBatch();
+
+	/** Finishes page batch and rebuilds page tree.
+	 * @param fanOut Maximum number of Kids for page tree nodes (at least 2).
+	 *
+	 * Replaces whole page tree under the current page tree root by a balanced
+	 * tree where each node has at most fanOut kids and all pages are in the 
+	 * same depth (the smallest height which can hold all pages). New 
+	 * intermediate nodes are created, Parent fields of pages are updated and
+	 * inheritable attributes are set directly to pages (see
+	 * CPageAttributes::setInheritable) because original intermediate nodes 
+	 * are no longer used. Original intermediate nodes are freed (see
+	 * XRefWriter::freeRef) and stored as free entries with the next save.
+	 * <br>
+	 * Page tree observers are not triggered for the rebuild, so all CPage 
+	 * instances returned during batch are kept valid on their positions.
+	 * <br>
+	 * This method can be called also without beginPageBatch to rebalance
+	 * degenerated page tree. 
+	 *
+	 * @throw ReadOnlyDocumentException if mode is set to ReadOnly or we are in
+	 * older revision (where no changes are allowed).
+	 * @throw NoPageRootException if no page tree root can be found.
+	 * @throw AmbiguousPageTreeException if page tree can't be flattened.
+	 */
+	void commitPageBatch(size_t fanOut=DEFAULT_PAGE_TREE_FANOUT);
+
+	/** Checks whether page batch is active.
+	 * @return true if beginPageBatch has been called and commitPageBatch not
+	 * yet.
+	 */
+	bool inPageBatch()const
+	{
+		return pageBatch;
+	}
+
+	/** Starts change notification transaction.
+	 *
+	 * While transaction is active, change notifications of all properties
+	 * of this document are not delivered to their observers immediately.
+	 * Notifications are coalesced per object and changed value (dictionary
+	 * entry) and one consolidated notification (with the original value from
+	 * the first change and the most recent new value) is delivered for each
+	 * of them by commitTransaction. This saves redundant observer callbacks
+	 * (e.g. content stream reparsing) when many changes are done to the same
+	 * objects. Changes of arrays are deferred as well, but they are not 
+	 * coalesced, so observers see them in the order they were done.
+	 * <br>
+	 * Transactions can be nested and only the outermost commitTransaction 
+	 * delivers notifications. Note that anything maintained by observers 
+	 * (page tree related caches, page contents, content streams) is 
+	 * consistent with changed properties only after the transaction is 
+	 * commited.
+	 * <br>
+	 * Use Transaction class for exception safe usage.
+	 */
+	void beginTransaction()
+	{
+		++transactionDepth;
+	}
+
+	/** Finishes change notification transaction.
+	 *
+	 * If this is the outermost transaction, all deferred notifications are
+	 * delivered in order of the first change.
+	 */
+	void commitTransaction();
+
+	/** Finishes change notification transaction left because of an error.
+	 *
+	 * Used instead of commitTransaction when the transaction is left because
+	 * of an exception. Changes done in the transaction stay applied, so if 
+	 * this is the outermost transaction, all deferred notifications are 
+	 * delivered to keep observers (page tree, page contents, content 
+	 * streams) consistent with properties. Exceptions of observers are 
+	 * logged and not propagated, because this is typically called during 
+	 * stack unwinding.
+	 */
+	void abortTransaction();
+
+	/** Checks whether change notification transaction is active.
+	 * @return true if beginTransaction has been called more times than
+	 * commitTransaction.
+	 */
+	bool inTransaction()const
+	{
+		return transactionDepth>0;
+	}
+
+	/** Scope guard for change notification transaction.
+	 *
+	 * Starts transaction in constructor and commits it in destructor. If 
+	 * the scope is left because of an exception, transaction is aborted
+	 * (see abortTransaction) instead, which delivers notifications without
+	 * propagating observer exceptions during stack unwinding.
+	 */
+	class Transaction
+	{
+		boost::shared_ptr<CPdf> pdf;
+
+		Transaction(const Transaction &);
+		Transaction & operator=(const Transaction &);
+	public:
+		/** Starts transaction for given pdf.
+		 * @param p Pdf instance.
+		 */
+		explicit Transaction(const boost::shared_ptr<CPdf> & p):pdf(p)
+		{
+			pdf->beginTransaction();
+		}
+
+		/** Commits or aborts transaction.
+		 */
+		~Transaction()
+		{
+			if(std::uncaught_exception())
+				pdf->abortTransaction();
+			else
+				pdf->commitTransaction();
+		}
+	};
+
 	/** Returns absolute position of given page.
 	 * @param page Page to look for.
 	 * 
 	 * Returns actual position of given page. If given page hasn't been returned
 	 * by this CPdf instance or it is no longer available, exception is thrown.
 	 * <br>
+	 * Position is taken from the flat page index according page dictionary
+	 * reference and checked against pageList. pageList is searched only if
+	 * the index is not usable.
+	 * <br>
 	 * NOTE: instances are same if they are stand for same instance.
 	 *
 	 * @throw PageNotFoundException if given page is not recognized by CPdf
@@ -1388,6 +1943,19 @@ public:
 	 */
 	unsigned int getPageCount()const;
 
+	/** Returns version of the page tree.
+	 *
+	 * Version changes whenever pages are inserted, removed or moved (or the
+	 * whole page tree is discarded), so page positions gathered earlier are
+	 * still valid as long as the version is the same.
+	 *
+	 * @return Page tree version.
+	 */
+	size_t getPageTreeVersion()const
+	{
+		return pageTreeVersion;
+	}
+
 	// page iteration methods
 	// =======================
 
@@ -1395,9 +1963,11 @@ public:
 	 * @param pos Position (starting from 1).
 	 *
 	 * At first tries to find page with given position in pageList. If found,
-	 * returns instance from list. Otherwise, searches page tree by findPageDict
-	 * helper function and if page dictionary is found, creates new CPage
-	 * instance and inserts new mapping (postion to CPage instance) to pageList.
+	 * returns instance from list. Otherwise, gets page dictionary from the 
+	 * flat page index (or searches page tree by findPageDict helper function 
+	 * if the index is not usable) and if page dictionary is found, creates 
+	 * new CPage instance and inserts new mapping (postion to CPage instance) 
+	 * to pageList.
 	 *
 	 * @throw PageNotFoundException if pos can't be found or out of range.
 	 * @return CPage instance wrapped by smart pointer.
@@ -1598,6 +2168,26 @@ public:
 		return xref->setPdfWriter(NULL);
 	}
 
+	/** Sets pdf content writer used by save method.
+	 * @param writer New pdf content writer (allocated by new operator, NULL
+	 * is ignored).
+	 *
+	 * Selects output format of the saved revisions - e.g.
+	 * utils::XRefStreamPdfWriter for compressed PDF 1.5 output instead of
+	 * default utils::OldStylePdfWriter. Previous writer is deallocated, so
+	 * observers registered on it (@see getPdfWriter) have to be registered
+	 * again.
+	 */
+	void setPdfWriter(utils::IPdfWriter * writer);
+
+	/** Sets compression policy for stream objects written by save method.
+	 * @param policy Compression policy.
+	 *
+	 * Delegates to current pdf content writer (@see
+	 * utils::IPdfWriter::setCompressionPolicy).
+	 */
+	void setCompressionPolicy(const utils::CompressionPolicy & policy);
+
 	/** Throws an exception if this document can not be changed. */
 	void canChange () const;
 
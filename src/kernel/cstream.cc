@@ -48,7 +48,8 @@ using namespace utils;
 //
 //
 //
-CStream::CStream (boost::weak_ptr<CPdf> p, ::Object& o, const IndiRef& rf) : IProperty (p,rf)
+CStream::CStream (boost::weak_ptr<CPdf> p, ::Object& o, const IndiRef& rf) 
+	: IProperty (p,rf), decodedValid (false)
 {
 	kernelPrintDbg (debug::DBG_DBG,"");
 	// Make sure it is a stream
@@ -75,7 +76,7 @@ CStream::CStream (boost::weak_ptr<CPdf> p, ::Object& o, const IndiRef& rf) : IPr
 //
 //
 //
-CStream::CStream ( ::Object& o) : parser (NULL), tmpObj (NULL)
+CStream::CStream ( ::Object& o) : parser (NULL), tmpObj (NULL), decodedValid (false)
 {
 	kernelPrintDbg (debug::DBG_DBG,"");
 	// Make sure it is a stream
@@ -98,7 +99,7 @@ CStream::CStream ( ::Object& o) : parser (NULL), tmpObj (NULL)
 //
 //
 //
-CStream::CStream (const CDict& dict) : parser (NULL), tmpObj (NULL)
+CStream::CStream (const CDict& dict) : parser (NULL), tmpObj (NULL), decodedValid (false)
 {
 	kernelPrintDbg (debug::DBG_DBG,"");
 
@@ -108,7 +109,7 @@ CStream::CStream (const CDict& dict) : parser (NULL), tmpObj (NULL)
 //
 //
 //
-CStream::CStream (bool makeReqEntries) : parser (NULL)
+CStream::CStream (bool makeReqEntries) : parser (NULL), decodedValid (false)
 {
 	kernelPrintDbg (debug::DBG_DBG,"");
 
@@ -209,6 +210,7 @@ CStream::setRawBuffer (const Buffer& buf)
 	// Copy buf to buffer
 	buffer.clear ();
 	copy (buf.begin(), buf.end(), back_inserter (buffer));
+	_invalidateDecodedBuffer ();
 	// Change length
 	setLength (buffer.size());
 	
@@ -318,6 +320,39 @@ CStream::getDecodedStringRepresentation (string& str) const
 	xpdf::freeXpdfObject (obj);
 }
 
+//
+//
+//
+const CStream::Buffer&
+CStream::getDecodedBuffer () const
+{
+	// Nothing to decode
+	if (!dictionary.containsProperty ("Filter"))
+		return buffer;
+
+	if (!decodedValid)
+	{
+		kernelPrintDbg (debug::DBG_DBG, "Decoding stream buffer.");
+		decoded.clear ();
+		decoded.reserve (buffer.size());
+		
+		//
+		// Make xpdf object and use its filters to get sane characters
+		// 
+		::Object* obj = _makeXpdfObject ();
+		assert (NULL != obj);
+		obj->streamReset ();
+		int c;
+		while (EOF != (c = obj->streamGetChar())) 
+			decoded.push_back (static_cast<StreamChar> (c));
+		obj->streamClose ();
+		xpdf::freeXpdfObject (obj);
+		
+		decodedValid = true;
+	}
+	return decoded;
+}
+
 //
 //
 //
@@ -352,6 +387,9 @@ CStream::_createContext () const
 void 
 CStream::_objectChanged (boost::shared_ptr<const ObserverContext> context)
 {
+	// Whatever changed, decoded data are not valid anymore
+	_invalidateDecodedBuffer ();
+
 	// Do not notify anything if we are not in a valid pdf
 	if (!hasValidPdf (this))
 		return;
@@ -99,6 +99,28 @@ protected:
 private:
 	/** Helper object, because xpdf stream does NOT automatically deallocated specified object. */
 	::Object* tmpObj;
+
+	//
+	// Decoded data
+	//
+private:
+	/** 
+	 * Decoded buffer cache. 
+	 * Valid only if decodedValid is set and the stream has filters.
+	 */
+	mutable Buffer decoded;
+	/** Is decoded buffer cache valid. */
+	mutable bool decodedValid;
+
+	/**
+	 * Drops decoded buffer cache.
+	 * Must be called whenever buffer or dictionary is changed.
+	 */
+	void _invalidateDecodedBuffer () const
+	{
+		decodedValid = false;
+		Buffer ().swap (decoded);
+	}
 		
 
 	//
@@ -191,15 +213,15 @@ public:
 	
 	/** Delagate this operation to underlying dictionary. \see CDict */
 	boost::shared_ptr<IProperty> setProperty (PropertyId id, IProperty& ip)
-		{return dictionary.setProperty (id, ip);}
+		{_invalidateDecodedBuffer (); return dictionary.setProperty (id, ip);}
 	
 	/** Delagate this operation to underlying dictionary. \see CDict */
 	boost::shared_ptr<IProperty> addProperty (PropertyId id, const IProperty& newIp)
-		{return dictionary.addProperty (id, newIp);}
+		{_invalidateDecodedBuffer (); return dictionary.addProperty (id, newIp);}
 	
 	/** Delagate this operation to underlying dictionary. \see CDict */
 	void delProperty (PropertyId id)
-		{dictionary.delProperty (id);}
+		{_invalidateDecodedBuffer (); dictionary.delProperty (id);}
 
 
 	//
@@ -234,6 +256,27 @@ public:
 	 * @return Buffer.
 	 */
 	const Buffer& getBuffer () const {return buffer;}
+
+	/**
+	 * Get decoded buffer. 
+	 *
+	 * Data are decoded only once and cached until the stream is changed or
+	 * releaseDecodedBuffer is called. If the stream has no filters, encoded
+	 * buffer is returned directly. Returned reference is valid until the 
+	 * stream is changed or the cache released.
+	 *
+	 * @return Decoded buffer.
+	 */
+	const Buffer& getDecodedBuffer () const;
+
+	/**
+	 * Releases decoded buffer cache.
+	 *
+	 * Decoded data are needed only while parsing, so parser releases them
+	 * not to hold both encoded and decoded copies of all content streams.
+	 */
+	void releaseDecodedBuffer () const
+		{ _invalidateDecodedBuffer (); }
 	
 	/**
 	 * Get filters.
@@ -337,6 +380,7 @@ public:
 		utils::makeStreamPdfValid (buf.begin(), buf.end(), strbuf);
 		buffer.clear();
 		copy(strbuf.begin(), strbuf.end(), back_inserter(buffer));
+		_invalidateDecodedBuffer ();
 		// Change length
 		std::vector<std::string> filters;
 		getFilters(filters);
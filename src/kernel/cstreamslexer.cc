@@ -0,0 +1,696 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+
+#include "kernel/static.h"
+#include "kernel/cstreamslexer.h"
+#include "kernel/exceptions.h"
+
+#include <limits.h>
+
+//=====================================================================================
+namespace pdfobjects {
+//=====================================================================================
+
+using namespace std;
+using namespace boost;
+
+namespace {
+
+	/** White space characters (pdf specification 3.1.1). */
+	inline bool
+	isWhiteSpace (char c)
+	{
+		return ' ' == c || '\n' == c || '\r' == c || '\t' == c || '\f' == c || '\0' == c;
+	}
+
+	/** Delimiter characters (pdf specification 3.1.1). */
+	inline bool
+	isDelimiter (char c)
+	{
+		switch (c)
+		{
+			case '(': case ')': case '<': case '>': case '[': case ']':
+			case '{': case '}': case '/': case '%':
+				return true;
+			default:
+				return false;
+		}
+	}
+
+	/** Regular characters. */
+	inline bool
+	isRegular (char c)
+		{ return !isWhiteSpace (c) && !isDelimiter (c); }
+
+	/** Decimal digit. */
+	inline bool
+	isDigit (char c)
+		{ return '0' <= c && c <= '9'; }
+
+	/** Hexadecimal digit value or -1. */
+	inline int
+	hexValue (char c)
+	{
+		if ('0' <= c && c <= '9')
+			return c - '0';
+		if ('a' <= c && c <= 'f')
+			return c - 'a' + 10;
+		if ('A' <= c && c <= 'F')
+			return c - 'A' + 10;
+		return -1;
+	}
+
+	/** Compares token with a keyword. */
+	inline bool
+	isKeyword (const char* begin, const char* end, const char* keyword)
+	{
+		const char* p = begin;
+		for (; p != end && '\0' != *keyword; ++p, ++keyword)
+			if (*p != *keyword)
+				return false;
+		return p == end && '\0' == *keyword;
+	}
+
+	/**
+	 * Create number object.
+	 *
+	 * Digits are accumulated in the same order as xpdf Lexer does it, so
+	 * values are bit for bit identical to those read by xpdf parser. Number
+	 * without decimal point is an integer unless it overflows.
+	 */
+	IProperty*
+	createNumber (const char* begin, const char* end)
+	{
+		const char* p = begin;
+		bool negative = false;
+		if ('+' == *p || '-' == *p)
+		{
+			negative = ('-' == *p);
+			++p;
+		}
+		
+		// Integer part, continues as real when it overflows
+		int ival = 0;
+		double xval = 0;
+		bool overflow = false;
+		for (; p != end && isDigit (*p); ++p)
+		{
+			int digit = *p - '0';
+			if (!overflow && ival > (INT_MAX - digit) / 10)
+			{
+				overflow = true;
+				xval = ival;
+			}
+			if (overflow)
+				xval = xval * 10.0 + digit;
+			else
+				ival = ival * 10 + digit;
+		}
+
+		// Fraction
+		if (p != end && '.' == *p)
+		{
+			if (!overflow)
+				xval = ival;
+			double scale = 0.1;
+			for (++p; p != end; ++p)
+			{
+				// Minus signs in fraction are skipped by xpdf
+				if ('-' == *p)
+					continue;
+				xval = xval + scale * (*p - '0');
+				scale *= 0.1;
+			}
+			return CRealFactory::getInstance (negative ? -xval : xval);
+		}
+
+		if (overflow)
+			return CRealFactory::getInstance (negative ? -xval : xval);
+		return CIntFactory::getInstance (negative ? -ival : ival);
+	}
+
+	/** Decode name (#xx escapes). */
+	void
+	decodeName (const char* begin, const char* end, string& str)
+	{
+		str.reserve (end - begin);
+		for (const char* p = begin; p != end; ++p)
+		{
+			if ('#' == *p && 2 < end - p)
+			{
+				int h = hexValue (p[1]), l = hexValue (p[2]);
+				if (0 <= h && 0 <= l)
+				{
+					str += static_cast<char> ((h << 4) | l);
+					p += 2;
+					continue;
+				}
+			}
+			str += *p;
+		}
+	}
+
+	/** Decode literal string (escape sequences). */
+	void
+	decodeString (const char* begin, const char* end, string& str)
+	{
+		str.reserve (end - begin);
+		for (const char* p = begin; p != end; ++p)
+		{
+			if ('\\' != *p)
+			{
+				str += *p;
+				continue;
+			}
+			if (++p == end)
+				break;
+			switch (*p)
+			{
+				case 'n': str += '\n'; break;
+				case 'r': str += '\r'; break;
+				case 't': str += '\t'; break;
+				case 'b': str += '\b'; break;
+				case 'f': str += '\f'; break;
+				case '\r':
+					// Line continuation
+					if (p + 1 != end && '\n' == p[1])
+						++p;
+					break;
+				case '\n':
+					break;
+				default:
+					if ('0' <= *p && *p <= '7')
+					{
+						int c = *p - '0';
+						for (int i = 1; i < 3 && p + 1 != end && '0' <= p[1] && p[1] <= '7'; ++i)
+							c = (c << 3) + (*++p - '0');
+						str += static_cast<char> (c);
+					}else
+						str += *p;
+					break;
+			}
+		}
+	}
+
+	/** Decode hexadecimal string. */
+	void
+	decodeHexString (const char* begin, const char* end, string& str)
+	{
+		str.reserve ((end - begin) / 2 + 1);
+		int high = -1;
+		for (const char* p = begin; p != end; ++p)
+		{
+			int v = hexValue (*p);
+			if (0 > v)
+				continue;
+			if (0 > high)
+				high = v;
+			else
+			{
+				str += static_cast<char> ((high << 4) | v);
+				high = -1;
+			}
+		}
+		// Missing last digit is 0
+		if (0 <= high)
+			str += static_cast<char> (high << 4);
+	}
+
+} // namespace
+
+
+//=====================================================================================
+// CStreamsLexer
+//=====================================================================================
+
+//
+//
+//
+void
+CStreamsLexer::open ()
+{
+	assert (!streams.empty());
+	ranges.clear ();
+	for (CStreams::const_iterator it = streams.begin(); it != streams.end(); ++it)
+	{
+		const CStream::Buffer& buf = (*it)->getDecodedBuffer ();
+		if (buf.empty())
+			ranges.push_back (Range (NULL, NULL));
+		else
+			ranges.push_back (Range (&buf[0], &buf[0] + buf.size()));
+	}
+	cur.stream = 0;
+	cur.pos = ranges.front().first;
+	cur.end = ranges.front().second;
+	lastStream = 0;
+}
+
+//
+//
+//
+void
+CStreamsLexer::close ()
+{
+	ranges.clear ();
+	for (CStreams::const_iterator it = streams.begin(); it != streams.end(); ++it)
+		(*it)->releaseDecodedBuffer ();
+}
+
+//
+//
+//
+bool
+CStreamsLexer::skipWhiteSpace ()
+{
+	for (;;)
+	{
+		while (cur.pos != cur.end)
+		{
+			if (isWhiteSpace (*cur.pos))
+				++cur.pos;
+			else if ('%' == *cur.pos)
+			{ // Comment up to the end of line
+				while (cur.pos != cur.end && '\n' != *cur.pos && '\r' != *cur.pos)
+					++cur.pos;
+			}else
+				return true;
+		}
+		
+		// Take next stream
+		if (cur.stream + 1 >= ranges.size())
+			return false;
+		++cur.stream;
+		cur.pos = ranges[cur.stream].first;
+		cur.end = ranges[cur.stream].second;
+	}
+}
+
+//
+//
+//
+CStreamsLexer::Token
+CStreamsLexer::getToken ()
+{
+	Token token;
+	// Stray characters are skipped
+	while (skipWhiteSpace ())
+	{
+		const char* p = cur.pos;
+		if (')' == *p || ('>' == *p && (p + 1 == cur.end || '>' != p[1])))
+		{
+			kernelPrintDbg (debug::DBG_WARN, "Illegal character " << *p << ". Skipping.");
+			++cur.pos;
+			continue;
+		}
+		readToken (token);
+		return token;
+	}
+	
+	token.kind = tkEnd;
+	token.begin = token.end = cur.pos;
+	return token;
+}
+
+//
+//
+//
+void
+CStreamsLexer::readToken (Token& token)
+{
+	const char* p = cur.pos;
+	switch (*p)
+	{
+		case '/':
+			token.kind = tkName;
+			token.begin = ++p;
+			while (p != cur.end && isRegular (*p))
+				++p;
+			token.end = p;
+			break;
+
+		case '(':
+			{
+				token.kind = tkString;
+				token.begin = ++p;
+				size_t nesting = 1;
+				for (; p != cur.end; ++p)
+				{
+					if ('\\' == *p)
+					{
+						if (++p == cur.end)
+							break;
+					}else if ('(' == *p)
+						++nesting;
+					else if (')' == *p && 0 == --nesting)
+						break;
+				}
+				token.end = p;
+				if (p == cur.end)
+					kernelPrintDbg (debug::DBG_WARN, "Unterminated string.");
+				else
+					++p;
+			}
+			break;
+
+		case '<':
+			if (p + 1 != cur.end && '<' == p[1])
+			{
+				token.kind = tkDictBegin;
+				token.begin = p;
+				p += 2;
+				token.end = p;
+			}else
+			{
+				token.kind = tkHexString;
+				token.begin = ++p;
+				while (p != cur.end && '>' != *p)
+					++p;
+				token.end = p;
+				if (p == cur.end)
+					kernelPrintDbg (debug::DBG_WARN, "Unterminated hex string.");
+				else
+					++p;
+			}
+			break;
+
+		case '>':
+			// Single > is skipped by getToken ()
+			assert (p + 1 != cur.end && '>' == p[1]);
+			token.kind = tkDictEnd;
+			token.begin = p;
+			p += 2;
+			token.end = p;
+			break;
+
+		case '[':
+		case ']':
+			token.kind = ('[' == *p) ? tkArrayBegin : tkArrayEnd;
+			token.begin = p++;
+			token.end = p;
+			break;
+
+		case '{':
+		case '}':
+			// PostScript calculator braces are handled as operators
+			token.kind = tkKeyword;
+			token.begin = p++;
+			token.end = p;
+			break;
+
+		case '+': case '-': case '.':
+		case '0': case '1': case '2': case '3': case '4':
+		case '5': case '6': case '7': case '8': case '9':
+			// Number ends with the first character which can't be its part
+			// (xpdf reads minus signs in fraction too)
+			token.kind = tkNumber;
+			token.begin = p++;
+			{
+				bool fraction = ('.' == *token.begin);
+				while (p != cur.end && isDigit (*p))
+					++p;
+				if (!fraction && p != cur.end && '.' == *p)
+				{
+					fraction = true;
+					++p;
+				}
+				while (p != cur.end && (isDigit (*p) || (fraction && '-' == *p)))
+					++p;
+			}
+			token.end = p;
+			break;
+
+		default:
+			token.kind = tkKeyword;
+			token.begin = p;
+			while (p != cur.end && isRegular (*p))
+				++p;
+			token.end = p;
+			break;
+	}
+
+	cur.pos = p;
+}
+
+//
+//
+//
+IProperty*
+CStreamsLexer::createObject (const Token& token, size_t depth)
+{
+	switch (token.kind)
+	{
+		case tkNumber:
+			return createNumber (token.begin, token.end);
+
+		case tkName:
+			{
+				string name;
+				if (std::find (token.begin, token.end, '#') == token.end)
+					name.assign (token.begin, token.end);
+				else
+					decodeName (token.begin, token.end, name);
+				return CNameFactory::getInstance (name);
+			}
+
+		case tkString:
+			{
+				string str;
+				if (std::find (token.begin, token.end, '\\') == token.end)
+					str.assign (token.begin, token.end);
+				else
+					decodeString (token.begin, token.end, str);
+				return CStringFactory::getInstance (str);
+			}
+
+		case tkHexString:
+			{
+				string str;
+				decodeHexString (token.begin, token.end, str);
+				return CStringFactory::getInstance (str);
+			}
+
+		case tkArrayBegin:
+			{
+				if (MAX_NESTING <= depth)
+					throw CObjInvalidObject ();
+				boost::scoped_ptr<CArray> array (CArrayFactory::getInstance ());
+				readObjects (tkArrayEnd, array->value, depth + 1);
+				return array.release ();
+			}
+
+		case tkDictBegin:
+			{
+				if (MAX_NESTING <= depth)
+					throw CObjInvalidObject ();
+				Objects objs;
+				readObjects (tkDictEnd, objs, depth + 1);
+				boost::scoped_ptr<CDict> dict (CDictFactory::getInstance ());
+				dict->value.reserve (objs.size() / 2);
+				// Positions of keys in dict->value
+				typedef std::map<std::string, CDict::Value::size_type> KeyPositions;
+				KeyPositions positions;
+				for (Objects::iterator it = objs.begin(); it != objs.end(); ++it)
+				{
+					// Damaged entries are skipped the same way xpdf parser
+					// does
+					if (!isName (*it))
+					{
+						kernelPrintDbg (debug::DBG_WARN, "Dictionary key is not a name. Skipping.");
+						continue;
+					}
+					if (it + 1 == objs.end())
+					{
+						kernelPrintDbg (debug::DBG_WARN, "Dictionary without value. Skipping.");
+						break;
+					}
+					string key;
+					IProperty::getSmartCObjectPtr<CName> (*it)->getValue (key);
+					++it;
+
+					// The last value of duplicated key wins (as in CDict)
+					std::pair<KeyPositions::iterator, bool> position 
+						= positions.insert (std::make_pair (key, dict->value.size()));
+					if (!position.second)
+					{
+						kernelPrintDbg (debug::DBG_WARN, "Duplicated dictionary key " << key << ".");
+						dict->value[position.first->second].second = *it;
+					}else
+						dict->value.push_back (std::make_pair (key, *it));
+				}
+				return dict.release ();
+			}
+
+		case tkKeyword:
+			if (isKeyword (token.begin, token.end, "true"))
+				return CBoolFactory::getInstance (true);
+			if (isKeyword (token.begin, token.end, "false"))
+				return CBoolFactory::getInstance (false);
+			if (isKeyword (token.begin, token.end, "null"))
+				return CNullFactory::getInstance ();
+			return NULL;
+
+		default:
+			kernelPrintDbg (debug::DBG_ERR, "Unexpected token.");
+			throw CObjInvalidObject ();
+	}
+}
+
+//
+//
+//
+void
+CStreamsLexer::readObjects (TokenKind terminator, Objects& objs, size_t depth)
+{
+	for (;;)
+	{
+		Token token = getToken ();
+		if (terminator == token.kind)
+			return;
+		if (tkEnd == token.kind)
+		{
+			kernelPrintDbg (debug::DBG_WARN, "Unterminated array or dictionary.");
+			return;
+		}
+		if (tkArrayEnd == token.kind || tkDictEnd == token.kind)
+		{
+			kernelPrintDbg (debug::DBG_WARN, "Unexpected end of array or dictionary. Skipping.");
+			continue;
+		}
+
+		IProperty* ip = createObject (token, depth);
+		if (ip)
+		{
+			objs.push_back (boost::shared_ptr<IProperty> (ip));
+			continue;
+		}
+
+		//
+		// Only reference can be made of a keyword inside an array or
+		// a dictionary
+		//
+		size_t count = objs.size();
+		if (isKeyword (token.begin, token.end, "R") && 2 <= count
+				&& isInt (objs[count - 2]) && isInt (objs[count - 1]))
+		{
+			int num, gen;
+			IProperty::getSmartCObjectPtr<CInt> (objs[count - 2])->getValue (num);
+			IProperty::getSmartCObjectPtr<CInt> (objs[count - 1])->getValue (gen);
+			if (0 <= num && 0 <= gen)
+			{
+				objs.resize (count - 2);
+				objs.push_back (boost::shared_ptr<IProperty> (CRefFactory::getInstance (IndiRef (num, gen))));
+				continue;
+			}
+		}
+		kernelPrintDbg (debug::DBG_WARN, "Operator inside an array or a dictionary. Skipping.");
+	}
+}
+
+//
+//
+//
+CStreamsLexer::ObjectKind
+CStreamsLexer::getObject (boost::shared_ptr<IProperty>& operand, std::string& cmd)
+{
+	assert (!ranges.empty() || !"Lexer is not opened.");
+	
+	Token token = getToken ();
+	while (tkArrayEnd == token.kind || tkDictEnd == token.kind)
+	{
+		kernelPrintDbg (debug::DBG_WARN, "Unexpected end of array or dictionary. Skipping.");
+		token = getToken ();
+	}
+	if (tkEnd == token.kind)
+		return End;
+	
+	IProperty* ip = createObject (token, 0);
+	lastStream = cur.stream;
+	if (NULL == ip)
+	{
+		cmd.assign (token.begin, token.end);
+		return Operator;
+	}
+	operand.reset (ip);
+	return Operand;
+}
+
+//
+//
+//
+CStreamsLexer::ObjectKind
+CStreamsLexer::lookObject (boost::shared_ptr<IProperty>& operand, std::string& cmd)
+{
+	Position saved = cur;
+	size_t savedLast = lastStream;
+	try {
+		ObjectKind kind = getObject (operand, cmd);
+		cur = saved;
+		lastStream = savedLast;
+		return kind;
+	
+	}catch (CObjectException&)
+	{
+		cur = saved;
+		lastStream = savedLast;
+		throw;
+	}
+}
+
+//
+//
+//
+void
+CStreamsLexer::getInlineImageData (CStream::Buffer& buf)
+{
+	// Single white space character follows ID
+	if (cur.pos != cur.end && isWhiteSpace (*cur.pos))
+		++cur.pos;
+	
+	//
+	// Data end with EI operator, binary data can contain EI so check that it
+	// is separated
+	//
+	const char* begin = cur.pos;
+	const char* p = begin;
+	for (; p != cur.end; ++p)
+	{
+		if ('E' == p[0] && cur.end - p >= 2 && 'I' == p[1]
+				&& (p == begin || isWhiteSpace (p[-1]))
+				&& (cur.end - p == 2 || !isRegular (p[2])))
+			break;
+	}
+
+	buf.assign (begin, p);
+	if (p == cur.end)
+		kernelPrintDbg (debug::DBG_WARN, "Inline image without EI.");
+	else
+		p += 2;
+	cur.pos = p;
+	lastStream = cur.stream;
+}
+
+//=====================================================================================
+} // namespace pdfobjects
+//=====================================================================================
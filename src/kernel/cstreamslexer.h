@@ -0,0 +1,237 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+#ifndef _CSTREAMSLEXER_H_
+#define _CSTREAMSLEXER_H_
+
+// all basic includes
+#include "kernel/static.h"
+#include "kernel/cobject.h"
+#include "kernel/factories.h"
+
+//=====================================================================================
+namespace pdfobjects {
+//=====================================================================================
+
+/**
+ * Native lexer and object parser of content streams.
+ *
+ * Tokenizes directly over decoded buffers of streams (\see
+ * CStream::getDecodedBuffer) and creates operands without intermediate xpdf
+ * objects. Tokens are only ranges of these buffers, data are copied just once
+ * when an operand value is created.
+ * <br>
+ * Content stream can be split into more streams. Split points can be at
+ * crazy places (e.g. inside an array), but according to pdf specification
+ * only between lexical tokens. So the end of a stream is handled as a white
+ * space.
+ * <br>
+ * Streams must not be changed while they are read by the lexer.
+ */
+class CStreamsLexer
+{
+public:
+	typedef std::vector<boost::shared_ptr<CStream> > CStreams;
+
+	/** Kind of an object read from streams. */
+	enum ObjectKind 
+	{
+		Operand,	/**< Operand (any pdf object). */
+		Operator,	/**< Operator keyword. */
+		End			/**< No more data. */
+	};
+
+	/** Maximal nesting of arrays and dictionaries. */
+	static const size_t MAX_NESTING = 256;
+
+private:
+	/** Kind of a lexical token. */
+	enum TokenKind 
+	{
+		tkEnd, tkNumber, tkString, tkHexString, tkName, 
+		tkArrayBegin, tkArrayEnd, tkDictBegin, tkDictEnd, tkKeyword
+	};
+
+	/** 
+	 * Lexical token. 
+	 * Range points to a decoded buffer and holds token without its
+	 * delimiters (e.g. string without parenthesis, name without slash).
+	 */
+	struct Token
+	{
+		TokenKind kind;
+		const char* begin;
+		const char* end;
+	};
+
+	/** Position in streams. */
+	struct Position
+	{
+		size_t stream;		/**< Index of actual stream. */
+		const char* pos;	/**< Actual position in the actual stream. */
+		const char* end;	/**< End of the actual stream. */
+	};
+
+	/** Decoded data of a stream. */
+	typedef std::pair<const char*, const char*> Range;
+	
+	/** Objects of an array or a dictionary. */
+	typedef std::vector<boost::shared_ptr<IProperty> > Objects;
+
+	CStreams streams;			/**< Streams. */
+	std::vector<Range> ranges;	/**< Decoded data of streams. */
+	Position cur;				/**< Actual position. */
+	size_t lastStream;			/**< Stream in which the last object ended. */
+
+public:
+
+	/** Constructor. */
+	template<typename Container>
+	CStreamsLexer (Container& strs) : lastStream (0)
+	{ 
+		assert (!strs.empty()); 
+		std::copy (strs.begin(), strs.end(), std::back_inserter(streams)); 
+	}
+	
+	/** Constructor. */
+	CStreamsLexer (boost::shared_ptr<CStream> str) : lastStream (0)
+		{ assert (str); streams.push_back (str); }
+
+	/** 
+	 * Open. 
+	 * Decodes all streams (if not already decoded).
+	 */
+	void open ();
+
+	/** 
+	 * Close. 
+	 * Releases decoded buffers of all streams.
+	 */
+	void close ();
+
+	/** 
+	 * Close. 
+	 * Save parsed streams to container.
+	 *
+	 * @param parsedstreams Output buffer that will contain all streams we have
+	 * really parsed.
+	 */
+	template<typename Ctr>
+	void close (Ctr& parsedstreams)
+	{
+		assert (!streams.empty());
+		for (size_t i = 0; i <= lastStream && i < streams.size(); ++i)
+			parsedstreams.push_back (streams[i]);
+		close ();
+	}
+
+	/**
+	 * Get next object.
+	 *
+	 * @param operand Output operand if an operand is read.
+	 * @param cmd Output operator name if an operator is read.
+	 *
+	 * Damaged data are skipped where possible (see getToken and 
+	 * createObject).
+	 *
+	 * @return Kind of the object read.
+	 * @throw CObjInvalidObject if streams are malformed beyond recovery.
+	 */
+	ObjectKind getObject (boost::shared_ptr<IProperty>& operand, std::string& cmd);
+
+	/**
+	 * Look at next object.
+	 * Position is not changed.
+	 * 
+	 * \see getObject
+	 */
+	ObjectKind lookObject (boost::shared_ptr<IProperty>& operand, std::string& cmd);
+
+	/**
+	 * Get inline image data.
+	 *
+	 * Must be called right after ID operator is read. Reads all data up to EI
+	 * operator which is consumed too.
+	 *
+	 * @param buf Output buffer.
+	 */
+	void getInlineImageData (CStream::Buffer& buf);
+
+private:
+	/**
+	 * Skip white spaces and comments. 
+	 * Continues in the next stream if actual stream is at its end.
+	 *
+	 * @return False if there are no more data, true otherwise.
+	 */
+	bool skipWhiteSpace ();
+
+	/** 
+	 * Get next token. 
+	 * Stray characters (")" and single ">") are logged and skipped,
+	 * unterminated strings end at the end of the stream.
+	 */
+	Token getToken ();
+
+	/** 
+	 * Read token at actual position.
+	 * Actual position must not be at white space or stray character.
+	 *
+	 * @param token Output token.
+	 */
+	void readToken (Token& token);
+
+	/**
+	 * Create object from a token.
+	 *
+	 * Damaged dictionary entries (key which is not a name, key without 
+	 * value) are logged and skipped. If a key is duplicated, the last value
+	 * is used.
+	 *
+	 * @param token Token (arrays and dictionaries are read further).
+	 * @param depth Nesting depth.
+	 *
+	 * @return New object or NULL if token is an operator keyword.
+	 * @throw CObjInvalidObject if nesting is deeper than MAX_NESTING.
+	 */
+	IProperty* createObject (const Token& token, size_t depth);
+
+	/**
+	 * Read objects up to terminating token.
+	 * Folds "num gen R" triples into references. Operators and unexpected 
+	 * terminators are logged and skipped, missing terminator at the end of 
+	 * data is tolerated.
+	 *
+	 * @param terminator Terminating token kind.
+	 * @param objs Output objects.
+	 * @param depth Nesting depth of objects.
+	 */
+	void readObjects (TokenKind terminator, Objects& objs, size_t depth);
+};
+
+//=====================================================================================
+} // namespace pdfobjects
+//=====================================================================================
+
+#endif // _CSTREAMSLEXER_H_
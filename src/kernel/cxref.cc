@@ -96,6 +96,7 @@ void CXref::cleanUp()
 		i->second=NULL;
 	}
 	changedStorage.clear();
+	freedRefs.clear();
 	kernelPrintDbg(DBG_DBG, "changedStorage cleaned up");
 
 	kernelPrintDbg(DBG_DBG, "Cleaning newStorage");
@@ -103,6 +104,9 @@ void CXref::cleanUp()
 
 	kernelPrintDbg(DBG_DBG, "newStorage cleaned up");
 
+	// free references has to be collected again
+	resetRefAllocator();
+
 	// remove changed trailer
 	currTrailer.reset();
 }
@@ -200,51 +204,70 @@ using namespace debug;
 	return prev;
 }
 
-::Ref CXref::reserveRef()
+void CXref::initRefAllocator()
 {
 using namespace debug;
 
-	int i=1;
-	int num=-1, gen=0;
+	freeRefs.clear();
 
-	kernelPrintDbg(DBG_DBG, "");
-	
-	check_need_credentials(this);
-
-	// goes through entries array in XRef class (xref entries)
-	// and reuses first free entry with its gen number.
-	// Considers just first XRef::getNumObjects because entries array
-	// is allocated by blocks and so there are entries which are marked 
+	// goes through entries array in XRef class (xref entries) and collects
+	// free entries. Considers just first XRef::getNumObjects because entries 
+	// array is allocated by blocks and so there are entries which are marked 
 	// as free but they are not realy removed objects.
-	int objectCount=0, xrefCount=XRef::getNumObjects();
-    for(; i<MAXOBJNUM && objectCount<xrefCount; ++i)
+	int xrefCount=XRef::getNumObjects();
+	for(int i=xrefCount-1; i>0; --i)
 	{
-
+		XRefEntry * entry=XRef::getEntry(i, false);
+		if(!entry || entry->type!=xrefEntryFree)
+			continue;
 
 		// reference is never reused if generation number is MAXOBJGEN
 		// according to specification
+		if(entry->gen>=MAXOBJGEN)
+			continue;
+
+		// entry can't be reused if it is already in reservation process
+		::Ref ref={i, entry->gen};
+		if(newStorage.contains(ref))
+			continue;
+		freeRefs.push_back(ref);
+	}
+
+	// high-water mark is behind everything what is known
+	nextFreeNum=(xrefCount>0)?xrefCount:1;
+	for(RefStorage::Iterator i=newStorage.begin(); i!=newStorage.end(); ++i)
+		if(i->first.num>=nextFreeNum)
+			nextFreeNum=i->first.num+1;
+
+	refAllocatorReady=true;
+	kernelPrintDbg(DBG_DBG, freeRefs.size()<<" free entries collected, next new number="
+			<<nextFreeNum);
+}
 
+::Ref CXref::reserveRef()
+{
+using namespace debug;
+
+	int num=-1, gen=0;
+
+	kernelPrintDbg(DBG_DBG, "");
+	
+	check_need_credentials(this);
 
-		// entry is marked as free, we can reuse it only if it is not in
-		// reservation process - not in newStorage
-        Ref ref={i};
+	if(!refAllocatorReady)
+		initRefAllocator();
+
+	// reuses the lowest free entry with its gen number. Entry may have been
+	// registered in newStorage in the meantime (e.g. by XRefWriter directly)
+	// so skips such entries
+	while(!freeRefs.empty())
+	{
+		::Ref ref=freeRefs.back();
+		freeRefs.pop_back();
 		if(newStorage.contains(ref))
-		{
 			continue;
-		}
 
-		// Entry is free and not used yet. 
-		if(ref.gen)
-		{
-			kernelPrintDbg(DBG_DBG, "Reusing entry "<<ref);
-		}
-		else
-		{
-			// gen is 0, so entry couldn't have been removed - so say that it is
-			// new entry
-			kernelPrintDbg(DBG_DBG, "Using new entry "<<ref);
-		}
-			
+		kernelPrintDbg(DBG_DBG, "Reusing entry "<<ref);
 		num=ref.num;
 		gen=ref.gen;
 		break;
@@ -253,19 +276,15 @@ using namespace debug;
 	// no entry for reuse, so new has to be used
 	if(num==-1)
 	{
-		// checks if num, gen is not in newStorage and if yes,
-		// use num+1
-		for(;i<MAXOBJNUM; ++i)
+		// skips numbers which are already in newStorage
+		for(; nextFreeNum<MAXOBJNUM; ++nextFreeNum)
 		{
-			Ref ref={i, 0};
+			::Ref ref={nextFreeNum, 0};
 			if(!newStorage.contains(ref))
-			{
-				num=i;
 				break;
-			}
 		}
 
-		if(num==-1)
+		if(nextFreeNum>=MAXOBJNUM)
 		{
 			// all object numbers are used, no more indirect objects
 			// can be created
@@ -273,6 +292,7 @@ using namespace debug;
 		}
 
 		// ok, we have new num and gen is 0, because object is new
+		num=nextFreeNum++;
 		gen=0;
 		kernelPrintDbg(DBG_DBG, "Using new entry ["<<num<<", "<<gen<<"]");
 	}
@@ -287,6 +307,60 @@ using namespace debug;
 	return objRef;
 }
 
+bool CXref::releaseRef(const ::Ref & ref)
+{
+using namespace debug;
+
+	if(newStorage.get(ref)!=RESERVED_REF)
+	{
+		kernelPrintDbg(DBG_WARN, ref<<" is not reserved. Ignoring.");
+		return false;
+	}
+
+	if(!refAllocatorReady)
+		initRefAllocator();
+	newStorage.remove(ref);
+
+	// keeps descending order so that the lowest number is reused first
+	std::vector< ::Ref>::iterator i=freeRefs.begin();
+	while(i!=freeRefs.end() && i->num>ref.num)
+		++i;
+	freeRefs.insert(i, ref);
+	kernelPrintDbg(DBG_DBG, ref<<" returned to the free list");
+	return true;
+}
+
+bool CXref::freeRef(const ::Ref & ref)
+{
+using namespace debug;
+
+	if(knowsRef(ref)==UNUSED_REF)
+	{
+		kernelPrintDbg(DBG_WARN, ref<<" is not known. Ignoring.");
+		return false;
+	}
+
+	// forgets all changes of the object
+	ObjectEntry * entry=changedStorage.remove(ref);
+	if(entry)
+	{
+		if(entry->object)
+			xpdf::freeXpdfObject(entry->object);
+		delete entry;
+	}
+
+	// objects created since the last save are not in the document, so 
+	// their numbers can be reused immediately
+	if(newStorage.contains(ref))
+	{
+		newStorage.put(ref, RESERVED_REF);
+		return releaseRef(ref);
+	}
+	freedRefs.insert(ref);
+	kernelPrintDbg(DBG_DBG, ref<<" freed");
+	return true;
+}
+
 ::Object * CXref::createObject(::ObjType type, ::Ref * ref)
 {
 using namespace debug;
@@ -368,6 +442,12 @@ using namespace debug;
 		return state;
 	}
 
+	if(freedRefs.count(ref))
+	{
+		kernelPrintDbg(DBG_DBG, "Reference has been freed.");
+		return UNUSED_REF;
+	}
+
 	kernelPrintDbg(DBG_DBG, "Reference is not in newStorage. Trying XRef.");
 	// object has to be in in XRef
     state=knowsRefs(ref);
@@ -541,6 +621,14 @@ using namespace debug;
 	}
 	*/
 	
+	// freed objects are not available anymore
+	if(freedRefs.count(ref))
+	{
+		kernelPrintDbg(DBG_DBG, ref<<" has been freed - using null object");
+		obj->initNull();
+		return obj;
+	}
+
 	ObjectEntry * entry=changedStorage.get(ref);
 	if(entry)
 	{
@@ -633,6 +721,8 @@ using namespace debug;
 	kernelPrintDbg(DBG_DBG, "Destroying CXref internals");
 	if(dropChanges)
 		cleanUp();
+	// xref entries are about to change
+	resetRefAllocator();
 
 	// clears XRef internals and forces to fill them again
 	kernelPrintDbg(DBG_DBG, "Destroing XRef internals");
@@ -26,6 +26,7 @@
 #define _CXREF_H_
 
 #include <limits.h>
+#include <set>
 
 // xpdf
 #include "kernel/static.h"
@@ -138,7 +139,8 @@ protected:
 	 * This constructor is protected to prevent uninitialized instances.
 	 * We need at least to specify stream with data.
 	 */
-	CXref(): XRef(NULL), needs_credentials(false), internal_fetch(false){}
+	CXref(): XRef(NULL), needs_credentials(false), internal_fetch(false),
+		nextFreeNum(1), refAllocatorReady(false){}
 
 	/** Entry for ChangedStorage.
 	 *
@@ -169,6 +171,56 @@ protected:
 	 */
 	RefStorage newStorage;
 
+	/** Free references which can be reused by reserveRef.
+	 *
+	 * Initialized lazily by initRefAllocator from free entries of the xref 
+	 * table. Entries are sorted in descending order so the lowest object 
+	 * number is at the back and it is reused first.
+	 */
+	std::vector< ::Ref> freeRefs;
+
+	/** The lowest object number which is not used by xref table neither by
+	 * newStorage (high-water mark). 
+	 * Valid only if refAllocatorReady is true.
+	 */
+	int nextFreeNum;
+
+	/** Flag whether freeRefs and nextFreeNum are initialized.
+	 */
+	bool refAllocatorReady;
+
+	/** Type for set of references. */
+	typedef std::set< ::Ref, xpdf::RefComparator> RefSet;
+
+	/** Objects from the document which have been freed by freeRef.
+	 *
+	 * These objects are not known anymore (knowsRef returns UNUSED_REF and
+	 * fetch returns null object) and they are stored as free entries when
+	 * changes are saved. Their object numbers are not reused until then.
+	 */
+	RefSet freedRefs;
+
+	/** Initializes free references list and high-water mark.
+	 *
+	 * Collects all free entries from the xref table which can be reused
+	 * (their generation number hasn't reached MAXOBJGEN) and which are not 
+	 * registered in newStorage. High-water mark is set behind the last
+	 * xref entry and the last newStorage entry.
+	 * <br>
+	 * This is done only once for each revision, so each reserveRef call
+	 * takes constant time.
+	 */
+	void initRefAllocator();
+
+	/** Discards free references list.
+	 * It will be initialized again by the next reserveRef call.
+	 */
+	void resetRefAllocator()
+	{
+		freeRefs.clear();
+		refAllocatorReady=false;
+	}
+
 	/** Registers change in given object addressable through given 
 	 * reference.
 	 * @param ref Object reference identificator.
@@ -251,8 +303,10 @@ protected:
 
 	/** Reserves reference for new indirect object.
 	 *
-	 * Searches for free object number and generation number and uses
-	 * it to register reference for new indirect object. Reference is stored
+	 * Reuses the lowest free entry from the xref table (with its generation 
+	 * number) or the lowest never used object number if there is no such 
+	 * entry and uses it to register reference for new indirect object. 
+	 * Reservation takes constant time (see initRefAllocator). Reference is stored
 	 * to the newStorage with Reserved flag. This is changed to Initialized if 
 	 * real object is stored to the CXref (using change method). 
 	 * <br>
@@ -267,6 +321,30 @@ protected:
 	 * @return Reference which can be used to add new indirect object.
 	 */
 	virtual ::Ref reserveRef();
+
+	/** Releases reference reserved by reserveRef.
+	 *
+	 * Reference which hasn't been initialized by change method yet is
+	 * removed from newStorage and returned to the free list, so that the
+	 * next reserveRef reuses it. Initialized references are kept because
+	 * their objects are already part of the document.
+	 *
+	 * @param ref Reference to release.
+	 * @return true if the reference has been released.
+	 */
+	virtual bool releaseRef(const ::Ref & ref);
+
+	/** Frees indirect object.
+	 *
+	 * Changes of the object are forgotten. References of objects created
+	 * since the last save are released (see releaseRef), objects from the
+	 * document are added to freedRefs.
+	 *
+	 * @param ref Reference of the object.
+	 * @return true if the object has been freed, false if the reference
+	 * is not known.
+	 */
+	virtual bool freeRef(const ::Ref & ref);
 	
 	/** Creates new xpdf indirect object.
 	 * @param type Type of the object.
@@ -445,6 +523,16 @@ public:
 		return knowsRef(xpdfRef);
 	}
 
+	/** Checks whether object with given reference has been changed.
+	 * @param ref Reference to check.
+	 *
+	 * @return true if object is stored in changedStorage, false otherwise.
+	 */
+	bool isChangedRef(const ::Ref& ref)const
+	{
+		return changedStorage.contains(ref);
+	}
+
 	/** Checks whether obj1 can replace obj2.
 	 * @param obj1 Original object.
 	 * @param obj2 Replace object.
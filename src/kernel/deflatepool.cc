@@ -0,0 +1,152 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+
+#include "kernel/static.h"
+#include "kernel/deflatepool.h"
+#include "kernel/pdfwriter.h"
+#include "kernel/exceptions.h"
+
+namespace pdfobjects {
+
+namespace utils {
+
+DeflatePool::DeflatePool(size_t threads, int _level):nextId(0), stopping(false), level(_level)
+{
+	if(!threads)
+		threads=1;
+	for(size_t i=0; i<threads; ++i)
+	{
+		os::Thread thread;
+		if(!os::startThread(thread, worker, this))
+		{
+			utilsPrintDbg(debug::DBG_ERR, "Unable to create worker thread. Continuing with "
+					<<workers.size()<<" workers.");
+			break;
+		}
+		workers.push_back(thread);
+	}
+	utilsPrintDbg(debug::DBG_DBG, workers.size()<<" worker threads started");
+}
+
+DeflatePool::~DeflatePool()
+{
+	lock.lock();
+	stopping=true;
+	jobQueued.broadcast();
+	lock.unlock();
+
+	for(std::vector<os::Thread>::iterator i=workers.begin(); i!=workers.end(); ++i)
+		os::joinThread(*i);
+
+	// nobody is interested in results of remaining jobs
+	for(Jobs::iterator i=jobs.begin(); i!=jobs.end(); ++i)
+	{
+		free(i->second->in);
+		free(i->second->out);
+	}
+}
+
+void * DeflatePool::worker(void * data)
+{
+	DeflatePool * pool=static_cast<DeflatePool *>(data);
+
+	pool->lock.lock();
+	for(;;)
+	{
+		while(pool->queue.empty() && !pool->stopping)
+			pool->jobQueued.wait(pool->lock);
+		if(pool->queue.empty())
+			break;
+		boost::shared_ptr<Job> job=pool->queue.front();
+		pool->queue.pop_front();
+		pool->lock.unlock();
+
+		// only the job's buffers are touched here so no lock is needed 
+		size_t size=0;
+		unsigned char * out=ZlibFilterStreamWriter::deflate_buffer(job->in, job->inSize, size, pool->level);
+
+		pool->lock.lock();
+		job->out=out;
+		job->outSize=size;
+		job->done=true;
+		pool->jobDone.broadcast();
+	}
+	pool->lock.unlock();
+	return NULL;
+}
+
+DeflatePool::JobId DeflatePool::submit(unsigned char * in, size_t inSize)
+{
+	boost::shared_ptr<Job> job(new Job());
+	job->in=in;
+	job->inSize=inSize;
+	job->out=NULL;
+	job->outSize=0;
+	job->done=false;
+
+	lock.lock();
+	JobId id=nextId++;
+	jobs.insert(Jobs::value_type(id, job));
+	if(!workers.empty())
+	{
+		queue.push_back(job);
+		jobQueued.signal();
+	}
+	lock.unlock();
+	return id;
+}
+
+unsigned char * DeflatePool::wait(JobId id, unsigned char *& in, size_t & inSize, size_t & size)
+{
+	lock.lock();
+	Jobs::iterator i=jobs.find(id);
+	if(i==jobs.end())
+	{
+		lock.unlock();
+		throw ElementNotFoundException("DeflatePool", "job");
+	}
+	boost::shared_ptr<Job> job=i->second;
+	jobs.erase(i);
+	if(workers.empty())
+	{
+		// no workers - compress it here
+		lock.unlock();
+		job->out=ZlibFilterStreamWriter::deflate_buffer(job->in, job->inSize, job->outSize, level);
+	}else
+	{
+		while(!job->done)
+			jobDone.wait(lock);
+		lock.unlock();
+	}
+
+	in=job->in;
+	inSize=job->inSize;
+	size=job->outSize;
+	return job->out;
+}
+
+} // namespace utils
+
+} // namespace pdfobjects
@@ -0,0 +1,168 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+
+#ifndef _DEFLATE_POOL_H_
+#define _DEFLATE_POOL_H_
+
+#include "kernel/static.h"
+#include <os/threads.h>
+#include <zlib.h>
+
+namespace pdfobjects {
+
+namespace utils {
+
+/** Pool of worker threads which deflate data buffers.
+ *
+ * Only raw data compression (ZlibFilterStreamWriter::deflate_buffer) is done
+ * by workers. Everything which touches xpdf objects (stream data decoding,
+ * dictionaries updating) has to be done by the thread which owns the pool 
+ * because xpdf streams share underlying file stream position.
+ * <br>
+ * Typical usage is a pipeline where the owner thread decodes streams, 
+ * submits their data and waits for results in the same order it wants to 
+ * write them while workers compress following buffers in the meantime.
+ * <pre>
+ * DeflatePool pool(4);
+ * JobId id=pool.submit(rawBuffer, rawSize);
+ * ...
+ * unsigned char * raw;
+ * size_t rawSize, size;
+ * unsigned char * deflated=pool.wait(id, raw, rawSize, size);
+ * </pre>
+ * <br>
+ * Instance is not supposed to be shared by more owner threads.
+ */
+class DeflatePool
+{
+public:
+	/** Type for job identifier. */
+	typedef size_t JobId;
+
+private:
+	/** Compression job. */
+	struct Job
+	{
+		/** Input (raw) data. Owned by job until it is returned by wait. */
+		unsigned char * in;
+		/** Number of bytes in input data. */
+		size_t inSize;
+		/** Deflated data or NULL if compression failed. */
+		unsigned char * out;
+		/** Number of bytes in deflated data. */
+		size_t outSize;
+		/** Flag set by worker when job is finished. */
+		bool done;
+	};
+
+	/** Type for jobs table. */
+	typedef std::map<JobId, boost::shared_ptr<Job> > Jobs;
+
+	/** All submitted jobs which haven't been waited for yet. */
+	Jobs jobs;
+
+	/** Jobs waiting for worker. */
+	std::deque<boost::shared_ptr<Job> > queue;
+
+	/** Identifier for the next submitted job. */
+	JobId nextId;
+
+	/** Worker threads. */
+	std::vector<os::Thread> workers;
+
+	/** Flag for workers to finish. */
+	bool stopping;
+
+	/** Zlib compression level used for all jobs. */
+	int level;
+
+	/** Lock for all fields above. */
+	os::Mutex lock;
+
+	/** Signaled when new job is queued or pool is stopping. */
+	os::Condition jobQueued;
+
+	/** Signaled when any job is finished. */
+	os::Condition jobDone;
+
+	/** Worker thread routine.
+	 * @param pool DeflatePool instance.
+	 */
+	static void * worker(void * pool);
+
+	// not copyable
+	DeflatePool(const DeflatePool &);
+	DeflatePool & operator=(const DeflatePool &);
+public:
+	/** Initialization constructor.
+	 * @param threads Number of worker threads (at least 1 is started).
+	 * @param level Zlib compression level.
+	 *
+	 * If thread creation fails, pool continues with already started
+	 * workers. If no worker is running (e.g. when threads are not 
+	 * supported on this platform - see os::threadsAvailable), jobs are 
+	 * compressed directly in wait method.
+	 */
+	DeflatePool(size_t threads, int level=Z_DEFAULT_COMPRESSION);
+
+	/** Destructor.
+	 *
+	 * Stops and joins all workers. Data of jobs which haven't been waited
+	 * for are deallocated.
+	 */
+	~DeflatePool();
+
+	/** Returns number of running worker threads. */
+	size_t getThreads()const
+	{
+		return workers.size();
+	}
+
+	/** Submits new compression job.
+	 * @param in Raw data buffer (allocated by malloc). Ownership is moved to 
+	 * the pool until wait returns it back.
+	 * @param inSize Number of bytes in data buffer.
+	 * @return Job identifier for wait method.
+	 */
+	JobId submit(unsigned char * in, size_t inSize);
+
+	/** Waits for given job.
+	 * @param id Job identifier returned by submit.
+	 * @param in Raw data buffer given to submit (caller is responsible for
+	 * deallocation).
+	 * @param inSize Number of bytes in raw data buffer.
+	 * @param size Number of bytes in deflated buffer.
+	 * @return Deflated buffer (allocated by malloc) or NULL if compression 
+	 * failed.
+	 * @throw ElementNotFoundException if there is no such job.
+	 */
+	unsigned char * wait(JobId id, unsigned char *& in, size_t & inSize, size_t & size);
+};
+
+} // namespace utils
+
+} // namespace pdfobjects
+
+#endif
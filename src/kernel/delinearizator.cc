@@ -99,14 +99,35 @@ int Delinearizator::fillObjectList(IPdfWriter::ObjectList &objectList, int maxOb
   	// free, to the objectList. Skips also Linearized dictionary
 	utilsPrintDbg(debug::DBG_DBG, "Collecting objects starting from "<<lastObj);
 	objectList.clear();
-    for(; lastObj < maxObjectCount; )
+	for(; lastObj < XRef::getNumObjects(); lastObj++)
   	{
 		// stop if we reach the maximum objects
-		if(maxObjectCount>0 && (int)objectList.size()>=maxObjectCount)
+		if(maxObjectCount>0 && (int)(objectList.size()+rawObjectList.size())>=maxObjectCount)
 			break;
+
+		XRefEntry * entry=XRef::getEntry(lastObj, false);
+		if(!entry || entry->type==xrefEntryFree)
+			continue;
+		::Ref ref={lastObj, entry->type==xrefEntryCompressed?0:entry->gen};
+		if(ref.num==linearizedRef.num && ref.gen==linearizedRef.gen)
+			continue;
+
+		// unchanged objects are copied as they are if possible
+		if(addRawObject(ref))
+			continue;
+
+		::Object * obj=XPdfObjectFactory::getInstance();
+		XRef::fetch(ref.num, ref.gen, obj);
+		if(!isOk())
+		{
+			xpdf::freeXpdfObject(obj);
+			throw MalformedFormatExeption("bad data stream");
+		}
+		objectList.push_back(IPdfWriter::ObjectElement(ref, obj));
   	}
-	utilsPrintDbg(debug::DBG_DBG, "Returned "<<objectList.size()<<" objects");
-	return objectList.size();
+	utilsPrintDbg(debug::DBG_DBG, "Returned "<<objectList.size()<<" objects and "
+			<<rawObjectList.size()<<" raw objects");
+	return objectList.size()+rawObjectList.size();
   }
 } //namespace utils
 } //namespace pdfobjects
@@ -61,6 +61,7 @@
 class PdfOpenException;
 class MalformedFormatExeption;
 class PageNotFoundException;
+class PageProcessingException;
 class ReadOnlyDocumentException;
 class NoPageRootException;
 
@@ -254,6 +255,43 @@ public:
 	}
 };
 
+/** Exception is thrown when processing of a page by a worker thread fails.
+ *
+ * Carries position of the page and message of the original exception (which
+ * can't be rethrown in other thread).
+ */
+class PageProcessingException: public PdfException
+{
+	size_t position;
+	std::string message;
+	
+public:
+	/** Exception constructor.
+	 * @param pos Position of the page which failed.
+	 * @param msg Message of the original exception.
+	 */
+	PageProcessingException(size_t pos, const std::string& msg):position(pos)
+	{
+		std::ostringstream str;
+		str<<"Processing of page at "<<pos<<" failed: "<<msg;
+		message=str.str();
+	}
+
+	virtual ~PageProcessingException() throw()
+	{
+	}
+
+	virtual const char * what()const throw()
+	{
+		return message.c_str();
+	}
+
+	void getPosition(size_t & pos)
+	{
+		pos=position;
+	}
+};
+
 /** Exception is thrown when page tree is ambiguous.
  *
  * This means that it is not possible to get Node position in its parent Kids
@@ -213,9 +213,13 @@ int Flattener::fillObjectList(IPdfWriter::ObjectList &objectList, int maxObjectC
 		int num=ref.num, gen=ref.gen;
 
 		// stop if we reach the maximum objects
-		if(maxObjectCount>0 && objectList.size()>=(size_t)maxObjectCount)
+		if(maxObjectCount>0 && objectList.size()+rawObjectList.size()>=(size_t)maxObjectCount)
 			break;
 
+		// unchanged objects are copied as they are if possible
+		if(addRawObject(ref))
+			continue;
+
 		::Object * obj=XPdfObjectFactory::getInstance();
 		XRef::fetch(num, gen, obj);
 		if(!isOk())
@@ -226,6 +230,7 @@ int Flattener::fillObjectList(IPdfWriter::ObjectList &objectList, int maxObjectC
 		}
 		objectList.push_back(IPdfWriter::ObjectElement(ref, obj));
 	}
-	utilsPrintDbg(debug::DBG_DBG, "Returned "<<objectList.size()<<" objects");
-	return objectList.size();
+	utilsPrintDbg(debug::DBG_DBG, "Returned "<<objectList.size()<<" objects and "
+			<<rawObjectList.size()<<" raw objects");
+	return objectList.size()+rawObjectList.size();
 }
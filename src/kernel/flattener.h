@@ -51,6 +51,7 @@ namespace utils
  * Use static factory method for instance creation:
  * <pre>
  * // we will use OldStylePdfWriter IPdfWriter implementator
+ * // (XRefStreamPdfWriter produces compressed PDF 1.5 output)
  * IPdfWriter * contentWriter=new OldStylePdfWriter();
  * boost::shared_ptr<Flattener> flattener = Flattener::getInstance(fileName, contentWriter);
  *
@@ -37,7 +37,8 @@ namespace pdfobjects {
 //
 // Constructor
 //
-IProperty::IProperty (boost::weak_ptr<CPdf> _pdf) : mode(mdUnknown), pdf(_pdf), wantDispatch (true)
+IProperty::IProperty (boost::weak_ptr<CPdf> _pdf) : mode(mdUnknown), pdf(_pdf), wantDispatch (true), 
+	notificationDeferred (false)
 {
 	ref.num = ref.gen = 0; 
 }
@@ -46,7 +47,8 @@ IProperty::IProperty (boost::weak_ptr<CPdf> _pdf) : mode(mdUnknown), pdf(_pdf),
 // Constructor
 //
 IProperty::IProperty (boost::weak_ptr<CPdf> _pdf, const IndiRef& rf) 
-	: ref(rf), mode(mdUnknown), pdf(_pdf), wantDispatch (true) {}
+	: ref(rf), mode(mdUnknown), pdf(_pdf), wantDispatch (true), 
+	notificationDeferred (false) {}
 
 	
 //
@@ -73,7 +75,12 @@ IProperty::clone () const
 //
 void 
 IProperty::setPdf (boost::weak_ptr<CPdf> p)
-	{ pdf = p; }
+{
+	// deferred notifications are kept by the original pdf
+	if (notificationDeferred)
+		discardDeferredNotifications ();
+	pdf = p;
+}
 
 
 void
@@ -121,6 +128,35 @@ IProperty::dispatchChange () const
 }
 
 
+//
+// Observers
+//
+void
+IProperty::notifyObservers (boost::shared_ptr<IProperty> newValue, 
+		boost::shared_ptr<const ObserverContext> context)
+{
+	// nobody is interested in this change
+	if (observers.empty ())
+		return;
+
+	// pdf in transaction keeps the change until commit
+	boost::shared_ptr<CPdf> p = pdf.lock();
+	if (p && p->inTransaction () && p->deferNotification (this, newValue, context))
+		return;
+
+	IPropertyObserverSubject::notifyObservers (newValue, context);
+}
+
+void
+IProperty::discardDeferredNotifications ()
+{
+	notificationDeferred = false;
+	boost::shared_ptr<CPdf> p = pdf.lock();
+	if (p)
+		p->forgetDeferredNotifications (this);
+}
+
+
 //=====================================================================================
 // Output functions
 //=====================================================================================
@@ -101,6 +101,10 @@ private:
 	PropertyMode	mode;		/**< Mode of this property. */
 	boost::weak_ptr<CPdf> 	pdf;/**< This object belongs to this pdf. */	
 	bool			wantDispatch;/**< If true changes are dispatched. */
+	bool			notificationDeferred;/**< If true pdf holds deferred notification for this object. */
+
+	/** Pdf keeps track of deferred notifications. */
+	friend class CPdf;
 
 	//
 	// Constructors
@@ -284,10 +288,38 @@ public:
 	 */
 	virtual Object* _makeXpdfObject () const = 0;
 
+	//
+	// Observers
+	//
+public:
+	/**
+	 * Notifies all observers about change.
+	 *
+	 * If the pdf this object belongs to is inside of a transaction (see
+	 * CPdf::beginTransaction), notification is handed over to the pdf which
+	 * coalesces it with previous changes of the same value and delivers it
+	 * when the transaction is commited. Otherwise observers are notified
+	 * immediately.
+	 *
+	 * @param newValue Object with new value.
+	 * @param context Context in which the change has been made.
+	 */
+	virtual void notifyObservers (boost::shared_ptr<IProperty> newValue, 
+			boost::shared_ptr<const ObserverContext> context);
+
+private:
+	/**
+	 * Removes all deferred notifications of this object from the pdf.
+	 */
+	void discardDeferredNotifications ();
+
+public:
 	/**
 	 * Destructor.
 	 */
 	virtual ~IProperty () {
+		if (notificationDeferred)
+			discardDeferredNotifications ();
 		check_observerlist (this->observers);
 	}
 
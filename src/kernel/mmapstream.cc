@@ -0,0 +1,106 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+
+#include "kernel/static.h"
+#include "kernel/mmapstream.h"
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace pdfobjects {
+
+MmapStream::MmapStream(void * buf, size_t size, Object * dict)
+	:MemStream((char *)buf, 0, size, dict), mapping(buf), mappingSize(size)
+{
+}
+
+#ifdef WIN32
+
+// memory mapping is not implemented for Windows, callers use FileStream
+MmapStream * MmapStream::create(FILE *, Object *)
+{
+	kernelPrintDbg(debug::DBG_INFO, "Memory mapping is not supported on this platform");
+	return NULL;
+}
+
+MmapStream::~MmapStream()
+{
+}
+
+#else
+
+MmapStream * MmapStream::create(FILE * file, Object * dict)
+{
+	int fd=fileno(file);
+	struct stat st;
+	if(fd<0 || fstat(fd, &st))
+	{
+		kernelPrintDbg(debug::DBG_WARN, "Unable to stat file (reason="
+				<<strerror(errno)<<")");
+		return NULL;
+	}
+
+	// only regular non empty files can be mapped
+	if(!S_ISREG(st.st_mode) || st.st_size<=0)
+	{
+		kernelPrintDbg(debug::DBG_WARN, "File is not mappable (size="
+				<<st.st_size<<")");
+		return NULL;
+	}
+	size_t size=(size_t)st.st_size;
+	if((off_t)size!=st.st_size)
+	{
+		kernelPrintDbg(debug::DBG_WARN, "File too big to be mapped (size="
+				<<st.st_size<<")");
+		return NULL;
+	}
+
+	void * buf=mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(buf==MAP_FAILED)
+	{
+		kernelPrintDbg(debug::DBG_WARN, "mmap failed (reason="
+				<<strerror(errno)<<")");
+		return NULL;
+	}
+	
+	// we are going to read document mostly sequentially while parsing
+	// revisions and in random order when fetching objects, so just hint
+	// the kernel that the whole content will be needed
+	madvise(buf, size, MADV_WILLNEED);
+	kernelPrintDbg(debug::DBG_DBG, "File mapped (size="<<size<<")");
+	return new MmapStream(buf, size, dict);
+}
+
+MmapStream::~MmapStream()
+{
+	if(munmap(mapping, mappingSize))
+		kernelPrintDbg(debug::DBG_ERR, "munmap failed (reason="
+				<<strerror(errno)<<")");
+}
+
+#endif // WIN32
+
+} // namespace pdfobjects
@@ -0,0 +1,90 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+
+#ifndef _MMAPSTREAM_H_
+#define _MMAPSTREAM_H_
+
+#include "kernel/static.h"
+
+namespace pdfobjects {
+
+/** Memory mapped read-only document stream.
+ *
+ * Whole file is mapped to the memory and the content is provided through
+ * xpdf MemStream interface, so all readers (XRef parsing, revisions
+ * collecting, content stream parsing through sub streams) access the data
+ * directly without buffered seek + read calls of the FileStream.
+ * <br>
+ * Mapping is released when the stream is deleted (XRef deletes its stream
+ * in its destructor). Sub streams created by makeSubStream share the 
+ * mapping and so they must not outlive this stream - which is the same
+ * constraint which holds for FileStream sub streams.
+ * <br>
+ * Instance is created only by create factory method which returns NULL if
+ * the file cannot be mapped (e.g. empty file, pipe or mmap failure) and the
+ * caller is supposed to fall back to FileStream in such a case. Mapping is
+ * not implemented on Windows, so create always returns NULL there.
+ * <br>
+ * Note that the mapping is private and read-only so this stream is suitable
+ * only for documents opened in CPdf::ReadOnly mode. Changes written to the
+ * file would not be visible in the stream.
+ */
+class MmapStream: public MemStream
+{
+	/** Start of the mapped region.
+	 */
+	void * mapping;
+
+	/** Size of the mapped region.
+	 */
+	size_t mappingSize;
+
+	/** Initialization constructor.
+	 * @param buf Mapped region.
+	 * @param size Size of the region.
+	 * @param dict Stream dictionary.
+	 */
+	MmapStream(void * buf, size_t size, Object * dict);
+public:
+	/** Maps given file to the memory.
+	 * @param file File handle (opened at least for reading).
+	 * @param dict Stream dictionary (see BaseStream constructor).
+	 *
+	 * File handle is not closed nor repositioned and it can be closed
+	 * after the stream has been created.
+	 *
+	 * @return New stream instance or NULL if file cannot be mapped.
+	 */
+	static MmapStream * create(FILE * file, Object * dict);
+
+	/** Destructor.
+	 * Unmaps the file content.
+	 */
+	virtual ~MmapStream();
+};
+
+} // namespace pdfobjects
+
+#endif
@@ -0,0 +1,208 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+
+#include "kernel/static.h"
+#include "kernel/nametable.h"
+#include "os/threads.h"
+
+//=====================================================================================
+namespace pdfobjects {
+//=====================================================================================
+
+namespace {
+
+	/** 
+	 * Returns lock for the table. 
+	 * Constructed on the first use like the table, so that it can be used
+	 * during initialization of other static data.
+	 */
+	os::Mutex&
+	tableLock ()
+	{
+		static os::Mutex lock;
+		return lock;
+	}
+
+} // namespace
+
+/** Atom caches of threads. */
+struct NameTable::ThreadCaches
+{
+	/** Cache of the calling thread. */
+	os::ThreadLocalPtr<Atoms> current;
+	/** Caches of all threads. */
+	std::vector<Atoms*> all;
+};
+
+NameTable::NameTable () : count (1), limit (DEFAULT_LIMIT), threadCaches (new ThreadCaches ())
+{
+	// lock has to outlive the table
+	tableLock ();
+	std::fill (chunks, chunks + MAX_CHUNKS, static_cast<std::string*> (NULL));
+	// NO_ATOM stands for the empty name and is never returned by intern
+	chunks[0] = new std::string[CHUNK_SIZE];
+}
+
+NameTable::~NameTable ()
+{
+	for (size_t i = 0; i < MAX_CHUNKS && chunks[i]; ++i)
+		delete [] chunks[i];
+	for (std::vector<Atoms*>::iterator it = threadCaches->all.begin(); it != threadCaches->all.end(); ++it)
+		delete *it;
+	delete threadCaches;
+}
+
+NameTable & 
+NameTable::instance ()
+{
+	// constructed on the first use so that it can be used also during 
+	// initialization of other static data
+	static NameTable table;
+	return table;
+}
+
+NameAtom 
+NameTable::intern (const std::string& name)
+{
+	NameAtom atom = _cachedAtom (name);
+	if (NO_ATOM != atom)
+		return atom;
+	os::ScopedLock lock (tableLock ());
+	return _cacheAtom (name, _intern (name, true));
+}
+
+NameAtom 
+NameTable::tryIntern (const std::string& name)
+{
+	NameAtom atom = _cachedAtom (name);
+	if (NO_ATOM != atom)
+		return atom;
+	os::ScopedLock lock (tableLock ());
+	return _cacheAtom (name, _intern (name, false));
+}
+
+NameAtom 
+NameTable::_cachedAtom (const std::string& name) const
+{
+	const Atoms* cache = threadCaches->current.get ();
+	if (!cache)
+		return NO_ATOM;
+	Atoms::const_iterator it = cache->find (name);
+	return (it == cache->end()) ? NO_ATOM : it->second;
+}
+
+NameAtom 
+NameTable::_cacheAtom (const std::string& name, NameAtom atom) const
+{
+	// name can be interned later, so misses are not cached
+	if (NO_ATOM == atom)
+		return atom;
+	Atoms* cache = threadCaches->current.get ();
+	if (!cache)
+	{
+		threadCaches->all.reserve (threadCaches->all.size() + 1);
+		cache = new Atoms ();
+		threadCaches->all.push_back (cache);
+		threadCaches->current.set (cache);
+	}
+	cache->insert (Atoms::value_type (name, atom));
+	return atom;
+}
+
+void
+NameTable::releaseThreadCache ()
+{
+	Atoms* cache = threadCaches->current.get ();
+	if (!cache)
+		return;
+	threadCaches->current.set (NULL);
+	os::ScopedLock lock (tableLock ());
+	threadCaches->all.erase (std::find (threadCaches->all.begin(), threadCaches->all.end(), cache));
+	delete cache;
+}
+
+NameAtom 
+NameTable::_intern (const std::string& name, bool force)
+{
+	Atoms::const_iterator it = atoms.find (name);
+	if (it != atoms.end())
+		return it->second;
+
+	if (!force && count >= limit)
+	{
+		kernelPrintDbg (debug::DBG_DBG, "Name table limit reached, " << name << " not interned.");
+		return NO_ATOM;
+	}
+
+	size_t chunk = count / CHUNK_SIZE;
+	if (chunk >= MAX_CHUNKS)
+	{
+		kernelPrintDbg (debug::DBG_CRIT, "Name table is full.");
+		throw std::bad_alloc ();
+	}
+	if (!chunks[chunk])
+		chunks[chunk] = new std::string[CHUNK_SIZE];
+	NameAtom atom = static_cast<NameAtom> (count);
+	chunks[chunk][count % CHUNK_SIZE] = name;
+	atoms.insert (Atoms::value_type (name, atom));
+	++count;
+	return atom;
+}
+
+void
+NameTable::setLimit (size_t l)
+{
+	os::ScopedLock lock (tableLock ());
+	limit = l;
+}
+
+size_t
+NameTable::getLimit () const
+{
+	os::ScopedLock lock (tableLock ());
+	return limit;
+}
+
+NameAtom 
+NameTable::lookup (const std::string& name) const
+{
+	NameAtom atom = _cachedAtom (name);
+	if (NO_ATOM != atom)
+		return atom;
+	os::ScopedLock lock (tableLock ());
+	Atoms::const_iterator it = atoms.find (name);
+	return _cacheAtom (name, (it == atoms.end()) ? NO_ATOM : it->second);
+}
+
+size_t
+NameTable::size () const
+{
+	os::ScopedLock lock (tableLock ());
+	return count;
+}
+
+//=====================================================================================
+} // namespace pdfobjects
+//=====================================================================================
@@ -0,0 +1,212 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+#ifndef _NAMETABLE_H_
+#define _NAMETABLE_H_
+
+#include "kernel/static.h"
+#include <boost/unordered_map.hpp>
+
+//=====================================================================================
+namespace pdfobjects {
+//=====================================================================================
+
+/** 
+ * Interned name identifier.
+ *
+ * Each distinct name string has exactly one atom assigned by the NameTable,
+ * so two names are equal if and only if their atoms are equal.
+ */
+typedef unsigned int NameAtom;
+
+/** Atom which doesn't represent any name. */
+const NameAtom NO_ATOM = 0;
+
+/**
+ * Global table of interned names.
+ *
+ * Names used in pdf objects (name objects, dictionary keys) and content
+ * stream operator names come from a rather small set of strings. This table 
+ * assigns an integer atom to each of them so that they can be stored and 
+ * compared cheaply. Strings of interned names are never released, so atoms
+ * and references returned by getName stay valid for the whole program life.
+ * <br>
+ * The table is shared by all documents, so it would grow without bounds for
+ * documents full of unique names. Names which are interned only to speed up
+ * lookups and comparisons (name objects, dictionary keys) use tryIntern 
+ * which gives up when the table reaches its limit (see setLimit), callers
+ * fall back to plain strings then. Names of known operators are always 
+ * interned (see intern), unknown operator names are kept as plain strings
+ * (see StateUpdater::findOpAtom).
+ * <br>
+ * Use static instance method to get the table.
+ * <br>
+ * Table is thread safe. Atoms never change, so each thread caches atoms of
+ * names it has already interned or looked up and repeated lookups don't
+ * lock at all. Only names which are new for the thread go to the shared
+ * table under a lock. getName doesn't lock at all because interned strings
+ * never move. Threads which are about to finish should call 
+ * releaseThreadCache.
+ */
+class NameTable : noncopyable
+{
+	/** Mapping from name to its atom. */
+	typedef boost::unordered_map<std::string, NameAtom> Atoms;
+	Atoms atoms;
+
+	/** Number of names in one chunk. */
+	static const size_t CHUNK_SIZE = 1024;
+	/** Maximal number of chunks. */
+	static const size_t MAX_CHUNKS = 65536;
+
+	/** Names indexed by their atoms. 
+	 * Names are stored in fixed size chunks which are never moved or 
+	 * released, so a name can be read while other thread interns a new one.
+	 */
+	std::string* chunks[MAX_CHUNKS];
+
+	/** Number of interned names. */
+	size_t count;
+
+	/** Maximal number of names interned by tryIntern. 
+	 * Atoms, chunks, count, limit and the set of thread caches are guarded
+	 * by a lock private to the implementation.
+	 */
+	size_t limit;
+
+	/** Per thread caches (defined by the implementation). */
+	struct ThreadCaches;
+	ThreadCaches* threadCaches;
+
+	/** Initializes table with empty name for NO_ATOM. */
+	NameTable ();
+
+	/** Destructor. */
+	~NameTable ();
+
+public:
+	/** Returns the only instance of the table.
+	 * @return NameTable instance.
+	 */
+	static NameTable & instance ();
+
+	/** Default limit of the table. */
+	static const size_t DEFAULT_LIMIT = 1 << 20;
+
+	/** Gets atom for given name, creates new one if name is not known yet.
+	 * Name is interned even if the limit has been reached.
+	 * @param name Name to intern.
+	 * @return Atom of the name.
+	 */
+	NameAtom intern (const std::string& name);
+
+	/** Gets atom for given name, creates new one if name is not known yet
+	 * and the table hasn't reached its limit.
+	 * @param name Name to intern.
+	 * @return Atom of the name or NO_ATOM if the table is full.
+	 */
+	NameAtom tryIntern (const std::string& name);
+
+	/** Sets limit for tryIntern.
+	 * Already interned names are kept even if there are more of them.
+	 * @param limit Maximal number of names.
+	 */
+	void setLimit (size_t limit);
+
+	/** Returns limit for tryIntern.
+	 * @return Maximal number of names.
+	 */
+	size_t getLimit () const;
+
+	/** Gets atom for given name without interning it.
+	 * @param name Name to look for.
+	 * @return Atom of the name or NO_ATOM if name hasn't been interned.
+	 */
+	NameAtom lookup (const std::string& name) const;
+
+	/** Gets name for given atom.
+	 * @param atom Atom returned by intern.
+	 * @return Interned name (empty for NO_ATOM).
+	 */
+	const std::string& getName (NameAtom atom) const
+	{
+		assert (atom / CHUNK_SIZE < MAX_CHUNKS && chunks[atom / CHUNK_SIZE]);
+		return chunks[atom / CHUNK_SIZE][atom % CHUNK_SIZE];
+	}
+
+	/** Returns number of interned names.
+	 * @return Names count (including empty name for NO_ATOM).
+	 */
+	size_t size () const;
+
+	/** Releases atom cache of the calling thread.
+	 * Thread gets a new cache when it uses the table next time.
+	 */
+	void releaseThreadCache ();
+
+private:
+	/** Interns the name, lock must be held.
+	 * @param name Name to intern.
+	 * @param force Intern even if the limit has been reached.
+	 * @return Atom of the name or NO_ATOM.
+	 */
+	NameAtom _intern (const std::string& name, bool force);
+
+	/** Gets atom from the cache of the calling thread, doesn't lock.
+	 * @param name Name to look for.
+	 * @return Atom of the name or NO_ATOM if the thread hasn't seen it.
+	 */
+	NameAtom _cachedAtom (const std::string& name) const;
+
+	/** Stores atom to the cache of the calling thread, lock must be held.
+	 * @param name Name.
+	 * @param atom Atom of the name (NO_ATOM is not stored).
+	 * @return atom.
+	 */
+	NameAtom _cacheAtom (const std::string& name, NameAtom atom) const;
+};
+
+/** Interns given name. 
+ * Shortcut for NameTable::instance().intern(name).
+ * @param name Name to intern.
+ * @return Atom of the name.
+ */
+inline NameAtom 
+internName (const std::string& name)
+	{ return NameTable::instance().intern (name); }
+
+/** Gets name for given atom. 
+ * Shortcut for NameTable::instance().getName(atom).
+ * @param atom Atom of the name.
+ * @return Interned name.
+ */
+inline const std::string& 
+atomName (NameAtom atom)
+	{ return NameTable::instance().getName (atom); }
+
+//=====================================================================================
+} // namespace pdfobjects
+//=====================================================================================
+
+#endif // _NAMETABLE_H_
@@ -0,0 +1,303 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+
+#include "kernel/static.h"
+#include "kernel/operatorpool.h"
+#include "os/threads.h"
+#include <cstdlib>
+
+//=====================================================================================
+namespace pdfobjects {
+//=====================================================================================
+
+namespace {
+
+	class ThreadPool;
+
+	/** Header in front of each pooled block. Keeps alignment of the block. */
+	union BlockHeader
+	{
+		/** Pool which the block belongs to. */
+		ThreadPool* owner;
+		double align[2];
+	};
+
+	/** Block in a free list (overlays the header). */
+	struct FreeBlock
+	{
+		FreeBlock* next;
+	};
+
+	/** Size class index of given size, 0 for empty objects. */
+	inline size_t
+	sizeClass (size_t size)
+		{ return (size + OperatorPool::GRANULARITY - 1) / OperatorPool::GRANULARITY; }
+
+	/**
+	 * Pools of one thread.
+	 *
+	 * Blocks are taken only by the thread which owns the pool but they can
+	 * be returned by any thread (operators can be handed over to another 
+	 * thread), so each pool has its own lock. Owner is the only one who
+	 * takes it unless operators change threads, so the lock is not 
+	 * contended and threads don't wait for each other.
+	 * <br>
+	 * Blocks of all size classes are cut from common chunks and returned 
+	 * to free lists of their classes.
+	 */
+	class ThreadPool
+	{
+	public:
+		/** Size of chunks reserved from the system. */
+		static const size_t CHUNK = 64 * 1024;
+
+		/** Lock for all fields below. */
+		os::Mutex lock;
+
+	private:
+		/** Free lists of size classes (0 is not used). */
+		FreeBlock* freeLists[OperatorPool::POOLS + 1];
+		/** Chunks reserved from the system. */
+		std::vector<char*> chunks;
+		/** Unused part of the last chunk. */
+		char* unused;
+		/** End of the last chunk. */
+		char* unusedEnd;
+		/** Number of live blocks. */
+		size_t liveBlocks;
+
+	public:
+		/** True if a thread allocates from the pool. Guarded by registryLock. */
+		bool owned;
+
+		ThreadPool () : unused (NULL), unusedEnd (NULL), liveBlocks (0), owned (false)
+			{ std::fill (freeLists, freeLists + OperatorPool::POOLS + 1, static_cast<FreeBlock*> (NULL)); }
+
+		/** Number of live blocks. Lock must be held. */
+		size_t getLiveBlocks () const
+			{ return liveBlocks; }
+
+		/** Number of reserved bytes. Lock must be held. */
+		size_t getReservedBytes () const
+			{ return chunks.size() * CHUNK; }
+
+		/** Takes a block of given size class. Lock must be held. */
+		void* allocate (size_t cls)
+		{
+			BlockHeader* header;
+			if (NULL != freeLists[cls])
+			{
+				header = reinterpret_cast<BlockHeader*> (freeLists[cls]);
+				freeLists[cls] = freeLists[cls]->next;
+			}else
+			{
+				size_t bytes = sizeof (BlockHeader) + cls * OperatorPool::GRANULARITY;
+				if (static_cast<size_t> (unusedEnd - unused) < bytes)
+				{
+					chunks.reserve (chunks.size() + 1);
+					char* chunk = static_cast<char*> (std::malloc (CHUNK));
+					if (NULL == chunk)
+						throw std::bad_alloc ();
+					chunks.push_back (chunk);
+					unused = chunk;
+					unusedEnd = chunk + CHUNK;
+				}
+				header = reinterpret_cast<BlockHeader*> (unused);
+				unused += bytes;
+			}
+			header->owner = this;
+			++liveBlocks;
+			return header + 1;
+		}
+
+		/** Returns a block of given size class. Lock must be held. */
+		void deallocate (BlockHeader* header, size_t cls)
+		{
+			assert (this == header->owner);
+			assert (0 < liveBlocks);
+			FreeBlock* block = reinterpret_cast<FreeBlock*> (header);
+			block->next = freeLists[cls];
+			freeLists[cls] = block;
+			--liveBlocks;
+		}
+
+		/** Returns all memory to the system. No block may be live. Lock must be held. */
+		void purge ()
+		{
+			assert (0 == liveBlocks);
+			for (std::vector<char*>::iterator it = chunks.begin(); it != chunks.end(); ++it)
+				std::free (*it);
+			std::vector<char*> ().swap (chunks);
+			std::fill (freeLists, freeLists + OperatorPool::POOLS + 1, static_cast<FreeBlock*> (NULL));
+			unused = unusedEnd = NULL;
+		}
+	};
+
+	/** Lock for the pool registry and owned flags of pools. */
+	os::Mutex registryLock;
+
+	/** 
+	 * All pools. 
+	 * Pools are never destroyed because their blocks can be returned at any
+	 * time (also during static destruction).
+	 */
+	std::vector<ThreadPool*>* registry = new std::vector<ThreadPool*> ();
+
+	/** Pool of the calling thread. */
+	os::ThreadLocalPtr<ThreadPool> currentPool;
+
+	/** Returns pool of the calling thread. Pool released by another thread is reused. */
+	ThreadPool&
+	threadPool ()
+	{
+		ThreadPool* pool = currentPool.get ();
+		if (NULL != pool)
+			return *pool;
+
+		os::ScopedLock lock (registryLock);
+		for (std::vector<ThreadPool*>::iterator it = registry->begin(); it != registry->end() && NULL == pool; ++it)
+			if (!(*it)->owned)
+				pool = *it;
+		if (NULL == pool)
+		{
+			registry->reserve (registry->size() + 1);
+			pool = new ThreadPool ();
+			registry->push_back (pool);
+		}
+		pool->owned = true;
+		currentPool.set (pool);
+		return *pool;
+	}
+
+} // namespace
+
+//
+//
+//
+void*
+OperatorPool::allocate (size_t size)
+{
+	size_t cls = sizeClass (size);
+	if (POOLS < cls)
+		return ::operator new (size);
+	if (0 == cls)
+		cls = 1;
+	
+	ThreadPool& pool = threadPool ();
+	os::ScopedLock lock (pool.lock);
+	return pool.allocate (cls);
+}
+
+//
+//
+//
+void
+OperatorPool::deallocate (void* p, size_t size)
+{
+	if (NULL == p)
+		return;
+	size_t cls = sizeClass (size);
+	if (POOLS < cls)
+	{
+		::operator delete (p);
+		return;
+	}
+	if (0 == cls)
+		cls = 1;
+
+	// Block goes back to the pool it was taken from
+	BlockHeader* header = static_cast<BlockHeader*> (p) - 1;
+	ThreadPool& pool = *header->owner;
+	os::ScopedLock lock (pool.lock);
+	pool.deallocate (header, cls);
+	// Small pools keep their memory for next operators
+	if (0 == pool.getLiveBlocks () && PURGE_THRESHOLD < pool.getReservedBytes ())
+		pool.purge ();
+}
+
+//
+//
+//
+void
+OperatorPool::purge ()
+{
+	os::ScopedLock lock (registryLock);
+	for (std::vector<ThreadPool*>::iterator it = registry->begin(); it != registry->end(); ++it)
+	{
+		os::ScopedLock poolLock ((*it)->lock);
+		if (0 == (*it)->getLiveBlocks ())
+			(*it)->purge ();
+	}
+}
+
+//
+//
+//
+void
+OperatorPool::releaseThreadPool ()
+{
+	ThreadPool* pool = currentPool.get ();
+	if (NULL == pool)
+		return;
+	currentPool.set (NULL);
+	os::ScopedLock lock (registryLock);
+	pool->owned = false;
+}
+
+//
+//
+//
+size_t
+OperatorPool::getLiveBlocks ()
+{
+	os::ScopedLock lock (registryLock);
+	size_t blocks = 0;
+	for (std::vector<ThreadPool*>::iterator it = registry->begin(); it != registry->end(); ++it)
+	{
+		os::ScopedLock poolLock ((*it)->lock);
+		blocks += (*it)->getLiveBlocks ();
+	}
+	return blocks;
+}
+
+//
+//
+//
+size_t
+OperatorPool::getReservedBytes ()
+{
+	os::ScopedLock lock (registryLock);
+	size_t bytes = 0;
+	for (std::vector<ThreadPool*>::iterator it = registry->begin(); it != registry->end(); ++it)
+	{
+		os::ScopedLock poolLock ((*it)->lock);
+		bytes += (*it)->getReservedBytes ();
+	}
+	return bytes;
+}
+
+//=====================================================================================
+} // namespace pdfobjects
+//=====================================================================================
@@ -0,0 +1,191 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+#ifndef _OPERATORPOOL_H_
+#define _OPERATORPOOL_H_
+
+#include "kernel/static.h"
+#include <cstddef>
+#include <new>
+#include <boost/shared_ptr.hpp>
+#include <boost/checked_delete.hpp>
+
+//=====================================================================================
+namespace pdfobjects {
+//=====================================================================================
+
+/**
+ * Memory pools for pdf operators.
+ *
+ * Content stream parsing creates a huge number of small operator objects 
+ * which live exactly as long as the content stream (or as long as somebody
+ * holds them). Allocating each of them from the global heap is slow, so 
+ * operators are allocated from size segregated pools instead. Allocation is
+ * taking a block from the free list (or bumping into a new chunk) and
+ * deallocation returns the block to its free list, so parsing and throwing
+ * away pages in sequence (e.g. batch text extraction) reuses the same memory
+ * without going to the global heap at all.
+ * <br>
+ * Operators are shared (they can outlive their content stream), so the
+ * memory can't be released as a whole when a content stream is destroyed.
+ * Instead live blocks are counted and memory of a pool without live blocks
+ * is returned to the system if it exceeds PURGE_THRESHOLD or when purge is 
+ * called. Smaller pools keep their memory, so parsing of pages in sequence
+ * doesn't go to the system for every page.
+ * <br>
+ * Each thread allocates from its own pool, so threads don't share a lock.
+ * Operators may be destroyed by any thread, their blocks always return to
+ * the pool they were taken from. Threads which are about to finish should
+ * call releaseThreadPool so that their pool can be reused by other threads.
+ */
+class OperatorPool
+{
+public:
+	/** Size granularity of pools. */
+	static const size_t GRANULARITY = 16;
+	/** Number of pools. Larger objects are allocated from the global heap. */
+	static const size_t POOLS = 16;
+	/** Pool without live blocks reserving more bytes is purged. */
+	static const size_t PURGE_THRESHOLD = 4 * 1024 * 1024;
+
+	/**
+	 * Allocates memory for an operator.
+	 *
+	 * @param size Number of bytes.
+	 * @return Memory block.
+	 * @throw std::bad_alloc if there is no memory left.
+	 */
+	static void* allocate (size_t size);
+
+	/**
+	 * Returns memory allocated by allocate.
+	 *
+	 * @param p Memory block (may be NULL).
+	 * @param size The same size as used for allocate.
+	 */
+	static void deallocate (void* p, size_t size);
+
+	/**
+	 * Returns memory of all pools without live blocks to the system.
+	 */
+	static void purge ();
+
+	/**
+	 * Detaches the calling thread from its pool.
+	 *
+	 * The pool is given to the next thread which needs one. Operators of 
+	 * the pool stay valid. Calling thread gets a pool again when it 
+	 * allocates next time.
+	 */
+	static void releaseThreadPool ();
+
+	/**
+	 * Get number of blocks allocated from pools and not deallocated yet.
+	 *
+	 * @return Number of live blocks.
+	 */
+	static size_t getLiveBlocks ();
+
+	/**
+	 * Get number of bytes reserved by pools from the system.
+	 *
+	 * This is 0 after purge if getLiveBlocks is 0.
+	 *
+	 * @return Number of reserved bytes.
+	 */
+	static size_t getReservedBytes ();
+};
+
+/**
+ * Standard allocator using OperatorPool.
+ *
+ * Used for shared pointer control blocks of pdf operators, so that they are
+ * counted and released together with operators. Use createPooledOperator 
+ * rather than this allocator directly.
+ */
+template<typename T>
+class PooledAllocator
+{
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef T& reference;
+	typedef const T& const_reference;
+	typedef size_t size_type;
+	typedef ptrdiff_t difference_type;
+
+	template<typename U> struct rebind 
+		{ typedef PooledAllocator<U> other; };
+
+	PooledAllocator () {}
+	template<typename U> PooledAllocator (const PooledAllocator<U>&) {}
+
+	pointer address (reference r) const 
+		{ return &r; }
+	const_pointer address (const_reference r) const 
+		{ return &r; }
+	pointer allocate (size_type n, const void* = NULL) 
+		{ return static_cast<pointer> (OperatorPool::allocate (n * sizeof (T))); }
+	void deallocate (pointer p, size_type n) 
+		{ OperatorPool::deallocate (p, n * sizeof (T)); }
+	size_type max_size () const 
+		{ return static_cast<size_type> (-1) / sizeof (T); }
+	void construct (pointer p, const T& val) 
+		{ new (p) T (val); }
+	void destroy (pointer p) 
+		{ p->~T (); }
+};
+
+/** All pooled allocators are equal. */
+template<typename T, typename U>
+inline bool operator== (const PooledAllocator<T>&, const PooledAllocator<U>&)
+	{ return true; }
+
+/** All pooled allocators are equal. */
+template<typename T, typename U>
+inline bool operator!= (const PooledAllocator<T>&, const PooledAllocator<U>&)
+	{ return false; }
+
+/**
+ * Creates a shared pointer of a pooled operator.
+ *
+ * Operator itself comes from the OperatorPool (see PdfOperator::operator new)
+ * and the shared pointer control block is allocated from a pool too.
+ *
+ * @param op New operator.
+ * @return Shared pointer owning the operator.
+ */
+template<typename T>
+inline boost::shared_ptr<T>
+createPooledOperator (T* op)
+{
+	return boost::shared_ptr<T> (op, boost::checked_deleter<T> (), PooledAllocator<char> ());
+}
+
+//=====================================================================================
+} // namespace pdfobjects
+//=====================================================================================
+
+#endif // _OPERATORPOOL_H_
@@ -0,0 +1,310 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+
+#include "kernel/static.h"
+#include "kernel/parallelpages.h"
+#include "kernel/cpdf.h"
+#include "kernel/cpage.h"
+#include "kernel/operatorpool.h"
+#include "kernel/nametable.h"
+#ifdef WIN32
+#	include <windows.h>
+#else
+#	include <unistd.h>
+#endif
+
+namespace pdfobjects {
+
+namespace {
+
+/** Sink which collects all results. */
+class ResultCollector: public PageSink
+{
+	ParallelPages::Results & results;
+public:
+	ResultCollector(ParallelPages::Results & _results):results(_results){}
+
+	virtual void consume(size_t, const std::string & result)
+	{
+		results.push_back(result);
+	}
+};
+
+/** Stops all workers of the run and waits for them.
+ * @param run Run of the workers.
+ * @param workers Worker threads.
+ */
+template<typename Run>
+void stopWorkers(Run & run, std::vector<os::Thread> & workers)
+{
+	{
+		os::ScopedLock lock(run.lock);
+		run.stopping=true;
+		run.pageConsumed.broadcast();
+	}
+
+	for(std::vector<os::Thread>::iterator i=workers.begin(); i!=workers.end(); ++i)
+		os::joinThread(*i);
+	workers.clear();
+}
+
+/** Releases operator pool and name cache of the calling thread when 
+ * destroyed.
+ */
+struct ThreadRelease
+{
+	~ThreadRelease()
+	{
+		OperatorPool::releaseThreadPool();
+		NameTable::instance().releaseThreadCache();
+	}
+};
+
+/** Returns number of online processors (at least 1). */
+size_t onlineProcessors()
+{
+#ifdef WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	long cpus=info.dwNumberOfProcessors;
+#else
+	long cpus=sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	return (cpus>0)?static_cast<size_t>(cpus):1;
+}
+
+} // namespace
+
+ParallelPages::Run::Run(ParallelPages * _owner, PageProcessor & _processor, const Pages & _pages, size_t _window)
+	:owner(_owner), processor(&_processor), pages(&_pages), slots(_pages.size()), 
+	 next(0), consumed(0), window(_window), stopping(false), failed(false), failedPos(0)
+{
+}
+
+void ParallelPages::Run::fail(size_t pos, const std::string & msg)
+{
+	// only the first failure is reported
+	if(!failed)
+	{
+		failed=true;
+		failedPos=pos;
+		failure=msg;
+	}
+	stopping=true;
+	pageDone.broadcast();
+	pageConsumed.broadcast();
+}
+
+ParallelPages::ParallelPages(const std::string & _fileName, size_t _threads)
+	:fileName(_fileName), threads(_threads)
+{
+	if(!threads)
+		threads=onlineProcessors();
+	utilsPrintDbg(debug::DBG_DBG, "file="<<fileName<<" threads="<<threads);
+}
+
+boost::shared_ptr<CPdf> ParallelPages::getDocument()const
+{
+	if(!document)
+		document=CPdf::getInstance(fileName.c_str(), CPdf::ReadOnly);
+	return document;
+}
+
+size_t ParallelPages::getPageCount()const
+{
+	return getDocument()->getPageCount();
+}
+
+void * ParallelPages::worker(void * data)
+{
+	Run * run=static_cast<Run *>(data);
+	// declared first to be released after all operators of the worker
+	// are gone, the pool is then reused by workers of next runs
+	ThreadRelease threadRelease;
+
+	// each worker has its own document instance (with its own xref and 
+	// caches), so nothing below touches objects of other workers
+	boost::shared_ptr<CPdf> pdf;
+	{
+		// the first worker takes the document of the owner
+		os::ScopedLock lock(run->lock);
+		pdf.swap(run->document);
+	}
+	try
+	{
+		if(!pdf)
+			pdf=CPdf::getInstance(run->owner->fileName.c_str(), CPdf::ReadOnly);
+	}catch(std::exception & e)
+	{
+		os::ScopedLock lock(run->lock);
+		run->fail(0, e.what());
+		return NULL;
+	}
+
+	run->lock.lock();
+	for(;;)
+	{
+		// don't run too much ahead of the sink
+		while(!run->stopping && run->next<run->slots.size() && run->next>=run->consumed+run->window)
+			run->pageConsumed.wait(run->lock);
+		if(run->stopping || run->next>=run->slots.size())
+			break;
+		size_t index=run->next++;
+		size_t pos=(*run->pages)[index];
+		run->lock.unlock();
+
+		std::string result, error;
+		bool ok=true;
+		try
+		{
+			boost::shared_ptr<CPage> page=pdf->getPage(pos);
+			run->processor->process(page, pos, result);
+		}catch(std::exception & e)
+		{
+			ok=false;
+			error=e.what();
+		}catch(...)
+		{
+			ok=false;
+			error="unknown exception";
+		}
+
+		run->lock.lock();
+		if(!ok)
+		{
+			utilsPrintDbg(debug::DBG_ERR, "Page at pos="<<pos<<" failed: "<<error);
+			run->fail(pos, error);
+			break;
+		}
+		run->slots[index].result.swap(result);
+		run->slots[index].done=true;
+		run->pageDone.broadcast();
+	}
+	run->lock.unlock();
+	return NULL;
+}
+
+void ParallelPages::processSerial(PageProcessor & processor, const Pages & pages, PageSink & sink)
+{
+	boost::shared_ptr<CPdf> pdf;
+	try
+	{
+		pdf=getDocument();
+	}catch(std::exception & e)
+	{
+		throw PageProcessingException(0, e.what());
+	}
+
+	for(Pages::const_iterator i=pages.begin(); i!=pages.end(); ++i)
+	{
+		std::string result;
+		try
+		{
+			boost::shared_ptr<CPage> page=pdf->getPage(*i);
+			processor.process(page, *i, result);
+		}catch(std::exception & e)
+		{
+			throw PageProcessingException(*i, e.what());
+		}
+		sink.consume(*i, result);
+	}
+}
+
+void ParallelPages::process(PageProcessor & processor, const Pages & pages, PageSink & sink)
+{
+	if(pages.empty())
+		return;
+
+	size_t count=std::min(threads, pages.size());
+	Run run(this, processor, pages, WINDOW_PER_WORKER*count);
+	// owner doesn't touch the document while workers run
+	run.document=document;
+	std::vector<os::Thread> workers;
+	for(size_t i=0; i<count && os::threadsAvailable(); ++i)
+	{
+		os::Thread thread;
+		if(!os::startThread(thread, worker, &run))
+		{
+			utilsPrintDbg(debug::DBG_ERR, "Unable to create worker thread. Continuing with "
+					<<workers.size()<<" workers.");
+			break;
+		}
+		workers.push_back(thread);
+	}
+	if(workers.empty())
+	{
+		processSerial(processor, pages, sink);
+		return;
+	}
+
+	try
+	{
+		for(size_t i=0; i<run.slots.size(); ++i)
+		{
+			std::string result;
+			{
+				os::ScopedLock lock(run.lock);
+				// results finished before a failure are still consumed
+				while(!run.slots[i].done && !run.failed)
+					run.pageDone.wait(run.lock);
+				if(!run.slots[i].done)
+					break;
+				result.swap(run.slots[i].result);
+				run.consumed=i+1;
+				run.pageConsumed.broadcast();
+			}
+
+			sink.consume(pages[i], result);
+		}
+	}catch(...)
+	{
+		// sink failed
+		stopWorkers(run, workers);
+		throw;
+	}
+	stopWorkers(run, workers);
+
+	if(run.failed)
+		throw PageProcessingException(run.failedPos, run.failure);
+}
+
+void ParallelPages::process(PageProcessor & processor, const Pages & pages, Results & results)
+{
+	results.clear();
+	results.reserve(pages.size());
+	ResultCollector collector(results);
+	process(processor, pages, collector);
+}
+
+void ParallelPages::process(PageProcessor & processor, Results & results)
+{
+	Pages pages;
+	size_t count=getPageCount();
+	for(size_t i=1; i<=count; ++i)
+		pages.push_back(i);
+	process(processor, pages, results);
+}
+
+} // namespace pdfobjects
@@ -0,0 +1,246 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+#ifndef _PARALLELPAGES_H_
+#define _PARALLELPAGES_H_
+
+#include "kernel/static.h"
+#include "os/threads.h"
+
+namespace pdfobjects {
+
+class CPage;
+class CPdf;
+
+/** Interface for page processing done by ParallelPages.
+ *
+ * process method is called concurrently from worker threads, so
+ * implementation has to be reentrant. Each page comes from a document
+ * instance owned by the calling worker, so nothing from the page may be
+ * kept after process returns.
+ * <br>
+ * Global parameters (e.g. text encoding) are shared by all workers, so
+ * they have to be set before processing starts and must not be changed
+ * by process (e.g. don't pass encoding to CPage::getText).
+ */
+class PageProcessor
+{
+public:
+	virtual ~PageProcessor(){}
+
+	/** Processes one page.
+	 * @param page Page to process.
+	 * @param pos Position of the page.
+	 * @param result Result of the processing (e.g. page text).
+	 */
+	virtual void process(boost::shared_ptr<CPage> page, size_t pos, std::string & result)=0;
+};
+
+/** Interface for consumer of ParallelPages results.
+ *
+ * consume method is always called by the thread which called
+ * ParallelPages::process and results come in the order of requested pages.
+ */
+class PageSink
+{
+public:
+	virtual ~PageSink(){}
+
+	/** Consumes result of one page.
+	 * @param pos Position of the page.
+	 * @param result Result produced by PageProcessor.
+	 */
+	virtual void consume(size_t pos, const std::string & result)=0;
+};
+
+/** Processes pages of a document by a pool of worker threads.
+ *
+ * CPdf and its objects (including observers) are not thread safe, so
+ * workers can't share one instance. Instead each worker opens its own 
+ * read-only CPdf over the same file (with its own xref and object cache)
+ * and processes pages it takes from the shared queue. The first worker 
+ * takes the document already opened by this instance (e.g. for 
+ * getPageCount), so the file is not opened more times than needed. 
+ * Methods of one instance must not be called concurrently. Results are given
+ * to the PageSink in the page order as soon as all previous pages are done,
+ * so text of a big document can be written out while it is still being
+ * extracted.
+ * <br>
+ * Workers may run only a limited number of pages ahead of the sink, so 
+ * memory used for results stays bounded even if some page is slow.
+ * <br>
+ * Typical usage:
+ * <pre>
+ * ParallelPages parallel(fileName);
+ * ParallelPages::Results texts;
+ * parallel.process(textProcessor, texts);
+ * </pre>
+ */
+class ParallelPages
+{
+public:
+	/** Type for page positions. */
+	typedef std::vector<size_t> Pages;
+	/** Type for results of all pages. */
+	typedef std::vector<std::string> Results;
+
+	/** Number of pages a worker may be ahead of the sink per worker. */
+	static const size_t WINDOW_PER_WORKER=4;
+
+private:
+	/** Document file name. */
+	std::string fileName;
+
+	/** Document opened by the calling thread.
+	 * Shared by getPageCount, serial processing and the first worker of
+	 * a run.
+	 */
+	mutable boost::shared_ptr<CPdf> document;
+
+	/** Number of worker threads. */
+	size_t threads;
+
+	/** Result of one page. */
+	struct Slot
+	{
+		/** Result produced by the processor. */
+		std::string result;
+		/** Flag set when worker is done with the page. */
+		bool done;
+
+		Slot():done(false){}
+	};
+
+	/** State of one process call shared by workers. */
+	struct Run
+	{
+		/** Owner of the run. */
+		ParallelPages * owner;
+		/** Processor used by workers. */
+		PageProcessor * processor;
+		/** Requested pages. */
+		const Pages * pages;
+		/** Results indexed like pages. */
+		std::vector<Slot> slots;
+		/** Index of the next page to be taken by a worker. */
+		size_t next;
+		/** Number of results already given to the sink. */
+		size_t consumed;
+		/** Maximal difference between next and consumed. */
+		size_t window;
+		/** Flag for workers to finish. */
+		bool stopping;
+		/** Flag set when any page failed. */
+		bool failed;
+		/** Position of the failed page. */
+		size_t failedPos;
+		/** Message of the failure. */
+		std::string failure;
+		/** Document of the owner for the first worker which takes it. */
+		boost::shared_ptr<CPdf> document;
+
+		/** Lock for all fields above. */
+		os::Mutex lock;
+		/** Signaled when a page is done or the run fails. */
+		os::Condition pageDone;
+		/** Signaled when sink consumes a result or the run stops. */
+		os::Condition pageConsumed;
+
+		Run(ParallelPages * owner, PageProcessor & processor, const Pages & pages, size_t window);
+
+		/** Records failure of the page.
+		 * Has to be called with lock held.
+		 */
+		void fail(size_t pos, const std::string & msg);
+	};
+
+	/** Returns the document, opens it if it is not opened yet.
+	 * @throw PdfOpenException if the document can't be opened.
+	 */
+	boost::shared_ptr<CPdf> getDocument()const;
+
+	/** Worker thread routine.
+	 * @param run Run instance.
+	 */
+	static void * worker(void * run);
+
+	/** Processes pages by the calling thread.
+	 * Used when no worker thread can be started.
+	 */
+	void processSerial(PageProcessor & processor, const Pages & pages, PageSink & sink);
+
+	// not copyable
+	ParallelPages(const ParallelPages &);
+	ParallelPages & operator=(const ParallelPages &);
+public:
+	/** Initialization constructor.
+	 * @param fileName Name of the document file.
+	 * @param threads Number of worker threads (0 for number of online 
+	 * processors). Pages are processed by the calling thread if threads
+	 * are not supported (see os::threadsAvailable).
+	 */
+	ParallelPages(const std::string & fileName, size_t threads=0);
+
+	/** Returns number of worker threads. */
+	size_t getThreads()const
+	{
+		return threads;
+	}
+
+	/** Returns number of pages of the document.
+	 * @throw PdfOpenException if the document can't be opened.
+	 */
+	size_t getPageCount()const;
+
+	/** Processes given pages.
+	 * @param processor Processor called for each page by workers.
+	 * @param pages Positions of pages (may contain duplicates).
+	 * @param sink Sink called with results in the order of pages.
+	 * @throw PageProcessingException if processing of any page fails (no
+	 * more results are given to the sink then). Position 0 is used if a
+	 * worker can't open the document.
+	 *
+	 * Exceptions thrown by the sink are propagated after all workers are
+	 * stopped.
+	 */
+	void process(PageProcessor & processor, const Pages & pages, PageSink & sink);
+
+	/** Processes given pages and collects results.
+	 * @param processor Processor called for each page by workers.
+	 * @param pages Positions of pages.
+	 * @param results Results in the order of pages.
+	 */
+	void process(PageProcessor & processor, const Pages & pages, Results & results);
+
+	/** Processes all pages of the document and collects results.
+	 * @param processor Processor called for each page by workers.
+	 * @param results Results in the page order (result of the first page 
+	 * is at index 0).
+	 */
+	void process(PageProcessor & processor, Results & results);
+};
+
+} // namespace pdfobjects
+
+#endif
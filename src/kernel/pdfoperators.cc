@@ -53,8 +53,10 @@ using namespace utils;
 //
 SimpleGenericOperator::SimpleGenericOperator (const char* opTxt, 
 											  const size_t numOper, 
-											  Operands& opers) : _opText (opTxt)
+											  Operands& opers) : _opAtom (StateUpdater::findOpAtom (opTxt))
 {
+		if (NO_ATOM == _opAtom)
+			_opName = opTxt;
 		//utilsPrintDbg (debug::DBG_DBG, "Operator [" << opTxt << "] Operand size: " << numOper << " got " << opers.size());
 		assert (numOper >= opers.size());
 		if (numOper < opers.size())
@@ -65,33 +67,30 @@ SimpleGenericOperator::SimpleGenericOperator (const char* opTxt,
 	// REMARK: the op count can vary ("scn" operator takes arbitrary number of
 	// parameters)
 	//
-	for (size_t i = 0; (i < numOper) && !opers.empty(); ++i)
-	{
-		Operands::value_type val = opers.back ();
-		// Store the last element of input parameter
-		_operands.push_front (val);
-		// Remove the element from input parameter
-		opers.pop_back ();
-	}
+	size_t count = std::min (numOper, opers.size());
+	_operands.reserve (count);
+	Operands::iterator first = opers.end() - count;
+	for (Operands::iterator it = first; it != opers.end(); ++it)
+		_operands.push_back (*it);
+	opers.erase (first, opers.end());
 }
 
 //
 //
 //
 SimpleGenericOperator::SimpleGenericOperator (const std::string& opTxt, 
-											  Operands& opers): _opText (opTxt)
+											  Operands& opers): _opAtom (StateUpdater::findOpAtom (opTxt))
 {
+		if (NO_ATOM == _opAtom)
+			_opName = opTxt;
 		utilsPrintDbg (debug::DBG_DBG, opTxt);
 	//
 	// Store the operands and remove it from opers
 	//
-	while (!opers.empty())
-	{
-		// Store the last element of input parameter
-		_operands.push_front ( opers.back() );
-		// Remove the element from input parameter
-		opers.pop_back ();
-	}
+	_operands.reserve (opers.size());
+	for (Operands::iterator it = opers.begin(); it != opers.end(); ++it)
+		_operands.push_back (*it);
+	opers.clear ();
 }
 
 //
@@ -102,8 +101,10 @@ SimpleGenericOperator::~SimpleGenericOperator()
 		// can happen when used as a temporary object
 		if (0 < _operands.size() && !(_operandobserver)) 
 			return;
-	for (Operands::iterator it = _operands.begin(); it != _operands.end(); ++it) {
-		UNREGISTER_SHAREDPTR_OBSERVER ((*it), _operandobserver);
+	// Only promoted operands have observer registered
+	for (size_t i = 0; i < _operands.size(); ++i) {
+		if (!_operands.isCompact (i))
+			UNREGISTER_SHAREDPTR_OBSERVER (_operands.getProperty (i), _operandobserver);
 	}
 }
 
@@ -115,15 +116,15 @@ void
 SimpleGenericOperator::getStringRepresentation (std::string& str) const
 {
 	std::string tmp;
-	for (Operands::const_iterator it = _operands.begin(); it != _operands.end (); ++it)
+	for (size_t i = 0; i < _operands.size(); ++i)
 	{
 		tmp.clear ();
-		(*it)->getStringRepresentation (tmp);
+		_operands.getStringRepresentation (i, tmp);
 		str += tmp + " ";
 	}
 
 	// Add operator string
-	str += _opText;
+	str += opText ();
 }
 	
 
@@ -133,14 +134,14 @@ SimpleGenericOperator::getStringRepresentation (std::string& str) const
 boost::shared_ptr<PdfOperator> 
 SimpleGenericOperator::clone ()
 {
-	// Clone operands
+	// Clone operands, plain values are simply copied
 	Operands ops;
-	for (Operands::iterator it = _operands.begin (); it != _operands.end(); ++it)
-		ops.push_back ((*it)->clone());
+	for (size_t i = 0; i < _operands.size(); ++i)
+		ops.push_back (_operands.isCompact (i) ? _operands.getProperty (i) : _operands.getProperty (i)->clone());
 	assert (ops.size () == _operands.size());
 
 	// Create clone
-	return createOperator (_opText,ops);
+	return createOperator (opText (),ops);
 }
 
 
@@ -149,29 +150,59 @@ SimpleGenericOperator::init_operands (boost::shared_ptr<observer::IObserver<IPro
 									  boost::weak_ptr<CPdf> pdf, 
 									  IndiRef* rf)
 { 
-	// store observer
+	// store observer, pdf and ref also for operands promoted later
 	_operandobserver = observer; 
+	_operandpdf = pdf;
+	_operandref = *rf;
 	//
-	for (Operands::iterator oper = _operands.begin (); oper != _operands.end (); ++oper)
+	for (size_t i = 0; i < _operands.size(); ++i)
 	{
-		if (hasValidPdf(*oper))
+		if (_operands.isCompact (i))
+			continue;
+		
+		boost::shared_ptr<IProperty> oper = _operands.getProperty (i);
+		if (hasValidPdf(oper))
 		{ // We do not support adding operators from another stream
-			if ( ((*oper)->getPdf().lock() != pdf.lock()) || !((*oper)->getIndiRef() == *rf) )
+			if ( (oper->getPdf().lock() != pdf.lock()) || !(oper->getIndiRef() == *rf) )
 			{
-				kernelPrintDbg (debug::DBG_ERR, "Pdf or indiref do not match: want " << *rf <<  " op has" <<(*oper)->getIndiRef());
+				kernelPrintDbg (debug::DBG_ERR, "Pdf or indiref do not match: want " << *rf <<  " op has" <<oper->getIndiRef());
 				throw CObjInvalidObject ();
 			}
 			
 		}else
-		{
-			(*oper)->setPdf (pdf);
-			(*oper)->setIndiRef (*rf);
-			REGISTER_SHAREDPTR_OBSERVER((*oper), observer);
-			(*oper)->lockChange ();
-		}
+			initOperand (oper);
 	} // for
 }
 
+//
+//
+//
+void
+SimpleGenericOperator::initOperand (boost::shared_ptr<IProperty> oper)
+{
+	if (!_operandobserver)
+		return;
+	oper->setPdf (_operandpdf);
+	oper->setIndiRef (_operandref);
+	REGISTER_SHAREDPTR_OBSERVER(oper, _operandobserver);
+	oper->lockChange ();
+}
+
+//
+//
+//
+void
+SimpleGenericOperator::getParameters (Operands& container)
+{
+	for (size_t i = 0; i < _operands.size(); ++i)
+	{
+		// Caller gets handles which can be changed, so create objects
+		if (_operands.isCompact (i))
+			initOperand (_operands.promote (i));
+		container.push_back (_operands.getProperty (i));
+	}
+}
+
 CharCode mapFromUnicode(const Unicode *u, int size)
 {
   CharCode mapLen = 256;
@@ -223,39 +254,37 @@ using namespace utils;
 	utilsPrintDbg(debug::DBG_DBG, "");
 	std::string name, rawStr;
 	getOperatorName(name);
-	Operands ops;
-	getParameters(ops);
+	// Only reading, don't create operand objects
+	const CompactOperands& ops = getCompactParameters();
 	if(name == "'" || name == "Tj")
 	{
-		if(ops.size() != 1 || !isString(ops[0]))
+		if(ops.size() != 1 || pString != ops.getType(0))
 		{
 			utilsPrintDbg(debug::DBG_WARN, "Bad operands for operator "
-					<<name<<" count="<<ops.size()
-					<<" ops[0] type="<< ops[0]->getType());
+					<<name<<" count="<<ops.size());
 			return;
 		}
-		rawStr = getStringFromIProperty(ops[0]);
+		rawStr = getStringFromIProperty(ops.getProperty(0));
 	}
 	else if (name == "\"")
 	{
-		if(ops.size() != 3 || !isArray(ops[2]))
+		if(ops.size() != 3 || pArray != ops.getType(2))
 		{
 			utilsPrintDbg(debug::DBG_WARN, "Bad operands for operator "
-					<<name<<" count="<<ops.size()
-					<<" ops[2] type="<< ops[2]->getType());
+					<<name<<" count="<<ops.size());
 			return;
 		}
-		rawStr = getStringFromIProperty(ops[2]);
+		rawStr = getStringFromIProperty(ops.getProperty(2));
 	}
 	else if (name == "TJ")
 	{
-		boost::shared_ptr<IProperty> op = ops[0];
-		if (!isArray(op) || ops.size() != 1)
+		if (ops.size() != 1 || pArray != ops.getType(0))
 		{
-			utilsPrintDbg(debug::DBG_WARN, "Bad operands for TJ operator: ops[type="
-					<< op->getType() <<" size="<<ops.size()<<"]");
+			utilsPrintDbg(debug::DBG_WARN, "Bad operands for TJ operator: ops[size="
+					<<ops.size()<<"]");
 			return;
 		}
+		boost::shared_ptr<IProperty> op = ops.getProperty(0);
 		boost::shared_ptr<CArray> opArray = IProperty::getSmartCObjectPtr<CArray>(op);
 		std::vector<boost::shared_ptr<IProperty> > props;
 		opArray->_getAllChildObjects(props);
@@ -469,7 +498,7 @@ UnknownCompositePdfOperator::getStringRepresentation (string& str) const
 boost::shared_ptr<PdfOperator> 
 UnknownCompositePdfOperator::clone ()
 {
-	boost::shared_ptr<UnknownCompositePdfOperator> clone (new UnknownCompositePdfOperator(_opBegin,_opEnd));
+	boost::shared_ptr<UnknownCompositePdfOperator> clone = createPooledOperator (new UnknownCompositePdfOperator(_opBegin,_opEnd));
 
 	for (PdfOperators::iterator it = _children.begin(); it != _children.end(); ++it)
 		clone->push_back ((*it)->clone(),getLastOperator(clone));
@@ -502,6 +531,9 @@ InlineImageCompositePdfOperator::InlineImageCompositePdfOperator
 		: CompositePdfOperator (), _opBegin (opBegin), _opEnd (opEnd), _inlineimage (im)
 {
 	utilsPrintDbg (DBG_DBG, _opBegin << " " << _opEnd);
+	// Inline image is not a simple object, so it is stored as object
+	boost::shared_ptr<IProperty> ip = _inlineimage;
+	_operands.push_back (ip);
 }
 
 //
@@ -544,7 +576,7 @@ InlineImageCompositePdfOperator::getStringRepresentation (string& str) const
 //
 //
 void
-InlineImageCompositePdfOperator::getParameters (Operands& opers) const
+InlineImageCompositePdfOperator::getParameters (Operands& opers)
 {
 	boost::shared_ptr<IProperty> ip = _inlineimage;
 	opers.push_back (ip);
@@ -560,7 +592,7 @@ InlineImageCompositePdfOperator::clone ()
 	boost::shared_ptr<CInlineImage> imgclone = IProperty::getSmartCObjectPtr<CInlineImage> (_inlineimage->clone());
 	assert(imgclone->width() == _inlineimage->width());
 	// Create clone
-	return boost::shared_ptr<PdfOperator> (new InlineImageCompositePdfOperator (imgclone, _opBegin, _opEnd));
+	return createPooledOperator<PdfOperator> (new InlineImageCompositePdfOperator (imgclone, _opBegin, _opEnd));
 }
 
 
@@ -577,7 +609,7 @@ boost::shared_ptr<PdfOperator> createOperator(const std::string& name, PdfOperat
 	const StateUpdater::CheckTypes* chcktp = StateUpdater::findOp (name.c_str());
 	// Operator not found, create unknown operator
 	if (NULL == chcktp)
-		return boost::shared_ptr<PdfOperator> (new SimpleGenericOperator (name ,operands));
+		return createPooledOperator<PdfOperator> (new SimpleGenericOperator (name ,operands));
 	
 	assert (chcktp);
 	utilsPrintDbg (DBG_DBG, "Operator found. " << chcktp->name);
@@ -596,13 +628,13 @@ boost::shared_ptr<PdfOperator> createOperator(const std::string& name, PdfOperat
 	// If endTag is "" it is a simple operator, composite otherwise
 	// 
 	if (isTextOp(*chcktp))
-		return boost::shared_ptr<PdfOperator> (new TextSimpleOperator(chcktp->name, argNum, operands));
+		return createPooledOperator<PdfOperator> (new TextSimpleOperator(chcktp->name, argNum, operands));
 
 	if (isSimpleOp(*chcktp))
-		return boost::shared_ptr<PdfOperator> (new SimpleGenericOperator (chcktp->name, argNum, operands));
+		return createPooledOperator<PdfOperator> (new SimpleGenericOperator (chcktp->name, argNum, operands));
 		
 	// Composite operator
-	return boost::shared_ptr<PdfOperator> (new UnknownCompositePdfOperator (chcktp->name, chcktp->endTag));
+	return createPooledOperator<PdfOperator> (new UnknownCompositePdfOperator (chcktp->name, chcktp->endTag));
 
 }
 
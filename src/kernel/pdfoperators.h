@@ -51,12 +51,37 @@ namespace pdfobjects {
 class SimpleGenericOperator : public PdfOperator
 {
 private:
-	/** Operands. */
-	Operands _operands;
-	/** Text representing the operator. */
-	const std::string _opText;
+	/** 
+	 * Operands. 
+	 * Operand objects are created lazily when getParameters is called.
+	 */
+	CompactOperands _operands;
+	/** Atom of the text representing the operator. 
+	 * NO_ATOM for unknown operators which are not interned (see
+	 * StateUpdater::findOpAtom).
+	 */
+	const NameAtom _opAtom;
+	/** Text representing an unknown operator (empty if _opAtom is set). */
+	std::string _opName;
 	/** Operand observers registered on its operands. */
 	boost::shared_ptr<observer::IObserver<IProperty> > _operandobserver;
+	/** Pdf of operands (set together with operand observer). */
+	boost::weak_ptr<CPdf> _operandpdf;
+	/** Indirect reference of operands (set together with operand observer). */
+	IndiRef _operandref;
+
+	/**
+	 * Initialize promoted operand.
+	 * Sets pdf and indirect reference and registers operand observer as
+	 * init_operands does.
+	 *
+	 * @param oper Operand object.
+	 */
+	void initOperand (boost::shared_ptr<IProperty> oper);
+
+	/** Returns text representing the operator. */
+	const std::string& opText () const
+		{ return (NO_ATOM == _opAtom) ? _opName : atomName (_opAtom); }
 	
 public:
 
@@ -81,11 +106,16 @@ public:
 	virtual size_t getParametersCount () const
 		{ return _operands.size (); }
 
-	virtual void getParameters (Operands& container) const
-		{ copy (_operands.begin(), _operands.end(), back_inserter(container)); }
+	virtual void getParameters (Operands& container);
+
+	virtual const CompactOperands& getCompactParameters () const
+		{ return _operands; }
 
 	virtual void getOperatorName (std::string& first) const
-		{ first = _opText;}
+		{ first = opText ();}
+
+	virtual NameAtom getOperatorAtom () const
+		{ return _opAtom; }
 	
 	virtual void getStringRepresentation (std::string& str) const;
 
@@ -256,6 +286,8 @@ private:
 	const char* _opEnd;
 	/** Stream representing inline image. */
 	boost::shared_ptr<CInlineImage> _inlineimage;
+	/** Operands (inline image object). */
+	CompactOperands _operands;
 
 public:
 	
@@ -275,7 +307,9 @@ public:
 	//
 public:
 	virtual size_t getParametersCount () const {return 1;}
-	virtual void getParameters (Operands& opers) const;
+	virtual void getParameters (Operands& opers);
+	virtual const CompactOperands& getCompactParameters () const
+		{ return _operands; }
 	virtual void getStringRepresentation (std::string& str) const;
 	virtual void getOperatorName (std::string& first) const {first = _opBegin;}
 
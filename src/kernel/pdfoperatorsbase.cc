@@ -31,6 +31,7 @@
 #include "kernel/iproperty.h"
 
 #include "kernel/ccontentstream.h"
+#include "kernel/stateupdater.h"
 
 //==========================================================
 namespace pdfobjects {
@@ -55,6 +56,18 @@ PdfOperator::getContentStream () const
 		assert (_contentstream == _contentstream->getSmartPointer().get());
 	return _contentstream->getSmartPointer();
 }
+
+//
+//
+//
+NameAtom
+PdfOperator::getOperatorAtom () const
+{
+	std::string name;
+	getOperatorName (name);
+	return StateUpdater::findOpAtom (name);
+}
+
 	
 void 
 PdfOperator::putBehind (boost::shared_ptr<PdfOperator> behindWhich, boost::shared_ptr<PdfOperator> which)
@@ -188,6 +201,17 @@ CompositePdfOperator::getStringRepresentation (std::string& str) const
 	}
 }
 
+//
+//
+//
+const CompactOperands&
+CompositePdfOperator::getCompactParameters () const
+{
+	// Composites have no operands
+	static const CompactOperands noOperands;
+	return noOperands;
+}
+
 void 
 CompositePdfOperator::init_operands (boost::shared_ptr<observer::IObserver<IProperty> > observer, boost::weak_ptr<CPdf> pdf, IndiRef* rf)
 { 
@@ -29,6 +29,9 @@
 // static includes
 #include "kernel/static.h"
 #include "kernel/iproperty.h"
+#include "kernel/nametable.h"
+#include "kernel/compactoperands.h"
+#include "kernel/operatorpool.h"
 #include "utils/iterator.h"
 #include "utils/listitem.h"
 
@@ -122,6 +125,15 @@ public:
 	/** Destructor. */
 	virtual ~PdfOperator ()	{}
 
+	// Allocation
+public:
+	/** Allocates operators from the OperatorPool. */
+	static void* operator new (size_t size)
+		{ return OperatorPool::allocate (size); }
+	/** Returns operators to the OperatorPool. */
+	static void operator delete (void* p, size_t size)
+		{ OperatorPool::deallocate (p, size); }
+
 	
 	//
 	// Pdf operator interface
@@ -138,9 +150,25 @@ public:
 	/**
 	 * Get the parameters used with this operator.
 	 *
+	 * Returned parameters are handles which can be changed, so objects of
+	 * all simple parameters are created (\see CompactOperands). Use 
+	 * getCompactParameters when parameters are only read.
+	 *
 	 * @param container Will be used to store parameters.
 	 */
-	virtual void getParameters (Operands& container) const = 0;
+	virtual void getParameters (Operands& container) = 0;
+
+	/**
+	 * Get the parameters for reading.
+	 *
+	 * Unlike getParameters, objects of simple parameters are not created
+	 * and nothing is copied. Use this when parameters are not going to be
+	 * changed.
+	 *
+	 * @return Parameters of this operator (valid until the operator is
+	 * changed or destroyed).
+	 */
+	virtual const CompactOperands& getCompactParameters () const = 0;
 
 	/**
 	 * Get the string representation of this operator.
@@ -156,6 +184,19 @@ public:
 	 */
 	virtual void getOperatorName (std::string& first) const = 0;
 
+	/**
+	 * Get the interned operator name.
+	 *
+	 * Operators can be compared and dispatched by their atoms without
+	 * copying names. Only known operators have atoms (see 
+	 * StateUpdater::findOpAtom). Default implementation looks up name 
+	 * returned by getOperatorName.
+	 *
+	 * @return Atom of the operator name (see NameTable) or NO_ATOM for 
+	 * unknown operators.
+	 */
+	virtual NameAtom getOperatorAtom () const;
+
 	
 	//
 	// Composite interface
@@ -383,7 +424,8 @@ protected:
 	//
 public:
 	virtual size_t getParametersCount () const {return 0;}
-	virtual void getParameters (Operands&) const {}
+	virtual void getParameters (Operands&) {}
+	virtual const CompactOperands& getCompactParameters () const;
 	virtual void getStringRepresentation (std::string& str) const;
 	virtual void getOperatorName (std::string& first) const = 0;
 	virtual void init_operands (boost::shared_ptr<observer::IObserver<IProperty> > observer, boost::weak_ptr<CPdf> pdf, IndiRef* rf);
@@ -405,6 +447,9 @@ protected:
 // Specific operator
 //
 inline bool
+isPdfOp (const PdfOperator& op, NameAtom opn)
+	{ return opn == op.getOperatorAtom (); }
+inline bool
 isPdfOp (const PdfOperator& op, const std::string& opn)
 {
 	std::string tmp;
@@ -28,9 +28,12 @@
 #include "kernel/cobject.h"
 #include "kernel/streamwriter.h"
 #include "kernel/factories.h"
+#include "kernel/pdfspecification.h"
+#include "kernel/deflatepool.h"
 #include <poppler/Hints.h>
 #include <poppler/Stream.h>
 #include <zlib.h>
+#include <sstream>
 
 /** Size of buffer for xref table row.
  * This includes also 1 byte for trailing '\0' (end of string marker).
@@ -40,6 +43,17 @@
 // size of the additional space for a xref entry for unexpected entries
 #define XREFFILLING 15
 
+/** Size of the chunk used for streamed stream data compression.
+ * This is used for both decoded input and deflated output buffers.
+ */
+#define DEFLATE_CHUNK_SIZE (64*1024)
+
+/** Placeholder for Length value of streamed stream data.
+ * It has to have the same number of digits as the widest possible value.
+ */
+#define LENGTH_PLACEHOLDER 2147483647
+#define LENGTH_PLACEHOLDER_WIDTH 10
+
 const char * PDFHEADER="%PDF-";
 
 const char * TRAILER_KEYWORD="trailer";
@@ -228,7 +242,7 @@ bool ZlibFilterStreamWriter::supportObject(Object& obj)const
 	return false;
 }
 
-unsigned char* ZlibFilterStreamWriter::deflate_buffer(unsigned char * in, size_t in_size, size_t& size)
+unsigned char* ZlibFilterStreamWriter::deflate_buffer(unsigned char * in, size_t in_size, size_t& size, int level)
 {
 	z_stream z;
 	z.zalloc = NULL; 
@@ -250,7 +264,7 @@ unsigned char* ZlibFilterStreamWriter::deflate_buffer(unsigned char * in, size_t
 	}
 	z.next_out = out_buff; 
 	z.avail_out = out_size;
-	if ((ret = deflateInit(&z, Z_DEFAULT_COMPRESSION)) != Z_OK)
+	if ((ret = deflateInit(&z, level)) != Z_OK)
 	{
 		utilsPrintDbg(debug::DBG_ERR, "deflateInit failed with ret="<<ret);
 		goto out_free_error;
@@ -328,18 +342,126 @@ out:
 	return deflateBuff;
 }
 
-void ZlibFilterStreamWriter::compress(Object& obj, Ref* ref, StreamWriter& outStream)const
+size_t ZlibFilterStreamWriter::deflate_stream(Object& obj, Ref* ref, StreamWriter& outStream, int level)
 {
-	CharBuffer charBuffer;
+using namespace debug;
+
 	assert(obj.isStream());
-	size_t size=streamToCharBuffer(obj, ref, charBuffer, deflate);
-	if(!size)
+
+	// original filters are not used for output data anymore
+	::Dict * streamDict=obj.streamGetDict();
+	const char * fieldsToRemove[] = {"Filter", "DecodeParms", "F", "FFilter", "FDecodeParms", "DL", NULL};
+	for(int i=0; fieldsToRemove[i]; ++i)
+		streamDict->remove(fieldsToRemove[i]);
+	update_dict(obj);
+
+	// final size is not known yet so the dictionary is written with 
+	// placeholder value which has maximum width
+	Object lengthObj;
+	lengthObj.initInt(LENGTH_PLACEHOLDER);
+	streamDict->set("Length", &lengthObj);
+	boost::shared_ptr< ::Object> streamDictObj(XPdfObjectFactory::getInstance(), xpdf::object_deleter());
+	streamDictObj->initDict(streamDict);
+	std::string dictStr;
+	xpdfObjToString(*streamDictObj, dictStr);
+	std::ostringstream placeholder;
+	placeholder << "Length" << Specification::CDICT_BETWEEN_NAMES << LENGTH_PLACEHOLDER;
+	size_t lengthOff=dictStr.find(placeholder.str());
+	assert(lengthOff!=std::string::npos);
+	lengthOff+=placeholder.str().length()-LENGTH_PLACEHOLDER_WIDTH;
+
+	std::string header;
+	if(ref)
 	{
-		utilsPrintDbg(debug::DBG_WARN, "zero size stream returned. Probably error in the the object");
-		return;
+		std::ostringstream indirectHeader;
+		indirectHeader << *ref << " " << Specification::INDIRECT_HEADER << "\n";
+		header=indirectHeader.str();
 	}
-	outStream.putLine(charBuffer.get(), size);
-	return;
+	// initializes zlib before anything is written so that we don't
+	// leave incomplete object in the output on failure
+	z_stream z;
+	z.zalloc = NULL; 
+	z.zfree = NULL;
+	z.opaque = NULL;
+	z.avail_in = 0;
+	int ret;
+	if ((ret = deflateInit(&z, level)) != Z_OK)
+	{
+		utilsPrintDbg(DBG_ERR, "deflateInit failed with ret="<<ret);
+		return 0;
+	}
+
+	size_t lengthPos=outStream.getPos()+header.length()+lengthOff;
+	header+=dictStr+Specification::CSTREAM_HEADER;
+	outStream.putBuffer(header.c_str(), header.length());
+
+	// pulls decoded data chunk by chunk and pushes each deflated
+	// window directly to the output stream
+	unsigned char in[DEFLATE_CHUNK_SIZE];
+	unsigned char out[DEFLATE_CHUNK_SIZE];
+	size_t total=0;
+	int flush=Z_NO_FLUSH;
+	obj.streamReset();
+	do
+	{
+		size_t inSize=0;
+		int c;
+		while(inSize<sizeof(in) && EOF!=(c=obj.streamGetChar()))
+			in[inSize++]=(unsigned char)c;
+		if(inSize<sizeof(in))
+			flush=Z_FINISH;
+		z.next_in=in;
+		z.avail_in=inSize;
+		do
+		{
+			z.next_out=out;
+			z.avail_out=sizeof(out);
+			ret=::deflate(&z, flush);
+			assert(ret!=Z_STREAM_ERROR);
+			size_t produced=sizeof(out)-z.avail_out;
+			outStream.putBuffer((const char *)out, produced);
+			total+=produced;
+		}while(z.avail_out==0);
+		assert(z.avail_in==0);
+	}while(flush!=Z_FINISH);
+	assert(ret==Z_STREAM_END);
+	deflateEnd(&z);
+	obj.streamClose();
+
+	std::string footer=Specification::CSTREAM_FOOTER;
+	if(ref)
+		footer+=Specification::INDIRECT_FOOTER;
+	outStream.putLine(footer.c_str(), footer.length());
+
+	// patches Length placeholder with the real value (padded by spaces
+	// which are valid white characters in dictionary) and keeps object
+	// consistent with the written data
+	size_t endPos=outStream.getPos();
+	if(total>(size_t)LENGTH_PLACEHOLDER)
+		utilsPrintDbg(DBG_ERR, "Compressed size="<<total<<" doesn't fit to Length placeholder");
+	std::ostringstream lengthStr;
+	lengthStr << std::setw(LENGTH_PLACEHOLDER_WIDTH) << total;
+	outStream.setPos(lengthPos);
+	outStream.putBuffer(lengthStr.str().c_str(), LENGTH_PLACEHOLDER_WIDTH);
+	outStream.setPos(endPos);
+	lengthObj.initInt(total);
+	streamDict->set("Length", &lengthObj);
+
+	utilsPrintDbg(DBG_DBG, "Stream deflated on the fly. Compressed size="<<total);
+	return total;
+}
+
+void ZlibFilterStreamWriter::compress(Object& obj, Ref* ref, StreamWriter& outStream)const
+{
+	assert(obj.isStream());
+	deflate_stream(obj, ref, outStream);
+}
+
+void ZlibFilterStreamWriter::compress(Object& obj, Ref* ref, StreamWriter& outStream, 
+		const CompressionPolicy& policy)const
+{
+	assert(obj.isStream());
+	deflate_stream(obj, ref, outStream, policy.level);
 }
 
 // initialization of static data for FilterStreamWriter classes
@@ -409,11 +531,51 @@ boost::shared_ptr<FilterStreamWriter> FilterStreamWriter::getInstance(Object& ob
 		
 }
 
+/** Helper function to check whether stream data come directly from the file.
+ * @param obj Stream object.
+ *
+ * Streams created or changed by kernel (CStream) are backed by memory 
+ * streams, so file based stream data are untouched since document opening.
+ * @return true if stream data are unchanged.
+ */
+bool isUnchangedStream(Object& obj)
+{
+	return obj.getStream()->getBaseStream()->getKind()==strFile;
+}
+
+/** Helper function to get encoded stream data length.
+ * @param obj Stream object.
+ * @return Length entry value or 0 if not available.
+ */
+size_t encodedStreamLength(Object& obj)
+{
+	Object lenObj;
+	obj.streamGetDict()->lookup("Length", &lenObj);
+	size_t len=(lenObj.isInt() && lenObj.getInt()>0)?lenObj.getInt():0;
+	lenObj.free();
+	return len;
+}
+
+boost::shared_ptr<FilterStreamWriter> FilterStreamWriter::getInstance(Object& objStream, 
+		const CompressionPolicy& policy)
+{
+	if(!objStream.isStream())
+		throw ElementBadTypeException("");
+	if(!policy.level)
+		return NullFilterStreamWriter::getInstance();
+	if(policy.passthrough && isUnchangedStream(objStream))
+		return NullFilterStreamWriter::getInstance();
+	if(policy.storeThreshold && encodedStreamLength(objStream)<policy.storeThreshold)
+		return NullFilterStreamWriter::getInstance();
+	return getInstance(objStream);
+}
+
 /** Helper method for xpdf object writing to the stream.
  * @param obj Xpdf object to write.
  * @param ref Object's reference (NULL for indirect object).
  * @param stream Stream where to write.
  * @param indirect Flag for indirect object
+ * @param policy Compression policy for stream objects.
  *
  * Creates correct pdf string representation of given object, adds indirect
  * header and footer if indirect flag is specified and writes everything to 
@@ -422,7 +584,8 @@ boost::shared_ptr<FilterStreamWriter> FilterStreamWriter::getInstance(Object& ob
  * Given xpdf object data (like stream or string) can contain unprintable or 
  * 0 bytes.
  */
-void writeObject(::Object & obj, BaseStream & stream, ::Ref* ref, bool indirect)
+void writeObject(::Object & obj, BaseStream & stream, ::Ref* ref, bool indirect, 
+		const CompressionPolicy& policy=CompressionPolicy())
 {
 using namespace boost;
 using namespace std;
@@ -431,9 +594,9 @@ using namespace std;
 	// contain binary data
 	if(obj.isStream())
 	{
-		shared_ptr<FilterStreamWriter> filter = FilterStreamWriter::getInstance(obj);
+		shared_ptr<FilterStreamWriter> filter = FilterStreamWriter::getInstance(obj, policy);
 		assert(filter->supportObject(obj));
-		filter->compress(obj, ref, stream);
+		filter->compress(obj, ref, stream, policy);
 	}else
 	{
 		// converts xpdf object to cobject and gets correct string
@@ -464,6 +627,347 @@ using namespace std;
 	}
 }
 
+namespace {
+
+/** Helper class for pipelined stream compression in writeContent.
+ *
+ * Stream objects which would be written by ZlibFilterStreamWriter are decoded
+ * (by the writing thread) up to window objects ahead of the currently 
+ * written one and their data are deflated by DeflatePool workers in the 
+ * meantime. write method then waits for the particular object and writes it.
+ */
+class StreamCompressionPipeline
+{
+	/** Batch of objects being written. */
+	IPdfWriter::ObjectList & objects;
+
+	/** Worker pool. */
+	DeflatePool pool;
+
+	/** Maximum number of objects prepared ahead. */
+	size_t window;
+
+	/** Index of the next object to be prepared. */
+	size_t prepared;
+
+	/** Mapping from object index to the submitted job. */
+	typedef std::map<size_t, DeflatePool::JobId> JobsTab;
+	JobsTab jobs;
+
+	/** Objects with empty decoded data (not submitted to the pool).
+	 * See ZlibFilterStreamWriter::deflate for reasons why they have to be 
+	 * written without deflating.
+	 */
+	typedef std::map<size_t, unsigned char *> EmptyTab;
+	EmptyTab empty;
+
+	/** Compression policy of the writer. */
+	const CompressionPolicy & policy;
+
+	/** Prepares objects up to index+window. */
+	void prepare(size_t index)
+	{
+		boost::shared_ptr<FilterStreamWriter> zlibWriter=ZlibFilterStreamWriter::getInstance();
+		for(; prepared<objects.size() && prepared<=index+window; ++prepared)
+		{
+			Object * obj=objects[prepared].second;
+			if(!obj || !obj->isStream())
+				continue;
+			if(FilterStreamWriter::getInstance(*obj, policy).get()!=zlibWriter.get())
+				continue;
+
+			size_t rawSize;
+			unsigned char * raw=convertStreamToDecodedData(*obj, rawSize);
+			if(!raw)
+				continue;
+			if(!rawSize)
+				empty.insert(EmptyTab::value_type(prepared, raw));
+			else
+				jobs.insert(JobsTab::value_type(prepared, pool.submit(raw, rawSize)));
+		}
+	}
+public:
+	StreamCompressionPipeline(IPdfWriter::ObjectList & objectList, size_t threads, 
+			const CompressionPolicy & _policy)
+		:objects(objectList), pool(threads, _policy.level), window(2*threads), prepared(0),
+		 policy(_policy)
+	{}
+
+	~StreamCompressionPipeline()
+	{
+		// objects skipped by the writer
+		for(EmptyTab::iterator i=empty.begin(); i!=empty.end(); ++i)
+			free(i->second);
+	}
+
+	/** Writes object with given index if it has been prepared.
+	 * @param index Index of the object in the batch.
+	 * @param ref Reference of the object.
+	 * @param stream Stream where to write.
+	 * @return true if object was written, false if the caller has to 
+	 * write it itself (by writeObject).
+	 */
+	bool write(size_t index, ::Ref & ref, BaseStream & stream)
+	{
+		prepare(index);
+
+		Object * obj=objects[index].second;
+		unsigned char * data;
+		size_t size;
+		JobsTab::iterator job=jobs.find(index);
+		if(job!=jobs.end())
+		{
+			unsigned char * raw;
+			size_t rawSize;
+			data=pool.wait(job->second, raw, rawSize, size);
+			jobs.erase(job);
+			if(data)
+			{
+				ZlibFilterStreamWriter::update_dict(*obj);
+				free(raw);
+			}else
+			{
+				// filters have been already removed from the 
+				// dictionary so raw data are still valid content
+				utilsPrintDbg(debug::DBG_WARN, "Unable to deflate stream "<<ref<<". Writing it uncompressed.");
+				data=raw;
+				size=rawSize;
+			}
+		}else
+		{
+			EmptyTab::iterator e=empty.find(index);
+			if(e==empty.end())
+				return false;
+			data=e->second;
+			size=0;
+			empty.erase(e);
+		}
+
+		CharBuffer charBuffer;
+		size_t len=streamDataToCharBuffer(*obj, &ref, charBuffer, data, size);
+		if(!len)
+		{
+			utilsPrintDbg(debug::DBG_WARN, "zero size stream returned. Probably error in the the object");
+			return true;
+		}
+        stream.getLine(charBuffer.get(), len);
+		return true;
+	}
+};
+
+} // annonymous namespace
+
+namespace {
+
+/** Size of the buffer used for raw objects scanning and copying. */
+const size_t RAW_CHUNK_SIZE = 64*1024;
+
+/** Checks whether given character is pdf regular character.
+ * Regular characters are all but white space and delimiters.
+ */
+bool isRegularChar(int ch)
+{
+	return !strchr(" \t\r\n\f", ch) && !strchr("()<>[]{}/%", ch) && ch;
+}
+
+/** Finds the first occurrence of one of given keywords in the stream.
+ * @param input Input stream.
+ * @param from Stream offset where to start (has to be at token boundary).
+ * @param kw1 The first keyword.
+ * @param kw2 The second keyword (may be NULL).
+ * @param pos Offset of the found keyword.
+ * @param end Offset where to stop scanning (0 to scan until the stream
+ * end).
+ *
+ * Input is tokenized the same way as pdf lexer does it - literal strings 
+ * (including nested parentheses and escapes), comments and names are 
+ * skipped, so keywords inside them are not found. Only a whole regular 
+ * token can match the keyword.
+ * <br>
+ * Position of the given stream is not relevant, data are read through a
+ * substream.
+ * @return 1 or 2 according to found keyword or 0 if none was found.
+ */
+int findFirstKeyword(BaseStream & input, size_t from, const char * kw1, const char * kw2, 
+		size_t & pos, size_t end=0)
+{
+	const char * keywords[] = {kw1, kw2};
+	size_t maxLen=std::max(strlen(kw1), kw2?strlen(kw2):0);
+
+	if(end && end<=from)
+		return 0;
+	Object dictObj;
+	boost::scoped_ptr<Stream> str(input.makeSubStream(from, end?gTrue:gFalse, end?end-from:0, &dictObj));
+	str->reset();
+
+	std::string token;
+	size_t tokenStart=from;
+	bool tokenTooLong=false, name=false;
+	int stringDepth=0;
+	bool comment=false;
+	size_t off=from;
+	for(;;++off)
+	{
+		int ch=str->getChar();
+
+		// literal strings and comments don't contain tokens
+		if(stringDepth)
+		{
+			if(ch==EOF)
+				return 0;
+			if(ch=='\\')
+			{
+				if(str->getChar()==EOF)
+					return 0;
+				++off;
+			}else if(ch=='(')
+				++stringDepth;
+			else if(ch==')')
+				--stringDepth;
+			continue;
+		}
+		if(comment)
+		{
+			if(ch==EOF)
+				return 0;
+			if(ch=='\r' || ch=='\n')
+				comment=false;
+			continue;
+		}
+
+		if(ch!=EOF && isRegularChar(ch))
+		{
+			if(token.empty() && !tokenTooLong)
+				tokenStart=off;
+			if(token.length()<maxLen)
+				token+=(char)ch;
+			else
+				tokenTooLong=true;
+			continue;
+		}
+
+		// token is complete
+		if(!token.empty() && !tokenTooLong && !name)
+		{
+			for(int k=0; k<2 && keywords[k]; ++k)
+				if(token==keywords[k])
+				{
+					pos=tokenStart;
+					return k+1;
+				}
+		}
+		token.clear();
+		tokenTooLong=false;
+		name=false;
+
+		switch(ch)
+		{
+			case EOF:
+				return 0;
+			case '(':
+				stringDepth=1;
+				break;
+			case '%':
+				comment=true;
+				break;
+			case '/':
+				// following regular characters form a name
+				name=true;
+				break;
+		}
+	}
+}
+
+/** Reads data from the current position of the stream.
+ * @param str Stream to read from.
+ * @param buffer Buffer for data.
+ * @param length Number of bytes to read.
+ * @return Number of bytes read (less than length at the end of stream).
+ */
+size_t readRawBytes(Stream & str, char * buffer, size_t length)
+{
+	size_t read=0;
+	while(read<length)
+	{
+		int len=str.doGetChars((int)std::min(length-read, RAW_CHUNK_SIZE), 
+				(Guchar *)buffer+read);
+		if(len<=0)
+			break;
+		read+=len;
+	}
+	return read;
+}
+
+/** Reads given byte range from the stream.
+ * @param input Input stream.
+ * @param start Start offset.
+ * @param buffer Buffer for data.
+ * @param length Number of bytes to read.
+ * @return Number of bytes read (less than length at the end of stream).
+ */
+size_t readRawBytes(BaseStream & input, size_t start, char * buffer, size_t length)
+{
+	Object dictObj;
+	boost::scoped_ptr<Stream> str(input.makeSubStream(start, gTrue, length, &dictObj));
+	str->reset();
+	return readRawBytes(*str, buffer, length);
+}
+
+/** Copies given byte range from the input stream to the output stream.
+ * @param input Input stream.
+ * @param start Start offset.
+ * @param length Number of bytes.
+ * @param stream Output stream.
+ * @return true on success, false if input couldn't be read.
+ */
+bool copyRawObject(BaseStream & input, size_t start, size_t length, StreamWriter & stream)
+{
+	Object dictObj;
+	boost::scoped_ptr<Stream> str(input.makeSubStream(start, gTrue, length, &dictObj));
+	str->reset();
+	std::vector<char> buffer(std::min(length, RAW_CHUNK_SIZE));
+	size_t copied=0;
+	while(copied<length)
+	{
+		size_t len=readRawBytes(*str, &buffer[0], 
+				std::min(buffer.size(), length-copied));
+		if(!len)
+		{
+			utilsPrintDbg(debug::DBG_ERR, "Unable to read input at offset="<<start+copied);
+			return false;
+		}
+		stream.putBuffer(&buffer[0], len);
+		copied+=len;
+	}
+	stream.putBuffer("\n", 1);
+	return true;
+}
+
+/** Checks that the object header at given offset matches the reference.
+ * @param input Input stream.
+ * @param start Offset of the object.
+ * @param ref Expected reference.
+ * @return true if there is "num gen obj" header for given reference.
+ */
+bool checkObjectHeader(BaseStream & input, size_t start, const ::Ref & ref)
+{
+	char header[64];
+	size_t len=readRawBytes(input, start, header, sizeof(header)-1);
+	header[len]='\0';
+	int num, gen, end=0;
+	if(sscanf(header, "%d %d obj%n", &num, &gen, &end)!=2 || !end)
+		return false;
+	return num==ref.num && gen==ref.gen && !isRegularChar(header[end]);
+}
+
+} // annonymous namespace
+
+void IPdfWriter::writeRawContent(UNUSED_PARAM RawObjectList & objectList, UNUSED_PARAM BaseStream & input, 
+		UNUSED_PARAM StreamWriter & stream, UNUSED_PARAM size_t off)
+{
+	throw NotImplementedException("IPdfWriter::writeRawContent");
+}
+
 void IPdfWriter::writeHeader( BaseStream &stream)
 {
 
@@ -512,27 +1016,37 @@ using namespace boost;
 	shared_ptr<ChangeContext> context(new ChangeContext(scope));
 	shared_ptr<OperationStep> newValue(new OperationStep());
 
+	// streams are deflated concurrently if more threads are allowed
+	scoped_ptr<StreamCompressionPipeline> pipeline;
+	if(compressionThreads>1 && os::threadsAvailable())
+		pipeline.reset(new StreamCompressionPipeline(objectList, compressionThreads, compressionPolicy));
+
 	// prepares offTable and writes objects
 	for(i=objectList.begin(); i!=objectList.end(); ++i, index++)
 	{
 		::Ref ref=i->first;
 		Object * obj=i->second;
 
-		// object must be valid
-		if(!obj)
-		{
-			utilsPrintDbg(DBG_WARN, "Object with "<<ref<<" is not valid. Skipping.");
-			continue;
-		}
-		
 		// no duplicities are allowed, because previous object wouldn't be
 		// available
-		if(offTable.find(ref)!=offTable.end())
+		if(offTable.find(ref)!=offTable.end() || freeTable.count(ref))
 		{
 			utilsPrintDbg(DBG_WARN, "Object with "<<ref<<" is already stored. Skipping.");
 			continue;
 		}
 
+		// object without value has been freed
+		if(!obj)
+		{
+			if(ref.num>maxObjNum)
+				maxObjNum=ref.num;
+			freeTable.insert(ref);
+			utilsPrintDbg(DBG_DBG, "Object with "<<ref<<" stored as free");
+			newValue->currStep=index;
+			notifyObservers(newValue, context);
+			continue;
+		}
+
 		// updates maximum Object number if ref is the one
 		if(ref.num>maxObjNum)
 			maxObjNum=ref.num;
@@ -541,7 +1055,8 @@ using namespace boost;
 		size_t objPos=stream.getPos();
 		offTable.insert(OffsetTab::value_type(ref, objPos));		
 		
-		writeObject(*obj, stream, &ref, true);	
+		if(!pipeline || !pipeline->write(index, ref, stream))
+			writeObject(*obj, stream, &ref, true, compressionPolicy);	
 		utilsPrintDbg(DBG_DBG, "Object with "<<ref<<" stored at offset="<<objPos);
 		
 		// calls observers
@@ -582,7 +1097,7 @@ size_t OldStylePdfWriter::writeTrailer(Object & trailer,const PrevSecInfo &prevS
 	utilsPrintDbg(DBG_DBG, "");
 	
 	// nothing has been stored, so no need for cross ref and trailer
-	if(!offTable.size())
+	if(!offTable.size() && freeTable.empty())
 	{
 		utilsPrintDbg(DBG_WARN, "No data stored. Skipping cross ref and trailer.");
 		return stream.getPos();
@@ -606,7 +1121,13 @@ size_t OldStylePdfWriter::writeTrailer(Object & trailer,const PrevSecInfo &prevS
 	// 	  pairs). This array contains sequence of entries each for one object
 	// 	  number. This sequence is without holes (n-th element has key+n object
 	// 	  number - n starts from 0)
-	typedef pair<size_t, int> EntryType;
+	struct EntryType
+	{
+		size_t off;
+		int gen;
+		bool free;
+		EntryType(size_t o, int g, bool f=false):off(o), gen(g), free(f) {}
+	};
 	typedef vector<EntryType> EntriesType;
 	typedef map< int , EntriesType> SubSectionTab;
 
@@ -617,13 +1138,40 @@ size_t OldStylePdfWriter::writeTrailer(Object & trailer,const PrevSecInfo &prevS
 	SubSectionTab::iterator sub=subSectionTable.begin();
 	
 	utilsPrintDbg(DBG_DBG, "Creating subsection offTable");
+
+	// merges used and free entries ordered by object number. Generation 
+	// number of free entries is incremented for reuse
+	typedef map<int, EntryType> RowsTab;
+	RowsTab rows;
+	for(OffsetTab::iterator i=offTable.begin(); i!=offTable.end(); ++i)
+		rows.insert(RowsTab::value_type((i->first).num, 
+					EntryType(i->second, (i->first).gen)));
+	for(FreeTab::iterator i=freeTable.begin(); i!=freeTable.end(); ++i)
+	{
+		int gen=std::min((i->gen)+1, 65535);
+		rows.insert(RowsTab::value_type(i->num, EntryType(0, gen, true)));
+	}
+
+	// object 0 is head of free list for the very first section and for
+	// each section with free entries
+	if(!prevSection.xrefPos || !freeTable.empty())
+		rows.insert(RowsTab::value_type(0, EntryType(0, 65535, true)));
+
+	// offset field of a free entry holds number of the next free object,
+	// the last one links back to the object 0
+	int nextFree=0;
+	for(RowsTab::reverse_iterator i=rows.rbegin(); i!=rows.rend(); ++i)
+	{
+		if(!i->second.free)
+			continue;
+		i->second.off=nextFree;
+		nextFree=i->first;
+	}
 	
 	// goes through rest entries of offset offTable
-	for(OffsetTab::iterator i=offTable.begin(); i!=offTable.end(); ++i)
+	for(RowsTab::iterator i=rows.begin(); i!=rows.end(); ++i)
 	{
-		int num=(i->first).num;
-		int gen=(i->first).gen;
-		size_t off=i->second;
+		int num=i->first;
 		
 		// skips not assigned subsection
 		if(sub!=subSectionTable.end())
@@ -635,7 +1183,7 @@ size_t OldStylePdfWriter::writeTrailer(Object & trailer,const PrevSecInfo &prevS
 			if((size_t)num == sub->first + (sub->second).size())
 			{
 				utilsPrintDbg(DBG_DBG, "Appending num="<<num<<" to section starting with num="<<sub->first);
-				(sub->second).push_back(EntryType(off, gen));
+				(sub->second).push_back(i->second);
 				continue;
 			}
 		}
@@ -643,7 +1191,7 @@ size_t OldStylePdfWriter::writeTrailer(Object & trailer,const PrevSecInfo &prevS
 		// num can't be added, so new subsection has to be created and this is
 		// used for next offset offTable elements
 		EntriesType entries;
-		entries.push_back(EntryType(off, gen));
+		entries.push_back(i->second);
 		pair<SubSectionTab::iterator, bool> ret=subSectionTable.insert(pair<int, EntriesType>(num, entries));
 		utilsPrintDbg(DBG_DBG, "New subsection created with starting num="<<num);
 		sub=ret.first;
@@ -689,17 +1237,17 @@ size_t OldStylePdfWriter::writeTrailer(Object & trailer,const PrevSecInfo &prevS
 		// 	where
 		// 		n* stands for file offset of object (padded by leading 0)
 		// 		g* is generation number (padded by leading 0)
-		// 		n is literal keyword identifying in-use object
+		// 		n is literal keyword identifying in-use object (f for
+		// 		  free object)
 		// 		eoln 2 characters end of line. If file uses 1 character
 		// 		     end of line character, it is preceeded by one space.
 		// Each entry is exactly 20 bytes long including the end-of-line marker.
-		// We don't provide information about free objects
 		for(EntriesType::iterator entry=entries.begin(); entry!=entries.end(); ++entry)
 		{
 			int ret = snprintf(xrefRow, sizeof(xrefRow)-1, 
-					"%010u %05i n ", 
-					(unsigned int)entry->first, 
-					entry->second);
+					(entry->free)?"%010u %05i f ":"%010u %05i n ", 
+					(unsigned int)entry->off, 
+					entry->gen);
 			if(ret<19)
 				utilsPrintDbg(DBG_WARN, "Xref entry to short ("
 						<<ret<<") for "<<xrefRow);
@@ -799,12 +1347,504 @@ size_t OldStylePdfWriter::writeTrailer(Object & trailer,const PrevSecInfo &prevS
 	return pos;
 }
 
+void OldStylePdfWriter::writeRawContent(RawObjectList & objectList, BaseStream & input, 
+		StreamWriter & stream, size_t off)
+{
+using namespace debug;
+using namespace boost;
+
+	utilsPrintDbg(DBG_DBG, "pos="<<off);
+	if(off)
+		stream.setPos(off);
+
+	shared_ptr<OperationScope> scope(new OperationScope());
+	scope->total=objectList.size();
+	scope->task=CONTENT;
+	shared_ptr<ChangeContext> context(new ChangeContext(scope));
+	shared_ptr<OperationStep> newValue(new OperationStep());
+
+	size_t index=0;
+	for(RawObjectList::const_iterator i=objectList.begin(); i!=objectList.end(); ++i, index++)
+	{
+		::Ref ref=i->ref;
+		if(offTable.find(ref)!=offTable.end() || freeTable.count(ref))
+		{
+			utilsPrintDbg(DBG_WARN, "Object with "<<ref<<" is already stored. Skipping.");
+			continue;
+		}
+		if(ref.num>maxObjNum)
+			maxObjNum=ref.num;
+
+		size_t objPos=stream.getPos();
+		if(!copyRawObject(input, i->start, i->length, stream))
+			throw MalformedFormatExeption("unable to read input file");
+		offTable.insert(OffsetTab::value_type(ref, objPos));
+		utilsPrintDbg(DBG_DBG, "Object with "<<ref<<" copied ("<<i->length
+				<<" bytes) to offset="<<objPos);
+
+		newValue->currStep=index;
+		notifyObservers(newValue, context);
+	}
+}
+
 void OldStylePdfWriter::reset()
 {
 	offTable.clear();
+	freeTable.clear();
 	maxObjNum=0;
 }
 
+const std::string XRefStreamPdfWriter::CONTENT = "Content phase"; 
+const std::string XRefStreamPdfWriter::TRAILER = "Object streams/XREF stream phase";
+
+namespace {
+
+/** Helper function to write indirect stream object with given data.
+ * @param ref Reference of the stream object.
+ * @param dict Pdf representation of the stream dictionary (without Length).
+ * @param data Raw stream data (already encoded).
+ * @param size Number of bytes in data.
+ * @param stream Stream where to write.
+ *
+ * Adds Length entry to the given dictionary and writes the whole indirect 
+ * object at the current position. Data may contain 0 bytes.
+ */
+void writeRawStreamObject(const ::Ref &ref, const std::string &dict, 
+		const unsigned char *data, size_t size, StreamWriter &stream)
+{
+	std::ostringstream header;
+	header << ref << " " << Specification::INDIRECT_HEADER << "\n"
+		<< Specification::CDICT_PREFIX << dict 
+		<< Specification::CDICT_MIDDLE << "Length " << size
+		<< Specification::CDICT_SUFFIX
+		<< Specification::CSTREAM_HEADER;
+	std::string prefix = header.str();
+	std::string suffix = Specification::CSTREAM_FOOTER + Specification::INDIRECT_FOOTER;
+
+	size_t len = prefix.length() + size + suffix.length();
+	char * buf = char_buffer_new(len);
+	CharBuffer charBuffer(buf, char_buffer_delete());
+	memcpy(buf, prefix.c_str(), prefix.length());
+	memcpy(buf+prefix.length(), data, size);
+	memcpy(buf+prefix.length()+size, suffix.c_str(), suffix.length());
+	stream.putLine(buf, len);
+}
+
+/** Helper function to store value as big endian number.
+ * @param buffer Buffer where to store.
+ * @param value Value to store.
+ * @param width Number of bytes to use.
+ */
+void putBigEndian(std::vector<unsigned char> &buffer, size_t value, int width)
+{
+	for(int i=width-1; i>=0; --i)
+		buffer.push_back((unsigned char)((value >> (8*i)) & 0xff));
+}
+
+/** Helper function to get number of bytes needed for the given value.
+ * @param value Value.
+ * @return Number of bytes (at least 1).
+ */
+int bytesNeeded(size_t value)
+{
+	int width=1;
+	while(value >>= 8)
+		width++;
+	return width;
+}
+
+} // annonymous namespace
+
+void XRefStreamPdfWriter::writeContent(ObjectList &objectList, BaseStream & stream, size_t off)
+{
+using namespace debug;
+using namespace boost;
+
+	utilsPrintDbg(DBG_DBG, "pos="<<off);
+	
+	if(off)
+		stream.setPos(off);
+
+	ObjectList::const_iterator i;
+	size_t index=0;
+
+	// creates context for observers
+	shared_ptr<OperationScope> scope(new OperationScope());
+	scope->total=objectList.size();
+	scope->task=CONTENT;
+	shared_ptr<ChangeContext> context(new ChangeContext(scope));
+	shared_ptr<OperationStep> newValue(new OperationStep());
+
+	scoped_ptr<StreamCompressionPipeline> pipeline;
+	if(compressionThreads>1 && os::threadsAvailable())
+		pipeline.reset(new StreamCompressionPipeline(objectList, compressionThreads, compressionPolicy));
+
+	for(i=objectList.begin(); i!=objectList.end(); ++i, index++)
+	{
+		::Ref ref=i->first;
+		Object * obj=i->second;
+
+		if(entries.find(ref)!=entries.end())
+		{
+			utilsPrintDbg(DBG_WARN, "Object with "<<ref<<" is already stored. Skipping.");
+			continue;
+		}
+		if(ref.num>maxObjNum)
+			maxObjNum=ref.num;
+
+		XRefStreamEntry entry;
+		// object without value has been freed
+		if(!obj)
+		{
+			entry.type=0;
+			entry.field2=0;
+			entry.field3=std::min(ref.gen+1, 65535);
+			entries.insert(EntriesTab::value_type(ref, entry));
+			utilsPrintDbg(DBG_DBG, "Object with "<<ref<<" stored as free");
+			newValue->currStep=index;
+			notifyObservers(newValue, context);
+			continue;
+		}
+		// streams (including cross reference and object streams of the 
+		// original document) are never packed to object streams
+		if(!obj->isStream() && !ref.gen)
+		{
+			// compressed objects are stored without indirect header and 
+			// footer. Entry is updated when object stream is flushed
+			std::string objPdfFormat;
+			xpdfObjToString(*obj, objPdfFormat);
+			pending.push_back(PendingObjects::value_type(ref.num, objPdfFormat));
+			entry.type=2;
+			entry.field2=0;
+			entry.field3=0;
+			entries.insert(EntriesTab::value_type(ref, entry));
+			utilsPrintDbg(DBG_DBG, "Object with "<<ref<<" scheduled for object stream");
+		}else
+		{
+			size_t objPos=stream.getPos();
+			entry.type=1;
+			entry.field2=objPos;
+			entry.field3=ref.gen;
+			entries.insert(EntriesTab::value_type(ref, entry));
+			if(!pipeline || !pipeline->write(index, ref, stream))
+				writeObject(*obj, stream, &ref, true, compressionPolicy);
+			utilsPrintDbg(DBG_DBG, "Object with "<<ref<<" stored at offset="<<objPos);
+		}
+
+		newValue->currStep=index;
+		notifyObservers(newValue, context);
+	}
+
+	utilsPrintDbg(DBG_DBG, "All objects (number="<<objectList.size()<<") processed. "
+			<<pending.size()<<" waiting for object streams.");
+}
+
+int XRefStreamPdfWriter::flushObjectStreams(int firstNum, StreamWriter & stream)
+{
+using namespace debug;
+using namespace boost;
+
+	int streamNum=firstNum;
+	size_t streamsCount=(pending.size()+objectsPerStream-1)/objectsPerStream;
+
+	shared_ptr<OperationScope> scope(new OperationScope());
+	scope->total=streamsCount;
+	scope->task=TRAILER;
+	shared_ptr<ChangeContext> context(new ChangeContext(scope));
+	shared_ptr<OperationStep> newValue(new OperationStep());
+
+	size_t step=1;
+	for(size_t start=0; start<pending.size(); start+=objectsPerStream, ++streamNum, ++step)
+	{
+		size_t end=std::min(start+objectsPerStream, pending.size());
+
+		// object stream data consists of header with pairs of object 
+		// number and offset relative to the first object followed by
+		// objects themselves
+		std::ostringstream header;
+		std::string body;
+		for(size_t i=start; i<end; ++i)
+		{
+			header << pending[i].first << " " << body.length() << " ";
+			body += pending[i].second;
+			body += "\n";
+
+			::Ref ref={pending[i].first, 0};
+			EntriesTab::iterator entry=entries.find(ref);
+			assert(entry!=entries.end());
+			entry->second.field2=streamNum;
+			entry->second.field3=i-start;
+		}
+		std::string data=header.str()+"\n";
+		size_t first=data.length();
+		data+=body;
+
+		size_t size;
+		unsigned char * deflated=ZlibFilterStreamWriter::deflate_buffer(
+				(unsigned char *)data.c_str(), data.length(), size, compressionPolicy.level);
+		if(!deflated)
+		{
+			utilsPrintDbg(DBG_ERR, "Unable to compress object stream. Aborting.");
+			throw MalformedFormatExeption("object stream compression failed");
+		}
+
+		std::ostringstream dict;
+		dict << Specification::CDICT_MIDDLE << "Type /ObjStm"
+			<< Specification::CDICT_MIDDLE << "N " << end-start
+			<< Specification::CDICT_MIDDLE << "First " << first
+			<< Specification::CDICT_MIDDLE << "Filter /FlateDecode";
+
+		::Ref streamRef={streamNum, 0};
+		XRefStreamEntry streamEntry;
+		streamEntry.type=1;
+		streamEntry.field2=stream.getPos();
+		streamEntry.field3=0;
+		entries.insert(EntriesTab::value_type(streamRef, streamEntry));
+		writeRawStreamObject(streamRef, dict.str(), deflated, size, stream);
+		free(deflated);
+		utilsPrintDbg(DBG_DBG, "Object stream "<<streamRef<<" with "<<end-start
+				<<" objects stored at offset="<<streamEntry.field2);
+
+		newValue->currStep=step;
+		notifyObservers(newValue, context);
+	}
+	pending.clear();
+	return streamNum;
+}
+
+void XRefStreamPdfWriter::flushPendingAsTopLevel(StreamWriter & stream)
+{
+using namespace debug;
+
+	for(PendingObjects::const_iterator i=pending.begin(); i!=pending.end(); ++i)
+	{
+		::Ref ref={i->first, 0};
+		EntriesTab::iterator entry=entries.find(ref);
+		assert(entry!=entries.end());
+		entry->second.type=1;
+		entry->second.field2=stream.getPos();
+		entry->second.field3=0;
+
+		// pending objects are already in pdf format, so just indirect 
+		// header and footer is added. Data may contain 0 bytes
+		std::string indirectFormat;
+		createIndirectObjectStringFromString(IndiRef(ref), i->second, indirectFormat);
+		size_t len=indirectFormat.length();
+		char * buf=char_buffer_new(len);
+		CharBuffer charBuffer(buf, char_buffer_delete());
+		memcpy(buf, indirectFormat.data(), len);
+		stream.putLine(buf, len);
+		utilsPrintDbg(DBG_DBG, "Object with "<<ref<<" stored at offset="<<entry->second.field2);
+	}
+	pending.clear();
+}
+
+size_t XRefStreamPdfWriter::writeTrailer(Object & trailer, const PrevSecInfo &prevSection, StreamWriter & stream, size_t off)
+{
+using namespace std;
+using namespace debug;
+
+	utilsPrintDbg(DBG_DBG, "");
+
+	if(!entries.size())
+	{
+		utilsPrintDbg(DBG_WARN, "No data stored. Skipping cross reference stream.");
+		return stream.getPos();
+	}
+	if(off)
+		stream.setPos(off);
+
+	// object streams and the cross reference stream get numbers behind all
+	// objects known so far so they can't collide with any document object
+	int firstFree=std::max((int)prevSection.entriesNum, maxObjNum+1);
+	::Object encrypt;
+	trailer.getDict()->lookupNF("Encrypt", &encrypt);
+	bool encrypted=!encrypt.isNull();
+	encrypt.free();
+	int xrefNum=firstFree;
+	if(encrypted)
+	{
+		utilsPrintDbg(DBG_WARN, "Document is encrypted. Object streams are not used.");
+		flushPendingAsTopLevel(stream);
+	}else
+		xrefNum=flushObjectStreams(firstFree, stream);
+
+	size_t xrefPos=stream.getPos();
+	::Ref xrefRef={xrefNum, 0};
+	XRefStreamEntry xrefEntry;
+	xrefEntry.type=1;
+	xrefEntry.field2=xrefPos;
+	xrefEntry.field3=0;
+	entries.insert(EntriesTab::value_type(xrefRef, xrefEntry));
+
+	// computes field widths - type field is always 1 byte
+	size_t maxField2=0, maxField3=0;
+	for(EntriesTab::const_iterator i=entries.begin(); i!=entries.end(); ++i)
+	{
+		maxField2=std::max(maxField2, i->second.field2);
+		maxField3=std::max(maxField3, i->second.field3);
+	}
+	// object 0 is head of free list for the very first section
+	bool writeFreeHead=!prevSection.xrefPos;
+	if(writeFreeHead)
+		maxField3=std::max(maxField3, (size_t)65535);
+	int w2=bytesNeeded(maxField2);
+	int w3=bytesNeeded(maxField3);
+
+	// builds entries data and Index array (continuous subsections) at once
+	vector<unsigned char> data;
+	ostringstream index;
+	int subStart=-1, subCount=0;
+	if(writeFreeHead)
+	{
+		putBigEndian(data, 0, 1);
+		putBigEndian(data, 0, w2);
+		putBigEndian(data, 65535, w3);
+		subStart=0;
+		subCount=1;
+	}
+	for(EntriesTab::const_iterator i=entries.begin(); i!=entries.end(); ++i)
+	{
+		int num=i->first.num;
+		if(subStart<0 || num!=subStart+subCount)
+		{
+			if(subStart>=0)
+				index << subStart << " " << subCount << " ";
+			subStart=num;
+			subCount=0;
+		}
+		putBigEndian(data, i->second.type, 1);
+		putBigEndian(data, i->second.field2, w2);
+		putBigEndian(data, i->second.field3, w3);
+		subCount++;
+	}
+	index << subStart << " " << subCount;
+
+	size_t size;
+	unsigned char * deflated=ZlibFilterStreamWriter::deflate_buffer(&data[0], data.size(), size, 
+			compressionPolicy.level);
+	if(!deflated)
+	{
+		utilsPrintDbg(DBG_ERR, "Unable to compress cross reference stream. Aborting.");
+		throw MalformedFormatExeption("xref stream compression failed");
+	}
+
+	// copies all trailer entries which are not related to the cross 
+	// reference section itself
+	static const char *fieldsToSkip [] = {"Type", "Index", "W", "Length", "Filter", 
+		"DecodeParms", "Prev", "Size", "XRefStm", NULL};
+	ostringstream dict;
+	::Dict * trailerDict=trailer.getDict();
+	boost::shared_ptr< ::Object> elem(XPdfObjectFactory::getInstance(), xpdf::object_deleter());
+	for(int i=0; i<trailerDict->getLength(); i++)
+	{
+		const char * key=trailerDict->getKey(i);
+		bool skip=false;
+		for(int j=0; fieldsToSkip[j]; j++)
+			if(!strcmp(key, fieldsToSkip[j]))
+				skip=true;
+		if(skip)
+			continue;
+		if(!trailerDict->getValNF(i, elem.get()))
+			continue;
+		string value;
+		xpdfObjToString(*elem, value);
+		dict << Specification::CDICT_MIDDLE << key 
+			<< Specification::CDICT_BETWEEN_NAMES << value;
+		elem->free();
+	}
+	dict << Specification::CDICT_MIDDLE << "Type /XRef"
+		<< Specification::CDICT_MIDDLE << "Size " << std::max(prevSection.entriesNum, (size_t)(xrefNum+1))
+		<< Specification::CDICT_MIDDLE << "W [1 " << w2 << " " << w3 << "]"
+		<< Specification::CDICT_MIDDLE << "Index [" << index.str() << "]"
+		<< Specification::CDICT_MIDDLE << "Filter /FlateDecode";
+	if(prevSection.xrefPos)
+	{
+		dict << Specification::CDICT_MIDDLE << "Prev " << prevSection.xrefPos;
+		utilsPrintDbg(DBG_DBG, "Linking to previous xref section. Prev="<<prevSection.xrefPos);
+	}
+
+	writeRawStreamObject(xrefRef, dict.str(), deflated, size, stream);
+	free(deflated);
+	utilsPrintDbg(DBG_DBG, "Cross reference stream "<<xrefRef<<" with "<<entries.size()
+			<<" entries stored at offset="<<xrefPos);
+
+	stream.putLine(STARTXREF_KEYWORD, strlen(STARTXREF_KEYWORD));
+	char xrefPosStr[128];
+	sprintf(xrefPosStr, "%u", (unsigned int)xrefPos);
+	stream.putLine(xrefPosStr, strlen(xrefPosStr));
+
+	size_t pos=stream.getPos();
+	stream.putLine(EOFMARKER, strlen(EOFMARKER));
+
+	// cleans pending data behind stored revision - same as in
+	// OldStylePdfWriter
+	size_t currPos=stream.getPos();
+	stream.setPos(0, -1);
+	size_t eofPos=stream.getPos();
+	if(eofPos>currPos)
+		stream.trim(currPos);
+
+	reset();
+
+	return pos;
+}
+
+void XRefStreamPdfWriter::writeRawContent(RawObjectList & objectList, BaseStream & input, 
+		StreamWriter & stream, size_t off)
+{
+using namespace debug;
+using namespace boost;
+
+	utilsPrintDbg(DBG_DBG, "pos="<<off);
+	if(off)
+		stream.setPos(off);
+
+	shared_ptr<OperationScope> scope(new OperationScope());
+	scope->total=objectList.size();
+	scope->task=CONTENT;
+	shared_ptr<ChangeContext> context(new ChangeContext(scope));
+	shared_ptr<OperationStep> newValue(new OperationStep());
+
+	size_t index=0;
+	for(RawObjectList::const_iterator i=objectList.begin(); i!=objectList.end(); ++i, index++)
+	{
+		::Ref ref=i->ref;
+		if(entries.find(ref)!=entries.end())
+		{
+			utilsPrintDbg(DBG_WARN, "Object with "<<ref<<" is already stored. Skipping.");
+			continue;
+		}
+		if(ref.num>maxObjNum)
+			maxObjNum=ref.num;
+
+		XRefStreamEntry entry;
+		entry.type=1;
+		entry.field2=stream.getPos();
+		entry.field3=ref.gen;
+		if(!copyRawObject(input, i->start, i->length, stream))
+			throw MalformedFormatExeption("unable to read input file");
+		entries.insert(EntriesTab::value_type(ref, entry));
+
+		newValue->currStep=index;
+		notifyObservers(newValue, context);
+	}
+}
+
+void XRefStreamPdfWriter::reset()
+{
+	entries.clear();
+	pending.clear();
+	maxObjNum=0;
+}
+
+IPdfWriter * createPdfWriter(bool useXRefStream)
+{
+	if(useXRefStream)
+		return new XRefStreamPdfWriter();
+	return new OldStylePdfWriter();
+}
+
 FileStreamData* PdfDocumentWriter::getStreamData(const char *fileName)
 {
 using namespace debug;
@@ -819,16 +1859,17 @@ using namespace debug;
 		utilsPrintDbg(DBG_ERR, "Unable to open file. Error message="<<strerror(err));
 		return NULL;
 	}
-    Object *dict;
-    Goffset  startA,lengthA ;
+	// input stream is only read, so it doesn't need an output handle
+	Object dict;
+	dict.initNull();
 	FileStreamData *streamData = new FileStreamData;
-    streamData->stream = new FileStream((GooFile*)file, startA, gFalse, lengthA, dict);
+	streamData->stream = new FileStream((GooFile*)file, 0, gFalse, 0, &dict);
 	streamData->file = file;
 	return streamData;
 }
 
 PdfDocumentWriter::PdfDocumentWriter(FileStreamData &data, IPdfWriter *_pdfWriter):
-	CXref(data.stream), pdfWriter(_pdfWriter) 
+	CXref(data.stream), inputStream(data.stream), rawCopy(false), pdfWriter(_pdfWriter) 
 {
 	assert(data.stream);
 	assert(data.file);
@@ -845,6 +1886,85 @@ PdfDocumentWriter::~PdfDocumentWriter()
 		delete pdfWriter;
 }
 
+bool PdfDocumentWriter::addRawObject(const ::Ref & ref)
+{
+using namespace debug;
+
+	if(!rawCopy || !inputStream || isEncrypted())
+		return false;
+	if(ref.num<0 || ref.num>=getNumObjects())
+		return false;
+	XRefEntry * entry=getEntry(ref.num, false);
+	if(!entry || entry->type!=xrefEntryUncompressed || entry->gen!=ref.gen)
+		return false;
+
+	size_t start=entry->offset;
+	if(!checkObjectHeader(*inputStream, start, ref))
+		return false;
+
+	// the object has to end before the following object in the file so 
+	// scanning can't run into another object (e.g. because of unbalanced
+	// string or wrong stream Length)
+	if(objectOffsets.empty())
+	{
+		for(int i=0; i<getNumObjects(); ++i)
+		{
+			XRefEntry * e=getEntry(i, false);
+			if(e && e->type==xrefEntryUncompressed)
+				objectOffsets.push_back(e->offset);
+		}
+		std::sort(objectOffsets.begin(), objectOffsets.end());
+	}
+	std::vector<size_t>::const_iterator next=std::upper_bound(
+			objectOffsets.begin(), objectOffsets.end(), start);
+	size_t end=(next!=objectOffsets.end())?*next:0;
+
+	size_t pos;
+	int found=findFirstKeyword(*inputStream, start, "endobj", "stream", pos, end);
+	if(!found)
+		return false;
+	if(found==2)
+	{
+		// stream data may contain anything so they are skipped according
+		// to the Length. Only stream dictionary is parsed by fetch.
+		boost::shared_ptr< ::Object> obj(XPdfObjectFactory::getInstance(), xpdf::object_deleter());
+		XRef::fetch(ref.num, ref.gen, obj.get());
+		if(!isOk() || !obj->isStream())
+			return false;
+		Object lenObj;
+		obj->streamGetDict()->lookup("Length", &lenObj);
+		if(!lenObj.isInt() || lenObj.getInt()<0)
+		{
+			lenObj.free();
+			return false;
+		}
+		size_t dataStart=pos+strlen("stream");
+		char eol[2];
+		if(readRawBytes(*inputStream, dataStart, eol, sizeof(eol))!=sizeof(eol))
+		{
+			lenObj.free();
+			return false;
+		}
+		dataStart+=(eol[0]=='\r' && eol[1]=='\n')?2:1;
+		size_t dataEnd=dataStart+lenObj.getInt();
+		lenObj.free();
+		if(findFirstKeyword(*inputStream, dataEnd, "endobj", NULL, pos, end)!=1)
+		{
+			utilsPrintDbg(DBG_WARN, "Object "<<ref<<" stream Length doesn't match. "
+					"Can't copy it raw.");
+			return false;
+		}
+	}
+	size_t length=pos+strlen("endobj")-start;
+
+	IPdfWriter::RawObjectElement elem;
+	elem.ref=ref;
+	elem.start=start;
+	elem.length=length;
+	rawObjectList.push_back(elem);
+	return true;
+}
+
 int PdfDocumentWriter::writeDocument(const char *fileName)
 {
 using namespace debug;
@@ -904,8 +2024,16 @@ using namespace debug;
     pdfWriter->writeHeader(*outputStream);
 	
 	IPdfWriter::ObjectList objectList;
+	rawObjectList.clear();
 	while (fillObjectList(objectList, writeBatchCount)>0)
 	{
+		if(rawObjectList.size())
+		{
+			utilsPrintDbg(DBG_INFO, "Copying "<<rawObjectList.size()
+					<<" unchanged objects to the output outputStream.");
+			pdfWriter->writeRawContent(rawObjectList, *inputStream, *outputStream);
+			rawObjectList.clear();
+		}
 		// writes collected objects and xref & trailer section
 		utilsPrintDbg(DBG_INFO, "Writing "<<objectList.size()
 				<<" objects to the output outputStream.");
@@ -29,6 +29,8 @@
 #include "kernel/static.h"
 #include "kernel/cxref.h"
 #include <poppler/Stream.h>
+#include <zlib.h>
+#include <set>
 
 /** Header of pdf file.
  * This string should be appended by pdf version number.
@@ -219,6 +221,64 @@ public:
 };
 
 
+/** Compression policy for stream objects writing.
+ *
+ * Holds all settings which influence how stream objects are written by 
+ * IPdfWriter implementators (@see IPdfWriter::setCompressionPolicy). 
+ * Default values keep the original behaviour (default zlib compression for 
+ * all streams which can be FlateDecode encoded).
+ */
+struct CompressionPolicy
+{
+	/** Zlib compression level.
+	 *
+	 * Z_DEFAULT_COMPRESSION (-1) or value from 0 (store) to 9 (best
+	 * compression). Level 0 means that streams are not recompressed at all
+	 * and they are written with their original encoding.
+	 */
+	int level;
+
+	/** Threshold for small streams.
+	 *
+	 * Streams with encoded size (Length) smaller than this value are 
+	 * written as they are because compression gain wouldn't be worth 
+	 * decoding and encoding. 0 means no threshold.
+	 */
+	size_t storeThreshold;
+
+	/** Flag for unchanged streams passthrough.
+	 *
+	 * If set, streams which haven't been changed (their data still come 
+	 * directly from the file) are written with their original encoded bytes 
+	 * without any decoding and encoding.
+	 */
+	bool passthrough;
+
+	/** Initialization constructor.
+	 * Uses default values.
+	 */
+	CompressionPolicy(int _level=-1, size_t _storeThreshold=0, bool _passthrough=false)
+		:level(_level), storeThreshold(_storeThreshold), passthrough(_passthrough)
+	{}
+
+	/** Policy preferring speed.
+	 * Fastest zlib level, small streams stored and unchanged streams
+	 * passed through.
+	 */
+	static CompressionPolicy fastest()
+	{
+		return CompressionPolicy(1, 1024, true);
+	}
+
+	/** Policy preferring output size.
+	 * Best zlib level and all streams are recompressed.
+	 */
+	static CompressionPolicy smallest()
+	{
+		return CompressionPolicy(9, 0, false);
+	}
+};
+
 /** Base class for filter stream writers.
  * Note that this class - unlike StreamWriter classes defined in streamwriter.h 
  * file is not based on xpdf Stream object. Its purpose is to help IPdfWriter
@@ -290,6 +350,33 @@ public:
 	 * @param outStream Output stream where to put data.
 	 */
      void compress( Object& obj, Ref* ref, BaseStream& outStream)const ;
+
+	/** Writes given stream object with respect to the compression policy.
+	 * @param obj Object to write (must be stream).
+	 * @param ref Indirect reference for object (NULL for direct object).
+	 * @param outStream Output stream where to put data.
+	 * @param policy Compression policy.
+	 *
+	 * Default implementation ignores policy and calls compress.
+	 */
+	virtual void compress(Object& obj, Ref* ref, StreamWriter& outStream, 
+			UNUSED_PARAM const CompressionPolicy& policy)const
+	{
+		compress(obj, ref, outStream);
+	}
+
+	/** Selects filter stream writer for given stream object and policy.
+	 * @param objStream Stream object.
+	 * @param policy Compression policy.
+	 *
+	 * Returns NullFilterStreamWriter if policy says that the stream should 
+	 * be written as it is (passthrough of unchanged stream, stream smaller 
+	 * than storeThreshold or level 0). Otherwise delegates to getInstance.
+	 *
+	 * @return Appropriate filter stream writer (never NULL).
+	 */
+	static boost::shared_ptr<FilterStreamWriter> getInstance(Object& objStream, 
+			const CompressionPolicy& policy);
 };
 
 /** Stream writer implementation with no filters.
@@ -329,14 +416,17 @@ class ZlibFilterStreamWriter: public FilterStreamWriter
 	/** Shared writer instance */
 	static boost::shared_ptr<ZlibFilterStreamWriter> instance;
 
+public:
+	static boost::shared_ptr<ZlibFilterStreamWriter> getInstance();
+
 	/** Updates given stream object with the applied fiter data.
 	 * @param obj Stream object.
 	 *
-	 * Only for internal use of ZlibFilterStreamWriter class.
+	 * Should be used only when data compressed by deflate_buffer are
+	 * written outside of compress method (e.g. by IPdfWriter compression 
+	 * pipeline).
 	 */
     static void update_dict(Object& obj);
-public:
-	static boost::shared_ptr<ZlibFilterStreamWriter> getInstance();
 
 	/** Checks whether given stream object is supported by this writer.
 	 * @param obj Stream object.
@@ -348,11 +438,13 @@ public:
 	 * @param in Input buffer.
 	 * @param in_size Input buffer size.
 	 * @param size Size of the output buffer data.
+	 * @param level Zlib compression level.
 	 * @return allocated buffer with the size data bytes or NULL on failure.
 	 *
 	 * Uses zlib interface to deflate given data.
 	 */
-	static unsigned char* deflate_buffer(unsigned char * in, size_t in_size, size_t& size);
+	static unsigned char* deflate_buffer(unsigned char * in, size_t in_size, size_t& size, 
+			int level=Z_DEFAULT_COMPRESSION);
 
 	/** Stream data extractor implementation for streamToCharBuffer function.
 	 * @param obj Stream object.
@@ -366,7 +458,33 @@ public:
 	 */
     static unsigned char* deflate(Object& obj, size_t& size);
 
+	/** Writes given stream object deflated on the fly.
+	 * @param obj Stream object.
+	 * @param ref Indirect reference for object (NULL for direct object).
+	 * @param outStream Output stream where to put data.
+	 * @param level Zlib compression level.
+	 *
+	 * Unlike deflate, no buffer for the whole decoded or compressed data is
+	 * allocated. Decoded data are pulled from the xpdf stream in 
+	 * DEFLATE_CHUNK_SIZE chunks and compressed data are pushed directly to 
+	 * the outStream. Stream dictionary is written with a fixed width Length
+	 * placeholder which is patched when the final size is known.
+	 *
+	 * @return Number of compressed data bytes.
+	 */
+	static size_t deflate_stream(Object& obj, Ref* ref, StreamWriter& outStream, 
+			int level=Z_DEFAULT_COMPRESSION);
+
+	/** Writes given stream object with FlateDecode filter.
+	 * Uses deflate_stream so the peak memory doesn't depend on the stream 
+	 * size.
+	 */
     virtual void compress(Object& obj, Ref* ref, StreamWriter& outStream)const;
+
+	/** Writes given stream object with FlateDecode filter and policy level.
+	 */
+    virtual void compress(Object& obj, Ref* ref, StreamWriter& outStream, 
+			const CompressionPolicy& policy)const;
 };
 
 /** Interface for pdf content writer.
@@ -405,13 +523,34 @@ public:
 	typedef std::pair<Ref, Object *> ObjectElement;
 
 	/** Type for object list.
-	 * Each element is pair of object reference and its value.
+	 * Each element is pair of object reference and its value. NULL value
+	 * stands for freed object which should be written as a free entry.
 	 * <br>
 	 * In any case (or future changes) this type supports push_back method for
 	 * storing and iterators which points to ObjectElement typed value.
 	 */
 	typedef std::vector<ObjectElement> ObjectList;
 
+	/** Type for RawObjectList element.
+	 * Describes byte range of an unchanged indirect object (from its 
+	 * "num gen obj" header to the endobj keyword inclusive) in the input 
+	 * file.
+	 */
+	struct RawObjectElement
+	{
+		/** Object reference. */
+		Ref ref;
+		/** File offset of the object header. */
+		size_t start;
+		/** Number of bytes of the object. */
+		size_t length;
+	};
+
+	/** Type for raw object list.
+	 * @see writeRawContent
+	 */
+	typedef std::vector<RawObjectElement> RawObjectList;
+
 	/** Type for pdf writer observer contenxt.
 	 *
 	 * This context holds OperationScope structure for change scope information. 
@@ -439,6 +578,21 @@ public:
 		size_t entriesNum;
 	};
 
+protected:
+	/** Number of threads used for stream compression.
+	 *
+	 * Values 0 and 1 mean that streams are compressed serially by the
+	 * writing thread.
+	 */
+	size_t compressionThreads;
+
+	/** Compression policy used for stream objects.
+	 */
+	CompressionPolicy compressionPolicy;
+
+public:
+	IPdfWriter():compressionThreads(0){}
+
 	virtual ~IPdfWriter()
 	{
 #ifdef OBSERVER_DEBUG
@@ -495,6 +649,66 @@ public:
 	 * cleared here.
 	 */
 	virtual void reset()=0;
+
+	/** Copies given objects from the input file to the stream.
+	 * @param objectList List of objects byte ranges.
+	 * @param input Input stream (read through substreams, so its position
+	 * is not relevant).
+	 * @param stream Stream writer where to write.
+	 * @param off Stream offset where to start writing (if 0, uses current
+	 * position).
+	 *
+	 * Same as writeContent but objects are not serialized. Their original
+	 * bytes are copied instead and only new offsets are recorded for 
+	 * writeTrailer. Caller is responsible that object bytes are valid for
+	 * the output (not encrypted, same reference).
+	 * <br>
+	 * Default implementation doesn't support raw copying.
+	 * @throw NotImplementedException if implementator doesn't support raw
+	 * copying.
+	 */
+	virtual void writeRawContent(RawObjectList & objectList, BaseStream & input, 
+			StreamWriter & stream, size_t off=0);
+
+	/** Sets number of threads used for stream compression.
+	 * @param threads Number of worker threads.
+	 *
+	 * If more than 1 thread is set, writeContent works in pipelined mode -
+	 * stream objects from the written batch are decoded ahead by the writing
+	 * thread and deflated concurrently by a DeflatePool while objects are 
+	 * written to the output stream in the original order. Values 0 and 1 
+	 * mean serial compression (default). Compression is serial also when
+	 * threads are not supported (see os::threadsAvailable).
+	 */
+	void setCompressionThreads(size_t threads)
+	{
+		compressionThreads=threads;
+	}
+
+	/** Returns number of threads used for stream compression.
+	 * @see setCompressionThreads
+	 */
+	size_t getCompressionThreads()const
+	{
+		return compressionThreads;
+	}
+
+	/** Sets compression policy for stream objects.
+	 * @param policy Compression policy.
+	 *
+	 * Policy is used for all following writeContent calls.
+	 */
+	void setCompressionPolicy(const CompressionPolicy& policy)
+	{
+		compressionPolicy=policy;
+	}
+
+	/** Returns current compression policy.
+	 */
+	const CompressionPolicy& getCompressionPolicy()const
+	{
+		return compressionPolicy;
+	}
 };
 
 /** Implementator of old style cross reference table pdf writer.
@@ -517,6 +731,17 @@ class OldStylePdfWriter: public IPdfWriter
 	 */
 	OffsetTab offTable;
 
+	/** Type for free objects table. */
+	typedef std::set<const ::Ref, xpdf::RefComparator> FreeTab;
+
+	/** Free objects table.
+	 *
+	 * Keeps references of objects which were given to writeContent without
+	 * value (freed objects). They are written as free entries to the cross 
+	 * reference table.
+	 */
+	FreeTab freeTable;
+
 	/** Maximum object number written.
 	 *
 	 * This value is set in writeContent method, used in writeTrailer and
@@ -566,7 +791,7 @@ public:
 	 * Sets new position in the stream, if off parameter is non 0 and iterate
 	 * through all objects from given list and writes each to the stream (uses 
 	 * helper writeIndirectObject function) and stores stream offset to the
-	 * offTable mapping. 
+	 * offTable mapping. Objects without value are stored to the freeTable.
 	 * <br>
 	 * Notifies all observers immediately after object has been written to the
 	 * stream. newValue parameter is number of written objects until now and
@@ -616,9 +841,14 @@ public:
 	 * </pre>
 	 * One subsection represents continuous sequence of indirect object numbers.
 	 * <br>
-	 * Cross reference subsections should also mark deleted objects, those which
-	 * are not accessible anymore and so can be reused with higher generation
-	 * number. This implementation doesn't write such entries.
+	 * Cross reference subsections also mark deleted objects (those from
+	 * freeTable), which are not accessible anymore and so can be reused 
+	 * with higher generation number. Such entries are written with the 
+	 * <code>f</code> keyword and incremented generation number. They form
+	 * a linked list - offset field holds number of the next free object and
+	 * the last one refers to the object 0. Object 0 (with 65535 generation 
+	 * number) is the head of the list and it is written for the first 
+	 * section and for each section with free entries.
 	 * <p>
 	 * Notifies observers immediately after one subsection is written. newValue
 	 * parameter contains number of already written subsections and context
@@ -629,14 +859,206 @@ public:
 	 */
     virtual size_t writeTrailer(Object & trailer, const PrevSecInfo &prevSection, StreamWriter & stream, size_t off=0);
 
+	/** Copies given objects from the input file.
+	 * Objects are stored to the offTable same way as in writeContent.
+	 * @see IPdfWriter::writeRawContent
+	 */
+	virtual void writeRawContent(RawObjectList & objectList, BaseStream & input, 
+			StreamWriter & stream, size_t off=0);
+
 	/** Resets all collected data.
 	 *
-	 * Clears offTable field and so this instance can be used for another 
+	 * Clears offTable and freeTable fields and so this instance can be used for another 
 	 * revision.
 	 */
 	virtual void reset();
 };
 
+/** Implementator of cross reference stream pdf writer (PDF 1.5).
+ *
+ * Writes content with compressed object streams and cross reference stream
+ * instead of old style cross reference table and trailer.
+ * <br>
+ * All non stream objects with generation number 0 are packed into object
+ * streams (each holds at most objectsPerStream objects) which are FlateDecode
+ * compressed. Stream objects and objects with non zero generation number can't
+ * be stored in object stream so they are written as normal top level indirect
+ * objects (same way as OldStylePdfWriter does).
+ * <br>
+ * Cross reference information (including trailer dictionary entries) is stored
+ * in compressed cross reference stream which is terminated by startxref and
+ * %%EOF markers.
+ * <p>
+ * Note that produced document requires PDF 1.5 capable reader. Incremental 
+ * revisions written by this class may follow old style cross reference 
+ * sections (Prev entry is allowed to point to both forms).
+ */
+class XRefStreamPdfWriter: public IPdfWriter
+{
+public:
+	/** Default number of objects stored in one object stream.
+	 */
+	static const size_t DEFAULT_OBJECTS_PER_STREAM = 100;
+
+	/** String for context task in writeContent.
+	 * @see OldStylePdfWriter::CONTENT
+	 */
+	static const std::string CONTENT;
+
+	/** String for context task in writeTrailer.
+	 * @see OldStylePdfWriter::TRAILER
+	 */
+	static const std::string TRAILER;
+
+private:
+	/** Cross reference stream entry.
+	 *
+	 * Type 0 entries (freed objects) hold generation number for reuse in
+	 * field3. Type 1 entries (uncompressed objects) hold file offset and 
+	 * generation number in field2 and field3 respectively. Type 2 entries (compressed
+	 * objects) hold object stream number and index of the object inside 
+	 * object stream.
+	 */
+	struct XRefStreamEntry
+	{
+		int type;
+		size_t field2;
+		size_t field3;
+	};
+
+	/** Type for cross reference entries table.
+	 * Mapping from reference to its cross reference stream entry.
+	 */
+	typedef std::map<const ::Ref, XRefStreamEntry, xpdf::RefComparator> EntriesTab;
+
+	/** Cross reference entries table.
+	 *
+	 * Filled for top level objects by writeContent and for compressed 
+	 * objects when object streams are flushed in writeTrailer.
+	 */
+	EntriesTab entries;
+
+	/** Type for objects waiting to be packed into object streams.
+	 * Each element holds object number and pdf representation of the
+	 * object.
+	 */
+	typedef std::vector<std::pair<int, std::string> > PendingObjects;
+
+	/** Objects waiting to be packed into object streams.
+	 *
+	 * Object streams need object numbers which don't collide with any
+	 * document object. Those are known only in writeTrailer (from previous 
+	 * section Size), so all compressible objects are collected here and
+	 * packed afterwards.
+	 */
+	PendingObjects pending;
+
+	/** Maximum number of objects in one object stream.
+	 */
+	size_t objectsPerStream;
+
+	/** Maximum object number written.
+	 * @see OldStylePdfWriter::maxObjNum
+	 */
+	int maxObjNum;
+
+	/** Writes all pending objects into object streams.
+	 * @param firstNum Object number for the first object stream.
+	 * @param stream Stream writer where to write.
+	 *
+	 * Allocates object numbers starting from firstNum for each object 
+	 * stream and stores type 2 entries for all packed objects.
+	 * @return Next unused object number.
+	 */
+	int flushObjectStreams(int firstNum, StreamWriter & stream);
+
+	/** Writes all pending objects as top level objects.
+	 * @param stream Stream writer where to write.
+	 *
+	 * Fallback to the classic layout used when object streams mustn't be
+	 * used (e.g. for encrypted documents). Updates entries of all written
+	 * objects to type 1 and clears pending objects.
+	 */
+	void flushPendingAsTopLevel(StreamWriter & stream);
+
+public:
+	/** Initialize constructor.
+	 * @param objectsPerStream Maximum number of objects in one object stream
+	 * (0 is treated as DEFAULT_OBJECTS_PER_STREAM).
+	 */
+	XRefStreamPdfWriter(size_t objectsPerStream=DEFAULT_OBJECTS_PER_STREAM)
+		:objectsPerStream(objectsPerStream?objectsPerStream:DEFAULT_OBJECTS_PER_STREAM), 
+		 maxObjNum(0)
+	{}
+
+	/** Writes given objects.
+	 * @param objectList List of objects to write.
+	 * @param stream Stream writer where to write.
+	 * @param off Stream offset where to start writing (if 0, uses current
+	 * position).
+	 *
+	 * Objects which can be compressed (non stream objects with generation
+	 * number 0 - so never cross reference or object streams) are converted to their pdf representation and kept until 
+	 * writeTrailer. All other objects are written immediately as top level 
+	 * indirect objects. Objects without value get free (type 0) entries.
+	 * <br>
+	 * Notifies observers same way as OldStylePdfWriter::writeContent.
+	 */
+	void writeContent(ObjectList & objectList, BaseStream & stream, size_t off=0);
+
+	/** Writes object streams and cross reference stream.
+	 * @param trailer Trailer object.
+	 * @param prevSection Context for previous section.
+	 * @param stream Stream writer where to write.
+	 * @param off Stream offset where to start writing (if 0, uses current
+	 * position).
+	 *
+	 * Packs all pending objects into object streams numbered from 
+	 * max{prevSection.entriesNum, maxObjNum+1}. If the trailer contains 
+	 * Encrypt entry, no object streams are created and pending objects are
+	 * written as top level objects instead, because the encryption 
+	 * dictionary must not be compressed and compressed objects are not 
+	 * encrypted one by one. Then creates cross reference
+	 * stream (with the next free object number) which contains entries for
+	 * all written objects (and itself), /W, /Index and /Size entries and all
+	 * trailer entries except those which are specific to the old style 
+	 * trailer or to the previous cross reference stream. Prev entry is set 
+	 * from prevSection.xrefPos (removed if 0). Finally writes startxref 
+	 * with position of the cross reference stream and EOFMARKER.
+	 * <br>
+	 * Notifies observers after each object stream written. Context task is
+	 * TRAILER string.
+	 *
+	 * @return stream position of pdf end of file %%EOF marker.
+	 */
+	virtual size_t writeTrailer(Object & trailer, const PrevSecInfo &prevSection, StreamWriter & stream, size_t off=0);
+
+	/** Copies given objects from the input file.
+	 * Copied objects are always stored as top level objects (type 1
+	 * entries).
+	 * @see IPdfWriter::writeRawContent
+	 */
+	virtual void writeRawContent(RawObjectList & objectList, BaseStream & input, 
+			StreamWriter & stream, size_t off=0);
+
+	/** Resets all collected data.
+	 *
+	 * Clears entries and pending objects so this instance can be used for 
+	 * another revision.
+	 */
+	virtual void reset();
+};
+
+/** Creates pdf content writer.
+ * @param useXRefStream Flag for cross reference stream writer.
+ *
+ * Helper for users which want to select output format by option (e.g.
+ * command line tools or CPdf::setPdfWriter callers).
+ * @return XRefStreamPdfWriter if useXRefStream is true, OldStylePdfWriter
+ * otherwise (allocated by new operator).
+ */
+IPdfWriter * createPdfWriter(bool useXRefStream);
+
 /** Helper data structure which keeps all file stream related data.
  */
 struct FileStreamData 
@@ -713,6 +1135,16 @@ class PdfDocumentWriter: public pdfobjects::CXref
 	 */
 	static const int writeBatchCount = 1000;
 
+	/** Input stream.
+	 * Used for raw objects copying. Owned by CXref.
+	 */
+	BaseStream * inputStream;
+
+	/** Flag for raw copy mode.
+	 * @see setRawCopy
+	 */
+	bool rawCopy;
+
 protected:
 	/** Pdf content writer implementator.
 	 *
@@ -720,6 +1152,41 @@ protected:
 	 */
 	IPdfWriter * pdfWriter;
 
+	/** Objects to be copied as raw byte ranges.
+	 *
+	 * Filled by addRawObject (called from fillObjectList implementation) and
+	 * cleared by writeDocument when objects are written.
+	 */
+	IPdfWriter::RawObjectList rawObjectList;
+
+	/** Sorted offsets of all uncompressed objects in the input.
+	 *
+	 * Built by the first addRawObject call and used to bound the byte range
+	 * of an object by the offset of the following object.
+	 */
+	std::vector<size_t> objectOffsets;
+
+	/** Adds object to rawObjectList if it can be copied as it is.
+	 * @param ref Object reference.
+	 *
+	 * Object can be copied if raw copy mode is enabled, document is not 
+	 * encrypted and the object is stored uncompressed in the file with the
+	 * same generation number. The object has to start with "num gen obj"
+	 * header and its byte range is found by scanning tokens for the endobj 
+	 * keyword (strings, comments and names are skipped and stream data are 
+	 * skipped according to their Length). Scanning stops at the offset of 
+	 * the following object, so whenever it would be confused by a malformed
+	 * object, false is returned and the object is serialized as usual. 
+	 * Objects are neither parsed nor fetched (only stream dictionaries are
+	 * fetched to get Length).
+	 * <br>
+	 * fillObjectList implementations should call this method before the 
+	 * object is fetched and fetch it only if false is returned.
+	 *
+	 * @return true if object was added, false otherwise.
+	 */
+	bool addRawObject(const ::Ref & ref);
+
 	/** Abstract method to provide objects to be written.
 	 * @param objectList List of objects to be filled.
 	 * @param maxObjectCount Maximum number of objects to be filled.
@@ -727,9 +1194,10 @@ protected:
 	 * This method is called by writeDocument until it returns no objects.
 	 * Implementation may clear the list before it adds new elements but
 	 * is must provide up to given maxObjectCount. Use maxObjectCount=0 
-	 * for unlimited number of objects.
+	 * for unlimited number of objects. Objects added by addRawObject are 
+	 * counted as well.
 	 *
-	 * @return Number of objects added to given objectList.
+	 * @return Number of objects added to given objectList and rawObjectList.
 	 * @throw MalformedFormatExeption if the document content is not valid.
 	 */
 	virtual int fillObjectList(IPdfWriter::ObjectList &objectList, int maxObjectCount)=0;
@@ -802,6 +1270,19 @@ public:
 	 */
 	virtual ~PdfDocumentWriter();
 
+	/** Sets raw copy mode.
+	 * @param enable Flag for raw copy mode.
+	 *
+	 * If enabled, unchanged objects are copied from the input file as
+	 * they are (@see addRawObject) instead of being fetched and serialized
+	 * by the pdfWriter. This avoids all parsing and stream decoding and 
+	 * encoding for the copied objects.
+	 */
+	void setRawCopy(bool enable)
+	{
+		rawCopy=enable;
+	}
+
 	/** Sets new pdf content writer.
 	 * @param pdfWriter IPdfWriter interface implementator.
 	 *
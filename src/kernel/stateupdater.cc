@@ -56,13 +56,13 @@ namespace {
 
 	// "m"
 	GfxState *
-    opmUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+    opmUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 		assert (2 <= args.size());
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
 
-		state->moveTo (getDoubleFromIProperty (args[0]), getDoubleFromIProperty (args[1]));
+		state->moveTo (args.getNumber (0), args.getNumber (1));
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xright, & rc->yright);
 
@@ -71,14 +71,14 @@ namespace {
 	}
 	// "Td"
 	GfxState *
-    opTdUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+    opTdUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 		assert (2 <= args.size());
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
 
-		double tx = state->getLineX() + getDoubleFromIProperty (args[0]);
-		double ty = state->getLineY() + getDoubleFromIProperty (args[1]);
+		double tx = state->getLineX() + args.getNumber (0);
+		double ty = state->getLineY() + args.getNumber (1);
 		state->textMoveTo(tx, ty);
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xright, & rc->yright);
@@ -88,18 +88,18 @@ namespace {
 	}
 	// "Tm"
 	GfxState *
-    opTmUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+    opTmUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 		assert (6 <= args.size ());
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
 
-		state->setTextMat (	getDoubleFromIProperty (args[0]), 
-							getDoubleFromIProperty (args[1]),
-							getDoubleFromIProperty (args[2]), 
-							getDoubleFromIProperty (args[3]),
-							getDoubleFromIProperty (args[4]), 
-							getDoubleFromIProperty (args[5])
+		state->setTextMat (	args.getNumber (0), 
+							args.getNumber (1),
+							args.getNumber (2), 
+							args.getNumber (3),
+							args.getNumber (4), 
+							args.getNumber (5)
 						  );
 		state->textMoveTo(0, 0);
 
@@ -111,7 +111,7 @@ namespace {
 	}
 	// "BT"
 	GfxState *
-    opBTUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands&, BBox* rc)
+    opBTUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands&, BBox* rc)
 	{
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
@@ -127,7 +127,7 @@ namespace {
 	}
 	// "Do"
 	GfxState *
-    opDoUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands&, BBox* rc)
+    opDoUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands&, BBox* rc)
 	{
 		// Set edge of rectangle from actual position on output devices
 		state->transform(0, 0, & rc->xleft, & rc->yleft);
@@ -140,13 +140,13 @@ namespace {
 	}
 	// "l"
 	GfxState *
-    oplUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+    oplUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 		assert (2 <= args.size ());
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
 		
-		state->lineTo (getDoubleFromIProperty(args[0]), getDoubleFromIProperty (args[1]));
+		state->lineTo (args.getNumber (0), args.getNumber (1));
 
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xright, & rc->yright);
@@ -156,7 +156,7 @@ namespace {
 	}
 	// "c"
 	GfxState *
-    opcUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+    opcUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 		assert (6 <= args.size ());
 		// Set edge of rectangle from actual position on output devices
@@ -164,9 +164,9 @@ namespace {
 		rc->xright = rc->xleft;
 		rc->yright = rc->yleft;
 
-		state->curveTo ( getDoubleFromIProperty(args[0]), getDoubleFromIProperty(args[1]),
-						getDoubleFromIProperty(args[2]), getDoubleFromIProperty(args[3]),
-						getDoubleFromIProperty(args[4]), getDoubleFromIProperty(args[5]));
+		state->curveTo ( args.getNumber (0), args.getNumber (1),
+						args.getNumber (2), args.getNumber (3),
+						args.getNumber (4), args.getNumber (5));
 
 		// simple calculate boundingbox of curve (inexact)
 		Point h_width;
@@ -177,7 +177,7 @@ namespace {
 		rc->yright += h_width.y;
 		Point h_pt;
 		for (int i=0; i<6 ;i+=2) {
-			state->transform(getDoubleFromIProperty(args[i]), getDoubleFromIProperty(args[i+1]), & h_pt.x, & h_pt.y);
+			state->transform(args.getNumber (i), args.getNumber (i+1), & h_pt.x, & h_pt.y);
 			rc->xleft = min( rc->xleft, h_pt.x - h_width.x );
 			rc->xright = max( rc->xright, h_pt.x + h_width.x );
 			rc->yleft = min( rc->yleft, h_pt.y - h_width.y );
@@ -189,7 +189,7 @@ namespace {
 	}
 	// "v"
 	GfxState *
-    opvUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+    opvUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 		assert (4 <= args.size ());
 		// Set edge of rectangle from actual position on output devices
@@ -198,10 +198,10 @@ namespace {
 		rc->yright = rc->yleft;
 
 		state->curveTo ( state->getCurX(), state->getCurY(), 
-						getDoubleFromIProperty(args[0]),
-						getDoubleFromIProperty(args[1]),
-						getDoubleFromIProperty(args[2]),
-						getDoubleFromIProperty(args[3])
+						args.getNumber (0),
+						args.getNumber (1),
+						args.getNumber (2),
+						args.getNumber (3)
 					  );
 
 		// simple calculate boundingbox of curve (inexact)
@@ -213,7 +213,7 @@ namespace {
 		rc->yright += h_width.y;
 		Point h_pt;
 		for (int i=0; i<4 ;i+=2) {
-			state->transform(getDoubleFromIProperty(args[i]), getDoubleFromIProperty(args[i+1]), & h_pt.x, & h_pt.y);
+			state->transform(args.getNumber (i), args.getNumber (i+1), & h_pt.x, & h_pt.y);
 			rc->xleft = min( rc->xleft, h_pt.x - h_width.x );
 			rc->xright = max( rc->xright, h_pt.x + h_width.x );
 			rc->yleft = min( rc->yleft, h_pt.y - h_width.y );
@@ -225,7 +225,7 @@ namespace {
 	}
 	// "y"
 	GfxState *
-    opyUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+    opyUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 		assert (4 <= args.size ());
 		// Set edge of rectangle from actual position on output devices
@@ -233,12 +233,12 @@ namespace {
 		rc->xright = rc->xleft;
 		rc->yright = rc->yleft;
 
-		state->curveTo ( getDoubleFromIProperty(args[0]),
-						getDoubleFromIProperty(args[1]),
-						getDoubleFromIProperty(args[2]),
-						getDoubleFromIProperty(args[3]),
-						getDoubleFromIProperty(args[2]),
-						getDoubleFromIProperty(args[3])
+		state->curveTo ( args.getNumber (0),
+						args.getNumber (1),
+						args.getNumber (2),
+						args.getNumber (3),
+						args.getNumber (2),
+						args.getNumber (3)
 					  );
 
 		// simple calculate boundingbox of curve (inexact)
@@ -250,7 +250,7 @@ namespace {
 		rc->yright += h_width.y;
 		Point h_pt;
 		for (int i=0; i<4 ;i+=2) {
-			state->transform(getDoubleFromIProperty(args[i]), getDoubleFromIProperty(args[i+1]), & h_pt.x, & h_pt.y);
+			state->transform(args.getNumber (i), args.getNumber (i+1), & h_pt.x, & h_pt.y);
 			rc->xleft = min( rc->xleft, h_pt.x - h_width.x );
 			rc->xright = max( rc->xright, h_pt.x + h_width.x );
 			rc->yleft = min( rc->yleft, h_pt.y - h_width.y );
@@ -262,13 +262,13 @@ namespace {
 	}
 	// "re"
 	GfxState *
-    opreUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+    opreUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 		assert (4 <= args.size ());
-		double x = getDoubleFromIProperty(args[0]);
-		double y = getDoubleFromIProperty(args[1]);
-		double w = getDoubleFromIProperty(args[2]);
-		double h = getDoubleFromIProperty(args[3]);
+		double x = args.getNumber (0);
+		double y = args.getNumber (1);
+		double w = args.getNumber (2);
+		double h = args.getNumber (3);
 		state->moveTo(x, y);
 		state->lineTo(x + w, y);
 		state->lineTo(x + w, y + h);
@@ -295,7 +295,7 @@ namespace {
 	}
 	// "h"
 	GfxState *
-    ophUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands&, BBox* rc)
+    ophUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands&, BBox* rc)
 	{
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
@@ -310,13 +310,13 @@ namespace {
 	}
 	// "Tc"
 	GfxState *
-    opTcUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+    opTcUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 		assert (1 <= args.size());
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
 
-  		state->setCharSpace (getDoubleFromIProperty(args[0]));
+  		state->setCharSpace (args.getNumber (0));
 
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xright, & rc->yright);
@@ -326,7 +326,7 @@ namespace {
 	}
 	// "Tf"
 	GfxState *
-    opTfUpdate (GfxState* state, boost::shared_ptr<GfxResources> res, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+    opTfUpdate (GfxState* state, boost::shared_ptr<GfxResources> res, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 			assert (2 <= args.size());
 		// Set edge of rectangle from actual position on output devices
@@ -334,29 +334,28 @@ namespace {
 		rc->xright = rc->xleft;
 		rc->yright = rc->yleft;
 
-			assert (isName(args[0]));
-		std::string val;
-		IProperty::getSmartCObjectPtr<CName>(args[0])->getValue (val);
+			assert (pName == args.getType (0));
+		std::string val = args.getName (0);
 
 		GfxFont* font = NULL;
 
         if (!(font = res->lookupFont ((char*)val.c_str())))
 			return state;		// same as displaing with xpdf/Gfx
 
-		state->setFont (font, getDoubleFromIProperty (args[1]));
+		state->setFont (font, args.getNumber (1));
 		
 		// return changed state
 		return state;
 	}
 	// "Ts"
 	GfxState *
-    opTsUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+    opTsUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 		assert (1 <= args.size());
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
 
-		state->setRise (getDoubleFromIProperty (args[0])); 
+		state->setRise (args.getNumber (0)); 
 
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xright, & rc->yright);
@@ -366,13 +365,13 @@ namespace {
 	}
 	// "Tw"
 	GfxState *
-    opTwUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+    opTwUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 		assert (1 <= args.size());
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
 
-  		state->setWordSpace (getDoubleFromIProperty (args[0]));
+  		state->setWordSpace (args.getNumber (0));
 
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xright, & rc->yright);
@@ -382,13 +381,13 @@ namespace {
 	}
 	// "Tz"
 	GfxState *
-    opTzUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+    opTzUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 		assert (1 <= args.size());
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
 
-		state->setHorizScaling (getDoubleFromIProperty (args[0]));
+		state->setHorizScaling (args.getNumber (0));
 
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xright, & rc->yright);
@@ -398,14 +397,14 @@ namespace {
 	}
 	// "TD"
 	GfxState *
-    opTDUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+    opTDUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 		assert (2 <= args.size ());
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
 
-		double tx = state->getLineX() + getDoubleFromIProperty (args[0]);
-		double ty = getDoubleFromIProperty (args[1]);
+		double tx = state->getLineX() + args.getNumber (0);
+		double ty = args.getNumber (1);
 		state->setLeading(-ty);
 		ty += state->getLineY();
 		state->textMoveTo(tx, ty);
@@ -418,7 +417,7 @@ namespace {
 	}
 	// "T*"
 	GfxState *
-    opTstarUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands&, BBox* rc)
+    opTstarUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands&, BBox* rc)
 	{
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
@@ -435,7 +434,7 @@ namespace {
 	}
 	// "Tj"
 	GfxState *
-    opTjUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator> op, const PdfOperator::Operands& args, BBox* rc)
+    opTjUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator> op, const CompactOperands& args, BBox* rc)
 	{
 		assert (1 <= args.size ());
 
@@ -455,7 +454,7 @@ namespace {
 	}
 	// "'"
 	GfxState *
-    opApoUpdate (GfxState* state, boost::shared_ptr<GfxResources> res, const boost::shared_ptr<PdfOperator> op, const PdfOperator::Operands& args, BBox* rc)
+    opApoUpdate (GfxState* state, boost::shared_ptr<GfxResources> res, const boost::shared_ptr<PdfOperator> op, const CompactOperands& args, BBox* rc)
 	{
 		assert (1 <= args.size ());
 
@@ -473,13 +472,13 @@ namespace {
 	}
 	// "TL"
 	GfxState *
-    opTLUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+    opTLUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 		assert (1 <= args.size ());
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
 
-  		state->setLeading ( getDoubleFromIProperty (args[0]));
+  		state->setLeading ( args.getNumber (0));
 
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xright, & rc->yright);
@@ -489,7 +488,7 @@ namespace {
 	}
 	// "\"
 	GfxState *
-    opSlashUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator> op, const PdfOperator::Operands& args, BBox* rc)
+    opSlashUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator> op, const CompactOperands& args, BBox* rc)
 	{
 		assert (3 <= args.size ());
 		
@@ -500,8 +499,8 @@ namespace {
 		// Set edge of rectangle from actual position on output devices
 		//state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
 
-		state->setWordSpace (getDoubleFromIProperty (args[0]));
-		state->setCharSpace (getDoubleFromIProperty (args[1]));
+		state->setWordSpace (args.getNumber (0));
+		state->setCharSpace (args.getNumber (1));
 		double tx = state->getLineX();
 		double ty = state->getLineY() - state->getLeading();
 		state->textMoveTo(tx, ty);
@@ -523,7 +522,7 @@ namespace {
 	}
 	// "TJ"
 	GfxState *
-    opTJUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator> op, const PdfOperator::Operands& args, BBox* rc)
+    opTJUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator> op, const CompactOperands& args, BBox* rc)
 	{
 		assert (1 <= args.size ());
 
@@ -536,7 +535,7 @@ namespace {
 		rc->xright = rc->xleft;
 		rc->yright = rc->yleft;
 
-		if (!isArray(args[0]))
+		if (pArray != args.getType (0))
 		{
 			assert (!"opTJUpdate: Invalid first argument.");
 			throw ElementBadTypeException ("opTJUpdate: Object in bad state->");
@@ -546,7 +545,7 @@ namespace {
 		wMode = state->getFont()->getWMode();
 
 		BBox h_rc;
-  		boost::shared_ptr<CArray> array = IProperty::getSmartCObjectPtr<CArray> (args[0]);
+  		boost::shared_ptr<CArray> array = IProperty::getSmartCObjectPtr<CArray> (args.getProperty (0));
 		for (size_t i = 0; i < array->getPropertyCount(); ++i) 
 		{
 			boost::shared_ptr<IProperty> item = array->getProperty (i);
@@ -594,19 +593,19 @@ namespace {
 	}
 	// "cm"
 	GfxState *
-    opcmUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+    opcmUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 		assert (6 <= args.size());
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
 
 		state->concatCTM (
-				getDoubleFromIProperty(args[0]),
-				getDoubleFromIProperty(args[1]),
-				getDoubleFromIProperty(args[2]),
-				getDoubleFromIProperty(args[3]),
-				getDoubleFromIProperty(args[4]),
-				getDoubleFromIProperty(args[5]));
+				args.getNumber (0),
+				args.getNumber (1),
+				args.getNumber (2),
+				args.getNumber (3),
+				args.getNumber (4),
+				args.getNumber (5));
 
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xright, & rc->yright);
@@ -617,7 +616,7 @@ namespace {
 
 	// "Q"
 	GfxState *
-    opQUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands&, BBox* rc)
+    opQUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands&, BBox* rc)
 	{
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
@@ -633,7 +632,7 @@ namespace {
 
 	// "q"
 	GfxState *
-    opqUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands&, BBox* rc)
+    opqUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands&, BBox* rc)
 	{
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
@@ -649,13 +648,13 @@ namespace {
 
 	// "Tr"
 	GfxState *
-    opTrUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+    opTrUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 		assert (1 <= args.size());
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
 
-		state->setRender( getIntFromIProperty(args[0]) );
+		state->setRender( args.getInt (0) );
 
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xright, & rc->yright);
@@ -666,14 +665,14 @@ namespace {
 
 	// "w"
 	GfxState *
-    opwUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+    opwUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
 		rc->xright = rc->xleft;
 		rc->yright = rc->yleft;
 
-		state->setLineWidth( getDoubleFromIProperty(args[0]) );
+		state->setLineWidth( args.getNumber (0) );
 		
 		// return changed state
 		return state;
@@ -681,7 +680,7 @@ namespace {
 	
 	// "BI"
 	GfxState *
-    opBIUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator> op, const PdfOperator::Operands&, BBox* rc)
+    opBIUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator> op, const CompactOperands&, BBox* rc)
 	{
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
@@ -707,7 +706,7 @@ namespace {
 
 	// "ID"
 	GfxState *
-    opIDUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator> op, const PdfOperator::Operands&, BBox* rc)
+    opIDUpdate (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator> op, const CompactOperands&, BBox* rc)
 	{
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
@@ -724,7 +723,7 @@ namespace {
 
 /*	// ""
 	GfxState *
-	op (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const PdfOperator::Operands& args, BBox* rc)
+	op (GfxState* state, boost::shared_ptr<GfxResources>, const boost::shared_ptr<PdfOperator>, const CompactOperands& args, BBox* rc)
 	{
 		// Set edge of rectangle from actual position on output devices
 		state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
@@ -1140,7 +1139,7 @@ GfxState *
 StateUpdater::unknownUpdate (GfxState* state, 
 							boost::shared_ptr<GfxResources>, 
                             const boost::shared_ptr<PdfOperator>,
-                            const PdfOperator::Operands&, BBox* rc)
+                            const CompactOperands&, BBox* rc)
 {
 	// Set rectangle from actual position on output devices
 	state->transform(state->getCurX (), state->getCurY(), & rc->xleft, & rc->yleft);
@@ -1153,6 +1152,53 @@ StateUpdater::unknownUpdate (GfxState* state,
 }
 
 
+//
+//
+//
+const StateUpdater::CheckTypes*
+StateUpdater::findOp (NameAtom opAtom)
+{
+	typedef std::vector<const CheckTypes*> AtomTable;
+	struct Builder
+	{
+		static AtomTable build ()
+		{
+			AtomTable table;
+			size_t count = sizeof (KNOWN_OPERATORS) / sizeof (CheckTypes);
+			for (size_t i = 0; i < count; ++i)
+			{
+				NameAtom atom = internName (KNOWN_OPERATORS[i].name);
+				if (table.size() <= atom)
+					table.resize (atom + 1, NULL);
+				table[atom] = &(KNOWN_OPERATORS[i]);
+			}
+			return table;
+		}
+	};
+	// Builds table on the first use (static initialization is thread safe so
+	// parallel page processing can't see a half built table). All known 
+	// operator names are interned here so any atom beyond the table is an
+	// unknown operator
+	static const AtomTable table = Builder::build ();
+
+	if (opAtom >= table.size())
+		return NULL;
+	return table[opAtom];
+}
+
+//
+//
+//
+NameAtom
+StateUpdater::findOpAtom (const std::string& name)
+{
+	// makes sure that all known operator names are interned
+	findOp (NO_ATOM);
+
+	NameAtom atom = NameTable::instance().lookup (name);
+	return (findOp (atom)) ? atom : NO_ATOM;
+}
+
 //
 //
 //
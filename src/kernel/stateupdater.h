@@ -79,7 +79,7 @@ public:
 		/** Function to execute when updating position. */
 		GfxState* (*update) (GfxState* , boost::shared_ptr<GfxResources>, 
                         const boost::shared_ptr<PdfOperator>,
-                        const PdfOperator::Operands&, BBox* rc);
+                        const CompactOperands&, BBox* rc);
 		
 		char endTag[MAX_OPERATOR_NAMELEN]; /**< If it is a complex type, its end tag.*/	
 		
@@ -106,7 +106,7 @@ public:
 	static GfxState* unknownUpdate (GfxState* state, 
 								 boost::shared_ptr<GfxResources>, 
                                  const boost::shared_ptr<PdfOperator>,
-                                 const PdfOperator::Operands&, BBox* rc);
+                                 const CompactOperands&, BBox* rc);
 	
 	//
 	// Accessors
@@ -119,6 +119,28 @@ public:
 	 */
 	static const CheckTypes* findOp (const std::string& name);
 
+	/**
+	 * Find operator specification.
+	 *
+	 * Constant time equivalent of findOp(const std::string&) which uses
+	 * table indexed by operator name atoms.
+	 *
+	 * @param atom Atom of the operator name (see PdfOperator::getOperatorAtom).
+	 * @return Operator specification or NULL if operator is unknown.
+	 */
+	static const CheckTypes* findOp (NameAtom atom);
+
+	/**
+	 * Get atom of a known operator name.
+	 *
+	 * Only names of known operators are interned, so garbage operator names
+	 * from damaged content streams don't grow the name table.
+	 *
+	 * @param name Name of the operator.
+	 * @return Atom of the operator name or NO_ATOM if operator is unknown.
+	 */
+	static NameAtom findOpAtom (const std::string& name);
+
 	/**
 	 *  Get end tag of an operator.
 	 *
@@ -129,6 +151,50 @@ public:
 	static std::string getEndTag (const std::string& name);
 	
 public:
+	/**
+	 * Update graphical state according to one pdf operator.
+	 *
+	 * Ownership of the state is passed to the function and the updated one
+	 * has to be used afterwards (operators like q/Q replace the state).
+	 * If an exception is thrown, given state is left untouched.
+	 *
+	 * @param state Graphical state.
+	 * @param res Graphical resources.
+	 * @param op Pdf operator.
+	 * @param rc Output bounding box of the operator.
+	 *
+	 * @return Updated graphical state.
+	 * @throw CObjInvalidObject if the operator has incorrect parameters.
+	 */
+	static GfxState*
+	updatePdfOperator (GfxState* state, 
+					   boost::shared_ptr<GfxResources> res, 
+					   boost::shared_ptr<PdfOperator> op,
+					   BBox& rc)
+	{
+		// Get operator specification
+		const CheckTypes* chcktp = findOp (op->getOperatorAtom());
+		// Get operands, they are only read
+		const CompactOperands& ops = op->getCompactParameters ();
+		// If operator found use the function else use default
+		if (NULL != chcktp)
+		{
+			// Check arguments
+			if ( ((chcktp->argNum >= 0) && (ops.size () != (size_t)chcktp->argNum)) ||
+			      ((chcktp->argNum < 0) && (ops.size () > (size_t)-chcktp->argNum)) )
+			{
+				kernelPrintDbg (debug::DBG_CRIT, "Bad content stream. Incorrect parameters.");
+				throw CObjInvalidObject ();
+			}
+
+			// Update the state
+			return (chcktp->update) (state, res, op, ops, &rc);
+		}
+
+		// Update the state
+		return unknownUpdate (state, res, op, ops, &rc);
+	}
+
 	/**
 	 *  Update pdf operators.
 	 *
@@ -161,35 +227,13 @@ public:
 		while (!it.isEnd ())
 		{
 			op = it.getCurrent();
-			// Get operator name
-			std::string frst;
-			op->getOperatorName(frst);
-			// Get operator specification
-			const CheckTypes* chcktp = findOp (frst);
-			// Get operands
-			PdfOperator::Operands ops;
-			op->getParameters (ops);
-			// If operator found use the function else use default
-			if (NULL != chcktp)
-			{
-				// Check arguments
-				if ( ((chcktp->argNum >= 0) && (ops.size () != (size_t)chcktp->argNum)) ||
-				      ((chcktp->argNum < 0) && (ops.size () > (size_t)-chcktp->argNum)) )
-				{
-					kernelPrintDbg (debug::DBG_CRIT, "Bad content stream. Incorrect parameters.");
-					
-					// Delete gfx state
-					delete tmpstate;
-					throw CObjInvalidObject ();
-				}
-
-				// Update the state
-				tmpstate = (chcktp->update) (tmpstate, res, op, ops, &rc);
-				
-			}else
+			try {
+				tmpstate = updatePdfOperator (tmpstate, res, op, rc);
+			}catch (CObjInvalidObject&)
 			{
-				// Update the state
-				tmpstate = unknownUpdate (tmpstate, res, op, ops, &rc);
+				// Delete gfx state
+				delete tmpstate;
+				throw;
 			}
 
 			assert (tmpstate);
@@ -68,6 +68,7 @@
 #include <deque>
 #include <map>
 #include <set>
+#include <algorithm>
 
 #include <limits>
 
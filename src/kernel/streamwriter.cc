@@ -33,41 +33,72 @@
 
 //TODO use stream encoding
 
-void FileStreamWriter::putChar(int ch)
-{
-    size_t pos ; /*= Stream::getPos();*/
-//	fputc(ch, f);
-//	fflush(f);
-//    Stream::setPos(pos+1);
-}
-
-void FileStreamWriter::putLine(const char * line, size_t length)
+bool FileStreamWriter::writeData(Goffset pos, const char * data, size_t length)
 {
 using namespace debug;
 
-	if(!line)
-		return;
+	if(!out)
+	{
+		kernelPrintDbg(DBG_ERR, "No output file handle. Unable to write.");
+		return false;
+	}
+	if(fseek(out, pos, SEEK_SET))
+	{
+		int err = errno;
+		kernelPrintDbg(DBG_ERR, "Unable to seek to "<<pos<<" \"" << strerror(err) << "\"");
+		return false;
+	}
 
-    size_t pos; /* =  Stream::getPos();*/
 	size_t totalWriten=0;
-	
-	// writes all data
 	while(totalWriten<length)
 	{
-        size_t writen;/*= fwrite(line+totalWriten, sizeof(char), length-totalWriten);*/
+		size_t writen=fwrite(data+totalWriten, sizeof(char), length-totalWriten, out);
 		if(!writen)
 		{
 			int err = errno;
 			kernelPrintDbg(DBG_ERR, "Write error \"" << strerror(err) << "\"");
-			return;
+			return false;
 		}
 		totalWriten+=writen;
 	}
-//    fputc(0xA);
-	totalWriten++;
-//    fflush(f);
-//    Stream::setPos(pos+totalWriten,0);
+	if(fflush(out))
+	{
+		int err = errno;
+		kernelPrintDbg(DBG_ERR, "Flush error \"" << strerror(err) << "\"");
+		return false;
+	}
+	return true;
+}
+
+void FileStreamWriter::putChar(int ch)
+{
+	char c=(char)ch;
+	Goffset pos=FileStream::getPos();
+	if(writeData(pos, &c, 1))
+		FileStream::setPos(pos+1, 0);
+}
+
+void FileStreamWriter::putLine(const char * line, size_t length)
+{
+	if(!line)
+		return;
+
+	Goffset pos=FileStream::getPos();
+	if(!writeData(pos, line, length))
+		return;
+	if(!writeData(pos+length, "\n", 1))
+		return;
+	FileStream::setPos(pos+length+1, 0);
+}
+
+void FileStreamWriter::putBuffer(const char * buffer, size_t length)
+{
+	if(!buffer)
+		return;
 
+	Goffset pos=FileStream::getPos();
+	if(writeData(pos, buffer, length))
+		FileStream::setPos(pos+length, 0);
 }
 
 bool FileStreamWriter::trim(size_t pos)
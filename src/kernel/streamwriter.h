@@ -80,6 +80,16 @@ public:
 	 * Otherwise result is unpredictable.
 	 */
 	virtual void putLine(const char * line, size_t length)=0;
+
+	/** Puts exactly length number of bytes at current position.
+	 * @param buffer Data buffer pointer.
+	 * @param length Number of bytes to be written.
+	 *
+	 * Same as putLine but no end of line marker is appended. This should be
+	 * used when data are written in several chunks (e.g. stream data
+	 * compressed on the fly).
+	 */
+	virtual void putBuffer(const char * buffer, size_t length)=0;
 	
 	/** Removes all data behind given position.
 	 * @param pos Stream offset from where to trim.
@@ -116,6 +126,21 @@ public:
  */
 class FileStreamWriter:  public StreamWriter, public FileStream
 {
+	/** File handle where all data are written.
+	 * May be NULL, in which case all write operations fail.
+	 */
+	FILE * out;
+
+	/** Writes given data at given file offset.
+	 * @param pos Absolute file offset.
+	 * @param data Data buffer.
+	 * @param length Number of bytes to write.
+	 *
+	 * Writes all bytes (partial writes are repeated) and flushes the file.
+	 * Errors are logged.
+	 * @return true if all data were written, false otherwise.
+	 */
+	bool writeData(Goffset pos, const char * data, size_t length);
 public:
 	/** Costructor.
 	 * @param fA File handle for stream.
@@ -125,6 +150,8 @@ public:
 	 * @param lengthA Length of the stream (ignored if limitedA is false).
 	 * @param dictA Dictionary for the stream (should be initialized as NULL
 	 * object).
+	 * @param outA File handle opened for writing which refers to the same 
+	 * file as fA (GooFile is read only). If NULL, writing fails.
 	 *
 	 * Calls BaseStream and StreamWriter constructors with given dictA parameter
 	 * and initializes FileStream super type with fA, startA, limitedA and dictA
@@ -132,9 +159,10 @@ public:
 	 */
     //‘Fil:FileStream(FILE*&,    Guint&,       GBool&,         Guint&,       Object*&)’
 
-    FileStreamWriter(GooFile* fA, Goffset startA, GBool limitedA,  Goffset lengthA, Object *dictA)
+    FileStreamWriter(GooFile* fA, Goffset startA, GBool limitedA,  Goffset lengthA, Object *dictA, FILE * outA=NULL)
         :  StreamWriter(dictA, lengthA),
-          FileStream(fA, startA, limitedA, lengthA, dictA)
+          FileStream(fA, startA, limitedA, lengthA, dictA),
+          out(outA)
           {
 
           }
@@ -173,9 +201,19 @@ public:
 	 * Additionally flushes all changes to the file and position is moved after
 	 * inserted buffer.
 	 * Appends LF after given string.
-	 *
+	 * <br>
+	 * Write errors are logged and position is not changed in such case.
 	 */
 	virtual void putLine(const char * line, size_t length);
+
+	/** Puts exactly length number of bytes to the file.
+	 * @param buffer Data buffer pointer.
+	 * @param length Number of bytes to be written.
+	 *
+	 * Same as putLine without LF appending.
+	 * @see StreamWriter::putBuffer
+	 */
+	virtual void putBuffer(const char * buffer, size_t length);
 	
 	/** Removes all data behind given file offset position.
 	 * @param pos Stream offset where to start removing.
@@ -206,7 +244,8 @@ public:
 	 */
 	virtual void flush()const
 	{
-
+		if(out)
+			fflush(out);
 	}
 
 	/** Duplicates content to given file.
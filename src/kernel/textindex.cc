@@ -0,0 +1,559 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+
+#include "kernel/static.h"
+#include "kernel/textindex.h"
+#include "kernel/cpdf.h"
+#include "kernel/cpage.h"
+#include "kernel/xrefwriter.h"
+
+//=====================================================================================
+namespace pdfobjects {
+//=====================================================================================
+
+using namespace std;
+
+const char* TextIndex::FILE_MAGIC = "PDFEDIT-TEXTINDEX 1";
+
+namespace {
+
+	/** Ordering of hits by page and word position. */
+	struct HitOrder
+	{
+		size_t page;
+		size_t word;
+		TextIndex::Hit hit;
+		bool operator< (const HitOrder& other) const
+			{ return (page != other.page) ? page < other.page : word < other.word; }
+	};
+
+	/** Minimal size of a word line in the side file ("0 0 0 0 0\n"). */
+	const size_t MIN_WORD_LINE = 10;
+
+	/** Returns size of the stream and rewinds it to the beginning. */
+	std::streampos
+	stream_size (std::istream& in)
+	{
+		in.seekg (0, std::ios::end);
+		std::streampos end = in.tellg ();
+		in.seekg (0, std::ios::beg);
+		return end;
+	}
+
+	/** Returns number of bytes between the current position of the stream
+	 * and its end. */
+	size_t
+	remaining (std::istream& in, std::streampos end)
+	{
+		std::streampos pos = in.tellg ();
+		return (end > pos) ? static_cast<size_t> (end - pos) : 0;
+	}
+
+} // namespace
+
+//
+//
+//
+TextIndex::TextIndex (boost::shared_ptr<CPdf> pdf) 
+	: _pdf (pdf), _wd (new TextWatchDog (this)), _walked (false), _pagetreeversion (0)
+{
+	assert (pdf);
+}
+
+//
+//
+//
+TextIndex::~TextIndex ()
+{
+	for (Entries::const_iterator e = _entries.begin(); e != _entries.end(); ++e)
+		if (e->page)
+			e->page->unregisterTextObserver (_wd);
+}
+
+//
+//
+//
+void
+TextIndex::TextWatchDog::notify (boost::shared_ptr<CPage> page, 
+								 boost::shared_ptr<const observer::IChangeContext<CPage> >) const throw()
+{
+	try {
+		PageEntries::const_iterator it = _index->_pageentries.find (page.get());
+		if (it != _index->_pageentries.end())
+			_index->_dirty.insert (it->second);
+	}catch (std::exception&)
+	{
+		// page is checked by the next refresh
+		_index->_walked = false;
+	}
+}
+
+//
+//
+//
+boost::shared_ptr<CPdf>
+TextIndex::pdf () const
+{
+	boost::shared_ptr<CPdf> p = _pdf.lock ();
+	if (!p)
+		throw CObjInvalidOperation ();
+	return p;
+}
+
+//
+//
+//
+string
+TextIndex::normalize (const string& word)
+{
+	size_t begin = 0, end = word.length();
+	while (begin < end && static_cast<unsigned char>(word[begin]) < 128 && ispunct (word[begin]))
+		++begin;
+	while (end > begin && static_cast<unsigned char>(word[end - 1]) < 128 && ispunct (word[end - 1]))
+		--end;
+	
+	string term (word, begin, end - begin);
+	for (string::iterator it = term.begin(); it != term.end(); ++it)
+		if ('A' <= *it && *it <= 'Z')
+			*it = *it - 'A' + 'a';
+	return term;
+}
+
+//
+//
+//
+size_t
+TextIndex::add_entry (boost::shared_ptr<CPage> page, size_t pos)
+{
+	size_t entry;
+	if (_freeentries.empty())
+	{
+		entry = _entries.size();
+		_entries.push_back (PageEntry());
+	}else
+	{
+		entry = _freeentries.back();
+		_freeentries.pop_back();
+	}
+
+	_entries[entry].page = page;
+	_entries[entry].pos = pos;
+	_entries[entry].version = 0;
+	_entries[entry].words.clear ();
+	_entries[entry].terms.clear ();
+	_pageentries[page.get()] = entry;
+	page->registerTextObserver (_wd);
+	return entry;
+}
+
+//
+//
+//
+void
+TextIndex::remove_entry (size_t entry)
+{
+	PageEntry& e = _entries[entry];
+	unindex_entry (entry);
+	e.page->unregisterTextObserver (_wd);
+	_pageentries.erase (e.page.get());
+	_dirty.erase (entry);
+	e.page.reset ();
+	_freeentries.push_back (entry);
+}
+
+//
+//
+//
+void
+TextIndex::index_entry (size_t entry)
+{
+	PageEntry& e = _entries[entry];
+	const CPageContents::Words& words = e.words;
+	for (size_t i = 0; i < words.size(); ++i)
+	{
+		if (words[i].text.empty())
+			continue;
+		Terms::value_type& term = *_terms.insert (Terms::value_type (words[i].text, Postings())).first;
+		// postings of the entry are appended together, so the term is new
+		// for the entry if the last posting belongs to other entry
+		if (term.second.empty() || term.second.back().entry != entry)
+			e.terms.push_back (&term);
+		Posting posting = {entry, i};
+		term.second.push_back (posting);
+	}
+}
+
+//
+//
+//
+void
+TextIndex::unindex_entry (size_t entry)
+{
+	PageEntry& e = _entries[entry];
+	for (std::vector<Terms::value_type*>::const_iterator it = e.terms.begin(); it != e.terms.end(); ++it)
+	{
+		Postings& postings = (*it)->second;
+		Postings::iterator last = postings.begin();
+		for (Postings::iterator p = postings.begin(); p != postings.end(); ++p)
+			if (p->entry != entry)
+				*last++ = *p;
+		postings.erase (last, postings.end());
+		if (postings.empty())
+			_terms.erase (_terms.find ((*it)->first));
+	}
+	e.terms.clear ();
+	e.words.clear ();
+}
+
+//
+//
+//
+void
+TextIndex::clear ()
+{
+	for (Entries::const_iterator e = _entries.begin(); e != _entries.end(); ++e)
+		if (e->page)
+			e->page->unregisterTextObserver (_wd);
+	Entries ().swap (_entries);
+	_freeentries.clear ();
+	_pageentries.clear ();
+	_terms.clear ();
+	_dirty.clear ();
+	_walked = false;
+}
+
+//
+//
+//
+void
+TextIndex::build_entry (size_t entry)
+{
+	PageEntry& e = _entries[entry];
+		kernelPrintDbg (debug::DBG_DBG, "Indexing page at pos=" << e.pos);
+
+	e.page->getTextWords (e.words);
+	for (CPageContents::Words::iterator it = e.words.begin(); it != e.words.end(); ++it)
+		it->text = normalize (it->text);
+	// version after the extraction, the extraction itself may change it
+	e.version = e.page->getTextVersion ();
+	index_entry (entry);
+}
+
+//
+//
+//
+void
+TextIndex::refresh ()
+{
+	boost::shared_ptr<CPdf> p = pdf ();
+	std::vector<bool> seen (_entries.size(), false);
+
+	size_t count = p->getPageCount ();
+	for (size_t pos = 1; pos <= count; ++pos)
+	{
+		boost::shared_ptr<CPage> page = p->getPage (pos);
+		PageEntries::iterator it = _pageentries.find (page.get());
+		if (it == _pageentries.end())
+		{
+			size_t entry = add_entry (page, pos);
+			build_entry (entry);
+			if (seen.size() <= entry)
+				seen.resize (entry + 1, false);
+			seen[entry] = true;
+			continue;
+		}
+
+		size_t entry = it->second;
+		_entries[entry].pos = pos;
+		seen[entry] = true;
+		if (_entries[entry].version != page->getTextVersion())
+		{
+			unindex_entry (entry);
+			build_entry (entry);
+		}
+	}
+
+	// drop removed pages
+	for (size_t entry = 0; entry < seen.size(); ++entry)
+		if (!seen[entry] && _entries[entry].page)
+			remove_entry (entry);
+
+	// all changes have been handled
+	_dirty.clear ();
+	_walked = true;
+	_pagetreeversion = p->getPageTreeVersion ();
+}
+
+//
+//
+//
+void
+TextIndex::update ()
+{
+	boost::shared_ptr<CPdf> p = pdf ();
+	if (!_walked || _pagetreeversion != p->getPageTreeVersion ())
+	{
+		refresh ();
+		return;
+	}
+
+	// only pages reported by the watchdog
+	std::set<size_t> dirty;
+	dirty.swap (_dirty);
+	for (std::set<size_t>::const_iterator it = dirty.begin(); it != dirty.end(); ++it)
+	{
+		PageEntry& e = _entries[*it];
+		// extraction itself changes the version, so it may be up to date
+		if (!e.page || e.version == e.page->getTextVersion())
+			continue;
+		unindex_entry (*it);
+		build_entry (*it);
+	}
+}
+
+//
+//
+//
+size_t
+TextIndex::search (const string& text, Hits& hits)
+{
+	hits.clear ();
+	update ();
+
+	// split to terms
+	std::vector<string> terms;
+	{
+		std::istringstream words (text);
+		string word;
+		while (words >> word)
+		{
+			string term = normalize (word);
+			if (!term.empty())
+				terms.push_back (term);
+		}
+	}
+	if (terms.empty())
+		return 0;
+
+	Terms::const_iterator first = _terms.find (terms.front());
+	if (first == _terms.end())
+		return 0;
+
+	std::vector<HitOrder> found;
+	for (Postings::const_iterator p = first->second.begin(); p != first->second.end(); ++p)
+	{
+		const PageEntry& e = _entries[p->entry];
+		if (p->word + terms.size() > e.words.size())
+			continue;
+
+		// other terms have to follow
+		bool match = true;
+		libs::Rectangle bbox = e.words[p->word].bbox;
+		for (size_t i = 1; i < terms.size() && match; ++i)
+		{
+			const CPageContents::Word& word = e.words[p->word + i];
+			match = (word.text == terms[i]);
+			bbox = libs::rectangle_merge (bbox, word.bbox);
+		}
+		if (!match)
+			continue;
+
+		HitOrder hit;
+		hit.page = e.pos;
+		hit.word = p->word;
+		hit.hit.page = e.pos;
+		hit.hit.bbox = bbox;
+		found.push_back (hit);
+	}
+
+	std::sort (found.begin(), found.end());
+	hits.reserve (found.size());
+	for (std::vector<HitOrder>::const_iterator it = found.begin(); it != found.end(); ++it)
+		hits.push_back (it->hit);
+	return hits.size();
+}
+
+//
+//
+//
+string
+TextIndex::getDocumentKey () const
+{
+	boost::shared_ptr<CPdf> p = pdf ();
+	std::ostringstream key;
+
+	boost::shared_ptr<const CDict> trailer = p->getTrailer ();
+	if (trailer && trailer->containsProperty ("ID"))
+	{
+		string id;
+		trailer->getProperty ("ID")->getStringRepresentation (id);
+		key << id;
+	}
+
+	// sizes of revisions change whenever anything is saved to the file
+	XRefWriter* xref = dynamic_cast<XRefWriter*> (p->getCXref());
+	size_t revisions = p->getRevisionsCount ();
+	key << " revisions " << revisions;
+	if (xref)
+		for (size_t rev = 0; rev < revisions; ++rev)
+			key << " " << xref->getRevisionSize (rev, true);
+	return key.str();
+}
+
+//
+//
+//
+bool
+TextIndex::save (const string& fileName)
+{
+	boost::shared_ptr<CPdf> p = pdf ();
+	if (p->isChanged())
+	{
+		kernelPrintDbg (debug::DBG_WARN, "Document has unsaved changes. Index is not saved.");
+		return false;
+	}
+	update ();
+
+	std::ofstream out (fileName.c_str(), std::ios::out | std::ios::binary);
+	if (!out)
+	{
+		kernelPrintDbg (debug::DBG_ERR, "Unable to open " << fileName);
+		return false;
+	}
+	out.precision (17);
+
+	out << FILE_MAGIC << "\n";
+	out << getDocumentKey () << "\n";
+	for (Entries::const_iterator e = _entries.begin(); e != _entries.end(); ++e)
+	{
+		if (!e->page)
+			continue;
+		IndiRef ref = e->page->getDictionary()->getIndiRef ();
+		out << "page " << e->pos << " " << ref.num << " " << ref.gen << " " << e->words.size() << "\n";
+		for (CPageContents::Words::const_iterator w = e->words.begin(); w != e->words.end(); ++w)
+			out << w->bbox.xleft << " " << w->bbox.yleft << " " << w->bbox.xright << " " << w->bbox.yright 
+				<< " " << w->text.length() << " " << w->text << "\n";
+	}
+	
+	return out.good();
+}
+
+//
+//
+//
+bool
+TextIndex::load (const string& fileName)
+{
+	boost::shared_ptr<CPdf> p = pdf ();
+	std::ifstream in (fileName.c_str(), std::ios::in | std::ios::binary);
+	if (!in)
+		return false;
+	const std::streampos size = stream_size (in);
+
+	string line;
+	if (!getline (in, line) || line != FILE_MAGIC)
+	{
+		kernelPrintDbg (debug::DBG_WARN, fileName << " is not a text index file.");
+		return false;
+	}
+	if (!getline (in, line) || line != getDocumentKey())
+	{
+		kernelPrintDbg (debug::DBG_INFO, fileName << " belongs to other document.");
+		return false;
+	}
+
+	size_t count = p->getPageCount ();
+	string tag;
+	while (in >> tag)
+	{
+		size_t pos, words;
+		IndiRef ref;
+		if ("page" != tag || !(in >> pos >> ref.num >> ref.gen >> words))
+		{
+			kernelPrintDbg (debug::DBG_ERR, "Corrupted text index file " << fileName);
+			clear ();
+			return false;
+		}
+
+		// counts are checked against the file size so that a damaged file
+		// can't make us allocate more than it can contain
+		if (words > remaining (in, size) / MIN_WORD_LINE)
+		{
+			kernelPrintDbg (debug::DBG_ERR, "Corrupted text index file " << fileName);
+			clear ();
+			return false;
+		}
+		PageEntry e;
+		e.words.resize (words);
+		for (CPageContents::Words::iterator w = e.words.begin(); w != e.words.end(); ++w)
+		{
+			size_t length;
+			if (!(in >> w->bbox.xleft >> w->bbox.yleft >> w->bbox.xright >> w->bbox.yright >> length))
+				break;
+			in.get ();
+			if (length > remaining (in, size))
+			{
+				in.setstate (std::ios::failbit);
+				break;
+			}
+			w->text.resize (length);
+			if (length)
+				in.read (&w->text[0], length);
+		}
+		if (!in)
+		{
+			kernelPrintDbg (debug::DBG_ERR, "Corrupted text index file " << fileName);
+			clear ();
+			return false;
+		}
+
+		// page has to be at the same position
+		if (pos < 1 || pos > count)
+			continue;
+		boost::shared_ptr<CPage> page = p->getPage (pos);
+		IndiRef pageRef = page->getDictionary()->getIndiRef ();
+		if (!(pageRef == ref))
+			continue;
+
+		PageEntries::iterator it = _pageentries.find (page.get());
+		size_t entry;
+		if (it == _pageentries.end())
+			entry = add_entry (page, pos);
+		else
+		{
+			entry = it->second;
+			unindex_entry (entry);
+		}
+		_entries[entry].words.swap (e.words);
+		_entries[entry].version = page->getTextVersion ();
+		index_entry (entry);
+	}
+	
+	return true;
+}
+
+//=====================================================================================
+} // namespace pdfobjects
+//=====================================================================================
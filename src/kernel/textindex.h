@@ -0,0 +1,247 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+#ifndef _TEXTINDEX_H_
+#define _TEXTINDEX_H_
+
+#include "kernel/static.h"
+#include "kernel/cpagecontents.h"
+#include <boost/unordered_map.hpp>
+
+//=====================================================================================
+namespace pdfobjects {
+//=====================================================================================
+
+class CPdf;
+class CPage;
+
+/**
+ * Document wide full-text index.
+ *
+ * Maps normalized terms (words) to their occurrences (page and bounding box)
+ * in the whole document, so a document can be searched without displaying
+ * all its pages again. Index is built from words of page text layers (see
+ * CPageContents::getTextWords).
+ * <br>
+ * Index is updated incrementally from change notifications. Indexed pages 
+ * are observed (see CPage::registerTextObserver) and only pages whose text
+ * changed are indexed again by the next search. Pages are walked again 
+ * (and added or removed pages indexed or dropped) only when the page tree 
+ * changes (see CPdf::getPageTreeVersion) or when refresh is called.
+ * <br>
+ * Index can be saved to a side file and loaded when the document is opened
+ * again. The file is keyed by the document identifier and sizes of its 
+ * revisions, so an index of a different (or changed) document is never 
+ * used.
+ *
+ * <pre>
+ * TextIndex index (pdf);
+ * TextIndex::Hits hits;
+ * if (!index.load (indexFile))
+ *     index.save (indexFile);
+ * index.search ("word", hits);
+ * </pre>
+ */
+class TextIndex : noncopyable
+{
+	// Typedefs
+public:
+	/** Occurrence of a searched text. */
+	struct Hit
+	{
+		/** Page position. */
+		size_t page;
+		/** Bounding box (of all words of a phrase). */
+		libs::Rectangle bbox;
+	};
+	typedef std::vector<Hit> Hits;
+
+	/** Magic string at the beginning of the side file. */
+	static const char* FILE_MAGIC;
+
+private:
+	/** Occurrence of a term. */
+	struct Posting
+	{
+		size_t entry;
+		size_t word;
+	};
+	typedef std::vector<Posting> Postings;
+	typedef boost::unordered_map<std::string, Postings> Terms;
+
+	/** Indexed page. */
+	struct PageEntry
+	{
+		/** Page (NULL if the entry is not used). */
+		boost::shared_ptr<CPage> page;
+		/** Page position from the last refresh. */
+		size_t pos;
+		/** Indexed text version of the page. */
+		size_t version;
+		/** Words of the page with normalized text. */
+		CPageContents::Words words;
+		/** Distinct terms of the page (elements of terms map are not moved
+		 * by rehashing and are erased only when they have no postings). */
+		std::vector<Terms::value_type*> terms;
+	};
+	typedef std::vector<PageEntry> Entries;
+
+	typedef std::map<const CPage*, size_t> PageEntries;
+
+	/** Observer which marks entries of pages with changed text. */
+	class TextWatchDog : public observer::IObserver<CPage>
+	{
+		TextIndex* _index;
+	public:
+		TextWatchDog (TextIndex* index) : _index (index) { assert (_index); }
+		virtual ~TextWatchDog() throw() {}
+		virtual void notify (boost::shared_ptr<CPage> page, boost::shared_ptr<const observer::IChangeContext<CPage> >) const throw();
+		virtual priority_t getPriority() const throw() 
+			{ return 0; }
+	};
+
+	// Variables
+private:
+	boost::weak_ptr<CPdf> _pdf;
+	Entries _entries;
+	std::vector<size_t> _freeentries;	// indices of unused entries
+	PageEntries _pageentries;			// page to entry mapping
+	Terms _terms;
+	boost::shared_ptr<TextWatchDog> _wd;
+	std::set<size_t> _dirty;			// entries with changed text
+	bool _walked;						// pages have been walked by refresh
+	size_t _pagetreeversion;			// page tree version of the last walk
+
+	// Ctor & Dtor
+public:
+	/**
+	 * Constructor. Nothing is indexed until the index is needed.
+	 * @param pdf Indexed document.
+	 */
+	TextIndex (boost::shared_ptr<CPdf> pdf);
+
+	/** Destructor. Stops observing pages. */
+	~TextIndex ();
+
+	//
+	// Methods
+	//
+public:
+	/**
+	 * Walks all pages and brings the index up to date.
+	 * Search does this automatically only when the page tree changes.
+	 */
+	void refresh ();
+
+	/**
+	 * Finds all occurrences of a text.
+	 *
+	 * Text is split to terms by white spaces, more terms are searched as a
+	 * phrase (terms have to follow each other on the same page).
+	 *
+	 * @param text Text to search.
+	 * @param hits Output container of occurrences ordered by pages.
+	 * @return Number of occurrences.
+	 */
+	size_t search (const std::string& text, Hits& hits);
+
+	/**
+	 * Returns number of distinct indexed terms.
+	 */
+	size_t getTermCount () const
+		{ return _terms.size(); }
+
+	/**
+	 * Saves the index to a side file.
+	 *
+	 * Index of a document with unsaved changes is not saved because it would
+	 * not match the document when it is opened again.
+	 *
+	 * @param fileName Side file name.
+	 * @return true if the index was saved, false otherwise.
+	 */
+	bool save (const std::string& fileName);
+
+	/**
+	 * Loads the index from a side file.
+	 *
+	 * Nothing is loaded if the file doesn't belong to the document (see
+	 * getDocumentKey). Pages which are not at the same position anymore are
+	 * indexed again by the next refresh.
+	 *
+	 * @param fileName Side file name.
+	 * @return true if the index was loaded, false otherwise.
+	 */
+	bool load (const std::string& fileName);
+
+	/**
+	 * Returns key identifying the document content.
+	 * Key consists of the document identifier from trailer and sizes of all 
+	 * revisions.
+	 */
+	std::string getDocumentKey () const;
+
+	/**
+	 * Normalizes a word to a term.
+	 * Ascii letters are lowered and ascii punctuation at both ends is removed.
+	 *
+	 * @param word Word to normalize.
+	 * @return Term (empty if there is nothing to index).
+	 */
+	static std::string normalize (const std::string& word);
+
+	//
+	// Helper methods
+	//
+private:
+	/** Returns indexed document. */
+	boost::shared_ptr<CPdf> pdf () const;
+
+	/** Indexes changed pages, walks all pages if the page tree changed. */
+	void update ();
+
+	/** Creates new entry for a page. */
+	size_t add_entry (boost::shared_ptr<CPage> page, size_t pos);
+
+	/** Removes entry of a page which is not in the document anymore. */
+	void remove_entry (size_t entry);
+
+	/** Adds entry words to terms. */
+	void index_entry (size_t entry);
+
+	/** Removes entry words from terms. */
+	void unindex_entry (size_t entry);
+
+	/** Extracts words of the entry page and indexes them. */
+	void build_entry (size_t entry);
+
+	/** Drops all entries and terms, pages are indexed by the next search. */
+	void clear ();
+};
+
+//=====================================================================================
+} // namespace pdfobjects
+//=====================================================================================
+
+#endif // _TEXTINDEX_H_
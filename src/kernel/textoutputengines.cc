@@ -95,10 +95,9 @@ namespace {
 		// Operator text -- needn't be real ascii chars
 		string text;
 		assert (1 == op.getParametersCount());
-		PdfOperator::Operands ops;
-		op.getParameters (ops);
+		const CompactOperands& ops = op.getCompactParameters ();
 		assert (1 == ops.size());
-		text = getStringFromIProperty (ops.front());
+		text = getStringFromIProperty (ops.getProperty (0));
 	
 		//
 		// Get real text from operators using xpdf (see the crazy code below)
@@ -226,10 +225,9 @@ namespace {
 			assert (s->getFont());
 			double fsize = s->getFontSize();
 			
-			PdfOperator::Operands ops;
-			op->getParameters (ops);
+			const CompactOperands& ops = op->getCompactParameters ();
 			assert (1 == ops.size());
-			boost::shared_ptr<CArray> array = IProperty::getSmartCObjectPtr<CArray> (ops.front());
+			boost::shared_ptr<CArray> array = IProperty::getSmartCObjectPtr<CArray> (ops.getProperty (0));
 			//
 			// Loop through TJ operands either strings or nums
 			//
@@ -410,6 +408,206 @@ SimpleLineEngine::LinePart::line_part (const PageLine& l, const PageFragment& f)
 }
 
 
+//
+// Line buckets
+//
+
+namespace {
+	// Bucket is split when it has twice as many lines
+	const static size_t LINE_BUCKET_SIZE = 32;
+}
+
+//
+//
+//
+SimpleLineEngine::LineBuckets::Extents::Extents ()
+	: max_top (-numeric_limits<double>::infinity()), 
+	  min_bottom (numeric_limits<double>::infinity()), 
+	  scan (false)
+{}
+
+//
+//
+//
+void
+SimpleLineEngine::LineBuckets::Extents::merge (const Extents& other)
+{
+	max_top = max (max_top, other.max_top);
+	min_bottom = min (min_bottom, other.min_bottom);
+	scan = scan || other.scan;
+}
+
+//
+// See LinePart::line_part, a line with yleft > yright decides about a word iff
+// yleft >= min y of the word, other lines iff yleft <= max y of the word
+//
+bool
+SimpleLineEngine::LineBuckets::Extents::skip (const PageFragment::BBox& b) const
+{
+	return !scan && max_top < min (b.yleft, b.yright) && min_bottom > max (b.yleft, b.yright);
+}
+
+//
+//
+//
+void
+SimpleLineEngine::LineBuckets::Bucket::update ()
+{
+	extents = Extents ();
+	for (PageLines::const_iterator it = lines.begin(); it != lines.end(); ++it)
+	{
+		BBox b = (*it)->bbox();
+		// Invalid bboxes are never part of anything but can be above a word
+		if (!BBox::isInitialized (b) || b.yleft != b.yleft || b.yright != b.yright)
+			extents.scan = true;
+		else if (b.yleft > b.yright)
+			extents.max_top = max (extents.max_top, b.yleft);
+		else
+			extents.min_bottom = min (extents.min_bottom, b.yleft);
+	}
+}
+
+//
+//
+//
+void
+SimpleLineEngine::LineBuckets::add (PageFragmentPtr f)
+{
+	const BBox b = f->bbox();
+	for (size_t bucket = find (0, b); bucket < _buckets.size(); bucket = find (bucket + 1, b))
+	{
+		PageLines& lines = _buckets[bucket]->lines;
+		for (PageLines::iterator itl = lines.begin(); itl != lines.end(); ++itl)
+		{
+			LinePart::result is_part = LinePart::line_part (*(*itl), *f);
+			
+			// Insert f into exsting line
+			if (LinePart::is_part == is_part)
+			{
+				(*itl)->push_back (f);
+				update (bucket);
+				return;
+		
+			// Create new line before existing one
+			}else if (LinePart::was_part == is_part)
+			{
+				itl = lines.insert (itl, PageLinePtr (new PageLine));
+				(*itl)->push_back (f);
+				update (bucket);
+				split (bucket);
+				return;
+			}
+		}
+	}
+
+	//	Not part make new line at the end
+	if (_buckets.empty())
+	{
+		_buckets.push_back (BucketPtr (new Bucket));
+		rebuild ();
+	}
+	_buckets.back()->lines.push_back (PageLinePtr (new PageLine));
+	_buckets.back()->lines.back()->push_back (f);
+	update (_buckets.size() - 1);
+	split (_buckets.size() - 1);
+}
+
+//
+//
+//
+void
+SimpleLineEngine::LineBuckets::split (size_t bucket)
+{
+	Bucket& first = *_buckets[bucket];
+	if (first.lines.size() < 2 * LINE_BUCKET_SIZE)
+		return;
+
+	BucketPtr second (new Bucket);
+	second->lines.assign (first.lines.begin() + LINE_BUCKET_SIZE, first.lines.end());
+	first.lines.resize (LINE_BUCKET_SIZE);
+	first.update ();
+	second->update ();
+	_buckets.insert (_buckets.begin() + bucket + 1, second);
+	rebuild ();
+}
+
+//
+//
+//
+void
+SimpleLineEngine::LineBuckets::update (size_t bucket)
+{
+	_buckets[bucket]->update ();
+	size_t node = _leaves + bucket;
+	_tree[node] = _buckets[bucket]->extents;
+	for (node /= 2; node > 0; node /= 2)
+	{
+		_tree[node] = _tree[2 * node];
+		_tree[node].merge (_tree[2 * node + 1]);
+	}
+}
+
+//
+// Buckets are inserted only when a bucket is split (at most once per 
+// LINE_BUCKET_SIZE lines), so the whole tree is built again
+//
+void
+SimpleLineEngine::LineBuckets::rebuild ()
+{
+	for (_leaves = 1; _leaves < _buckets.size(); _leaves *= 2)
+		;
+	_tree.assign (2 * _leaves, Extents ());
+	for (size_t bucket = 0; bucket < _buckets.size(); ++bucket)
+		_tree[_leaves + bucket] = _buckets[bucket]->extents;
+	for (size_t node = _leaves - 1; node > 0; --node)
+	{
+		_tree[node] = _tree[2 * node];
+		_tree[node].merge (_tree[2 * node + 1]);
+	}
+}
+
+//
+//
+//
+size_t
+SimpleLineEngine::LineBuckets::find (size_t from, const PageFragment::BBox& b) const
+{
+	if (from >= _buckets.size())
+		return _buckets.size();
+	return find (1, 0, _leaves, from, b);
+}
+
+//
+// Leftmost leaf of the node subtree not before from which can't be skipped, 
+// unused leaves are empty so they are always skipped
+//
+size_t
+SimpleLineEngine::LineBuckets::find (size_t node, size_t begin, size_t end, size_t from, const PageFragment::BBox& b) const
+{
+	if (end <= from || _tree[node].skip (b))
+		return _buckets.size();
+	if (end - begin == 1)
+		return begin;
+
+	size_t middle = (begin + end) / 2;
+	size_t found = find (2 * node, begin, middle, from, b);
+	if (found < _buckets.size())
+		return found;
+	return find (2 * node + 1, middle, end, from, b);
+}
+
+//
+//
+//
+void
+SimpleLineEngine::LineBuckets::lines (PageLines& lines) const
+{
+	lines.clear ();
+	for (Buckets::const_iterator it = _buckets.begin(); it != _buckets.end(); ++it)
+		lines.insert (lines.end(), (*it)->lines.begin(), (*it)->lines.end());
+}
+
+
 //=====================================================================================
 } // namespace textoutput
 //=====================================================================================
@@ -29,6 +29,7 @@
 // basic types
 #include "kernel/static.h"
 #include <vector>
+#include <list>
 
 // output builder
 #include "kernel/textoutputentities.h"
@@ -129,6 +130,72 @@ private:
 		static result line_part (const PageLine& l, const PageFragment& f);
 	};
 
+	/**
+	 * Lines in their output order split into small buckets.
+	 *
+	 * Each bucket knows the y extents of its lines and a segment tree over
+	 * buckets merges extents of consecutive buckets, so the first bucket 
+	 * with a line which could decide about a word (see LinePart) is found 
+	 * in O(log n). Words are placed exactly as if all lines were tried in 
+	 * order.
+	 */
+	class LineBuckets
+	{
+		/** Y extents of lines which decide about words. */
+		struct Extents
+		{
+			double max_top;		/**< Max yleft of lines with yleft > yright. */
+			double min_bottom;	/**< Min yleft of other lines. */
+			bool scan;			/**< Contains lines which have to be always tried. */
+
+			/** Empty extents (skip everything). */
+			Extents ();
+			/** Add extents of other lines. */
+			void merge (const Extents& other);
+			/** True if no line can decide about a word with this bbox. */
+			bool skip (const PageFragment::BBox& b) const;
+		};
+
+		/** Bucket of consecutive lines. */
+		struct Bucket
+		{
+			PageLines lines;
+			Extents extents;
+
+			/** Recompute extents. */
+			void update ();
+		};
+		typedef boost::shared_ptr<Bucket> BucketPtr;
+		typedef std::vector<BucketPtr> Buckets;
+
+		Buckets _buckets;
+		/** Segment tree of bucket extents. Node i has children 2i and 2i+1,
+		 * bucket i is the leaf _leaves + i. */
+		std::vector<Extents> _tree;
+		size_t _leaves;
+
+	public:
+		LineBuckets () : _leaves (0) {}
+		/** Put the word into a line (or a new line). */
+		void add (PageFragmentPtr f);
+		/** Return all lines in order. */
+		void lines (PageLines& lines) const;
+
+	private:
+		/** Split the bucket if it is too big. */
+		void split (size_t bucket);
+		/** Update extents of the bucket and its tree nodes. */
+		void update (size_t bucket);
+		/** Rebuild the whole tree when buckets are inserted. */
+		void rebuild ();
+		/** Return the first bucket not before from which can decide about a 
+		 * word with this bbox (number of buckets if there is none). */
+		size_t find (size_t from, const PageFragment::BBox& b) const;
+		size_t find (size_t node, size_t begin, size_t end, size_t from, const PageFragment::BBox& b) const;
+	};
+
+	LineBuckets _buckets;
+
 	//
 	// Page source functor
 	//
@@ -141,37 +208,8 @@ public:
 		// Loop through all words and group them into lines
 		//
 		for (typename WordEngine::Iterator itw = w.begin(); itw != w.end(); ++itw)
-		{
-			PageLines::iterator itl;
-			LinePart::result 	is_part = LinePart::not_part;
-
-			// Find appropriate place
-			for (itl = _lines.begin(); itl != _lines.end(); ++itl)
-			{
-				is_part = LinePart::line_part (*(*itl), *(*itw));
-				if (LinePart::not_part != is_part)
-					break;
-			}
-			
-			// Insert itw into exsting line
-			if (LinePart::is_part == is_part)
-			{
-				(*itl)->push_back (*itw);
-		
-			// Create new line before existing one
-			}else if (LinePart::was_part == is_part)
-			{
-				itl = _lines.insert (itl, PageLinePtr (new PageLine));
-				(*itl)->push_back (*itw);
-
-			//	Not part make new line at the end
-			}else if (LinePart::not_part == is_part)
-			{
-				_lines.push_back (PageLinePtr (new PageLine));
-				_lines.back()->push_back (*itw);
-			}
-
-		}// for (WordEngine::Iterator itl = w.begin(); itl != w.end(); ++itl)
+			_buckets.add (*itw);
+		_buckets.lines (_lines);
 	
 		//
 		// Sort words in lines
@@ -0,0 +1,341 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+
+#include "kernel/static.h"
+#include "kernel/textsearch.h"
+
+//=====================================================================================
+namespace pdfobjects {
+//=====================================================================================
+
+using namespace std;
+
+namespace {
+
+	/** Replacement character for invalid UTF-8 sequences. */
+	const ::Unicode REPLACEMENT_CHAR = 0xFFFD;
+
+	/** Compares transitions by their characters. */
+	struct TransitionLess
+	{
+		bool operator() (const pair< ::Unicode, size_t>& t, ::Unicode c) const
+			{ return t.first < c; }
+	};
+
+} // namespace
+
+//
+//
+//
+TextSearch::TextSearch (const vector<string>& patterns, bool caseSensitive)
+	: _states (1), _caseSensitive (caseSensitive)
+{
+	_lengths.reserve (patterns.size());
+	for (size_t i = 0; i < patterns.size(); ++i)
+	{
+		// Not UTF-8 strings are taken as latin-1 (like findText did before)
+		Text decoded;
+		if (!decodeUtf8 (patterns[i], decoded))
+		{
+			decoded.clear ();
+			for (string::const_iterator c = patterns[i].begin(); c != patterns[i].end(); ++c)
+				decoded.push_back (static_cast<unsigned char> (*c));
+		}
+
+		// Normalize white spaces and case
+		Text pattern;
+		for (Text::const_iterator it = decoded.begin(); it != decoded.end(); ++it)
+		{
+			if (isSpace (*it))
+			{
+				if (!pattern.empty() && ' ' != pattern.back())
+					pattern.push_back (' ');
+				continue;
+			}
+			pattern.push_back (_caseSensitive ? *it : fold (*it));
+		}
+		if (!pattern.empty() && ' ' == pattern.back())
+			pattern.pop_back ();
+
+		_lengths.push_back (pattern.size());
+		if (!pattern.empty())
+			add_pattern (pattern, i);
+	}
+	build_links ();
+	kernelPrintDbg (debug::DBG_DBG, "Patterns: " << patterns.size() << " states: " << _states.size());
+}
+
+//
+//
+//
+size_t
+TextSearch::transition (size_t state, ::Unicode c) const
+{
+	const State::Transitions& next = _states[state].next;
+	State::Transitions::const_iterator it = lower_bound (next.begin(), next.end(), c, TransitionLess());
+	if (it == next.end() || it->first != c)
+		return NO_STATE;
+	return it->second;
+}
+
+//
+//
+//
+void
+TextSearch::add_pattern (const Text& pattern, size_t index)
+{
+	size_t state = 0;
+	for (Text::const_iterator c = pattern.begin(); c != pattern.end(); ++c)
+	{
+		State::Transitions& next = _states[state].next;
+		State::Transitions::iterator it = lower_bound (next.begin(), next.end(), *c, TransitionLess());
+		if (it != next.end() && it->first == *c)
+		{
+			state = it->second;
+			continue;
+		}
+		size_t newstate = _states.size();
+		next.insert (it, make_pair (*c, newstate));
+		// next must not be used after the push
+		_states.push_back (State());
+		state = newstate;
+	}
+	_states[state].patterns.push_back (index);
+}
+
+//
+//
+//
+void
+TextSearch::build_links ()
+{
+	// Breadth first, failure of a state is always closer to the root
+	deque<size_t> queue;
+	const State::Transitions& root = _states[0].next;
+	for (State::Transitions::const_iterator it = root.begin(); it != root.end(); ++it)
+	{
+		_states[it->second].fail = 0;
+		queue.push_back (it->second);
+	}
+
+	while (!queue.empty())
+	{
+		size_t state = queue.front();
+		queue.pop_front ();
+
+		const State::Transitions& next = _states[state].next;
+		for (State::Transitions::const_iterator it = next.begin(); it != next.end(); ++it)
+		{
+			size_t child = it->second;
+			size_t fail = _states[state].fail;
+			while (fail && NO_STATE == transition (fail, it->first))
+				fail = _states[fail].fail;
+			size_t target = transition (fail, it->first);
+			_states[child].fail = (NO_STATE == target) ? 0 : target;
+
+			const State& failstate = _states[_states[child].fail];
+			_states[child].outlink = failstate.patterns.empty() ? failstate.outlink : _states[child].fail;
+			queue.push_back (child);
+		}
+	}
+}
+
+//
+//
+//
+size_t
+TextSearch::search (const Text& text, Matches& matches, bool wholeWord) const
+{
+	matches.clear ();
+	// end of the last occurrence of each pattern
+	vector<size_t> lastEnd (_lengths.size(), 0);
+
+	size_t state = 0;
+	for (size_t i = 0; i < text.size(); ++i)
+	{
+		// line breaks never match, other spaces are normalized like in patterns
+		::Unicode c = text[i];
+		if ('\n' != c && isSpace (c))
+			c = ' ';
+		else if (!_caseSensitive)
+			c = fold (c);
+
+		size_t next;
+		while (NO_STATE == (next = transition (state, c)) && state)
+			state = _states[state].fail;
+		state = (NO_STATE == next) ? 0 : next;
+
+		size_t out = _states[state].patterns.empty() ? _states[state].outlink : state;
+		for (; NO_STATE != out; out = _states[out].outlink)
+		{
+			const vector<size_t>& patterns = _states[out].patterns;
+			for (vector<size_t>::const_iterator p = patterns.begin(); p != patterns.end(); ++p)
+			{
+				Match match;
+				match.pattern = *p;
+				match.end = i + 1;
+				match.begin = match.end - _lengths[*p];
+				if (match.begin < lastEnd[*p])
+					continue;
+				if (wholeWord)
+				{
+					if (match.begin > 0 && isWordChar (text[match.begin - 1]))
+						continue;
+					if (match.end < text.size() && isWordChar (text[match.end]))
+						continue;
+				}
+				lastEnd[*p] = match.end;
+				matches.push_back (match);
+			}
+		}
+	}
+
+	return matches.size();
+}
+
+//
+//
+//
+bool
+TextSearch::decodeUtf8 (const string& str, Text& text)
+{
+	bool result = true;
+	text.clear ();
+	text.reserve (str.length());
+	size_t i = 0;
+	while (i < str.length())
+	{
+		unsigned char b = static_cast<unsigned char> (str[i]);
+		size_t extra;
+		::Unicode c;
+		if (b < 0x80)
+			{ c = b; extra = 0; }
+		else if (0xC0 == (b & 0xE0))
+			{ c = b & 0x1F; extra = 1; }
+		else if (0xE0 == (b & 0xF0))
+			{ c = b & 0x0F; extra = 2; }
+		else if (0xF0 == (b & 0xF8))
+			{ c = b & 0x07; extra = 3; }
+		else
+		{
+			text.push_back (REPLACEMENT_CHAR);
+			result = false;
+			++i;
+			continue;
+		}
+
+		bool valid = (i + extra < str.length());
+		for (size_t j = 1; valid && j <= extra; ++j)
+		{
+			unsigned char cont = static_cast<unsigned char> (str[i + j]);
+			valid = (0x80 == (cont & 0xC0));
+			c = (c << 6) | (cont & 0x3F);
+		}
+		if (!valid)
+		{
+			text.push_back (REPLACEMENT_CHAR);
+			result = false;
+			++i;
+			continue;
+		}
+		text.push_back (c);
+		i += extra + 1;
+	}
+	return result;
+}
+
+//
+//
+//
+::Unicode
+TextSearch::fold (::Unicode c)
+{
+	// Basic latin and latin-1
+	if (c < 0x80)
+		return ('A' <= c && c <= 'Z') ? c + 32 : c;
+	if (c < 0x100)
+		return (0xC0 <= c && c <= 0xDE && 0xD7 != c) ? c + 32 : c;
+	
+	// Latin extended-A (upper and lower case letters are in pairs)
+	if (c < 0x180)
+	{
+		if (0x130 == c)
+			return 'i';
+		if (0x178 == c)
+			return 0xFF;
+		if ((0x100 <= c && c <= 0x137) || (0x14A <= c && c <= 0x177))
+			return c | 1;
+		if ((0x139 <= c && c <= 0x148) || (0x179 <= c && c <= 0x17E))
+			return (c & 1) ? c + 1 : c;
+		return c;
+	}
+
+	// Greek
+	if (0x391 <= c && c <= 0x3A9 && 0x3A2 != c)
+		return c + 32;
+	if (0x3C2 == c)
+		return 0x3C3;
+	
+	// Cyrillic
+	if (0x410 <= c && c <= 0x42F)
+		return c + 32;
+	if (0x400 <= c && c <= 0x40F)
+		return c + 80;
+	
+	return c;
+}
+
+//
+//
+//
+bool
+TextSearch::isSpace (::Unicode c)
+{
+	return ' ' == c || '\t' == c || '\n' == c || '\r' == c || '\f' == c || '\v' == c
+		|| 0xA0 == c || (0x2000 <= c && c <= 0x200B) || 0x3000 == c;
+}
+
+//
+//
+//
+bool
+TextSearch::isWordChar (::Unicode c)
+{
+	if (c < 0x80)
+		return isalnum (static_cast<int> (c));
+	if (isSpace (c))
+		return false;
+	// Latin-1 punctuation and symbols
+	if ((0xA1 <= c && c <= 0xBF) || 0xD7 == c || 0xF7 == c)
+		return false;
+	// General punctuation
+	if (0x2010 <= c && c <= 0x205E)
+		return false;
+	return true;
+}
+
+//=====================================================================================
+} // namespace pdfobjects
+//=====================================================================================
@@ -0,0 +1,172 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+#ifndef _TEXTSEARCH_H_
+#define _TEXTSEARCH_H_
+
+#include "kernel/static.h"
+
+//=====================================================================================
+namespace pdfobjects {
+//=====================================================================================
+
+/**
+ * Multi pattern text search.
+ *
+ * Aho-Corasick automaton built from a set of patterns which finds all 
+ * occurrences of all patterns in one pass through a text. Patterns are 
+ * given in UTF-8 and text is searched as a sequence of unicode characters
+ * (e.g. page text layer, see CPageContents::findText). 
+ * <br>
+ * If the search is not case sensitive, both patterns and the text are case
+ * folded (simple one to one folding of latin, greek and cyrillic letters).
+ * White spaces in patterns are normalized to a single space.
+ * <br>
+ * Automaton is immutable after construction so one instance can be used to
+ * search many pages (even concurrently).
+ */
+class TextSearch : noncopyable
+{
+	// Typedefs
+public:
+	/** Unicode text. */
+	typedef std::vector< ::Unicode> Text;
+
+	/** Occurrence of a pattern. */
+	struct Match
+	{
+		/** Index of the pattern. */
+		size_t pattern;
+		/** Position of the first character in the text. */
+		size_t begin;
+		/** Position after the last character in the text. */
+		size_t end;
+	};
+	typedef std::vector<Match> Matches;
+
+private:
+	/** Automaton state. */
+	struct State
+	{
+		/** Transitions sorted by characters. */
+		typedef std::vector<std::pair< ::Unicode, size_t> > Transitions;
+		Transitions next;
+		/** Failure transition. */
+		size_t fail;
+		/** Nearest state on the failure path with output (or NO_STATE). */
+		size_t outlink;
+		/** Patterns which end in this state. */
+		std::vector<size_t> patterns;
+
+		State () : fail (0), outlink (NO_STATE) {}
+	};
+	typedef std::vector<State> States;
+
+	static const size_t NO_STATE = static_cast<size_t>(-1);
+
+	// Variables
+private:
+	States _states;
+	std::vector<size_t> _lengths;	// pattern lengths in characters
+	bool _caseSensitive;
+
+	// Ctor & Dtor
+public:
+	/**
+	 * Builds the automaton.
+	 *
+	 * @param patterns Patterns in UTF-8 (empty patterns never match, strings
+	 * which are not valid UTF-8 are taken as latin-1).
+	 * @param caseSensitive Match letter case.
+	 */
+	TextSearch (const std::vector<std::string>& patterns, bool caseSensitive = false);
+
+	//
+	// Methods
+	//
+public:
+	/**
+	 * Finds all occurrences of all patterns.
+	 *
+	 * Matches are ordered by their end positions. Occurrences of the same 
+	 * pattern don't overlap (the leftmost one wins).
+	 *
+	 * @param text Text to search.
+	 * @param matches Output container.
+	 * @param wholeWord Only matches which are not part of a bigger word.
+	 * @return Number of matches.
+	 */
+	size_t search (const Text& text, Matches& matches, bool wholeWord = false) const;
+
+	/** Returns number of patterns. */
+	size_t getPatternCount () const
+		{ return _lengths.size(); }
+
+	/** Returns true if the search is case sensitive. */
+	bool isCaseSensitive () const
+		{ return _caseSensitive; }
+
+	//
+	// Helper functions
+	//
+public:
+	/**
+	 * Decodes UTF-8 string. 
+	 * Invalid sequences are decoded as replacement characters.
+	 *
+	 * @param str UTF-8 string.
+	 * @param text Output text.
+	 * @return False if there was an invalid sequence.
+	 */
+	static bool decodeUtf8 (const std::string& str, Text& text);
+
+	/**
+	 * Returns simple case folding of a character.
+	 */
+	static ::Unicode fold (::Unicode c);
+
+	/**
+	 * Returns true for characters which can be part of a word.
+	 */
+	static bool isWordChar (::Unicode c);
+
+	/**
+	 * Returns true for white space characters.
+	 */
+	static bool isSpace (::Unicode c);
+
+private:
+	/** Returns transition of the state or NO_STATE. */
+	size_t transition (size_t state, ::Unicode c) const;
+	/** Adds the pattern to the trie. */
+	void add_pattern (const Text& pattern, size_t index);
+	/** Computes failure and output links. */
+	void build_links ();
+};
+
+//=====================================================================================
+} // namespace pdfobjects
+//=====================================================================================
+
+#endif // _TEXTSEARCH_H_
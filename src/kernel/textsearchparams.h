@@ -43,7 +43,10 @@ namespace pdfobjects {
 /** 
  * Text search parameters. 
  *
- * These parameters are used by xpdf when serching a text string.
+ * These parameters are used when serching a text string. Coordinates are
+ * the same as of found rectangles. Like in xpdf, start and stop positions
+ * are positions in the reading order. Search is restricted to the region 
+ * only if the region is not empty.
  */
 typedef struct TextSearchParams
 {
@@ -51,13 +54,24 @@ typedef struct TextSearchParams
 	GBool startAtTop;		/**< Start searching from the top.    */
 	double xStart; 			/**< Start searching from x position. */
 	double yStart; 			/**< Start searching from y position. */
+	GBool stopAtBottom;		/**< Stop searching at the bottom.    */
 	double xEnd; 			/**< Stop searching from x position.  */
 	double yEnd; 			/**< Stop searching from y position.  */
+	double regionXLeft;		/**< Left x of the search region.     */
+	double regionYLeft;		/**< Left y of the search region.     */
+	double regionXRight;	/**< Right x of the search region.    */
+	double regionYRight;	/**< Right y of the search region.    */
+	GBool caseSensitive;	/**< Match letter case.               */
+	GBool wholeWord;		/**< Match only whole words.          */
 
 	/** Constructor. Default values are set. */
 	TextSearchParams () : 
 		startAtTop (DEFAULT_START_AT_TOP),
-		xStart (DEFAULT_X_START), yStart (DEFAULT_Y_START), xEnd (DEFAULT_X_END), yEnd (DEFAULT_Y_END)
+		xStart (DEFAULT_X_START), yStart (DEFAULT_Y_START), 
+		stopAtBottom (DEFAULT_STOP_AT_BOTTOM),
+		xEnd (DEFAULT_X_END), yEnd (DEFAULT_Y_END),
+		regionXLeft (0), regionYLeft (0), regionXRight (0), regionYRight (0),
+		caseSensitive (DEFAULT_CASE_SENSITIVE), wholeWord (DEFAULT_WHOLE_WORD)
 	{}
 
 	//
@@ -67,6 +81,9 @@ typedef struct TextSearchParams
 	// integral type compilator error))
 	//
 	static const GBool DEFAULT_START_AT_TOP = gTrue;	/**< Start at top. */
+	static const GBool DEFAULT_STOP_AT_BOTTOM = gTrue;	/**< Stop at bottom. */
+	static const GBool DEFAULT_CASE_SENSITIVE = gFalse;	/**< Ignore letter case. */
+	static const GBool DEFAULT_WHOLE_WORD = gFalse;		/**< Match also parts of words. */
 
 	static const int DEFAULT_X_START = 0;	/**< Default x position of left upper corner. */
 	static const int DEFAULT_Y_START = 0;	/**< Default y position of left upper corner. */
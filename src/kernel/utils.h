@@ -151,6 +151,10 @@ struct PdfOpCmpRc
 	bool operator() (const _JM_NAMESPACE::Rectangle& rc) const
 		{ return _JM_NAMESPACE::Rectangle::isInitialized (_JM_NAMESPACE::rectangle_intersect (rc_, rc)); }
 
+	/** Rectangle used when comparing. */
+	const _JM_NAMESPACE::Rectangle& getRectangle () const
+		{ return rc_; }
+
 private:
 	const _JM_NAMESPACE::Rectangle rc_;	/**< Rectangle to be compared. */
 };
@@ -179,6 +183,10 @@ struct PdfOpCmpPt
 		return (rc.contains (pt_.x, pt_.y));
 	}
 
+	/** Point used when comparing. */
+	const Point& getPoint () const
+		{ return pt_; }
+
 private:
 	const Point pt_;	/**< Point to be compared. */
 };
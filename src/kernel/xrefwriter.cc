@@ -151,7 +151,8 @@ XRefWriter::XRefWriter(BaseStream  * stream, CPdf * _pdf)
 	mode(paranoid), 
 	pdf(_pdf), 
 	revision(0), 
-	pdfWriter(new utils::OldStylePdfWriter())
+	pdfWriter(new utils::OldStylePdfWriter()),
+	inputStream(stream)
 {
 
 
@@ -481,8 +482,8 @@ void XRefWriter::saveChanges(bool newRevision)
 	if(linearized)
 		kernelPrintDbg(DBG_WARN, "Pdf is linearized and changes may break rules for linearization.");
 
-	// if changedStorage is empty, there is nothing to do
-	if(changedStorage.size()==0)
+	// if changedStorage and freedRefs are empty, there is nothing to do
+	if(changedStorage.size()==0 && freedRefs.empty())
 	{
 		kernelPrintDbg(DBG_DBG, "Nothing to be saved - changedStorage is empty");
 		return;
@@ -497,7 +498,7 @@ void XRefWriter::saveChanges(bool newRevision)
 	// casts stream (from XRef super type) and casts it to the FileStreamWriter
 	// instance - it is ok, because it is initialized with this type of stream
 	// in constructor
-    BaseStream *str;
+    BaseStream *str=inputStream;
     StreamWriter * streamWriter=dynamic_cast<StreamWriter *>(str);
 
 	// gets vector of all changed objects
@@ -511,13 +512,17 @@ void XRefWriter::saveChanges(bool newRevision)
 		// object itself to writer which is allowed to alter object
 //        changed.push_back(IPdfWriter::ObjectElement(ref, obj->copy()));
 	}
+	// freed objects are stored as free entries
+	for(RefSet::const_iterator f=freedRefs.begin(); f!=freedRefs.end(); ++f)
+		changed.push_back(IPdfWriter::ObjectElement(*f, (Object *)NULL));
 
 	// delegates writing to pdfWriter using streamWriter stream from storePos
 	// position and frees all clones from changed storage.
 	pdfWriter->writeContent(changed, *streamWriter, storePos);
 	for(IPdfWriter::ObjectList::iterator i=changed.begin(); i!=changed.end(); ++i){
 		Object *o = i->second;
-		xpdf::freeXpdfObject(o);
+		if(o)
+			xpdf::freeXpdfObject(o);
 	}
 
 	// Stores position of the cross reference section to xrefPos
@@ -601,7 +606,7 @@ int XRefWriter::getOldStyleTrailer(Object * trailer, size_t off)
 	// searches for TRAILER_KEYWORD to be able to parse older trailer (one
 	// for xref on off position) - this works only for oldstyle XRef tables
 	// not XRef streams
-    BaseStream *str;
+    BaseStream *str=inputStream;
 	char * ret; 
 	char buffer[1024];
 	memset(buffer, '\0', sizeof(buffer));
@@ -700,7 +705,7 @@ void XRefWriter::collectRevisions()
 
 	// starts with newest revision
     size_t off=XRef::getRootGen();
-    BaseStream *str;
+    BaseStream *str=inputStream;
 
 	// linearized pdf doesn't support multiversion document clearly, so we don't
 	// implement collecting for such documents
@@ -867,31 +872,31 @@ void XRefWriter::changeRevision(unsigned revNumber)
 
 size_t XRefWriter::getRevisionEnd(size_t xrefStart)const
 {
-    BaseStream *str;
-	StreamWriter * streamWriter=dynamic_cast<StreamWriter *>(str);
-	size_t pos=streamWriter->getPos();
+	// only reading is required so BaseStream interface is sufficient
+	BaseStream * str=inputStream;
+	size_t pos=str->getPos();
 
 	// starts from given position
-	streamWriter->setPos(xrefStart);
+	str->setPos(xrefStart);
 	char buffer[BUFSIZ];
 	memset(buffer, '\0', sizeof(buffer));
-	while(streamWriter->getLine(buffer, sizeof(buffer)))
+	while(str->getLine(buffer, sizeof(buffer)))
 	{
 		if(!strncmp(buffer, STARTXREF_KEYWORD, strlen(STARTXREF_KEYWORD)))
 		{
 			// we have found start-xref key word, next line should contain
 			// value of offset - this information is not important, we just have
 			// to get behind and calculates number of bytes
-			streamWriter->getLine(buffer, sizeof(buffer));
+			str->getLine(buffer, sizeof(buffer));
 			break;
 		}
 	}
 
 	// returns current position
-	size_t endPos=streamWriter->getPos();
+	size_t endPos=str->getPos();
 	
 	// restores position in the stream
-	streamWriter->setPos(pos);
+	str->setPos(pos);
 
 	return endPos;
 }
@@ -905,15 +910,39 @@ using namespace debug;
 	check_need_credentials(this);
 
 
-    BaseStream *str;
+	BaseStream *str=inputStream;
 	StreamWriter * streamWriter=dynamic_cast<StreamWriter *>(str);
-	size_t pos=streamWriter->getPos();
+	size_t pos=str->getPos();
 
 	// gets current revision end
 	size_t revisionEOF=getRevisionEnd(revisions[revision]);
 
 	kernelPrintDbg(DBG_DBG, "Copies until "<<revisionEOF<<" offset");
-	streamWriter->cloneToFile(file, 0, revisionEOF);
+	if(streamWriter)
+		streamWriter->cloneToFile(file, 0, revisionEOF);
+	else
+	{
+		// read-only stream (e.g. memory mapped one) - copies content 
+		// through BaseStream interface
+		char buffer[BUFSIZ];
+		size_t copied=0;
+		str->setPos(0);
+		while(copied<revisionEOF)
+		{
+			size_t chunk=0;
+			int ch;
+			while(chunk<sizeof(buffer) && copied+chunk<revisionEOF 
+					&& (ch=str->getChar())!=EOF)
+				buffer[chunk++]=(char)ch;
+			if(!chunk || fwrite(buffer, sizeof(char), chunk, file)<chunk)
+			{
+				kernelPrintDbg(DBG_ERR, "Unable to copy whole revision (copied="
+						<<copied<<").");
+				break;
+			}
+			copied+=chunk;
+		}
+	}
 
 	// adds pdf end of line marker to the output file
 	size_t marker_len = strlen(EOFMARKER);
@@ -926,7 +955,7 @@ using namespace debug;
 	fflush(file);
 
 	// restore stream position
-	streamWriter->setPos(pos);
+	str->setPos(pos);
 }
 
 size_t XRefWriter::getRevisionSize(unsigned rev, bool includeXref)const
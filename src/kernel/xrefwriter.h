@@ -173,13 +173,23 @@ private:
 	 * handling, ... - it is always described in method if it is problem)
 	 */
 	bool linearized;
+
+	/** Stream with document data.
+	 *
+	 * Same stream as given to the XRef super type (which doesn't provide
+	 * access to it). This may be FileStreamWriter for documents which can be
+	 * changed or any read-only BaseStream (e.g. MmapStream) otherwise. 
+	 * Revisions parsing uses only BaseStream interface.
+	 */
+	BaseStream * inputStream;
 	
 	/* Empty constructor.
 	 *
 	 * It's not available to prevent uninitialized instances.
 	 * Sets mode to paranoid.
 	 */
-	XRefWriter():CXref(), mode(paranoid), pdf(NULL), revision(0), linearized(false)
+	XRefWriter():CXref(), mode(paranoid), pdf(NULL), revision(0), linearized(false),
+		inputStream(NULL)
 	{
 	}
 protected:
@@ -532,7 +542,7 @@ public:
 	{
 		// if we are in newest revision, delegates to CXref
 		if(utils::isLatestRevision(*this))
-            return knowsRefs(ref);
+			return CXref::knowsRef(ref);
 				
 		// otherwise use XRef directly
         return knowsRefs(ref);
@@ -576,6 +586,24 @@ public:
 	 * revision is not the newest one or if pdf is in read-only mode.
 	 */
 	virtual ::Ref reserveRef();
+
+	/** Releases reserved reference.
+	 * This is just public wrapper for CXref::releaseRef, used when the
+	 * reserved reference can't be initialized.
+	 */
+	virtual bool releaseRef(const ::Ref & ref)
+	{
+		return CXref::releaseRef(ref);
+	}
+
+	/** Frees indirect object.
+	 * This is just public wrapper for CXref::freeRef, used when the
+	 * object is not referenced from the document anymore.
+	 */
+	virtual bool freeRef(const ::Ref & ref)
+	{
+		return CXref::freeRef(ref);
+	}
 	
 	/** Creates new indirect object.
 	 * @param type New object type.
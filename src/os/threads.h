@@ -0,0 +1,332 @@
+/*
+ * PDFedit - free program for PDF document manipulation.
+ * Copyright (C) 2006-2009  PDFedit team: Michal Hocko,
+ *                                        Jozef Misutka,
+ *                                        Martin Petricek
+ *                   Former team members: Miroslav Jahoda
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; version 2 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program (in doc/LICENSE.GPL); if not, write to the 
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330, Boston, 
+ * MA  02111-1307  USA
+ *
+ * Project is hosted on http://sourceforge.net/projects/pdfedit
+ */
+// vim:tabstop=4:shiftwidth=4:noexpandtab:textwidth=80
+
+#ifndef _PDFEDIT_THREADS_H_
+#define _PDFEDIT_THREADS_H_
+
+// Minimal threading primitives used by kernel. Pthread implementation is
+// used when HAVE_PTHREAD is defined (by configure), native one on Windows.
+// Otherwise threads can't be started (startThread returns false) and mutexes
+// and conditions are no-ops, so callers have to fall back to serial 
+// processing.
+
+#if defined(WIN32)
+#	define PDFEDIT_THREADS 1
+#	include <windows.h>
+#	include <process.h>
+#elif defined(HAVE_PTHREAD)
+#	define PDFEDIT_THREADS 1
+#	include <pthread.h>
+#endif
+#include <cstddef>
+
+namespace os {
+
+/** Thread routine type. */
+typedef void * (*ThreadRoutine)(void *);
+
+/** Returns true if threads can be started on this platform. */
+inline bool threadsAvailable()
+{
+#ifdef PDFEDIT_THREADS
+	return true;
+#else
+	return false;
+#endif
+}
+
+/** Non recursive mutex. */
+class Mutex
+{
+#if defined(WIN32)
+	CRITICAL_SECTION cs;
+#elif defined(PDFEDIT_THREADS)
+	pthread_mutex_t mutex;
+#endif
+	friend class Condition;
+
+	// not copyable
+	Mutex(const Mutex &);
+	Mutex & operator=(const Mutex &);
+public:
+	Mutex()
+	{
+#if defined(WIN32)
+		InitializeCriticalSection(&cs);
+#elif defined(PDFEDIT_THREADS)
+		pthread_mutex_init(&mutex, NULL);
+#endif
+	}
+
+	~Mutex()
+	{
+#if defined(WIN32)
+		DeleteCriticalSection(&cs);
+#elif defined(PDFEDIT_THREADS)
+		pthread_mutex_destroy(&mutex);
+#endif
+	}
+
+	void lock()
+	{
+#if defined(WIN32)
+		EnterCriticalSection(&cs);
+#elif defined(PDFEDIT_THREADS)
+		pthread_mutex_lock(&mutex);
+#endif
+	}
+
+	void unlock()
+	{
+#if defined(WIN32)
+		LeaveCriticalSection(&cs);
+#elif defined(PDFEDIT_THREADS)
+		pthread_mutex_unlock(&mutex);
+#endif
+	}
+};
+
+/** Locks given mutex for the scope of the instance. */
+class ScopedLock
+{
+	Mutex & mutex;
+
+	// not copyable
+	ScopedLock(const ScopedLock &);
+	ScopedLock & operator=(const ScopedLock &);
+public:
+	explicit ScopedLock(Mutex & _mutex):mutex(_mutex)
+	{
+		mutex.lock();
+	}
+
+	~ScopedLock()
+	{
+		mutex.unlock();
+	}
+};
+
+/** Condition variable.
+ *
+ * Without thread support wait returns immediately (nobody could signal it
+ * anyway).
+ */
+class Condition
+{
+#if defined(WIN32)
+	CONDITION_VARIABLE cond;
+#elif defined(PDFEDIT_THREADS)
+	pthread_cond_t cond;
+#endif
+
+	// not copyable
+	Condition(const Condition &);
+	Condition & operator=(const Condition &);
+public:
+	Condition()
+	{
+#if defined(WIN32)
+		InitializeConditionVariable(&cond);
+#elif defined(PDFEDIT_THREADS)
+		pthread_cond_init(&cond, NULL);
+#endif
+	}
+
+	~Condition()
+	{
+#if !defined(WIN32) && defined(PDFEDIT_THREADS)
+		pthread_cond_destroy(&cond);
+#endif
+	}
+
+	/** Waits for signal. Given mutex has to be locked by caller. */
+	void wait(Mutex & mutex)
+	{
+#if defined(WIN32)
+		SleepConditionVariableCS(&cond, &mutex.cs, INFINITE);
+#elif defined(PDFEDIT_THREADS)
+		pthread_cond_wait(&cond, &mutex.mutex);
+#else
+		(void)mutex;
+#endif
+	}
+
+	void signal()
+	{
+#if defined(WIN32)
+		WakeConditionVariable(&cond);
+#elif defined(PDFEDIT_THREADS)
+		pthread_cond_signal(&cond);
+#endif
+	}
+
+	void broadcast()
+	{
+#if defined(WIN32)
+		WakeAllConditionVariable(&cond);
+#elif defined(PDFEDIT_THREADS)
+		pthread_cond_broadcast(&cond);
+#endif
+	}
+};
+
+/** Pointer with a separate value for each thread.
+ *
+ * Value is NULL in each thread until it sets it. Pointed object is not
+ * owned, so it is not deleted when thread exits. Without thread support
+ * there is only one value.
+ */
+template<typename T>
+class ThreadLocalPtr
+{
+#if defined(WIN32)
+	DWORD key;
+#elif defined(PDFEDIT_THREADS)
+	pthread_key_t key;
+#else
+	T * value;
+#endif
+
+	// not copyable
+	ThreadLocalPtr(const ThreadLocalPtr &);
+	ThreadLocalPtr & operator=(const ThreadLocalPtr &);
+public:
+	ThreadLocalPtr()
+	{
+#if defined(WIN32)
+		key=TlsAlloc();
+#elif defined(PDFEDIT_THREADS)
+		pthread_key_create(&key, NULL);
+#else
+		value=NULL;
+#endif
+	}
+
+	~ThreadLocalPtr()
+	{
+#if defined(WIN32)
+		TlsFree(key);
+#elif defined(PDFEDIT_THREADS)
+		pthread_key_delete(key);
+#endif
+	}
+
+	/** Returns value of the calling thread. */
+	T * get()const
+	{
+#if defined(WIN32)
+		return static_cast<T *>(TlsGetValue(key));
+#elif defined(PDFEDIT_THREADS)
+		return static_cast<T *>(pthread_getspecific(key));
+#else
+		return value;
+#endif
+	}
+
+	/** Sets value of the calling thread. */
+	void set(T * _value)
+	{
+#if defined(WIN32)
+		TlsSetValue(key, _value);
+#elif defined(PDFEDIT_THREADS)
+		pthread_setspecific(key, _value);
+#else
+		value=_value;
+#endif
+	}
+};
+
+#if defined(WIN32)
+/** Thread handle. */
+typedef HANDLE Thread;
+
+namespace detail {
+struct ThreadStart
+{
+	ThreadRoutine routine;
+	void * arg;
+};
+
+inline unsigned __stdcall threadTrampoline(void * data)
+{
+	ThreadStart start=*static_cast<ThreadStart *>(data);
+	delete static_cast<ThreadStart *>(data);
+	start.routine(start.arg);
+	return 0;
+}
+} // namespace detail
+#elif defined(PDFEDIT_THREADS)
+/** Thread handle. */
+typedef pthread_t Thread;
+#else
+/** Thread handle (threads are not supported). */
+typedef int Thread;
+#endif
+
+/** Starts new thread.
+ * @param thread Handle of started thread.
+ * @param routine Thread routine.
+ * @param arg Parameter for the routine.
+ * @return true if thread has been started, false otherwise (always when
+ * threads are not supported).
+ */
+inline bool startThread(Thread & thread, ThreadRoutine routine, void * arg)
+{
+#if defined(WIN32)
+	detail::ThreadStart * start=new detail::ThreadStart();
+	start->routine=routine;
+	start->arg=arg;
+	uintptr_t handle=_beginthreadex(NULL, 0, detail::threadTrampoline, start, 0, NULL);
+	if(!handle)
+	{
+		delete start;
+		return false;
+	}
+	thread=(HANDLE)handle;
+	return true;
+#elif defined(PDFEDIT_THREADS)
+	return !pthread_create(&thread, NULL, routine, arg);
+#else
+	(void)thread; (void)routine; (void)arg;
+	return false;
+#endif
+}
+
+/** Waits for thread started by startThread to finish. */
+inline void joinThread(Thread & thread)
+{
+#if defined(WIN32)
+	WaitForSingleObject(thread, INFINITE);
+	CloseHandle(thread);
+#elif defined(PDFEDIT_THREADS)
+	pthread_join(thread, NULL);
+#else
+	(void)thread;
+#endif
+}
+
+} // namespace os
+
+#endif
@@ -93,6 +93,29 @@ void bench_addTextToStream(shared_ptr<CPdf> pdf, const std::string &fontName, st
 	}
 }
 
+void bench_hit_test(shared_ptr<CPdf> pdf, struct result *results, int startPage, int pageCount, int queries)
+{
+	for(int p=startPage; p < startPage+pageCount; ++p)
+	{
+		shared_ptr<CPage> page = pdf->getPage(p);
+		libs::Rectangle box = page->getMediabox();
+		double width = box.xright - box.xleft, height = box.yright - box.yleft;
+		// don't include time for parsing
+		bench_get_ccstreams(pdf, NULL, p, 1);
+		for(int i=0; i < queries; ++i)
+		{
+			std::vector<shared_ptr<PdfOperator> > ops;
+			libs::Point pt(box.xleft + width*(i%100)/100, box.yleft + height*(i/100%100)/100);
+			time_stamp_t start,  end;
+			get_time_stamp(&start);
+			page->getObjectsAtPosition(ops, pt);
+			get_time_stamp(&end);
+			if (results)
+				update_result(time_diff(start, end), *results);
+		}
+	}
+}
+
 int main(int argc, char ** argv)
 {
 	int ret;
@@ -112,6 +135,9 @@ int main(int argc, char ** argv)
 	DEFINE_RESULTS(getCStreams_again, "getCStreams_again");
 	bench_get_ccstreams(pdf, &getCStreams_again, 1, pageCount);
 
+	DEFINE_RESULTS(hitTest, "hitTest");
+	bench_hit_test(pdf, &hitTest, 1, pageCount, 1000);
+
 	// add text on the clean pdf
 	pdf = open_file(file_name);
 	DEFINE_RESULTS(addTextToStream1, "addToStream1");
@@ -147,6 +173,7 @@ int main(int argc, char ** argv)
 	struct result *all_results [] = {
 		&getCStreams_first,
 		&getCStreams_again,
+		&hitTest,
 		&addTextToStream1,
 		&addTextToStream10,
 		&addTextToStream100,
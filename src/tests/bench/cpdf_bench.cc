@@ -250,6 +250,41 @@ void bench_bwd_iter(shared_ptr<CPdf> pdf, struct result * result)
 	// we don't use last unseccessfull hasPrevPage
 }
 
+// measures random page access (getPage and getPagePosition for pages in
+// pseudo random order - every page is visited once)
+void bench_random_access(shared_ptr<CPdf> pdf, struct result * result)
+{
+	time_stamp_t start, end;
+	size_t count = pdf->getPageCount();
+	if(!count)
+		return;
+	// step coprime with count visits all positions
+	size_t step = count/2+1;
+	for(;;++step)
+	{
+		size_t a = step, b = count;
+		while(b)
+		{
+			size_t t = a % b;
+			a = b;
+			b = t;
+		}
+		if(a == 1)
+			break;
+	}
+	size_t pos = 0;
+	for(size_t i=0; i<count; ++i)
+	{
+		pos = (pos + step) % count;
+		get_time_stamp(&start);
+		shared_ptr<CPage> page = pdf->getPage(pos+1);
+		pdf->getPagePosition(page);
+		get_time_stamp(&end);
+		if(result)
+			update_result(time_diff(start, end), *result);
+	}
+}
+
 // add all page dictionaries from helper_pdf to the pdf 
 // (if follow_refs is true, removes Parent entry from each one before 
 // addIndirectProperty is called)
@@ -383,7 +418,10 @@ int main(int argc, char **argv)
 	pdf = open_file(file_name);
 	bench_bwd_iter(pdf, &page_bwd_iteration);
 
-	// TODO getPagePosition
+	// random page access - getPage + getPagePosition
+	DEFINE_RESULTS(page_random_access, "page_random_access");
+	pdf = open_file(file_name);
+	bench_random_access(pdf, &page_random_access);
 	
 	// insertPage - same document opened in different CPdf all pages
 	// are inserted to the back and front
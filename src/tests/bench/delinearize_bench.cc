@@ -24,6 +24,7 @@
 #include <kernel/delinearizator.h>
 #include <kernel/pdfedit-core-dev.h>
 #include "utils.h"
+#include <unistd.h>
 
 using namespace pdfobjects;
 using namespace utils;
@@ -48,8 +49,21 @@ int main(int argc, char **argv)
 	delin->delinearize(output_file.c_str());
 	get_time_stamp(&end);
 	update_result(time_diff(start, end), delinearize);
+
+	// same with stream compression spread over all available cores
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	IPdfWriter *parallelWriter = new OldStylePdfWriter();
+	parallelWriter->setCompressionThreads((cpus > 1)?cpus:2);
+	boost::shared_ptr<Delinearizator> parallelDelin = Delinearizator::getInstance(file_name, parallelWriter);
+	DEFINE_RESULTS(delinearize_parallel, "delinearize_parallel");
+	get_time_stamp(&start);
+	parallelDelin->delinearize(output_file.c_str());
+	get_time_stamp(&end);
+	update_result(time_diff(start, end), delinearize_parallel);
+
 	struct result *all_results [] = {
 		&delinearize,
+		&delinearize_parallel,
 		NULL
 	};
 	print_results(stdout, all_results);
@@ -196,6 +196,23 @@ void bench_fetch(XRefWriter *xref, struct result * result_known, struct result *
 
 }
 
+// number of references reserved by bench_reserveRef
+#define RESERVED_NUMBER 50000
+
+// reserves given number of new references
+void bench_reserveRef(XRefWriter * xref, struct result * result, int number)
+{
+	time_stamp_t start, end;
+	for(int i=0; i<number; ++i)
+	{
+		get_time_stamp(&start);
+		xref->reserveRef();
+		get_time_stamp(&end);
+		if(result)
+			update_result(time_diff(start, end), *result);
+	}
+}
+
 int main(int argc, char ** argv)
 {
 	int ret;
@@ -246,8 +263,14 @@ int main(int argc, char ** argv)
 		bench_fetch(xref, &fetch_known2, &fetch_unknown2);
 	}
 
+	// reserveRef (RESERVED_NUMBER) - each reservation should take the same
+	// time regardless how many objects have been reserved before
+	open_and_get_xrefwriter(pdf, xref, file_name);
+	DEFINE_RESULTS(reserveRef_all, "reserveRef");
+	if(pdf->getMode() != CPdf::ReadOnly)
+		bench_reserveRef(xref, &reserveRef_all, RESERVED_NUMBER);
+
 	// clone (???)
-	// reserveRef (RESERVED_NUMBER)
 	struct result *all_results [] = {
 		&changeRevisionResults1, 
 		&knowsRef_known1, &knowsRef_unknown1,
@@ -255,6 +278,7 @@ int main(int argc, char ** argv)
 		&changeObject_all,
 		&fetch_known1, &fetch_unknown1,
 		&fetch_known2, &fetch_unknown2,
+		&reserveRef_all,
 		NULL
 	};
 
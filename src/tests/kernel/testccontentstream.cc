@@ -26,6 +26,11 @@
 #include "kernel/static.h"
 #include <poppler/PDFDoc.h>
 #include "kernel/cstreamsxpdfreader.h"
+#include "kernel/cstreamslexer.h"
+#include "kernel/stateupdater.h"
+#include "kernel/pdfoperatorsiter.h"
+#include "kernel/operatorpool.h"
+#include "os/threads.h"
 #include "tests/kernel/testmain.h"
 #include "tests/kernel/testcobject.h"
 #include "tests/kernel/testcpage.h"
@@ -140,6 +145,663 @@ frontinsert (ostream& oss, const char* fileName)
 
 //=====================================================================================
 
+//=====================================================================================
+
+/** Collects bounding boxes of all operators. */
+void
+getBBoxes (boost::shared_ptr<CContentStream> cs, vector<PdfOperator::BBox>& bboxes)
+{
+	bboxes.clear ();
+	CContentStream::Operators ops;
+	cs->getPdfOperators (ops);
+	if (ops.empty())
+		return;
+	for (PdfOperator::Iterator it = PdfOperator::getIterator (ops.front()); !it.isEnd(); it.next())
+		bboxes.push_back (it.getCurrent()->getBBox());
+}
+
+bool
+incrementalbbox (ostream& oss, const char* fileName)
+{
+	boost::shared_ptr<CPdf> ppdf = getTestCPdf (fileName);
+	size_t pagecnt = ppdf->getPageCount ();
+	ppdf.reset();
+	
+	for (size_t i = 0; i < pagecnt && i < TEST_MAX_PAGE_COUNT; ++i)
+	{
+		boost::shared_ptr<CPdf> pdf = getTestCPdf (fileName);
+		boost::shared_ptr<CPage> page = pdf->getPage (i + 1);
+		
+		vector<boost::shared_ptr<CContentStream> > ccs;
+		page->getContentStreams (ccs);
+		if (ccs.empty())
+			continue;
+		shared_ptr<CContentStream> cs = ccs.front();
+		CContentStream::Operators ops;
+		cs->getPdfOperators (ops);
+		if (ops.empty())
+			continue;
+
+		// change all numeric operands of the first operators (updated 
+		// incrementaly) 
+		size_t changed = 0;
+		for (PdfOperator::Iterator it = PdfOperator::getIterator (ops.front()); !it.isEnd() && changed < 10; it.next())
+		{
+			PdfOperator::Operands operands;
+			it.getCurrent()->getParameters (operands);
+			for (PdfOperator::Operands::iterator op = operands.begin(); op != operands.end(); ++op)
+			{
+				if (isInt (*op))
+				{
+					IProperty::getSmartCObjectPtr<CInt>(*op)->setValue (getIntFromIProperty (*op) + 1);
+					++changed;
+				}else if (isReal (*op))
+				{
+					IProperty::getSmartCObjectPtr<CReal>(*op)->setValue (getDoubleFromIProperty (*op) + 1);
+					++changed;
+				}
+			}
+		}
+
+		// bounding boxes have to be the same as from the full update
+		vector<PdfOperator::BBox> incremental, full;
+		getBBoxes (cs, incremental);
+		cs->reparse (true);
+		getBBoxes (cs, full);
+		CPPUNIT_ASSERT (incremental == full);
+
+		// removing of the first operator changes all following ones
+		cs->deleteOperator (PdfOperator::getIterator (ops.front()));
+		getBBoxes (cs, incremental);
+		cs->reparse (true);
+		getBBoxes (cs, full);
+		CPPUNIT_ASSERT (incremental == full);
+
+		// changes of the removed operator are not reported any more
+		PdfOperator::Operands operands;
+		ops.front()->getParameters (operands);
+		if (!operands.empty() && isInt (operands.front()))
+		{
+			IProperty::getSmartCObjectPtr<CInt>(operands.front())->setValue (getIntFromIProperty (operands.front()) + 1);
+			getBBoxes (cs, incremental);
+			CPPUNIT_ASSERT (incremental == full);
+		}
+
+		_working (oss);
+	}
+	
+	return true;
+}
+
+//=====================================================================================
+
+/** Records graphical state values after each operator. */
+struct StateRecorder
+{
+	typedef std::vector<std::vector<double> > States;
+	States states;
+
+	void operator() (boost::shared_ptr<GfxResources>) {}
+	void operator() (boost::shared_ptr<PdfOperator>, PdfOperator::BBox, const GfxState& state)
+		{ states.push_back (stateValues (state)); }
+
+	static std::vector<double> stateValues (const GfxState& state)
+	{
+		std::vector<double> values (state.getCTM(), state.getCTM() + 6);
+		values.push_back (state.getLineWidth());
+		values.push_back (state.getFontSize());
+		values.push_back (state.getCurX());
+		values.push_back (state.getCurY());
+		return values;
+	}
+};
+
+bool
+statecheckpoints (ostream& oss, const char* fileName)
+{
+	boost::shared_ptr<CPdf> pdf = getTestCPdf (fileName);
+	size_t pagecnt = pdf->getPageCount ();
+	
+	for (size_t i = 0; i < pagecnt && i < TEST_MAX_PAGE_COUNT; ++i)
+	{
+		boost::shared_ptr<CPage> page = pdf->getPage (i + 1);
+		
+		vector<boost::shared_ptr<CContentStream> > ccs;
+		page->getContentStreams (ccs);
+		if (ccs.empty())
+			continue;
+		shared_ptr<CContentStream> cs = ccs.front();
+		CContentStream::Operators ops;
+		cs->getPdfOperators (ops);
+		if (ops.empty())
+			continue;
+
+		// state after each operator from the full replay
+		StateRecorder recorder;
+		boost::shared_ptr<GfxState> initial (cs->getStateBefore (ops.front()));
+		StateUpdater::updatePdfOperators<StateRecorder&> (PdfOperator::getIterator (ops.front()), 
+				cs->getResources(), *initial, recorder);
+
+		// state before each operator has to match state after the previous 
+		// one
+		size_t pos = 0;
+		for (PdfOperator::Iterator it = PdfOperator::getIterator (ops.front()); !it.isEnd(); it.next(), ++pos)
+		{
+			if (0 == pos)
+				continue;
+			boost::shared_ptr<GfxState> state = cs->getStateBefore (it.getCurrent());
+			CPPUNIT_ASSERT (StateRecorder::stateValues (*state) == recorder.states[pos - 1]);
+		}
+
+		_working (oss);
+	}
+	
+	return true;
+}
+
+//=====================================================================================
+
+/** Comparator which is not handled by the spatial index. */
+struct UnindexedCmp
+{
+	PdfOpCmpRc cmp;
+	UnindexedCmp (const libs::Rectangle& rc) : cmp (rc) {}
+	bool operator() (const libs::Rectangle& rc) const
+		{ return cmp (rc); }
+};
+
+bool
+spatialindex (ostream& oss, const char* fileName)
+{
+	boost::shared_ptr<CPdf> pdf = getTestCPdf (fileName);
+	size_t pagecnt = pdf->getPageCount ();
+	
+	for (size_t i = 0; i < pagecnt && i < TEST_MAX_PAGE_COUNT; ++i)
+	{
+		boost::shared_ptr<CPage> page = pdf->getPage (i + 1);
+		vector<boost::shared_ptr<CContentStream> > ccs;
+		page->getContentStreams (ccs);
+		if (ccs.empty())
+			continue;
+		shared_ptr<CContentStream> cs = ccs.front();
+
+		// indexed queries have to return the same operators as the full scan
+		libs::Rectangle box = page->getMediabox ();
+		double width = box.xright - box.xleft, height = box.yright - box.yleft;
+		for (int x = 0; x <= 10; ++x)
+		{
+			for (int y = 0; y <= 10; ++y)
+			{
+				libs::Rectangle rc (box.xleft + x*width/10, box.yleft + y*height/10, 
+						box.xleft + x*width/10 + width/7, box.yleft + y*height/10 + height/7);
+				vector<shared_ptr<PdfOperator> > indexed, scanned;
+				cs->getOperatorsAtPosition (indexed, PdfOpCmpRc (rc));
+				cs->getOperatorsAtPosition (scanned, UnindexedCmp (rc));
+				CPPUNIT_ASSERT (indexed == scanned);
+
+				Point pt (rc.xleft, rc.yleft);
+				indexed.clear ();
+				scanned.clear ();
+				cs->getOperatorsAtPosition (indexed, PdfOpCmpPt (pt));
+				cs->getOperatorsAtPosition (scanned, UnindexedCmp (libs::Rectangle (pt.x, pt.y, pt.x, pt.y)));
+				CPPUNIT_ASSERT (indexed == scanned);
+			}
+		}
+
+		_working (oss);
+	}
+	
+	return true;
+}
+
+//=====================================================================================
+
+bool
+lexer (ostream& oss, const char* fileName)
+{
+	boost::shared_ptr<CPdf> pdf = getTestCPdf (fileName);
+	size_t pagecnt = pdf->getPageCount ();
+	
+	for (size_t i = 0; i < pagecnt && i < TEST_MAX_PAGE_COUNT; ++i)
+	{
+		boost::shared_ptr<CPage> page = pdf->getPage (i + 1);
+		vector<boost::shared_ptr<CContentStream> > ccs;
+		page->getContentStreams (ccs);
+		for (vector<boost::shared_ptr<CContentStream> >::iterator cs = ccs.begin(); cs != ccs.end(); ++cs)
+		{
+			typedef vector<shared_ptr<CStream> > Streams;
+			Streams streams;
+			(*cs)->getCStreams (streams);
+			if (streams.empty())
+				continue;
+
+			// native lexer has to read the same objects as xpdf parser
+			CStreamsXpdfReader<Streams> reader (streams);
+			CStreamsLexer lexer (streams);
+			reader.open ();
+			lexer.open ();
+			
+			::Object o;
+			shared_ptr<IProperty> ip;
+			string cmd;
+			reader.getXpdfObject (o);
+			while (!reader.eof())
+			{
+				CStreamsLexer::ObjectKind kind = lexer.getObject (ip, cmd);
+				if (o.isCmd ())
+				{
+					CPPUNIT_ASSERT (CStreamsLexer::Operator == kind);
+					CPPUNIT_ASSERT_EQUAL (string (o.getCmd()), cmd);
+					// inline image data are not objects
+					if ("BI" == cmd)
+						break;
+				}else
+				{
+					CPPUNIT_ASSERT (CStreamsLexer::Operand == kind);
+					scoped_ptr<IProperty> xip (createObjFromXpdfObj (o));
+					string expected, got;
+					xip->getStringRepresentation (expected);
+					ip->getStringRepresentation (got);
+					CPPUNIT_ASSERT_EQUAL (expected, got);
+				}
+				o.free ();
+				reader.getXpdfObject (o);
+			}
+			o.free ();
+			reader.close ();
+			lexer.close ();
+		}
+
+		_working (oss);
+	}
+	
+	return true;
+}
+
+//=====================================================================================
+
+bool
+damagedlexer (ostream& oss)
+{
+	boost::shared_ptr<CStream> stream (new CStream ());
+	stream->setBuffer (std::string ("q ) 1 2 > [3 ] ) << /A 1 /A 2 3 /B >> ] BT (unterminated"));
+	CStreamsLexer lexer (stream);
+	lexer.open ();
+
+	shared_ptr<IProperty> ip;
+	string cmd;
+	CPPUNIT_ASSERT (CStreamsLexer::Operator == lexer.getObject (ip, cmd));
+	CPPUNIT_ASSERT_EQUAL (string ("q"), cmd);
+	CPPUNIT_ASSERT (CStreamsLexer::Operand == lexer.getObject (ip, cmd));
+	CPPUNIT_ASSERT (1 == getIntFromIProperty (ip));
+	CPPUNIT_ASSERT (CStreamsLexer::Operand == lexer.getObject (ip, cmd));
+	CPPUNIT_ASSERT (2 == getIntFromIProperty (ip));
+	CPPUNIT_ASSERT (CStreamsLexer::Operand == lexer.getObject (ip, cmd));
+	CPPUNIT_ASSERT (isArray (ip));
+	CPPUNIT_ASSERT (CStreamsLexer::Operand == lexer.getObject (ip, cmd));
+	CPPUNIT_ASSERT (isDict (ip));
+
+	// the last value of duplicated key wins, key which is not a name and 
+	// key without value are skipped
+	boost::shared_ptr<CDict> dict = IProperty::getSmartCObjectPtr<CDict> (ip);
+	CPPUNIT_ASSERT (1 == dict->getPropertyCount ());
+	CPPUNIT_ASSERT (2 == getIntFromIProperty (dict->getProperty ("A")));
+
+	CPPUNIT_ASSERT (CStreamsLexer::Operator == lexer.getObject (ip, cmd));
+	CPPUNIT_ASSERT_EQUAL (string ("BT"), cmd);
+	CPPUNIT_ASSERT (CStreamsLexer::Operand == lexer.getObject (ip, cmd));
+	CPPUNIT_ASSERT (isString (ip));
+	CPPUNIT_ASSERT (CStreamsLexer::End == lexer.getObject (ip, cmd));
+	lexer.close ();
+
+	_working (oss);
+	return true;
+}
+
+//=====================================================================================
+
+bool
+numberlexer (ostream& oss)
+{
+	boost::shared_ptr<CStream> stream (new CStream ());
+	stream->setBuffer (std::string ("2147483647 2147483648 -.25 1.2-3 3.14159265358979 ."));
+	CStreamsLexer lexer (stream);
+	lexer.open ();
+
+	shared_ptr<IProperty> ip;
+	string cmd;
+	CPPUNIT_ASSERT (CStreamsLexer::Operand == lexer.getObject (ip, cmd));
+	CPPUNIT_ASSERT (isInt (ip) && 2147483647 == getIntFromIProperty (ip));
+	
+	// integer overflow continues as real
+	CPPUNIT_ASSERT (CStreamsLexer::Operand == lexer.getObject (ip, cmd));
+	CPPUNIT_ASSERT (isReal (ip) && 2147483648.0 == getDoubleFromIProperty (ip));
+	
+	CPPUNIT_ASSERT (CStreamsLexer::Operand == lexer.getObject (ip, cmd));
+	CPPUNIT_ASSERT (-0.25 == getDoubleFromIProperty (ip));
+
+	// minus sign in fraction is skipped as xpdf does
+	CPPUNIT_ASSERT (CStreamsLexer::Operand == lexer.getObject (ip, cmd));
+	CPPUNIT_ASSERT ((1 + 0.1 * 2) + 0.1 * 0.1 * 3 == getDoubleFromIProperty (ip));
+
+	// fraction is accumulated in the same order as in xpdf
+	double xf = 3, scale = 0.1;
+	const char* digits = "14159265358979";
+	for (const char* d = digits; *d; ++d, scale *= 0.1)
+		xf = xf + scale * (*d - '0');
+	CPPUNIT_ASSERT (CStreamsLexer::Operand == lexer.getObject (ip, cmd));
+	CPPUNIT_ASSERT (xf == getDoubleFromIProperty (ip));
+
+	CPPUNIT_ASSERT (CStreamsLexer::Operand == lexer.getObject (ip, cmd));
+	CPPUNIT_ASSERT (isReal (ip) && 0 == getDoubleFromIProperty (ip));
+	CPPUNIT_ASSERT (CStreamsLexer::End == lexer.getObject (ip, cmd));
+	lexer.close ();
+
+	_working (oss);
+	return true;
+}
+
+//=====================================================================================
+
+/** Creates operators in a separate thread. */
+void*
+createOperators (void* data)
+{
+	vector<shared_ptr<PdfOperator> >& ops = *static_cast<vector<shared_ptr<PdfOperator> >*> (data);
+	for (size_t i = 0; i < 1000; ++i)
+	{
+		PdfOperator::Operands operands;
+		ops.push_back (createOperator ("q", operands));
+	}
+	OperatorPool::releaseThreadPool ();
+	return NULL;
+}
+
+bool
+threadoperatorpool (ostream& oss)
+{
+	if (!os::threadsAvailable ())
+		return true;
+
+	size_t baseBlocks = OperatorPool::getLiveBlocks ();
+	{
+		vector<shared_ptr<PdfOperator> > ops;
+		os::Thread thread;
+		CPPUNIT_ASSERT (os::startThread (thread, createOperators, &ops));
+		os::joinThread (thread);
+		CPPUNIT_ASSERT (baseBlocks < OperatorPool::getLiveBlocks ());
+		// blocks return to the pool of the finished thread
+	}
+	CPPUNIT_ASSERT_EQUAL (baseBlocks, OperatorPool::getLiveBlocks ());
+
+	_working (oss);
+	return true;
+}
+
+//=====================================================================================
+
+bool
+badtextoperands (ostream& oss)
+{
+	const char* names[] = {"Tj", "'", "\"", "TJ"};
+	for (size_t i = 0; i < sizeof (names) / sizeof (names[0]); ++i)
+	{
+		// operands are checked before they are accessed
+		PdfOperator::Operands operands;
+		TextSimpleOperator op (names[i], 0, operands);
+		string text;
+		op.getRawText (text);
+		CPPUNIT_ASSERT (text.empty());
+	}
+
+	_working (oss);
+	return true;
+}
+
+//=====================================================================================
+
+bool
+compactoperands (ostream& oss, const char* fileName)
+{
+	boost::shared_ptr<CPdf> pdf = getTestCPdf (fileName);
+	size_t pagecnt = pdf->getPageCount ();
+	
+	for (size_t i = 0; i < pagecnt && i < TEST_MAX_PAGE_COUNT; ++i)
+	{
+		boost::shared_ptr<CPage> page = pdf->getPage (i + 1);
+		vector<boost::shared_ptr<CContentStream> > ccs;
+		page->getContentStreams (ccs);
+		if (ccs.empty())
+			continue;
+		shared_ptr<CContentStream> cs = ccs.front();
+		CContentStream::Operators ops;
+		cs->getPdfOperators (ops);
+		if (ops.empty())
+			continue;
+
+		for (PdfOperator::Iterator it = PdfOperator::getIterator (ops.front()); !it.isEnd(); it.next())
+		{
+			shared_ptr<PdfOperator> op = it.getCurrent();
+			string before, after;
+			op->getStringRepresentation (before);
+			
+			// read only access doesn't create objects
+			const CompactOperands& compact = op->getCompactParameters ();
+			CPPUNIT_ASSERT (&compact == &op->getCompactParameters ());
+			vector<PropertyType> types;
+			for (size_t pos = 0; pos < compact.size(); ++pos)
+				types.push_back (compact.getType (pos));
+
+			// promotion to objects must not change anything
+			PdfOperator::Operands operands;
+			op->getParameters (operands);
+			CPPUNIT_ASSERT_EQUAL (types.size(), operands.size());
+			op->getStringRepresentation (after);
+			CPPUNIT_ASSERT_EQUAL (before, after);
+
+			// promoted operands are shared with the operator
+			size_t pos = 0;
+			for (PdfOperator::Operands::iterator oper = operands.begin(); oper != operands.end(); ++oper, ++pos)
+			{
+				CPPUNIT_ASSERT ((*oper)->getType() == types[pos]);
+				CPPUNIT_ASSERT (op->getCompactParameters ().contains ((*oper).get()));
+			}
+		}
+
+		_working (oss);
+	}
+	
+	return true;
+}
+
+//=====================================================================================
+
+bool
+operatorpool (ostream& oss, const char* fileName)
+{
+	// operators which are alive from other tests
+	size_t baseBlocks = OperatorPool::getLiveBlocks ();
+	size_t blocks = baseBlocks;
+	{
+		boost::shared_ptr<CPdf> pdf = getTestCPdf (fileName);
+		size_t pagecnt = pdf->getPageCount ();
+		vector<boost::shared_ptr<CContentStream> > streams;
+		for (size_t i = 0; i < pagecnt && i < TEST_MAX_PAGE_COUNT; ++i)
+		{
+			boost::shared_ptr<CPage> page = pdf->getPage (i + 1);
+			vector<boost::shared_ptr<CContentStream> > ccs;
+			page->getContentStreams (ccs);
+			streams.insert (streams.end(), ccs.begin(), ccs.end());
+		}
+		blocks = OperatorPool::getLiveBlocks ();
+		oss << " live blocks: " << blocks - baseBlocks 
+			<< " reserved bytes: " << OperatorPool::getReservedBytes () << flush;
+		if (baseBlocks < blocks)
+			CPPUNIT_ASSERT (0 < OperatorPool::getReservedBytes ());
+	}
+
+	// all operators of the document are gone
+	CPPUNIT_ASSERT_EQUAL (baseBlocks, OperatorPool::getLiveBlocks ());
+	// memory of pools without live blocks is returned by purge
+	OperatorPool::purge ();
+	if (0 == OperatorPool::getLiveBlocks ())
+		CPPUNIT_ASSERT_EQUAL ((size_t)0, OperatorPool::getReservedBytes ());
+
+	_working (oss);
+	return true;
+}
+
+//=====================================================================================
+
+/** Returns first text operator of the content stream. */
+shared_ptr<TextSimpleOperator>
+firstTextOperator (shared_ptr<CContentStream> cs)
+{
+	CContentStream::Operators ops;
+	cs->getPdfOperators (ops);
+	if (ops.empty())
+		return shared_ptr<TextSimpleOperator> ();
+	TextOperatorIterator it = PdfOperator::getIterator<TextOperatorIterator> (ops.front());
+	if (it.isEnd())
+		return shared_ptr<TextSimpleOperator> ();
+	return dynamic_pointer_cast<TextSimpleOperator, PdfOperator> (it.getCurrent());
+}
+
+bool
+replacetext (ostream& oss, const char* fileName)
+{
+	boost::shared_ptr<CPdf> pdf = getTestCPdf (fileName);
+	size_t pagecnt = pdf->getPageCount ();
+	
+	for (size_t i = 0; i < pagecnt && i < TEST_MAX_PAGE_COUNT; ++i)
+	{
+		boost::shared_ptr<CPage> page = pdf->getPage (i + 1);
+		vector<boost::shared_ptr<CContentStream> > ccs;
+		page->getContentStreams (ccs);
+		if (ccs.empty())
+			continue;
+		shared_ptr<CContentStream> cs = ccs.front();
+		shared_ptr<TextSimpleOperator> op = firstTextOperator (cs);
+		if (!op)
+			continue;
+		string text;
+		op->getFontText (text);
+		size_t second = text.find_first_not_of (text.empty() ? ' ' : text[0]);
+		if (string::npos == second)
+			continue;
+
+		// nothing to replace
+		CPPUNIT_ASSERT_EQUAL ((size_t)0, cs->replaceText (CContentStream::TextReplacements()));
+
+		// swap two characters in one pass (replaced text is not replaced again)
+		const string a (1, text[0]), b (1, text[second]);
+		CContentStream::TextReplacements swap;
+		swap[a] = b;
+		swap[b] = a;
+		CPPUNIT_ASSERT (0 < cs->replaceText (swap));
+
+		string expected (text);
+		for (string::iterator c = expected.begin(); c != expected.end(); ++c)
+			if (*c == a[0] || *c == b[0])
+				*c = (*c == a[0]) ? b[0] : a[0];
+		op = firstTextOperator (cs);
+		CPPUNIT_ASSERT (op);
+		string swapped;
+		op->getFontText (swapped);
+		CPPUNIT_ASSERT_EQUAL (expected, swapped);
+
+		_working (oss);
+	}
+	
+	return true;
+}
+
+//=====================================================================================
+
+/** Checks that state after Q is the same as from the full replay. */
+void
+checkStateAfterQ (boost::shared_ptr<CContentStream> cs, boost::shared_ptr<PdfOperator> after)
+{
+	CContentStream::Operators ops;
+	cs->getPdfOperators (ops);
+	StateRecorder recorder;
+	boost::shared_ptr<GfxState> initial (cs->getStateBefore (ops.front()));
+	StateUpdater::updatePdfOperators<StateRecorder&> (PdfOperator::getIterator (ops.front()), 
+			cs->getResources(), *initial, recorder);
+
+	size_t pos = 0;
+	for (PdfOperator::Iterator it = PdfOperator::getIterator (ops.front()); it.getCurrent() != after; it.next())
+		++pos;
+	CPPUNIT_ASSERT (0 < pos);
+	boost::shared_ptr<GfxState> state = cs->getStateBefore (after);
+	CPPUNIT_ASSERT (StateRecorder::stateValues (*state) == recorder.states[pos - 1]);
+}
+
+bool
+stateqrestore (ostream& oss, const char* fileName)
+{
+	boost::shared_ptr<CPdf> pdf = getTestCPdf (fileName);
+	if (0 == pdf->getPageCount())
+		return true;
+	boost::shared_ptr<CPage> page = pdf->getPage (1);
+
+	// q w cm ... cm Q w - Q is far behind the last checkpoint before q
+	PdfOperator::Operands operands;
+	boost::shared_ptr<UnknownCompositePdfOperator> q (new UnknownCompositePdfOperator ("q", "Q"));
+	operands.push_back (boost::shared_ptr<IProperty> (new CReal (5)));
+	q->push_back (createOperator ("w", operands), q);
+	boost::shared_ptr<PdfOperator> lastCm;
+	for (size_t i = 0; i < 3 * CContentStream::CHECKPOINT_INTERVAL; ++i)
+	{
+		operands.clear ();
+		operands.push_back (boost::shared_ptr<IProperty> (new CReal (1.01)));
+		operands.push_back (boost::shared_ptr<IProperty> (new CReal (0)));
+		operands.push_back (boost::shared_ptr<IProperty> (new CReal (0)));
+		operands.push_back (boost::shared_ptr<IProperty> (new CReal (1.01)));
+		operands.push_back (boost::shared_ptr<IProperty> (new CReal (1)));
+		operands.push_back (boost::shared_ptr<IProperty> (new CReal (1)));
+		lastCm = createOperator ("cm", operands);
+		q->push_back (lastCm, getLastOperator (q));
+	}
+	operands.clear ();
+	q->push_back (createOperator ("Q", operands), getLastOperator (q));
+	operands.push_back (boost::shared_ptr<IProperty> (new CReal (2)));
+	boost::shared_ptr<PdfOperator> after = createOperator ("w", operands);
+
+	vector<boost::shared_ptr<PdfOperator> > contents;
+	contents.push_back (q);
+	contents.push_back (after);
+	page->addContentStreamToBack (contents);
+
+	vector<boost::shared_ptr<CContentStream> > ccs;
+	page->getContentStreams (ccs);
+	CPPUNIT_ASSERT (!ccs.empty());
+	boost::shared_ptr<CContentStream> cs = ccs.back();
+	CContentStream::Operators ops;
+	cs->getPdfOperators (ops);
+	after = ops.back ();
+	checkStateAfterQ (cs, after);
+
+	// changes the last operator in q (after checkpoints) - Q has to restore
+	// the same state as the full replay
+	PdfOperator::Operands changed;
+	for (PdfOperator::Iterator it = PdfOperator::getIterator (ops.front()); !it.isEnd(); it.next())
+	{
+		std::string name;
+		it.getCurrent()->getOperatorName (name);
+		if ("cm" == name)
+			lastCm = it.getCurrent();
+	}
+	lastCm->getParameters (changed);
+	IProperty::getSmartCObjectPtr<CReal>(changed[4])->setValue (10);
+	checkStateAfterQ (cs, after);
+	
+	_working (oss);
+	return true;
+}
+
+//=====================================================================================
+
 bool
 position (ostream& oss, const char* fileName, const libs::Rectangle rc)
 {
@@ -713,6 +1375,13 @@ class TestCContentStream : public CppUnit::TestFixture
 		CPPUNIT_TEST(TestSetCS);
 		CPPUNIT_TEST(TestFront);
 		CPPUNIT_TEST(TestCStreams);
+		CPPUNIT_TEST(TestIncrementalBBox);
+		CPPUNIT_TEST(TestStateCheckpoints);
+		CPPUNIT_TEST(TestSpatialIndex);
+		CPPUNIT_TEST(TestLexer);
+		CPPUNIT_TEST(TestCompactOperands);
+		CPPUNIT_TEST(TestOperatorPool);
+		CPPUNIT_TEST(TestReplaceText);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -808,6 +1477,166 @@ public:
 	}
 
 
+	//
+	//
+	//
+	void TestIncrementalBBox ()
+	{
+		OUTPUT << "CContentStream ..." << endl;
+		
+		for(TestParams::FileList::const_iterator it = TestParams::instance().files.begin(); 
+				it != TestParams::instance().files.end(); 
+					++it)
+		{
+			OUTPUT << "Testing filename: " << *it << endl;
+			
+			BEGIN_CHECK_READONLY;
+				TEST(" incremental bbox update");
+				CPPUNIT_ASSERT (incrementalbbox (OUTPUT, (*it).c_str()));
+				OK_TEST;
+			END_CHECK_READONLY;
+		}
+	}
+
+
+	//
+	//
+	//
+	void TestStateCheckpoints ()
+	{
+		OUTPUT << "CContentStream ..." << endl;
+		
+		for(TestParams::FileList::const_iterator it = TestParams::instance().files.begin(); 
+				it != TestParams::instance().files.end(); 
+					++it)
+		{
+			OUTPUT << "Testing filename: " << *it << endl;
+			
+			TEST(" state checkpoints");
+			CPPUNIT_ASSERT (statecheckpoints (OUTPUT, (*it).c_str()));
+			OK_TEST;
+			
+			TEST(" state restored at Q after checkpoints");
+			CPPUNIT_ASSERT (stateqrestore (OUTPUT, (*it).c_str()));
+			OK_TEST;
+		}
+	}
+
+
+	//
+	//
+	//
+	void TestSpatialIndex ()
+	{
+		OUTPUT << "CContentStream ..." << endl;
+		
+		for(TestParams::FileList::const_iterator it = TestParams::instance().files.begin(); 
+				it != TestParams::instance().files.end(); 
+					++it)
+		{
+			OUTPUT << "Testing filename: " << *it << endl;
+			
+			TEST(" spatial index");
+			CPPUNIT_ASSERT (spatialindex (OUTPUT, (*it).c_str()));
+			OK_TEST;
+		}
+	}
+
+
+	//
+	//
+	//
+	void TestLexer ()
+	{
+		OUTPUT << "CContentStream ..." << endl;
+		
+		for(TestParams::FileList::const_iterator it = TestParams::instance().files.begin(); 
+				it != TestParams::instance().files.end(); 
+					++it)
+		{
+			OUTPUT << "Testing filename: " << *it << endl;
+			
+			TEST(" native lexer");
+			CPPUNIT_ASSERT (lexer (OUTPUT, (*it).c_str()));
+			OK_TEST;
+		}
+
+		TEST(" native lexer with damaged data");
+		CPPUNIT_ASSERT (damagedlexer (OUTPUT));
+		OK_TEST;
+
+		TEST(" native lexer numbers");
+		CPPUNIT_ASSERT (numberlexer (OUTPUT));
+		OK_TEST;
+	}
+
+
+	//
+	//
+	//
+	void TestCompactOperands ()
+	{
+		OUTPUT << "CContentStream ..." << endl;
+		
+		for(TestParams::FileList::const_iterator it = TestParams::instance().files.begin(); 
+				it != TestParams::instance().files.end(); 
+					++it)
+		{
+			OUTPUT << "Testing filename: " << *it << endl;
+			
+			TEST(" compact operands");
+			CPPUNIT_ASSERT (compactoperands (OUTPUT, (*it).c_str()));
+			OK_TEST;
+		}
+
+		TEST(" text operators without operands");
+		CPPUNIT_ASSERT (badtextoperands (OUTPUT));
+		OK_TEST;
+	}
+
+	//
+	//
+	//
+	void TestOperatorPool ()
+	{
+		OUTPUT << "CContentStream ..." << endl;
+		
+		for(TestParams::FileList::const_iterator it = TestParams::instance().files.begin(); 
+				it != TestParams::instance().files.end(); 
+					++it)
+		{
+			OUTPUT << "Testing filename: " << *it << endl;
+			
+			TEST(" operator pool");
+			CPPUNIT_ASSERT (operatorpool (OUTPUT, (*it).c_str()));
+			OK_TEST;
+		}
+
+		TEST(" operators destroyed by another thread");
+		CPPUNIT_ASSERT (threadoperatorpool (OUTPUT));
+		OK_TEST;
+	}
+
+	//
+	//
+	//
+	void TestReplaceText ()
+	{
+		OUTPUT << "CContentStream ..." << endl;
+		
+		for(TestParams::FileList::const_iterator it = TestParams::instance().files.begin(); 
+				it != TestParams::instance().files.end(); 
+					++it)
+		{
+			OUTPUT << "Testing filename: " << *it << endl;
+			
+			TEST(" replace text");
+			CPPUNIT_ASSERT (replacetext (OUTPUT, (*it).c_str()));
+			OK_TEST;
+		}
+	}
+
+
 	//
 	//
 	//
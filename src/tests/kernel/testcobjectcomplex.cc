@@ -490,6 +490,59 @@ c_set ()
 
 //=====================================================================================
 
+bool
+c_bigdict ()
+{
+	CDict d;
+	const int count = 100;
+
+	// large enough to be looked up through the index
+	string expected ("<<\n");
+	for (int i = 0; i < count; ++i)
+	{
+		ostringstream name;
+		name << "Key" << i;
+		CInt val (i);
+		d.addProperty (name.str(), val);
+		expected += "/" + name.str() + " " + name.str().substr (3) + "\n";
+	}
+	expected += ">>";
+	// insertion order has to be kept
+	ip_validate (d, expected, false);
+
+	for (int i = 0; i < count; ++i)
+	{
+		ostringstream name;
+		name << "Key" << i;
+		CPPUNIT_ASSERT (d.containsProperty (name.str()));
+		CPPUNIT_ASSERT (i == getIntFromDict (d, name.str()));
+	}
+	CPPUNIT_ASSERT (!d.containsProperty ("Key"));
+
+	// removing shifts positions of the following entries
+	for (int i = 0; i < count; i += 2)
+	{
+		ostringstream name;
+		name << "Key" << i;
+		d.delProperty (name.str());
+		CPPUNIT_ASSERT (!d.containsProperty (name.str()));
+	}
+	CPPUNIT_ASSERT ((size_t)count/2 == d.getPropertyCount());
+	for (int i = 1; i < count; i += 2)
+	{
+		ostringstream name;
+		name << "Key" << i;
+		CPPUNIT_ASSERT (i == getIntFromDict (d, name.str()));
+		CString str ("s");
+		d.setProperty (name.str(), str);
+		CPPUNIT_ASSERT (isString (d.getProperty (name.str())));
+	}
+
+	return true;
+}
+
+//=====================================================================================
+
 bool
 c_xpdfctor (const char* filename)
 {
@@ -740,6 +793,10 @@ public:
 			TEST(" xpdf addProperty + getPosition")
 			CPPUNIT_ASSERT (c_addprop2 ());
 			OK_TEST;
+
+			TEST(" big dictionary lookups")
+			CPPUNIT_ASSERT (c_bigdict ());
+			OK_TEST;
 		}
 	}
 	void TestForEach ()
@@ -399,6 +399,73 @@ s_rel ()
 }
 
 
+//====================================================
+
+bool
+s_atoms ()
+{
+	// same names share atom
+	NameAtom fontAtom = internName ("Font");
+	CPPUNIT_ASSERT (NO_ATOM != fontAtom);
+	CPPUNIT_ASSERT (fontAtom == internName (string ("Font")));
+	CPPUNIT_ASSERT (fontAtom != internName ("XObject"));
+	CPPUNIT_ASSERT ("Font" == atomName (fontAtom));
+	CPPUNIT_ASSERT (NO_ATOM == NameTable::instance().lookup ("NotInternedName_X_Y_Z"));
+
+	// cached atom has to follow value changes
+	CName name ("Font");
+	CPPUNIT_ASSERT (fontAtom == name.getAtom ());
+	name.setValue ("XObject");
+	CPPUNIT_ASSERT (internName ("XObject") == name.getAtom ());
+	name.setStringRepresentation ("/Font");
+	CPPUNIT_ASSERT (fontAtom == name.getAtom ());
+
+	// names beyond the table limit are not interned but they still work
+	NameTable& table = NameTable::instance ();
+	size_t limit = table.getLimit ();
+	table.setLimit (table.size ());
+	CName unique ("UniqueName_Beyond_Limit");
+	CPPUNIT_ASSERT (NO_ATOM == unique.getAtom ());
+	CPPUNIT_ASSERT (NO_ATOM == table.lookup ("UniqueName_Beyond_Limit"));
+	CDict dict;
+	for (int i = 0; i < 20; ++i)
+	{
+		ostringstream key;
+		key << "UniqueKey_Beyond_Limit_" << i;
+		dict.addProperty (key.str(), CInt (i));
+	}
+	CPPUNIT_ASSERT (dict.containsProperty ("UniqueKey_Beyond_Limit_15"));
+	CPPUNIT_ASSERT (!dict.containsProperty ("UniqueKey_Beyond_Limit_99"));
+	CPPUNIT_ASSERT (NO_ATOM == table.lookup ("UniqueKey_Beyond_Limit_15"));
+	// forced interning ignores the limit
+	CPPUNIT_ASSERT (NO_ATOM != table.intern ("UniqueOperator_Beyond_Limit"));
+	table.setLimit (limit);
+
+	// only known operator names are interned, others stay plain strings
+	size_t count = table.size ();
+	Operands ops;
+	SimpleGenericOperator garbage (string ("Garbage_Operator_X_Y_Z"), ops);
+	CPPUNIT_ASSERT (NO_ATOM == garbage.getOperatorAtom ());
+	CPPUNIT_ASSERT (NO_ATOM == table.lookup ("Garbage_Operator_X_Y_Z"));
+	CPPUNIT_ASSERT (count == table.size ());
+	string opName;
+	garbage.getOperatorName (opName);
+	CPPUNIT_ASSERT ("Garbage_Operator_X_Y_Z" == opName);
+	SimpleGenericOperator known (string ("Tj"), ops);
+	CPPUNIT_ASSERT (table.lookup ("Tj") == known.getOperatorAtom ());
+	CPPUNIT_ASSERT (NO_ATOM != known.getOperatorAtom ());
+
+	// thread cache doesn't remember missing names and can be released
+	CPPUNIT_ASSERT (NO_ATOM == table.lookup ("Name_Interned_Later_X_Y_Z"));
+	NameAtom later = table.intern ("Name_Interned_Later_X_Y_Z");
+	CPPUNIT_ASSERT (later == table.lookup ("Name_Interned_Later_X_Y_Z"));
+	table.releaseThreadCache ();
+	CPPUNIT_ASSERT (later == table.lookup ("Name_Interned_Later_X_Y_Z"));
+	CPPUNIT_ASSERT (fontAtom == internName ("Font"));
+	return true;
+}
+
+
 //=========================================================================
 // class TestCObjectSimple
 //=========================================================================
@@ -515,6 +582,10 @@ public:
 			TEST(" __");
 			CPPUNIT_ASSERT (s_rel ());
 			OK_TEST;
+
+			TEST(" name atoms");
+			CPPUNIT_ASSERT (s_atoms ());
+			OK_TEST;
 		}
 	}
 
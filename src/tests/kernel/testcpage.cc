@@ -203,6 +203,263 @@ findtext (UNUSED_PARAM ostream& oss, const char* fileName)
 }
 
 
+//=====================================================================================
+
+bool
+findtexts (UNUSED_PARAM ostream& oss, const char* fileName)
+{
+	boost::shared_ptr<CPdf> pdf = getTestCPdf (fileName);
+
+	for (size_t i = 0; i < pdf->getPageCount() && i < TEST_MAX_PAGE_COUNT; ++i)
+	{
+		boost::shared_ptr<CPage> page = pdf->getPage (i+1);
+
+		CPageContents::Words words;
+		page->getTextWords (words);
+		vector<string> patterns;
+		for (size_t w = 0; w < words.size() && patterns.size() < 50; w += 3)
+			patterns.push_back (words[w].text);
+		if (patterns.empty())
+			continue;
+
+		// one pass search finds the same as searching patterns one by one
+		TextSearch search (patterns);
+		CPageContents::TextMatches matches;
+		page->findTexts (search, matches);
+		for (size_t p = 0; p < patterns.size(); ++p)
+		{
+			vector<libs::Rectangle> recs;
+			page->findText (patterns[p], recs);
+			size_t count = 0;
+			for (CPageContents::TextMatches::const_iterator it = matches.begin(); it != matches.end(); ++it)
+				if (it->pattern == p)
+					++count;
+			CPPUNIT_ASSERT_EQUAL (recs.size(), count);
+		}
+
+		// whole words are subset of all occurrences
+		TextSearchParams params;
+		params.wholeWord = gTrue;
+		CPageContents::TextMatches whole;
+		page->findTexts (search, whole, params);
+		CPPUNIT_ASSERT (whole.size() <= matches.size());
+
+		if (matches.empty())
+			continue;
+
+		// region around the first match contains it
+		const libs::Rectangle& bbox = matches.front().bbox;
+		TextSearchParams inside;
+		inside.regionXLeft = bbox.xleft - 1;
+		inside.regionYLeft = bbox.yleft - 1;
+		inside.regionXRight = bbox.xright + 1;
+		inside.regionYRight = bbox.yright + 1;
+		CPageContents::TextMatches limited;
+		page->findTexts (search, limited, inside);
+		CPPUNIT_ASSERT (!limited.empty() && limited.size() <= matches.size());
+		for (CPageContents::TextMatches::const_iterator it = limited.begin(); it != limited.end(); ++it)
+			CPPUNIT_ASSERT (inside.regionXLeft <= it->bbox.xleft && it->bbox.xright <= inside.regionXRight
+					&& inside.regionYLeft <= it->bbox.yleft && it->bbox.yright <= inside.regionYRight);
+
+		// region next to the first match doesn't contain it
+		if (bbox.xright <= bbox.xleft || bbox.yright <= bbox.yleft)
+			continue;
+		TextSearchParams outside;
+		outside.regionXLeft = bbox.xright + 1;
+		outside.regionYLeft = bbox.yleft;
+		outside.regionXRight = bbox.xright + 1 + (bbox.xright - bbox.xleft);
+		outside.regionYRight = bbox.yright;
+		page->findTexts (search, limited, outside);
+		for (CPageContents::TextMatches::const_iterator it = limited.begin(); it != limited.end(); ++it)
+			CPPUNIT_ASSERT (!(it->bbox == bbox));
+
+		// start and stop positions are not used as a region
+		TextSearchParams start;
+		start.xStart = bbox.xleft;
+		start.yStart = bbox.yleft;
+		start.xEnd = bbox.xright;
+		start.yEnd = bbox.yright;
+		page->findTexts (search, limited, start);
+		CPPUNIT_ASSERT_EQUAL (matches.size(), limited.size());
+
+		_working (oss);
+	}
+
+	return true;
+}
+
+//=====================================================================================
+
+namespace {
+
+	/** Returns unicode text of a UTF-8 string. */
+	TextSearch::Text
+	unicodeText (const string& str)
+	{
+		TextSearch::Text text;
+		CPPUNIT_ASSERT (TextSearch::decodeUtf8 (str, text));
+		return text;
+	}
+
+	/** Returns number of matches of one pattern in the text. */
+	size_t
+	countMatches (const string& pattern, const string& text, bool caseSensitive = false, bool wholeWord = false)
+	{
+		TextSearch search (vector<string> (1, pattern), caseSensitive);
+		TextSearch::Matches matches;
+		return search.search (unicodeText (text), matches, wholeWord);
+	}
+
+} // namespace
+
+bool
+textsearch (UNUSED_PARAM ostream& oss)
+{
+	// case folding of latin, greek and cyrillic letters
+	CPPUNIT_ASSERT_EQUAL ((size_t)2, countMatches ("hello", "Hello HELLO"));
+	CPPUNIT_ASSERT_EQUAL ((size_t)1, countMatches ("hello", "Hello HELLO hello", true));
+	CPPUNIT_ASSERT_EQUAL ((size_t)1, countMatches ("\xce\xb1\xce\xb2\xce\xb3", "\xce\x91\xce\x92\xce\x93"));
+	CPPUNIT_ASSERT_EQUAL ((size_t)1, countMatches ("\xd0\xbc\xd0\xb8\xd1\x80", "\xd0\x9c\xd0\x98\xd0\xa0"));
+	CPPUNIT_ASSERT_EQUAL ((size_t)1, countMatches ("\xc3\xa9t\xc3\xa9", "\xc3\x89T\xc3\x89"));
+	CPPUNIT_ASSERT_EQUAL ((size_t)0, countMatches ("\xc3\xa9t\xc3\xa9", "\xc3\x89T\xc3\x89", true));
+
+	// UTF-8 patterns match unicode characters, invalid UTF-8 is latin-1
+	TextSearch::Text text = unicodeText ("\xc4\x8d" "aj");
+	CPPUNIT_ASSERT_EQUAL ((size_t)3, text.size());
+	CPPUNIT_ASSERT_EQUAL ((::Unicode)0x10D, text[0]);
+	CPPUNIT_ASSERT (!TextSearch::decodeUtf8 ("\xe9t\xe9", text));
+	{
+		TextSearch search (vector<string> (1, "\xe9t\xe9"));
+		TextSearch::Matches matches;
+		::Unicode latin[] = {'x', 0xE9, 't', 0xE9};
+		CPPUNIT_ASSERT_EQUAL ((size_t)1, search.search (TextSearch::Text (latin, latin + 4), matches));
+		CPPUNIT_ASSERT_EQUAL ((size_t)1, matches.front().begin);
+		CPPUNIT_ASSERT_EQUAL ((size_t)4, matches.front().end);
+	}
+
+	// white spaces are normalized
+	CPPUNIT_ASSERT_EQUAL ((size_t)1, countMatches ("a  b", "a\tb"));
+
+	// whole words
+	CPPUNIT_ASSERT_EQUAL ((size_t)4, countMatches ("cat", "cat concat cats cat."));
+	CPPUNIT_ASSERT_EQUAL ((size_t)2, countMatches ("cat", "cat concat cats cat.", false, true));
+	CPPUNIT_ASSERT_EQUAL ((size_t)1, countMatches ("\xc4\x8d" "aj", "\xc4\x8d" "ajovna \xc4\x8c" "aj", false, true));
+
+	// all patterns in one pass
+	vector<string> patterns;
+	patterns.push_back ("he");
+	patterns.push_back ("she");
+	patterns.push_back ("his");
+	patterns.push_back ("hers");
+	TextSearch search (patterns);
+	TextSearch::Matches matches;
+	CPPUNIT_ASSERT_EQUAL ((size_t)3, search.search (unicodeText ("ushers"), matches));
+	for (TextSearch::Matches::const_iterator it = matches.begin(); it != matches.end(); ++it)
+	{
+		CPPUNIT_ASSERT (it->pattern != 2);
+		CPPUNIT_ASSERT_EQUAL (patterns[it->pattern].length(), it->end - it->begin);
+		// ordered by end positions
+		if (it != matches.begin())
+			CPPUNIT_ASSERT ((it - 1)->end <= it->end);
+	}
+
+	return true;
+}
+
+//=====================================================================================
+
+bool
+textlayer (UNUSED_PARAM ostream& oss, const char* fileName)
+{
+	boost::shared_ptr<CPdf> pdf = getTestCPdf (fileName);
+	// square rectangle isn't affected by rotation
+	const libs::Rectangle rc (0, 0, 10000, 10000);
+
+	for (size_t i = 0; i < pdf->getPageCount() && i < TEST_MAX_PAGE_COUNT; ++i)
+	{
+		boost::shared_ptr<CPage> page = pdf->getPage (i+1);
+
+		// repeated extraction uses the same text layer
+		string text, again;
+		page->getText (text, NULL, &rc);
+		page->getText (again, NULL, &rc);
+		CPPUNIT_ASSERT_EQUAL (text, again);
+
+		vector<shared_ptr<CContentStream> > ccs;
+		page->getContentStreams (ccs);
+		if (ccs.empty())
+			continue;
+		CContentStream::Operators ops;
+		ccs.front()->getPdfOperators (ops);
+		if (ops.empty())
+			continue;
+
+		// change of an operator has to drop the text layer
+		ccs.front()->deleteOperator (PdfOperator::getIterator (ops.front()));
+		page->getText (text, NULL, &rc);
+		TextOutputDev textDev (NULL, gFalse, 0, gFalse, gFalse);
+		page->displayPage (textDev);
+		scoped_ptr<GooString> displayed (textDev.getText (rc.xleft, rc.yleft, rc.xright, rc.yright));
+		CPPUNIT_ASSERT_EQUAL (string (displayed->getCString()), text);
+
+		_working (oss);
+	}
+	
+	return true;
+}
+
+//=====================================================================================
+
+bool
+textlayerlimit (UNUSED_PARAM ostream& oss, const char* fileName)
+{
+	boost::shared_ptr<CPdf> pdf = getTestCPdf (fileName);
+	const libs::Rectangle rc (0, 0, 10000, 10000);
+	size_t count = std::min (pdf->getPageCount(), (size_t)TEST_MAX_PAGE_COUNT);
+
+	// only the last used page keeps its layer, released layers are 
+	// extracted again with the same text and version
+	pdf->setTextLayerLimit (1);
+	vector<string> texts (count);
+	vector<size_t> versions (count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		boost::shared_ptr<CPage> page = pdf->getPage (i+1);
+		page->getText (texts[i], NULL, &rc);
+		versions[i] = page->getTextVersion ();
+	}
+	for (size_t i = 0; i < count; ++i)
+	{
+		boost::shared_ptr<CPage> page = pdf->getPage (i+1);
+		string text;
+		page->getText (text, NULL, &rc);
+		CPPUNIT_ASSERT_EQUAL (texts[i], text);
+		CPPUNIT_ASSERT_EQUAL (versions[i], page->getTextVersion ());
+	}
+	pdf->setTextLayerLimit (CPdf::DEFAULT_TEXT_LAYER_LIMIT);
+
+	// change of the content stream data has to change the text version
+	for (size_t i = 0; i < count; ++i)
+	{
+		boost::shared_ptr<CPage> page = pdf->getPage (i+1);
+		if (!page->getDictionary()->containsProperty ("Contents"))
+			continue;
+		boost::shared_ptr<IProperty> contents = utils::getReferencedObject (page->getDictionary()->getProperty ("Contents"));
+		if (!isStream (contents))
+			continue;
+		boost::shared_ptr<CStream> stream = IProperty::getSmartCObjectPtr<CStream> (contents);
+		string text;
+		page->getText (text, NULL, &rc);
+		size_t version = page->getTextVersion ();
+		CStream::Buffer buf (stream->getDecodedBuffer ());
+		stream->setBuffer (buf);
+		CPPUNIT_ASSERT (version != page->getTextVersion ());
+		break;
+	}
+
+	return true;
+}
+
 //=====================================================================================
 
 bool
@@ -631,6 +888,10 @@ public:
 	{
 		OUTPUT << "CPage find..." << endl;
 		
+		TEST(" text search");
+		CPPUNIT_ASSERT (textsearch (OUTPUT));
+		OK_TEST;
+
 		for(TestParams::FileList::const_iterator it = TestParams::instance().files.begin(); 
 				it != TestParams::instance().files.end(); 
 					++it)
@@ -640,6 +901,18 @@ public:
 			TEST(" find text");
 			CPPUNIT_ASSERT (findtext (OUTPUT, (*it).c_str()));
 			OK_TEST;
+			
+			TEST(" find texts");
+			CPPUNIT_ASSERT (findtexts (OUTPUT, (*it).c_str()));
+			OK_TEST;
+
+			TEST(" text layer");
+			CPPUNIT_ASSERT (textlayer (OUTPUT, (*it).c_str()));
+			OK_TEST;
+
+			TEST(" text layer limit");
+			CPPUNIT_ASSERT (textlayerlimit (OUTPUT, (*it).c_str()));
+			OK_TEST;
 		}
 	}
 	//
@@ -30,7 +30,15 @@
 #include "kernel/cobjecthelpers.h"
 #include "kernel/cpdf.h"
 #include "kernel/pdfwriter.h"
+#include "kernel/deflatepool.h"
+#include "kernel/xrefwriter.h"
 #include "kernel/delinearizator.h"
+#include "kernel/flattener.h"
+#include "kernel/parallelpages.h"
+#include "kernel/textindex.h"
+#include "kernel/cpage.h"
+#include <zlib.h>
+#include <algorithm>
 
 using namespace pdfobjects;
 using namespace utils;
@@ -77,6 +85,32 @@ public:
 	}
 };
 
+/** Observer which counts received notifications.
+ */
+class CountingObserver:public IObserver<IProperty>
+{
+public:
+	mutable int counter;
+	mutable boost::shared_ptr<IProperty> lastValue;
+	mutable boost::shared_ptr<const IChangeContext<IProperty> > lastContext;
+
+	CountingObserver():counter(0){}
+
+	virtual ~CountingObserver()throw(){}
+
+	void notify(boost::shared_ptr<IProperty> newValue, boost::shared_ptr<const IChangeContext<IProperty> > context)const throw()
+	{
+		++counter;
+		lastValue=newValue;
+		lastContext=context;
+	}
+
+	priority_t getPriority()const throw()
+	{
+		return 0;
+	}
+};
+
 class TestCPdf: public CppUnit::TestFixture
 {
 	CPPUNIT_TEST_SUITE(TestCPdf);
@@ -370,6 +404,18 @@ public:
 
 		// page count is same as in original file now
 
+		printf("TC01:\tpage positions after insertPage, removePage in the middle\n");
+		size_t middle=pageCount/2+1;
+		shared_ptr<CPage> middlePage=pdf->insertPage(pdf->getPage(1), middle);
+		CPPUNIT_ASSERT(pdf->getPagePosition(middlePage)==middle);
+		CPPUNIT_ASSERT(pdf->getPagePosition(newPage)==1);
+		for(size_t pos=1; pos<=pdf->getPageCount(); pos++)
+			CPPUNIT_ASSERT(pdf->getPagePosition(pdf->getPage(pos))==pos);
+		pdf->removePage(middle);
+		CPPUNIT_ASSERT(pageCount==pdf->getPageCount());
+		for(size_t pos=1; pos<=pdf->getPageCount(); pos++)
+			CPPUNIT_ASSERT(pdf->getPagePosition(pdf->getPage(pos))==pos);
+
 		printf("TC02:\tremovePage out of range test\n");
 		// remove from 0 page should fail
 		try
@@ -1117,6 +1163,95 @@ public:
 		CPPUNIT_ASSERT(changedIntProp->getIndiRef()==originalIntProp->getIndiRef());
 	}
 
+	void indirectCacheTC(string fileName)
+	{
+	using namespace boost;
+	using namespace utils;
+
+		printf("%s\n", __FUNCTION__);
+
+		// cache is not bounded unless asked for
+		CPPUNIT_ASSERT(CPdf::getInstance(fileName.c_str(), CPdf::ReadOnly)->getIndirectCacheLimit()==0);
+
+		// very small cache to force evictions
+		size_t limit=4;
+		shared_ptr<CPdf> pdf=CPdf::getInstance(fileName.c_str(), CPdf::ReadOnly, limit);
+		CPPUNIT_ASSERT(pdf->getIndirectCacheLimit()==limit);
+		if(!pdf->getPageCount())
+		{
+			printf("Usecase is not suitable because document has no pages\n");
+			return;
+		}
+
+		printf("TC01:\theld indirect property survives cache shrinking\n");
+		shared_ptr<CDict> firstDict=pdf->getFirstPage()->getDictionary();
+		IndiRef firstRef=firstDict->getIndiRef();
+		for(size_t pos=1; pos<=pdf->getPageCount(); ++pos)
+		{
+			shared_ptr<CDict> pageDict=pdf->getPage(pos)->getDictionary();
+			CPPUNIT_ASSERT(pdf->getIndirectProperty(pageDict->getIndiRef())==pageDict);
+		}
+		CPPUNIT_ASSERT(pdf->getIndirectProperty(firstRef)==firstDict);
+
+		printf("TC02:\tevicted property is fetched again with same value\n");
+		// collects some objects which are not held by anybody
+		std::vector<IndiRef> refs;
+		for(int num=1; num<pdf->getCXref()->getNumObjects() && refs.size()<4*limit; ++num)
+		{
+			IndiRef ref(num, 0);
+			if(pdf->getCXref()->knowsRef(ref)==INITIALIZED_REF)
+				refs.push_back(ref);
+		}
+		if(refs.empty())
+			return;
+		string original;
+		pdf->getIndirectProperty(refs.front())->getStringRepresentation(original);
+		for(std::vector<IndiRef>::const_iterator i=refs.begin(); i!=refs.end(); ++i)
+			pdf->getIndirectProperty(*i);
+		string fetched;
+		pdf->getIndirectProperty(refs.front())->getStringRepresentation(fetched);
+		CPPUNIT_ASSERT(original==fetched);
+		CPPUNIT_ASSERT(!pdf->isChanged());
+
+		printf("TC03:\tunbounded cache keeps all instances\n");
+		pdf->setIndirectCacheLimit(0);
+		CPPUNIT_ASSERT(pdf->getIndirectCacheLimit()==0);
+		IProperty * first=pdf->getIndirectProperty(refs.front()).get();
+		for(std::vector<IndiRef>::const_iterator i=refs.begin(); i!=refs.end(); ++i)
+			pdf->getIndirectProperty(*i);
+		CPPUNIT_ASSERT(pdf->getIndirectProperty(refs.front()).get()==first);
+	}
+
+	void releaseRefTC(string fileName)
+	{
+		printf("%s\n", __FUNCTION__);
+
+		boost::shared_ptr<CPdf> pdf=getTestCPdf(fileName.c_str(), CPdf::ReadWrite);
+		if(pdf->getMode()==CPdf::ReadOnly)
+		{
+			printf("%s: Document is read only and it is not usable for this test\n", __FUNCTION__);
+			return;
+		}
+		XRefWriter * xref=dynamic_cast<XRefWriter*>(pdf->getCXref());
+		CPPUNIT_ASSERT(xref);
+
+		printf("TC01:\treleased reference is reused by the next reservation\n");
+		::Ref first=xref->reserveRef();
+		::Ref second=xref->reserveRef();
+		CPPUNIT_ASSERT(xref->releaseRef(first));
+		CPPUNIT_ASSERT(xref->knowsRef(first)!=RESERVED_REF);
+		::Ref again=xref->reserveRef();
+		CPPUNIT_ASSERT(again.num==first.num && again.gen==first.gen);
+
+		printf("TC02:\tonly reserved references can be released\n");
+		boost::shared_ptr<IProperty> value(CIntFactory::getInstance(1));
+		IndiRef added=pdf->addIndirectProperty(value);
+		::Ref addedRef={added.num, added.gen};
+		CPPUNIT_ASSERT(!xref->releaseRef(addedRef));
+		CPPUNIT_ASSERT(xref->knowsRef(addedRef)==INITIALIZED_REF);
+		CPPUNIT_ASSERT(xref->releaseRef(second));
+	}
+
 	void delinearizatorTC(string fileName)
 	{
 	using namespace pdfobjects::utils;
@@ -1139,6 +1274,636 @@ public:
 		delinearizator->delinearize(outputFile.c_str());
 	}
 
+	/** Compares all indirect objects (with generation 0) known in both 
+	 * documents. Output writers keep object numbers and flattener drops
+	 * only unreachable objects, so all of them should be the same. Streams
+	 * are compared by their decoded data if compareStreams is set and
+	 * skipped otherwise. Returns number of compared objects.
+	 */
+	size_t compareIndirectObjects(boost::shared_ptr<CPdf> original, boost::shared_ptr<CPdf> other, 
+			bool compareStreams)
+	{
+		size_t compared=0;
+		for(int num=1; num<original->getCXref()->getNumObjects(); ++num)
+		{
+			IndiRef ref(num, 0);
+			if(original->getCXref()->knowsRef(ref)!=INITIALIZED_REF 
+					|| other->getCXref()->knowsRef(ref)!=INITIALIZED_REF)
+				continue;
+			boost::shared_ptr<IProperty> origObj=original->getIndirectProperty(ref);
+			boost::shared_ptr<IProperty> newObj=other->getIndirectProperty(ref);
+			CPPUNIT_ASSERT(origObj->getType()==newObj->getType());
+			string origStr, newStr;
+			if(isStream(origObj))
+			{
+				if(!compareStreams)
+					continue;
+				IProperty::getSmartCObjectPtr<CStream>(origObj)->getDecodedStringRepresentation(origStr);
+				IProperty::getSmartCObjectPtr<CStream>(newObj)->getDecodedStringRepresentation(newStr);
+			}else
+			{
+				origObj->getStringRepresentation(origStr);
+				newObj->getStringRepresentation(newStr);
+			}
+			CPPUNIT_ASSERT(origStr==newStr);
+			compared++;
+		}
+		return compared;
+	}
+
+	void xrefStreamTC(string fileName)
+	{
+	using namespace pdfobjects::utils;
+
+		printf("%s\n", __FUNCTION__);
+
+		// flattens document with cross reference stream writer and checks
+		// that the result is readable and has the same pages
+		boost::shared_ptr<Flattener> flattener=Flattener::getInstance(fileName.c_str(), new XRefStreamPdfWriter());
+		if(!flattener)
+			return;
+		string outputFile=fileName+"-xrefstream.pdf";
+		printf("\tFlattened output with xref stream is in %s file\n", outputFile.c_str());
+		CPPUNIT_ASSERT(!flattener->flatten(outputFile.c_str()));
+
+		boost::shared_ptr<CPdf> original=getTestCPdf(fileName.c_str(), CPdf::ReadOnly);
+		boost::shared_ptr<CPdf> compressed=getTestCPdf(outputFile.c_str(), CPdf::ReadOnly);
+		CPPUNIT_ASSERT(original->getPageCount()==compressed->getPageCount());
+		if(original->getPageCount())
+		{
+			string origPage, newPage;
+			original->getFirstPage()->getDictionary()->getStringRepresentation(origPage);
+			compressed->getFirstPage()->getDictionary()->getStringRepresentation(newPage);
+			CPPUNIT_ASSERT(origPage==newPage);
+		}
+
+		// all (possibly packed) non stream objects have to be the same 
+		// after reopen
+		size_t compared=compareIndirectObjects(original, compressed, false);
+		printf("\t%u objects are the same after reopen\n", (unsigned)compared);
+	}
+
+	void pipelinedCompressionTC(string fileName)
+	{
+	using namespace pdfobjects::utils;
+
+		printf("%s\n", __FUNCTION__);
+
+		// pool output has to inflate to the same bytes as submitted (also 
+		// when threads are not available and pool compresses serially)
+		DeflatePool pool(4);
+		std::vector<DeflatePool::JobId> ids;
+		std::vector<std::string> inputs;
+		for(size_t i=0; i<16; ++i)
+		{
+			std::string data;
+			for(size_t j=0; j<(i+1)*997; ++j)
+				data+=(char)((j*i+j/7)&0xff);
+			inputs.push_back(data);
+			unsigned char * buf=(unsigned char *)malloc(data.length());
+			memcpy(buf, data.data(), data.length());
+			ids.push_back(pool.submit(buf, data.length()));
+		}
+		for(size_t i=0; i<ids.size(); ++i)
+		{
+			unsigned char * in;
+			size_t inSize, size;
+			unsigned char * out=pool.wait(ids[i], in, inSize, size);
+			CPPUNIT_ASSERT(out);
+			std::vector<unsigned char> inflated(inputs[i].length());
+			uLongf inflatedSize=inflated.size();
+			CPPUNIT_ASSERT(uncompress(&inflated[0], &inflatedSize, out, size)==Z_OK);
+			CPPUNIT_ASSERT(inflatedSize==inputs[i].length());
+			CPPUNIT_ASSERT(!memcmp(&inflated[0], inputs[i].data(), inflatedSize));
+			free(in);
+			free(out);
+		}
+
+		// all streams written by the pipelined writer have to decode to the
+		// same data as in the original document
+		IPdfWriter * writer=new OldStylePdfWriter();
+		writer->setCompressionThreads(4);
+		boost::shared_ptr<Flattener> flattener=Flattener::getInstance(fileName.c_str(), writer);
+		if(!flattener)
+			return;
+		string outputFile=fileName+"-pipelined.pdf";
+		CPPUNIT_ASSERT(!flattener->flatten(outputFile.c_str()));
+
+		boost::shared_ptr<CPdf> original=getTestCPdf(fileName.c_str(), CPdf::ReadOnly);
+		boost::shared_ptr<CPdf> pipelined=getTestCPdf(outputFile.c_str(), CPdf::ReadOnly);
+		size_t compared=compareIndirectObjects(original, pipelined, true);
+		printf("\t%u objects are the same after pipelined compression\n", (unsigned)compared);
+	}
+
+	void compressionPolicyTC(string fileName)
+	{
+	using namespace pdfobjects::utils;
+
+		printf("%s\n", __FUNCTION__);
+
+		// unchanged streams are passed through - output has to be still
+		// readable with the same pages
+		IPdfWriter * writer=new OldStylePdfWriter();
+		writer->setCompressionPolicy(CompressionPolicy::fastest());
+		boost::shared_ptr<Flattener> flattener=Flattener::getInstance(fileName.c_str(), writer);
+		if(!flattener)
+			return;
+		string outputFile=fileName+"-passthrough.pdf";
+		CPPUNIT_ASSERT(!flattener->flatten(outputFile.c_str()));
+
+		boost::shared_ptr<CPdf> original=getTestCPdf(fileName.c_str(), CPdf::ReadOnly);
+		boost::shared_ptr<CPdf> passed=getTestCPdf(outputFile.c_str(), CPdf::ReadOnly);
+		CPPUNIT_ASSERT(original->getPageCount()==passed->getPageCount());
+	}
+
+	void rawCopyTC(string fileName)
+	{
+	using namespace pdfobjects::utils;
+
+		printf("%s\n", __FUNCTION__);
+
+		// all unchanged objects are copied byte by byte - output has to be
+		// readable with the same pages
+		boost::shared_ptr<Flattener> flattener=Flattener::getInstance(fileName.c_str(), new OldStylePdfWriter());
+		if(!flattener)
+			return;
+		flattener->setRawCopy(true);
+		string outputFile=fileName+"-rawcopy.pdf";
+		CPPUNIT_ASSERT(!flattener->flatten(outputFile.c_str()));
+
+		boost::shared_ptr<CPdf> original=getTestCPdf(fileName.c_str(), CPdf::ReadOnly);
+		boost::shared_ptr<CPdf> copied=getTestCPdf(outputFile.c_str(), CPdf::ReadOnly);
+		CPPUNIT_ASSERT(original->getPageCount()==copied->getPageCount());
+		size_t compared=compareIndirectObjects(original, copied, true);
+		printf("\t%u objects are the same after raw copy\n", (unsigned)compared);
+	}
+
+	void rawCopyKeywordsTC()
+	{
+	using namespace pdfobjects::utils;
+
+		printf("%s\n", __FUNCTION__);
+
+		// endobj and stream keywords inside strings, comments, names and 
+		// stream data mustn't confuse raw copy
+		const char * objects[] = {
+			"1 0 obj\n<< /Type /Catalog /Pages 2 0 R >>\nendobj\n",
+			"2 0 obj\n<< /Type /Pages /Kids [3 0 R] /Count 1 >>\nendobj\n",
+			"3 0 obj\n<< /Type /Page /Parent 2 0 R /MediaBox [0 0 612 792] /Contents 4 0 R\n"
+				"/PieceInfo << /endobj (fake \\) endobj (nested) stream) >> >> % endobj stream\nendobj\n",
+			"4 0 obj\n<< /Length 26 >>\nstream\n(endobj) Tj\nendobj stream\nendstream\nendobj\n",
+			NULL
+		};
+		string data="%PDF-1.4\n";
+		std::vector<size_t> offsets;
+		for(size_t i=0; objects[i]; ++i)
+		{
+			offsets.push_back(data.length());
+			data+=objects[i];
+		}
+		size_t xrefPos=data.length();
+		std::ostringstream xref;
+		xref << "xref\n0 " << offsets.size()+1 << "\n0000000000 65535 f \n";
+		for(size_t i=0; i<offsets.size(); ++i)
+			xref << std::setw(10) << std::setfill('0') << offsets[i] << " 00000 n \n";
+		xref << "trailer\n<< /Size " << offsets.size()+1 << " /Root 1 0 R >>\n"
+			<< "startxref\n" << xrefPos << "\n%%EOF\n";
+		data+=xref.str();
+
+		string fileName="rawcopy-keywords.pdf";
+		FILE * f=fopen(fileName.c_str(), "wb");
+		CPPUNIT_ASSERT(f);
+		CPPUNIT_ASSERT(fwrite(data.data(), 1, data.length(), f)==data.length());
+		fclose(f);
+
+		boost::shared_ptr<Flattener> flattener=Flattener::getInstance(fileName.c_str(), new OldStylePdfWriter());
+		CPPUNIT_ASSERT(flattener);
+		flattener->setRawCopy(true);
+		string outputFile=fileName+"-rawcopy.pdf";
+		CPPUNIT_ASSERT(!flattener->flatten(outputFile.c_str()));
+		flattener.reset();
+
+		boost::shared_ptr<CPdf> original=getTestCPdf(fileName.c_str(), CPdf::ReadOnly);
+		boost::shared_ptr<CPdf> copied=getTestCPdf(outputFile.c_str(), CPdf::ReadOnly);
+		CPPUNIT_ASSERT(compareIndirectObjects(original, copied, true)==offsets.size());
+		remove(outputFile.c_str());
+		remove(fileName.c_str());
+	}
+
+	/** Checks that no node of the page tree has more than fanOut kids and
+	 * that all pages are in the same depth. Returns depth of pages.
+	 */
+	size_t checkBalancedNode(boost::shared_ptr<CDict> node, size_t fanOut)
+	{
+		boost::shared_ptr<CArray> kids=node->getProperty<CArray>("Kids");
+		CPPUNIT_ASSERT(kids->getPropertyCount()<=fanOut);
+		size_t depth=0;
+		for(size_t i=0; i<kids->getPropertyCount(); ++i)
+		{
+			boost::shared_ptr<CDict> kid=utils::getCObjectFromRef<CDict>(kids->getProperty(i));
+			CPPUNIT_ASSERT(utils::getCObjectFromRef<CDict>(kid->getProperty("Parent"))==node);
+			size_t kidDepth=(utils::getNodeType(kid)==utils::LeafNode)?1:checkBalancedNode(kid, fanOut)+1;
+			if(i)
+				CPPUNIT_ASSERT(kidDepth==depth);
+			depth=kidDepth;
+		}
+		return depth;
+	}
+
+	/** Collects references of all intermediate nodes under node.
+	 */
+	void collectInterNodes(boost::shared_ptr<CDict> node, vector<IndiRef> & refs)
+	{
+		boost::shared_ptr<CArray> kids=node->getProperty<CArray>("Kids");
+		for(size_t i=0; i<kids->getPropertyCount(); ++i)
+		{
+			boost::shared_ptr<IProperty> kid=kids->getProperty(i);
+			if(!isRef(kid) || utils::getNodeType(kid)!=utils::InterNode)
+				continue;
+			IndiRef ref=utils::getValueFromSimple<CRef>(kid);
+			if(std::find(refs.begin(), refs.end(), ref)!=refs.end())
+				continue;
+			refs.push_back(ref);
+			collectInterNodes(utils::getCObjectFromRef<CDict>(kid), refs);
+		}
+	}
+
+	void pageBatchTC(string fileName)
+	{
+		printf("%s\n", __FUNCTION__);
+
+		boost::shared_ptr<CPdf> pdf=getTestCPdf(fileName.c_str(), CPdf::ReadWrite);
+		if(pdf->getMode()==CPdf::ReadOnly || !pdf->getPageCount())
+		{
+			printf("%s: Document is read only or empty and it is not usable for this test\n", __FUNCTION__);
+			return;
+		}
+		boost::shared_ptr<CPdf> source=getTestCPdf(fileName.c_str(), CPdf::ReadOnly);
+		size_t pageCount=pdf->getPageCount();
+		boost::shared_ptr<CPage> first=pdf->getPage(1);
+
+		// appends all pages again and removes the first one
+		pdf->beginPageBatch();
+		CPPUNIT_ASSERT(pdf->inPageBatch());
+		for(size_t i=1; i<=pageCount; ++i)
+			pdf->insertPage(source->getPage(i), pdf->getPageCount()+1);
+		boost::shared_ptr<CPage> inserted=pdf->insertPage(source->getPage(1), 2);
+		CPPUNIT_ASSERT(pdf->getPagePosition(inserted)==2);
+		CPPUNIT_ASSERT(pdf->getPagePosition(first)==1);
+		pdf->removePage(1);
+		CPPUNIT_ASSERT(pdf->getPageCount()==2*pageCount);
+		CPPUNIT_ASSERT(pdf->getPagePosition(inserted)==1);
+
+		vector<IndiRef> oldNodes;
+		collectInterNodes(utils::getPageTreeRoot(pdf), oldNodes);
+
+		const size_t fanOut=3;
+		pdf->commitPageBatch(fanOut);
+		CPPUNIT_ASSERT(!pdf->inPageBatch());
+		CPPUNIT_ASSERT(pdf->getPageCount()==2*pageCount);
+		CPPUNIT_ASSERT(pdf->getPagePosition(inserted)==1);
+		size_t depth=checkBalancedNode(utils::getPageTreeRoot(pdf), fanOut);
+		size_t height=1;
+		for(size_t capacity=fanOut; capacity<pdf->getPageCount(); capacity*=fanOut)
+			++height;
+		CPPUNIT_ASSERT(depth==height);
+		for(size_t pos=1; pos<=pdf->getPageCount(); pos++)
+			CPPUNIT_ASSERT(pdf->getPagePosition(pdf->getPage(pos))==pos);
+
+		// replaced intermediate nodes are freed
+		for(vector<IndiRef>::const_iterator i=oldNodes.begin(); i!=oldNodes.end(); ++i)
+			CPPUNIT_ASSERT(pdf->getCXref()->knowsRef(*i)==UNUSED_REF);
+
+		// page tree observers have to work normally after rebuild
+		pdf->removePage(pdf->getPageCount());
+		CPPUNIT_ASSERT(pdf->getPageCount()==2*pageCount-1);
+		CPPUNIT_ASSERT(pdf->getPagePosition(inserted)==1);
+
+		// uneven number of pages has to keep all pages in the same depth 
+		// as well
+		oldNodes.clear();
+		collectInterNodes(utils::getPageTreeRoot(pdf), oldNodes);
+		pdf->commitPageBatch(2);
+		checkBalancedNode(utils::getPageTreeRoot(pdf), 2);
+		for(vector<IndiRef>::const_iterator i=oldNodes.begin(); i!=oldNodes.end(); ++i)
+			CPPUNIT_ASSERT(pdf->getCXref()->knowsRef(*i)==UNUSED_REF);
+		for(size_t pos=1; pos<=pdf->getPageCount(); pos++)
+			CPPUNIT_ASSERT(pdf->getPagePosition(pdf->getPage(pos))==pos);
+	}
+
+	void transactionTC(string fileName)
+	{
+		printf("%s\n", __FUNCTION__);
+
+		boost::shared_ptr<CPdf> pdf=getTestCPdf(fileName.c_str(), CPdf::ReadWrite);
+		if(pdf->getMode()==CPdf::ReadOnly || !pdf->getPageCount())
+		{
+			printf("%s: Document is read only or empty and it is not usable for this test\n", __FUNCTION__);
+			return;
+		}
+		boost::shared_ptr<CDict> pageDict=pdf->getPage(1)->getDictionary();
+		boost::shared_ptr<CountingObserver> observer(new CountingObserver());
+		REGISTER_SHAREDPTR_OBSERVER(pageDict, observer);
+
+		printf("\tNotifications are delivered immediately without transaction\n");
+		boost::scoped_ptr<CInt> value(CIntFactory::getInstance(0));
+		pageDict->setProperty("PdfEditTag", *value);
+		CPPUNIT_ASSERT(observer->counter==1);
+		
+		printf("\tChanges of the same entry are coalesced\n");
+		observer->counter=0;
+		pdf->beginTransaction();
+		CPPUNIT_ASSERT(pdf->inTransaction());
+		for(int i=1; i<=10; ++i)
+		{
+			value->setValue(i);
+			pageDict->setProperty("PdfEditTag", *value);
+		}
+		pageDict->setProperty("PdfEditTag1", *value);
+		{
+			// nested transaction doesn't deliver anything
+			CPdf::Transaction transaction(pdf);
+			pageDict->setProperty("PdfEditTag1", *value);
+		}
+		CPPUNIT_ASSERT(observer->counter==0);
+		pdf->commitTransaction();
+		CPPUNIT_ASSERT(!pdf->inTransaction());
+		CPPUNIT_ASSERT(observer->counter==2);
+
+		printf("\tConsolidated notification contains original and the last value\n");
+		observer->counter=0;
+		{
+			CPdf::Transaction transaction(pdf);
+			for(int i=11; i<=20; ++i)
+			{
+				value->setValue(i);
+				pageDict->setProperty("PdfEditTag", *value);
+			}
+		}
+		CPPUNIT_ASSERT(observer->counter==1);
+		int newValue=getIntFromIProperty(observer->lastValue);
+		CPPUNIT_ASSERT(newValue==20);
+		boost::shared_ptr<const CDict::CDictComplexObserverContext> context=
+			dynamic_pointer_cast<const CDict::CDictComplexObserverContext, 
+			const IChangeContext<IProperty> >(observer->lastContext);
+		CPPUNIT_ASSERT(context);
+		CPPUNIT_ASSERT(context->getValueId()=="PdfEditTag");
+		int originalValue=getIntFromIProperty(context->getOriginalValue());
+		CPPUNIT_ASSERT(originalValue==10);
+
+		printf("\tNotifications of destroyed objects are dropped\n");
+		observer->counter=0;
+		{
+			CPdf::Transaction transaction(pdf);
+			boost::shared_ptr<CDict> dict(CDictFactory::getInstance());
+			boost::shared_ptr<CDict> added=IProperty::getSmartCObjectPtr<CDict>(
+					pageDict->setProperty("PdfEditTagDict", *dict));
+			REGISTER_SHAREDPTR_OBSERVER(added, observer);
+			added->setProperty("PdfEditTag", *value);
+			UNREGISTER_SHAREDPTR_OBSERVER(added, observer);
+			pageDict->delProperty("PdfEditTagDict");
+		}
+		CPPUNIT_ASSERT(observer->counter==1);
+
+		printf("\tChanges of arrays are delivered in order\n");
+		boost::shared_ptr<CArray> array(CArrayFactory::getInstance());
+		boost::shared_ptr<CArray> addedArray=IProperty::getSmartCObjectPtr<CArray>(
+				pageDict->setProperty("PdfEditTagArray", *array));
+		boost::shared_ptr<CountingObserver> arrayObserver(new CountingObserver());
+		REGISTER_SHAREDPTR_OBSERVER(addedArray, arrayObserver);
+		{
+			CPdf::Transaction transaction(pdf);
+			for(int i=0; i<3; ++i)
+			{
+				value->setValue(i);
+				addedArray->addProperty(*value);
+			}
+			addedArray->delProperty(0);
+			CPPUNIT_ASSERT(arrayObserver->counter==0);
+		}
+		CPPUNIT_ASSERT(arrayObserver->counter==4);
+		boost::shared_ptr<const CArray::CArrayComplexObserverContext> arrayContext=
+			dynamic_pointer_cast<const CArray::CArrayComplexObserverContext, 
+			const IChangeContext<IProperty> >(arrayObserver->lastContext);
+		CPPUNIT_ASSERT(arrayContext);
+		CPPUNIT_ASSERT(arrayContext->getValueId()==0);
+		CPPUNIT_ASSERT(addedArray->getPropertyCount()==2);
+		UNREGISTER_SHAREDPTR_OBSERVER(addedArray, arrayObserver);
+		pageDict->delProperty("PdfEditTagArray");
+
+		printf("\tTransaction left by an exception delivers pending notifications\n");
+		observer->counter=0;
+		try
+		{
+			CPdf::Transaction transaction(pdf);
+			pageDict->setProperty("PdfEditTag", *value);
+			throw PageNotFoundException(0);
+		}catch(PageNotFoundException &)
+		{
+		}
+		CPPUNIT_ASSERT(!pdf->inTransaction());
+		CPPUNIT_ASSERT(observer->counter==1);
+		observer->counter=0;
+		{
+			// following transactions work normally
+			CPdf::Transaction transaction(pdf);
+			pageDict->setProperty("PdfEditTag", *value);
+		}
+		CPPUNIT_ASSERT(observer->counter==1);
+
+		UNREGISTER_SHAREDPTR_OBSERVER(pageDict, observer);
+	}
+
+	/** Page processor which returns page text.
+	 * Fails on failPos page if it is non 0.
+	 */
+	struct TextProcessor: public PageProcessor
+	{
+		size_t failPos;
+		TextProcessor(size_t _failPos=0):failPos(_failPos){}
+		virtual void process(boost::shared_ptr<CPage> page, size_t pos, string & result)
+		{
+			if(pos==failPos)
+				throw PageNotFoundException(pos);
+			page->getText(result);
+		}
+	};
+
+	void parallelPagesTC(string fileName)
+	{
+		printf("%s\n", __FUNCTION__);
+
+		boost::shared_ptr<CPdf> pdf=getTestCPdf(fileName.c_str(), CPdf::ReadOnly);
+		size_t pageCount=pdf->getPageCount();
+		if(!pageCount)
+		{
+			printf("%s: Document is empty and it is not usable for this test\n", __FUNCTION__);
+			return;
+		}
+
+		printf("\tResults are the same as from serial processing\n");
+		TextProcessor processor;
+		ParallelPages::Results serial;
+		for(size_t i=1; i<=pageCount; ++i)
+		{
+			string text;
+			processor.process(pdf->getPage(i), i, text);
+			serial.push_back(text);
+		}
+		ParallelPages parallel(fileName, 4);
+		CPPUNIT_ASSERT(parallel.getPageCount()==pageCount);
+		ParallelPages::Results results;
+		parallel.process(processor, results);
+		CPPUNIT_ASSERT(results==serial);
+
+		printf("\tResults follow requested page order\n");
+		ParallelPages::Pages pages;
+		for(size_t i=pageCount; i>=1; --i)
+			pages.push_back(i);
+		pages.push_back(1);
+		parallel.process(processor, pages, results);
+		CPPUNIT_ASSERT(results.size()==pages.size());
+		for(size_t i=0; i<pages.size(); ++i)
+			CPPUNIT_ASSERT(results[i]==serial[pages[i]-1]);
+
+		printf("\tFailure of a page is reported\n");
+		TextProcessor failing(pageCount);
+		try
+		{
+			parallel.process(failing, results);
+			CPPUNIT_FAIL("Page processing failure not reported");
+		}catch(PageProcessingException & e)
+		{
+			size_t pos;
+			e.getPosition(pos);
+			CPPUNIT_ASSERT(pos==pageCount);
+		}
+	}
+
+	void textIndexTC(string fileName)
+	{
+		printf("%s\n", __FUNCTION__);
+
+		boost::shared_ptr<CPdf> pdf=getTestCPdf(fileName.c_str(), CPdf::ReadOnly);
+		size_t pageCount=std::min<size_t>(pdf->getPageCount(), TEST_MAX_PAGE_COUNT);
+
+		// finds a term on the first page with some text
+		string term;
+		size_t termPage=0;
+		for(size_t i=1; i<=pageCount && term.empty(); ++i)
+		{
+			CPageContents::Words words;
+			pdf->getPage(i)->getTextWords(words);
+			for(CPageContents::Words::iterator w=words.begin(); w!=words.end() && term.empty(); ++w)
+			{
+				term=TextIndex::normalize(w->text);
+				termPage=i;
+			}
+		}
+		if(term.empty())
+		{
+			printf("%s: Document has no text and it is not usable for this test\n", __FUNCTION__);
+			return;
+		}
+
+		printf("\tTerm is found on the page it comes from\n");
+		TextIndex index(pdf);
+		TextIndex::Hits hits;
+		CPPUNIT_ASSERT(index.search(term, hits));
+		bool found=false;
+		for(TextIndex::Hits::iterator h=hits.begin(); h!=hits.end(); ++h)
+		{
+			if(h->page==termPage)
+				found=true;
+			// hits are ordered by pages
+			if(h!=hits.begin())
+				CPPUNIT_ASSERT((h-1)->page<=h->page);
+		}
+		CPPUNIT_ASSERT(found);
+		CPPUNIT_ASSERT(!index.search("", hits));
+
+		printf("\tIndex survives save and load\n");
+		string indexFile=fileName+"-textindex";
+		CPPUNIT_ASSERT(index.save(indexFile));
+		TextIndex::Hits expected;
+		index.search(term, expected);
+		TextIndex loaded(pdf);
+		CPPUNIT_ASSERT(loaded.load(indexFile));
+		loaded.search(term, hits);
+		CPPUNIT_ASSERT(hits.size()==expected.size());
+		for(size_t i=0; i<hits.size(); ++i)
+			CPPUNIT_ASSERT(hits[i].page==expected[i].page && hits[i].bbox==expected[i].bbox);
+
+		printf("\tCorrupted index file drops the index\n");
+		{
+			std::ofstream corrupted(indexFile.c_str(), std::ios::out | std::ios::binary);
+			corrupted << TextIndex::FILE_MAGIC << "\n" << loaded.getDocumentKey() << "\n"
+				<< "page 1 0 0 1000000\n";
+		}
+		CPPUNIT_ASSERT(!loaded.load(indexFile));
+		CPPUNIT_ASSERT(loaded.getTermCount()==0);
+		loaded.search(term, hits);
+		CPPUNIT_ASSERT(hits.size()==expected.size());
+		remove(indexFile.c_str());
+
+		printf("\tIndex follows page changes\n");
+		boost::shared_ptr<CPdf> rwPdf=getTestCPdf(fileName.c_str());
+		if(rwPdf->getMode()==CPdf::ReadOnly)
+			return;
+		TextIndex rwIndex(rwPdf);
+		rwIndex.search(term, expected);
+		CPPUNIT_ASSERT(expected.size()==hits.size());
+
+		// page without contents has no text
+		boost::shared_ptr<CPage> page=rwPdf->getPage(termPage);
+		vector<boost::shared_ptr<CContentStream> > streams;
+		page->getContentStreams(streams);
+		for(size_t i=0; i<streams.size(); ++i)
+			page->removeContentStream(0);
+		rwIndex.search(term, hits);
+		for(TextIndex::Hits::iterator h=hits.begin(); h!=hits.end(); ++h)
+			CPPUNIT_ASSERT(h->page!=termPage);
+		CPPUNIT_ASSERT(hits.size()<expected.size());
+
+		// inserted page is indexed and following pages are moved
+		TextIndex::Hits changed=hits;
+		rwPdf->insertPage(pdf->getPage(termPage), 1);
+		rwIndex.search(term, hits);
+		CPPUNIT_ASSERT(!hits.empty() && hits.front().page==1);
+		for(TextIndex::Hits::iterator h=changed.begin(); h!=changed.end(); ++h)
+		{
+			bool moved=false;
+			for(TextIndex::Hits::iterator m=hits.begin(); m!=hits.end() && !moved; ++m)
+				moved=(m->page==h->page+1 && m->bbox==h->bbox);
+			CPPUNIT_ASSERT(moved);
+		}
+	}
+
+	void mmapTC(string fileName)
+	{
+		printf("%s\n", __FUNCTION__);
+
+		// memory mapped document has to provide the same content as the
+		// file stream one
+		boost::shared_ptr<CPdf> filePdf=getTestCPdf(fileName.c_str(), CPdf::ReadOnly);
+		boost::shared_ptr<CPdf> mappedPdf=CPdf::getInstance(fileName.c_str(), 
+				CPdf::ReadOnly, CPdf::DEFAULT_INDIRECT_CACHE_LIMIT, true);
+		CPPUNIT_ASSERT(filePdf->getRevisionsCount()==mappedPdf->getRevisionsCount());
+		CPPUNIT_ASSERT(filePdf->getPageCount()==mappedPdf->getPageCount());
+		for(size_t i=1; i<=filePdf->getPageCount(); ++i)
+		{
+			string fileText, mappedText;
+			filePdf->getPage(i)->getText(fileText);
+			mappedPdf->getPage(i)->getText(mappedText);
+			CPPUNIT_ASSERT(fileText==mappedText);
+		}
+
+		// mapping is ignored for other modes
+		boost::shared_ptr<CPdf> rwPdf=CPdf::getInstance(fileName.c_str(), 
+				CPdf::ReadWrite, CPdf::DEFAULT_INDIRECT_CACHE_LIMIT, true);
+		CPPUNIT_ASSERT(filePdf->getPageCount()==rwPdf->getPageCount());
+	}
+
 #define staticArraySize(array) sizeof(array)/sizeof(*array)
 	void changeTrailerTC(string& fname)
 	{
@@ -1351,10 +2116,22 @@ public:
 			pageManipulationTC(pdf);
 			linearizedTC(pdf);
 
+			indirectCacheTC(fileName);
+			releaseRefTC(fileName);
 			delinearizatorTC(fileName);
+			xrefStreamTC(fileName);
+			compressionPolicyTC(fileName);
+			pipelinedCompressionTC(fileName);
+			rawCopyTC(fileName);
+			mmapTC(fileName);
+			pageBatchTC(fileName);
+			transactionTC(fileName);
+			parallelPagesTC(fileName);
+			textIndexTC(fileName);
 			changeTrailerTC(fileName);
 		}
 		revisionsTC();
+		rawCopyKeywordsTC();
 		printf("TEST_CPDF testig finished\n");
 
 	}
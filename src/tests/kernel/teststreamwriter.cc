@@ -115,6 +115,70 @@ public:
 		// removes clone file
 		remove(cloneName.c_str());
 	}
+
+	void writeReadBackTC(string test_file)
+	{
+		printf("%s with file %s\n", __FUNCTION__, test_file.c_str());
+
+		// works on a copy so that the test file is not changed
+		FILE * in=fopen(test_file.c_str(), "rb");
+		if(!in)
+		{
+			printf("file: %s open error (reason=%s)\n", test_file.c_str(), strerror(errno));
+			return;
+		}
+		string copyName=test_file+"_write";
+		FILE * out=fopen(copyName.c_str(), "wb+");
+		if(!out)
+		{
+			printf("file: %s open error (reason=%s)\n", copyName.c_str(), strerror(errno));
+			fclose(in);
+			return;
+		}
+		char buffer[BUFSIZ];
+		size_t read;
+		while((read=fread(buffer, 1, sizeof(buffer), in))>0)
+			CPPUNIT_ASSERT(fwrite(buffer, 1, read, out)==read);
+		fclose(in);
+		fflush(out);
+
+		Object dict;
+		dict.initNull();
+		FileStreamWriter * streamWriter=new FileStreamWriter((GooFile*)out, 0, gFalse, 0, &dict, out);
+
+		printf("TC04:\tWritten data are read back from the file\n");
+		const char data[]="%PDFedit stream writer test";
+		size_t len=sizeof(data)-1;
+		streamWriter->setPos(0);
+		streamWriter->putBuffer(data, len);
+		CPPUNIT_ASSERT((size_t)streamWriter->getPos()==len);
+		streamWriter->putLine(data, len);
+		CPPUNIT_ASSERT((size_t)streamWriter->getPos()==2*len+1);
+		streamWriter->putChar('X');
+		CPPUNIT_ASSERT((size_t)streamWriter->getPos()==2*len+2);
+
+		FILE * check=fopen(copyName.c_str(), "rb");
+		CPPUNIT_ASSERT(check);
+		CPPUNIT_ASSERT(fread(buffer, 1, 2*len+2, check)==2*len+2);
+		CPPUNIT_ASSERT(!memcmp(buffer, data, len));
+		CPPUNIT_ASSERT(!memcmp(buffer+len, data, len));
+		CPPUNIT_ASSERT(buffer[2*len]=='\n');
+		CPPUNIT_ASSERT(buffer[2*len+1]=='X');
+
+		printf("TC05:\tWriter without output handle doesn't change the file\n");
+		FileStreamWriter * readOnlyWriter=new FileStreamWriter((GooFile*)out, 0, gFalse, 0, &dict);
+		readOnlyWriter->setPos(0);
+		readOnlyWriter->putBuffer("Y", 1);
+		CPPUNIT_ASSERT(readOnlyWriter->getPos()==0);
+		fseek(check, 0, SEEK_SET);
+		CPPUNIT_ASSERT(fgetc(check)==data[0]);
+
+		delete readOnlyWriter;
+		delete streamWriter;
+		fclose(check);
+		fclose(out);
+		remove(copyName.c_str());
+	}
 		
 	virtual ~TestStreamWriter()
 	{
@@ -137,6 +201,7 @@ public:
 					++i)
 		{
 			fileStreamWriterTC(*i);
+			writeReadBackTC(*i);
 		}
 	}
 };
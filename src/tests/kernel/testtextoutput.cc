@@ -67,6 +67,88 @@ bool text_cpageout (UNUSED_PARAM std::ostream& oss,
 }
 
 
+//=====================================================================================
+
+/** Words with given bboxes. */
+struct TestWordEngine
+{
+	typedef SimpleWordEngine::PageFragments::const_iterator Iterator;
+	SimpleWordEngine::PageFragments words;
+
+	void add (const libs::Rectangle& bbox)
+	{
+		shared_ptr<PageSimpleFragment> sfrag (new PageSimpleFragment);
+		sfrag->add (bbox);
+		shared_ptr<PageWord> word (new PageWord);
+		word->push_back (sfrag);
+		words.push_back (word);
+	}
+	Iterator begin () const { return words.begin(); }
+	Iterator end () const { return words.end(); }
+};
+
+/** Lines built by trying every line in order (original line engine). */
+void
+reference_lines (const TestWordEngine& w, SimpleLineEngine::PageLines& lines)
+{
+	typedef libs::Rectangle BBox;
+	for (TestWordEngine::Iterator itw = w.begin(); itw != w.end(); ++itw)
+	{
+		SimpleLineEngine::PageLines::iterator itl = lines.begin();
+		bool is_part = false;
+		for (; itl != lines.end(); ++itl)
+		{
+			BBox b1 = (*itl)->bbox();
+			BBox b2 = (*itw)->bbox();
+			// next line
+			if ((b1.yleft > b1.yright) ? (b1.yright > max (b2.yleft, b2.yright)) : (b1.yleft < min (b2.yleft, b2.yright)))
+				break;
+			b2.xleft = b1.xleft;
+			b2.xright = b1.xright;
+			if (BBox::isInitialized (libs::rectangle_intersect (b1,b2)))
+			{
+				is_part = true;
+				break;
+			}
+		}
+		if (!is_part)
+			itl = lines.insert (itl, shared_ptr<PageLine> (new PageLine));
+		(*itl)->push_back (*itw);
+	}
+}
+
+bool
+line_engine (UNUSED_PARAM std::ostream& oss)
+{
+	srand (1);
+	for (size_t i = 0; i < 100; ++i)
+	{
+		// words in the reading order, in random order and some tall ones
+		TestWordEngine w;
+		bool flip = (1 == i % 2);
+		for (size_t j = 0; j < 2000; ++j)
+		{
+			double x = 25 * (j % 20);
+			double y = (i % 4 < 2) ? 10000 - 10 * (j / 20) : rand() % 1000;
+			double h = (0 == rand() % 50) ? rand() % 100 : 8;
+			w.add (flip ? libs::Rectangle (x, y + h, x + 20, y) : libs::Rectangle (x, y, x + 20, y + h));
+		}
+
+		SimpleLineEngine::PageLines expected;
+		reference_lines (w, expected);
+		SimpleLineEngine lines;
+		lines (w);
+
+		CPPUNIT_ASSERT_EQUAL (expected.size(), (size_t) std::distance (lines.begin(), lines.end()));
+		SimpleLineEngine::Iterator it = lines.begin();
+		for (SimpleLineEngine::PageLines::const_iterator e = expected.begin(); e != expected.end(); ++e, ++it)
+			CPPUNIT_ASSERT (std::equal ((*e)->begin(), (*e)->end(), (*it)->begin()));
+	}
+
+	return true;
+}
+
+
 //=========================================================================
 // class TestTextOutput
 //=========================================================================
@@ -75,6 +157,7 @@ class TestTextOutput : public CppUnit::TestFixture
 {
 	CPPUNIT_TEST_SUITE(TestTextOutput);
 		CPPUNIT_TEST(test_cpageout);
+		CPPUNIT_TEST(test_lineengine);
 	CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -99,6 +182,16 @@ public:
 		}
 	}
 
+	//
+	//
+	//
+	void test_lineengine ()
+	{
+		TEST(" line engine");
+		CPPUNIT_ASSERT (line_engine (OUTPUT));
+		OK_TEST;
+	}
+
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION(TestTextOutput);
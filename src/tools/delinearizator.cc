@@ -35,14 +35,19 @@ using namespace pdfobjects::utils;
 using namespace boost;
 namespace po = program_options;
 
-int delinearize(const char *input, const char *output)
+int delinearize(const char *input, const char *output, bool xrefStream, size_t threads,
+		const CompressionPolicy &policy, bool rawCopy)
 {
 	Object dict;
 	dict.initNull();
+	IPdfWriter * writer = createPdfWriter(xrefStream);
+	writer->setCompressionThreads(threads);
+	writer->setCompressionPolicy(policy);
 	boost::shared_ptr<Delinearizator> del = 
-		Delinearizator::getInstance(input, new OldStylePdfWriter());
+		Delinearizator::getInstance(input, writer);
 	if (!del) 
 		return 1;
+	del->setRawCopy(rawCopy);
 	int ret = del->delinearize(output);
 	return ret;
 }
@@ -61,6 +66,12 @@ int main(int argc, char ** argv)
 		("help", "produce help message")
 		("file", po::value<string>(), "Input pdf file")
 		("output", po::value<string>(), "Output pdf file")
+		("xref-stream", "Use compressed object streams and xref stream (PDF 1.5)")
+		("threads", po::value<size_t>()->default_value(1), "Number of stream compression threads")
+		("level", po::value<int>()->default_value(-1), "Zlib compression level (0 keeps streams as they are)")
+		("store-below", po::value<size_t>()->default_value(0), "Keep streams smaller than given size as they are")
+		("passthrough", "Keep unchanged streams with their original encoding")
+		("raw-copy", "Copy unchanged objects byte by byte from the input file")
 	;
 	
 	po::variables_map vm;
@@ -82,7 +93,11 @@ int main(int argc, char ** argv)
 	string input_file = vm["file"].as<string>(); 
 	string output_file = vm["output"].as<string>();
 
-	ret = delinearize(input_file.c_str(), output_file.c_str());
+	ret = delinearize(input_file.c_str(), output_file.c_str(), vm.count("xref-stream")>0,
+			vm["threads"].as<size_t>(), 
+			CompressionPolicy(vm["level"].as<int>(), vm["store-below"].as<size_t>(), 
+				vm.count("passthrough")>0), 
+			vm.count("raw-copy")>0);
 
 	pdfedit_core_dev_destroy();
 	return ret;
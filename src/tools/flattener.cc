@@ -21,6 +21,8 @@
  *
  * Project is hosted on http://sourceforge.net/projects/pdfedit
  */
+#include <string.h>
+#include <stdlib.h>
 #include "kernel/pdfedit-core-dev.h"
 #include "kernel/flattener.h"
 #include "kernel/pdfwriter.h"
@@ -28,15 +30,20 @@
 
 using namespace pdfobjects;
 #define suffix ".flatten"
-int flatten_file(const char *fname)
+int flatten_file(const char *fname, bool xrefStream, size_t threads, 
+		const utils::CompressionPolicy &policy, bool rawCopy)
 {
 using namespace utils;
+	IPdfWriter * writer = createPdfWriter(xrefStream);
+	writer->setCompressionThreads(threads);
+	writer->setCompressionPolicy(policy);
 	boost::shared_ptr<utils::Flattener> flattener = 
-		Flattener::getInstance(fname, new OldStylePdfWriter()); 
+		Flattener::getInstance(fname, writer); 
 	if(!flattener) {
 		std::cerr << "Unable to open "<<fname<<" file"<<std::endl;
 		return 1;
 	}
+	flattener->setRawCopy(rawCopy);
 	std::string outputFile(fname);
 	outputFile+=suffix;
 	std::cout << "Writing output to "<<outputFile<<std::endl;
@@ -52,12 +59,47 @@ int main(int argc, char** argv)
 	}
 	//debug::changeDebugLevel(debug::utilsDebugTarget, debug::DBG_DBG);
 	int ret = 0;
+	bool xrefStream = false;
+	size_t threads = 1;
+	utils::CompressionPolicy policy;
+	bool rawCopy = false;
 	for(int i=1; i<argc; ++i)
 	{
 		const char *fname= argv[i];
+		// options apply to all following files
+		if(!strcmp(fname, "--xref-stream"))
+		{
+			xrefStream = true;
+			continue;
+		}
+		if(!strncmp(fname, "--threads=", strlen("--threads=")))
+		{
+			threads = atoi(fname + strlen("--threads="));
+			continue;
+		}
+		if(!strncmp(fname, "--level=", strlen("--level=")))
+		{
+			policy.level = atoi(fname + strlen("--level="));
+			continue;
+		}
+		if(!strncmp(fname, "--store-below=", strlen("--store-below=")))
+		{
+			policy.storeThreshold = atoi(fname + strlen("--store-below="));
+			continue;
+		}
+		if(!strcmp(fname, "--passthrough"))
+		{
+			policy.passthrough = true;
+			continue;
+		}
+		if(!strcmp(fname, "--raw-copy"))
+		{
+			rawCopy = true;
+			continue;
+		}
 		try
 		{
-			ret = flatten_file(fname);
+			ret = flatten_file(fname, xrefStream, threads, policy, rawCopy);
 		}catch(...)
 		{
 			std::cerr << fname << " is not a valid pdf document - ignoring"<<std::endl;
@@ -25,6 +25,7 @@
 #include <kernel/cpdf.h>
 #include <kernel/cpage.h>
 #include <kernel/delinearizator.h>
+#include <kernel/parallelpages.h>
 #include <boost/program_options.hpp>
 #include <vector>
 
@@ -39,6 +40,7 @@ namespace {
 	const string DEFAULT_ENCODING( "UTF-8" );
 	const bool DEFAULT_OUTPUT_PAGES = false;
 	const string DEFAULT_FONT_DIR( "." );
+	const size_t DEFAULT_THREADS = 0;
 
 	// pages
 	typedef vector<size_t> Pages;
@@ -54,7 +56,7 @@ namespace {
 	};
 	// what to do with a page
 	struct _textify {
-		string operator () (shared_ptr<CPage> page, const string& encoding)
+		string operator () (shared_ptr<CPage> page)
 		{
 			// Update display params to use media box not default page rect (DEFAULT_PAGE_RX, DEFAULT_PAGE_RY)
 			// TODO upsidedown? get/set
@@ -64,11 +66,28 @@ namespace {
 			dp.rotate = page->getRotation ();
 			page->setDisplayParams (dp);
 
+			// encoding is set globally before workers start
 			string text;
-			page->getText( text, &encoding );
+			page->getText( text );
 			return text;
 		}
 	};
+	// pages are textified by parallel workers
+	struct _textify_processor : public PageProcessor {
+		virtual void process (shared_ptr<CPage> page, size_t, string& result)
+			{ result = _textify()(page); }
+	};
+	// and written out in the page order
+	struct _text_writer : public PageSink {
+		bool _output_pages;
+		_text_writer (bool output_pages) : _output_pages (output_pages) {}
+		virtual void consume (size_t pos, const string& text)
+		{
+			if (_output_pages)
+				std::cout << "\nPage " << pos << ":\n";
+			std::cout << text;
+		}
+	};
 }
 
 int 
@@ -85,6 +104,7 @@ main(int argc, char ** argv)
 		("output-pages", po::value<bool>()->default_value(DEFAULT_OUTPUT_PAGES), "output page number before each page")
 		("encoding", po::value<string>()->default_value(DEFAULT_ENCODING), "encoding to use")
 		("font-dir", po::value<string>()->default_value(DEFAULT_FONT_DIR), "(xpdf) font directory with font definitions(e.g. N019003L.PFB)")
+		("threads", po::value<size_t>()->default_value(DEFAULT_THREADS), "number of worker threads (0 for number of processors)")
 	;
 
 	po::variables_map vm;
@@ -106,6 +126,7 @@ main(int argc, char ** argv)
 	bool output_pages = vm["output-pages"].as<bool>(); 
 	string encoding = vm["encoding"].as<string>(); 
 	string font_dir = vm["font-dir"].as<string>(); 
+	size_t threads = vm["threads"].as<size_t>(); 
 	
 	Pages pages;
 	if (vm.count("what"))
@@ -117,36 +138,35 @@ main(int argc, char ** argv)
 		_pdf_lib _lib(argc, argv, font_dir);
 			if (!_lib._ok)
 				return 1;
+		// global parameters are shared by all workers
+		globalParams->setTextEncoding (const_cast<char*>(encoding.c_str()));
 
-		// open pdf
-		shared_ptr<CPdf> pdf = CPdf::getInstance (file.c_str(), CPdf::ReadWrite);
+		// each worker opens its own pdf instance
+		ParallelPages parallel (file, threads);
+		size_t count = parallel.getPageCount ();
 
+		Pages todo;
 		if (pages.empty())
 		{
-			for (size_t i = 1; i <= pdf->getPageCount(); ++i)
-			{
-				shared_ptr<CPage> page = pdf->getPage(i);
-				if (output_pages)
-					std::cout << "\nPage " << i << ":\n";
-				std::cout << _textify()(page, encoding);
-			}
+			for (size_t i = 1; i <= count; ++i)
+				todo.push_back (i);
 		}
 		
 		// do it for selected pages
 		for (Pages::const_iterator it = pages.begin(); it != pages.end(); ++it)
 		{
-				if (*it > pdf->getPageCount())
+				if (*it > count)
 				{
 					cout << "Invalid page number! " << endl << desc << endl;
 					continue;
 				}
-
-			shared_ptr<CPage> page = pdf->getPage(*it);
-			if (output_pages)
-				std::cout << "\nPage " << *it << ":\n";
-			std::cout << _textify()(page, encoding);
+			todo.push_back (*it);
 		}
 
+		_textify_processor processor;
+		_text_writer writer (output_pages);
+		parallel.process (processor, todo, writer);
+
 	}catch (std::exception& e)
 	{
 		std::cout << "exception - " << e.what();
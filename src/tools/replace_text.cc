@@ -59,9 +59,9 @@ namespace {
 
 	struct _replace {
 		static const string name;
-		void operator () (shared_ptr<CPage> page, const string& what, const string& with)
+		size_t operator () (shared_ptr<CPage> page, const CContentStream::TextReplacements& replacements)
 		{
-			page->replaceText (what, with);
+			return page->replaceText (replacements);
 		}
 	};
 	const string _replace::name ("replace");
@@ -79,8 +79,9 @@ main(int argc, char ** argv)
 		("file", po::value<string>(), "file")
 		("from", po::value<size_t>()->default_value(1), "start page (default 0)")
 		("to", po::value<size_t>(), "end page (default till the end of file)")
-		("what", po::value<vector<string> >(), "what to replace")
+		("what", po::value<vector<string> >(), "what to replace (each text at most once, all texts are replaced in one pass, so replacements don't chain)")
 		("with", po::value<vector<string> >(), "with what")
+		("verbose", "print number of changed text operators")
 	;
 
 	po::variables_map vm;
@@ -107,6 +108,15 @@ main(int argc, char ** argv)
 			cout << desc << endl;
 			return 1;
 		}
+	// all replacements are done in one pass through each page
+	CContentStream::TextReplacements replacements;
+	for (size_t things_to_replace = 0; things_to_replace < withs.size(); ++things_to_replace)
+		if (!replacements.insert (make_pair (whats[things_to_replace], withs[things_to_replace])).second)
+		{
+			cout << "Text \"" << whats[things_to_replace] << "\" is replaced more times." << endl << desc << endl;
+			return 1;
+		}
+	bool verbose = (0 != vm.count("verbose"));
 	size_t to = numeric_limits<size_t>::max();
 	if (vm.count("to")) 
 		to = vm["to"].as<size_t>();
@@ -139,24 +149,20 @@ main(int argc, char ** argv)
 		// sane values
 		to = std::min(static_cast<unsigned int>(to), pdf->getPageCount()+1);
 
-		// now the hard stuff comes - do this crazy loops intentionally
-		for (size_t things_to_replace = 0; things_to_replace < withs.size(); ++things_to_replace)
+		#ifdef WIN32
+		DWORD time = ::GetTickCount ();
+		#endif
+		size_t changed = 0;
+		for (size_t i = from; i < to; ++i)
 		{
-			#ifdef WIN32
-			DWORD time = ::GetTickCount ();
-			#endif
-
-			string what = whats[things_to_replace];
-			string with = withs[things_to_replace];
-			for (size_t i = from; i < to; ++i)
-			{
-				shared_ptr<CPage> page = pdf->getPage(i);
-				_replace()(page, what, with);
-			}
-			#ifdef WIN32
-			cout << "time passed:" << ::GetTickCount()-time << endl;
-			#endif
+			shared_ptr<CPage> page = pdf->getPage(i);
+			changed += _replace()(page, replacements);
 		}
+		#ifdef WIN32
+		cout << "time passed:" << ::GetTickCount()-time << endl;
+		#endif
+		if (verbose)
+			cout << "changed text operators: " << changed << endl;
 
 		pdf->save ();
 	
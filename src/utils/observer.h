@@ -633,6 +633,15 @@ public:
 			throw ObserverException ();
 	}
 
+	/** Checks whether there is at least one registered observer.
+	 *
+	 * @return true if observers list is not empty, false otherwise.
+	 */
+	bool hasObservers()const
+	{
+		return !observers.empty();
+	}
+
 	/**
 	 * Notify all active observers about a change.
 	 *